@@ -273,6 +273,71 @@ uint16_t fifoBuf_putData(t_fifo_buffer *buf, const void *data, uint16_t len)
     return i; // return number of bytes copied
 }
 
+uint16_t fifoBuf_reserve(t_fifo_buffer *buf, t_fifo_span *span, uint16_t len)
+{ // get space for data at the write position, the data is only added by fifoBuf_commit()
+    uint16_t wr = buf->wr;
+    uint16_t buf_size = buf->buf_size;
+    uint8_t *buff     = buf->buf_ptr;
+
+    if (len < 1 || fifoBuf_getFree(buf) < len) {
+        return 0; // all or nothing
+    }
+
+    uint16_t block_len = buf_size - wr;
+    if (block_len > len) {
+        block_len = len;
+    }
+
+    span->ptr[0] = buff + wr;
+    span->len[0] = block_len;
+    span->ptr[1] = buff;
+    span->len[1] = len - block_len;
+
+    return len; // return number of bytes reserved
+}
+
+void fifoBuf_commit(t_fifo_buffer *buf, uint16_t len)
+{ // add the data written to the reserved space to the buffer
+    uint16_t wr = buf->wr;
+    uint16_t buf_size = buf->buf_size;
+
+    wr += len;
+    if (wr >= buf_size) {
+        wr -= buf_size;
+    }
+
+    buf->wr = wr;
+}
+
+void fifoBuf_spanSlice(const t_fifo_span *span, uint16_t offset, uint16_t len, t_fifo_span *slice)
+{ // get the part of a reserved span that starts at offset
+    if (offset < span->len[0]) {
+        uint16_t block_len = span->len[0] - offset;
+        if (block_len > len) {
+            block_len = len;
+        }
+        slice->ptr[0] = span->ptr[0] + offset;
+        slice->len[0] = block_len;
+        slice->ptr[1] = span->ptr[1];
+        slice->len[1] = len - block_len;
+    } else {
+        slice->ptr[0] = span->ptr[1] + (offset - span->len[0]);
+        slice->len[0] = len;
+        slice->ptr[1] = span->ptr[1];
+        slice->len[1] = 0;
+    }
+}
+
+void fifoBuf_spanWrite(const t_fifo_span *span, uint16_t offset, const void *data, uint16_t len)
+{ // copy data to a reserved span, starting at offset
+    t_fifo_span slice;
+    const uint8_t *p = (const uint8_t *)data;
+
+    fifoBuf_spanSlice(span, offset, len, &slice);
+    memcpy(slice.ptr[0], p, slice.len[0]);
+    memcpy(slice.ptr[1], p + slice.len[0], slice.len[1]);
+}
+
 void fifoBuf_init(t_fifo_buffer *buf, const void *buffer, const uint16_t buffer_size)
 {
     buf->buf_ptr  = (uint8_t *)buffer;
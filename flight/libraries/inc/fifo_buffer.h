@@ -37,6 +37,12 @@ typedef struct {
     uint16_t buf_size;
 } t_fifo_buffer;
 
+// Buffer space handed out by fifoBuf_reserve(), in two parts when it wraps around the end of the buffer
+typedef struct {
+    uint8_t  *ptr[2];
+    uint16_t len[2];
+} t_fifo_span;
+
 // *********************
 
 uint16_t fifoBuf_getSize(t_fifo_buffer *buf);
@@ -57,6 +63,12 @@ uint16_t fifoBuf_putByte(t_fifo_buffer *buf, const uint8_t b);
 
 uint16_t fifoBuf_putData(t_fifo_buffer *buf, const void *data, uint16_t len);
 
+uint16_t fifoBuf_reserve(t_fifo_buffer *buf, t_fifo_span *span, uint16_t len);
+void fifoBuf_commit(t_fifo_buffer *buf, uint16_t len);
+
+void fifoBuf_spanSlice(const t_fifo_span *span, uint16_t offset, uint16_t len, t_fifo_span *slice);
+void fifoBuf_spanWrite(const t_fifo_span *span, uint16_t offset, const void *data, uint16_t len);
+
 void fifoBuf_init(t_fifo_buffer *buf, const void *buffer, const uint16_t buffer_size);
 
 // *********************
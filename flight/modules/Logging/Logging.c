@@ -37,18 +37,42 @@
 #include "debuglogentry.h"
 #include "flightstatus.h"
 
+// entries sent per RetrieveStream request
+#define STREAM_MAX_ENTRIES   8
+// DebugLogEntry instances the streamed entries take turns in, an entry stays
+// untouched for STREAM_INSTANCES periods while telemetry sends it
+#define STREAM_INSTANCES     2
+#define STREAM_PERIOD_MS     20
+#define STREAM_STACK_SIZE    640
+#define CALLBACK_PRIORITY    CALLBACK_PRIORITY_LOW
+#define CBTASK_PRIORITY      CALLBACK_TASK_AUXILIARY
+
+// private types
+// A RetrieveStream request, written by the event dispatcher and consumed by the stream callback under streamLock
+struct StreamRequest {
+    uint16_t flight;
+    uint16_t next;
+    uint16_t end;
+    uint8_t  id; // changes with every request, so an outdated read does not end the new one
+};
+
 // private variables
 static DebugLogSettingsData settings;
 static DebugLogControlData control;
 static DebugLogStatusData status;
 static FlightStatusData flightstatus;
 static DebugLogEntryData *entry; // would be better on stack but event dispatcher stack might be insufficient
+static DebugLogEntryData *streamEntry;
+static DelayedCallbackInfo *streamCallback;
+static struct StreamRequest stream;
+static xSemaphoreHandle streamLock;
 
 // private functions
 static void SettingsUpdatedCb(UAVObjEvent *ev);
 static void ControlUpdatedCb(UAVObjEvent *ev);
 static void StatusUpdatedCb(UAVObjEvent *ev);
 static void FlightStatusUpdatedCb(UAVObjEvent *ev);
+static void StreamEntries(void);
 
 int32_t LoggingInitialize(void)
 {
@@ -58,10 +82,18 @@ int32_t LoggingInitialize(void)
     DebugLogEntryInitialize();
     FlightStatusInitialize();
     PIOS_DEBUGLOG_Initialize();
-    entry = pios_malloc(sizeof(DebugLogEntryData));
-    if (!entry) {
+    entry       = pios_malloc(sizeof(DebugLogEntryData));
+    streamEntry = pios_malloc(sizeof(DebugLogEntryData));
+    streamLock  = xSemaphoreCreateMutex();
+    if (!entry || !streamEntry || !streamLock) {
         return -1;
     }
+    for (uint16_t i = UAVObjGetNumInstances(DebugLogEntryHandle()); i < STREAM_INSTANCES; i++) {
+        if (!DebugLogEntryCreateInstance()) {
+            return -1;
+        }
+    }
+    streamCallback = PIOS_CALLBACKSCHEDULER_Create(&StreamEntries, CALLBACK_PRIORITY, CBTASK_PRIORITY, CALLBACKINFO_RUNNING_LOGGING, STREAM_STACK_SIZE);
 
     return 0;
 }
@@ -90,6 +122,7 @@ MODULE_INITCALL(LoggingInitialize, LoggingStart);
 static void StatusUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
 {
     PIOS_DEBUGLOG_Info(&status.Flight, &status.Entry, &status.FreeSlots, &status.UsedSlots);
+    PIOS_DEBUGLOG_Throughput(&status.BytesPerSecond, &status.DroppedRecords);
     DebugLogStatusSet(&status);
 }
 
@@ -133,6 +166,15 @@ static void ControlUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
             entry->Type   = DEBUGLOGENTRY_TYPE_EMPTY;
         }
         DebugLogEntrySet(entry);
+    } else if (control.Operation == DEBUGLOGCONTROL_OPERATION_RETRIEVESTREAM) {
+        // the flash reads happen in the stream callback, a new request replaces the running one
+        xSemaphoreTake(streamLock, portMAX_DELAY);
+        stream.flight = control.Flight;
+        stream.next   = control.Entry;
+        stream.end    = control.Entry + MIN(MAX(control.Count, 1), STREAM_MAX_ENTRIES);
+        stream.id++;
+        xSemaphoreGive(streamLock);
+        PIOS_CALLBACKSCHEDULER_Dispatch(streamCallback);
     } else if (control.Operation == DEBUGLOGCONTROL_OPERATION_FORMATFLASH) {
         uint8_t armed;
         FlightStatusArmedGet(&armed);
@@ -143,6 +185,45 @@ static void ControlUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
     StatusUpdatedCb(ev);
 }
 
+/**
+ * Sends the next entry of a RetrieveStream request, one flash read per run
+ */
+static void StreamEntries(void)
+{
+    struct StreamRequest request;
+
+    // take the entry to send from the request, the flash is read without holding the lock
+    xSemaphoreTake(streamLock, portMAX_DELAY);
+    request = stream;
+    if (stream.next != stream.end) {
+        stream.next++;
+    }
+    xSemaphoreGive(streamLock);
+    if (request.next == request.end) {
+        return;
+    }
+
+    memset(streamEntry, 0, sizeof(DebugLogEntryData));
+    bool last = PIOS_DEBUGLOG_Read(streamEntry, request.flight, request.next) != 0;
+    if (last) {
+        streamEntry->Flight = request.flight;
+        streamEntry->Entry  = request.next;
+        streamEntry->Type   = DEBUGLOGENTRY_TYPE_EMPTY;
+        // past the end of the flight, unless a new request came in meanwhile
+        xSemaphoreTake(streamLock, portMAX_DELAY);
+        if (stream.id == request.id) {
+            stream.end = stream.next;
+        }
+        xSemaphoreGive(streamLock);
+    }
+    // the telemetry queue only holds the instance, give it time to send the entry before it is reused
+    DebugLogEntryInstSet(request.next % STREAM_INSTANCES, streamEntry);
+    DebugLogEntryInstUpdated(request.next % STREAM_INSTANCES);
+    if (!last) {
+        PIOS_CALLBACKSCHEDULER_Schedule(streamCallback, STREAM_PERIOD_MS, CALLBACK_UPDATEMODE_NONE);
+    }
+}
+
 
 /**
  * @}
@@ -84,6 +84,7 @@ void stabilizationInnerloopInit()
     ManualControlCommandInitialize();
     StabilizationDesiredInitialize();
     ActuatorDesiredInitialize();
+    UAVObjEnableSeqLock(ActuatorDesiredHandle());
 #ifdef REVOLUTION
     AirspeedStateInitialize();
     AirspeedStateConnectCallback(AirSpeedUpdatedCb);
@@ -287,21 +287,27 @@ int32_t StateEstimationInitialize(void)
     AccelStateInitialize();
     MagStateInitialize();
     AirspeedStateInitialize();
+    AttitudeStateInitialize();
     PositionStateInitialize();
     VelocityStateInitialize();
 
+    // Read at loop rate by several modules, let them read without the object manager lock
+    UAVObjEnableSeqLock(GyroStateHandle());
+    UAVObjEnableSeqLock(AttitudeStateHandle());
+
     RevoSettingsConnectCallback(&settingsUpdatedCb);
 
     HomeLocationConnectCallback(&homeLocationUpdatedCb);
 
-    GyroSensorConnectCallback(&sensorUpdatedCb);
-    AccelSensorConnectCallback(&sensorUpdatedCb);
-    MagSensorConnectCallback(&sensorUpdatedCb);
-    BaroSensorConnectCallback(&sensorUpdatedCb);
-    AirspeedSensorConnectCallback(&sensorUpdatedCb);
-    AuxMagSensorConnectCallback(&sensorUpdatedCb);
-    GPSVelocitySensorConnectCallback(&sensorUpdatedCb);
-    GPSPositionSensorConnectCallback(&sensorUpdatedCb);
+    // sensorUpdatedCb() only works on the latest sensor data, pending updates can be merged
+    GyroSensorConnectCallbackCoalesced(&sensorUpdatedCb);
+    AccelSensorConnectCallbackCoalesced(&sensorUpdatedCb);
+    MagSensorConnectCallbackCoalesced(&sensorUpdatedCb);
+    BaroSensorConnectCallbackCoalesced(&sensorUpdatedCb);
+    AirspeedSensorConnectCallbackCoalesced(&sensorUpdatedCb);
+    AuxMagSensorConnectCallbackCoalesced(&sensorUpdatedCb);
+    GPSVelocitySensorConnectCallbackCoalesced(&sensorUpdatedCb);
+    GPSPositionSensorConnectCallbackCoalesced(&sensorUpdatedCb);
 
     uint32_t stack_required = STACK_SIZE_BYTES;
     // Initialize Filters
@@ -56,6 +56,7 @@
 #include <taskinfo.h>
 #include <watchdogstatus.h>
 #include <callbackinfo.h>
+#include <callbacktiming.h>
 #include <hwsettings.h>
 #include <pios_flashfs.h>
 #include <pios_notify.h>
@@ -84,6 +85,10 @@
 // Private constants
 #define SYSTEM_UPDATE_PERIOD_MS 250
 
+// Flash garbage collection runs while disarmed, a sector erase can take a second
+#define FLASH_GC_PERIOD_MS      1000
+#define FLASH_GC_STACK_SIZE     512
+
 #if defined(PIOS_SYSTEM_STACK_SIZE)
 #define STACK_SIZE_BYTES        PIOS_SYSTEM_STACK_SIZE
 #else
@@ -102,6 +107,9 @@ static bool mallocFailed;
 static HwSettingsData bootHwSettings;
 static FrameType_t bootFrameType;
 static struct PIOS_FLASHFS_Stats fsStats;
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INCREMENTAL_GC
+static DelayedCallbackInfo *flashGCCallback;
+#endif
 
 // Private functions
 static void objectUpdatedCb(UAVObjEvent *ev);
@@ -113,6 +121,9 @@ static void callbackSchedulerForEachCallback(int16_t callback_id, const struct p
 static void updateStats();
 static void updateSystemAlarms();
 static void systemTask(void *parameters);
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INCREMENTAL_GC
+static void flashGarbageCollect(void);
+#endif
 #ifdef DIAG_I2C_WDG_STATS
 static void updateI2Cstats();
 static void updateWDGstats();
@@ -152,6 +163,7 @@ int32_t SystemModInitialize(void)
 #ifdef DIAG_TASKS
     TaskInfoInitialize();
     CallbackInfoInitialize();
+    CallbackTimingInitialize();
 #endif
 #ifdef DIAG_I2C_WDG_STATS
     I2CStatsInitialize();
@@ -167,6 +179,14 @@ int32_t SystemModInitialize(void)
         return -1;
     }
 
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INCREMENTAL_GC
+    // Erase and compact flash ahead of time so object saves don't have to
+    flashGCCallback = PIOS_CALLBACKSCHEDULER_Create(&flashGarbageCollect, CALLBACK_PRIORITY_LOW, CALLBACK_TASK_AUXILIARY, CALLBACKINFO_RUNNING_FLASHGC, FLASH_GC_STACK_SIZE);
+    if (flashGCCallback) {
+        PIOS_CALLBACKSCHEDULER_Schedule(flashGCCallback, FLASH_GC_PERIOD_MS, CALLBACK_UPDATEMODE_NONE);
+    }
+#endif
+
     SystemModStart();
 
     return 0;
@@ -445,6 +465,21 @@ static void callbackSchedulerForEachCallback(int16_t callback_id, const struct p
     ((uint8_t *)&callbackData->Running)[callback_id] = callback_info->is_running;
     ((uint32_t *)&callbackData->RunningTime)[callback_id]   = callback_info->running_time_count;
     ((int16_t *)&callbackData->StackRemaining)[callback_id] = callback_info->stack_remaining;
+
+    // The CallbackTiming instance ID is the callback_id, instances are added as callbacks report in
+    while (UAVObjGetNumInstances(CallbackTimingHandle()) <= callback_id) {
+        if (CallbackTimingCreateInstance() == 0) {
+            return;
+        }
+    }
+    CallbackTimingData timingData;
+    timingData.ExecTimeMax = callback_info->exec_time_max;
+    timingData.LatencyMax  = callback_info->latency_max;
+    PIOS_STATIC_ASSERT(sizeof(timingData.ExecTime) == sizeof(callback_info->exec_time_histogram));
+    PIOS_STATIC_ASSERT(sizeof(timingData.Latency) == sizeof(callback_info->latency_histogram));
+    memcpy(&timingData.ExecTime, callback_info->exec_time_histogram, sizeof(timingData.ExecTime));
+    memcpy(&timingData.Latency, callback_info->latency_histogram, sizeof(timingData.Latency));
+    CallbackTimingInstSet(callback_id, &timingData);
 }
 #endif /* ifdef DIAG_TASKS */
 
@@ -544,11 +579,13 @@ static void updateStats()
         PIOS_FLASHFS_GetStats(pios_uavo_settings_fs_id, &fsStats);
         stats.SysSlotsFree   = fsStats.num_free_slots;
         stats.SysSlotsActive = fsStats.num_active_slots;
+        stats.SysFlashBlockingMax = fsStats.max_blocking_time;
     }
     if (pios_user_fs_id) {
         PIOS_FLASHFS_GetStats(pios_user_fs_id, &fsStats);
         stats.UsrSlotsFree   = fsStats.num_free_slots;
         stats.UsrSlotsActive = fsStats.num_active_slots;
+        stats.UsrFlashBlockingMax = fsStats.max_blocking_time;
     }
 #endif
     stats.CPULoad = 100 - PIOS_TASK_MONITOR_GetIdlePercentage();
@@ -630,6 +667,30 @@ static void updateSystemAlarms()
     }
 }
 
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INCREMENTAL_GC
+/**
+ * Run one garbage collection step on each filesystem, then wait for the next period.
+ * A step erases at most one sector, which blocks the flash for up to a second on the
+ * external JEDEC flash and stalls the CPU on the internal one. It is only taken while
+ * disarmed, in flight the saves collect the garbage they need themselves.
+ */
+static void flashGarbageCollect(void)
+{
+    uint8_t armed;
+
+    FlightStatusArmedGet(&armed);
+    if (armed == FLIGHTSTATUS_ARMED_DISARMED) {
+        if (pios_uavo_settings_fs_id) {
+            PIOS_FLASHFS_GarbageCollectStep(pios_uavo_settings_fs_id);
+        }
+        if (pios_user_fs_id) {
+            PIOS_FLASHFS_GarbageCollectStep(pios_user_fs_id);
+        }
+    }
+    PIOS_CALLBACKSCHEDULER_Schedule(flashGCCallback, FLASH_GC_PERIOD_MS, CALLBACK_UPDATEMODE_NONE);
+}
+#endif /* ifdef PIOS_INCLUDE_FLASH_LOGFS_INCREMENTAL_GC */
+
 /**
  * Called by the RTOS when the CPU is idle,
  */
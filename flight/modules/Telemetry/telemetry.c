@@ -63,6 +63,7 @@
 #define MAX_RETRIES               2
 #define STATS_UPDATE_PERIOD_MS    4000
 #define CONNECTION_TIMEOUT_MS     8000
+#define RX_BUFFER_SIZE            16
 
 // Private types
 
@@ -91,6 +92,12 @@ static UAVTalkConnection uavTalkCon;
 #ifdef PIOS_INCLUDE_RFM22B
 static UAVTalkConnection radioUavTalkCon;
 #endif
+// Port holding the space reserved by each connection until the commit,
+// only used under the lock of the connection
+static uint32_t reservedPort;
+#ifdef PIOS_INCLUDE_RFM22B
+static uint32_t radioReservedPort;
+#endif
 
 // Private functions
 static void telemetryTxTask(void *parameters);
@@ -98,8 +105,12 @@ static void telemetryRxTask(void *parameters);
 #ifdef PIOS_INCLUDE_RFM22B
 static void radioRxTask(void *parameters);
 static int32_t transmitRadioData(uint8_t *data, int32_t length);
+static int32_t reserveRadioData(t_fifo_span *span, uint16_t length);
+static int32_t commitRadioData(uint16_t length);
 #endif
 static int32_t transmitData(uint8_t *data, int32_t length);
+static int32_t reserveData(t_fifo_span *span, uint16_t length);
+static int32_t commitData(uint16_t length);
 static void registerObject(UAVObjHandle obj);
 static void updateObject(UAVObjHandle obj, int32_t eventType);
 static int32_t setUpdatePeriod(UAVObjHandle obj, int32_t updatePeriodMs);
@@ -165,9 +176,9 @@ int32_t TelemetryInitialize(void)
     updateSettings();
 
     // Initialise UAVTalk
-    uavTalkCon = UAVTalkInitialize(&transmitData);
+    uavTalkCon = UAVTalkInitializeReserve(&reserveData, &commitData, &transmitData);
 #ifdef PIOS_INCLUDE_RFM22B
-    radioUavTalkCon = UAVTalkInitialize(&transmitRadioData);
+    radioUavTalkCon = UAVTalkInitializeReserve(&reserveRadioData, &commitRadioData, &transmitRadioData);
 #endif
 
     // Create periodic event that will be used to update the telemetry stats
@@ -406,11 +417,19 @@ static void telemetryTxTask(__attribute__((unused)) void *parameters)
             // Process event
             processObjEvent(&ev);
             // if both queues are empty, wait on priority queue for updates (1 tick) then repeat cycle
-        } else if (xQueueReceive(priorityQueue, &ev, 1) == pdTRUE) {
-            // Process event
-            processObjEvent(&ev);
+        } else {
+            // Out of work, send the objects collected in a multi object packet
+            UAVTalkFlush(uavTalkCon);
+            if (xQueueReceive(priorityQueue, &ev, 1) == pdTRUE) {
+                // Process event
+                processObjEvent(&ev);
+            }
         }
 #else
+        // Out of work, send the objects collected in a multi object packet
+        if (uxQueueMessagesWaiting(queue) == 0) {
+            UAVTalkFlush(uavTalkCon);
+        }
         // wait on queue for updates (1 tick) then repeat cycle
         if (xQueueReceive(queue, &ev, 1) == pdTRUE) {
             // Process event
@@ -432,14 +451,12 @@ static void telemetryRxTask(__attribute__((unused)) void *parameters)
 
         if (inputPort) {
             // Block until data are available
-            uint8_t serial_data[1];
+            uint8_t serial_data[RX_BUFFER_SIZE];
             uint16_t bytes_to_process;
 
             bytes_to_process = PIOS_COM_ReceiveBuffer(inputPort, serial_data, sizeof(serial_data), 500);
             if (bytes_to_process > 0) {
-                for (uint8_t i = 0; i < bytes_to_process; i++) {
-                    UAVTalkProcessInputStream(uavTalkCon, serial_data[i]);
-                }
+                UAVTalkProcessInputBuffer(uavTalkCon, serial_data, bytes_to_process);
             }
         } else {
             vTaskDelay(5);
@@ -457,14 +474,12 @@ static void radioRxTask(__attribute__((unused)) void *parameters)
     while (1) {
         if (radioPort) {
             // Block until data are available
-            uint8_t serial_data[1];
+            uint8_t serial_data[RX_BUFFER_SIZE];
             uint16_t bytes_to_process;
 
             bytes_to_process = PIOS_COM_ReceiveBuffer(radioPort, serial_data, sizeof(serial_data), 500);
             if (bytes_to_process > 0) {
-                for (uint8_t i = 0; i < bytes_to_process; i++) {
-                    UAVTalkProcessInputStream(radioUavTalkCon, serial_data[i]);
-                }
+                UAVTalkProcessInputBuffer(radioUavTalkCon, serial_data, bytes_to_process);
             }
         } else {
             vTaskDelay(5);
@@ -486,6 +501,36 @@ static int32_t transmitRadioData(uint8_t *data, int32_t length)
 
     return -1;
 }
+
+/**
+ * Reserve space for a packet in the radioport transmit buffer.
+ * \param[out] span Where to write the packet
+ * \param[in] length Length of the packet
+ * \return -1 on failure
+ * \return 0 if the packet is too large, use transmitRadioData()
+ * \return number of bytes reserved on success
+ */
+static int32_t reserveRadioData(t_fifo_span *span, uint16_t length)
+{
+    radioReservedPort = radioPort;
+
+    if (radioReservedPort) {
+        return PIOS_COM_ReserveBuffer(radioReservedPort, span, length);
+    }
+
+    return -1;
+}
+
+/**
+ * Transmit the packet written to the reserved space of the radioport.
+ * \param[in] length Length of the packet
+ * \return -1 on failure
+ * \return number of bytes transmitted on success
+ */
+static int32_t commitRadioData(uint16_t length)
+{
+    return PIOS_COM_CommitBuffer(radioReservedPort, length);
+}
 #endif /* PIOS_INCLUDE_RFM22B */
 
 /**
@@ -506,6 +551,37 @@ static int32_t transmitData(uint8_t *data, int32_t length)
     return -1;
 }
 
+/**
+ * Reserve space for a packet in the transmit buffer of the modem or USB port.
+ * \param[out] span Where to write the packet
+ * \param[in] length Length of the packet
+ * \return -1 on failure
+ * \return 0 if the packet is too large, use transmitData()
+ * \return number of bytes reserved on success
+ */
+static int32_t reserveData(t_fifo_span *span, uint16_t length)
+{
+    // The port may change before the commit, remember the one holding the space
+    reservedPort = getComPort(false);
+
+    if (reservedPort) {
+        return PIOS_COM_ReserveBuffer(reservedPort, span, length);
+    }
+
+    return -1;
+}
+
+/**
+ * Transmit the packet written to the reserved space.
+ * \param[in] length Length of the packet
+ * \return -1 on failure
+ * \return number of bytes transmitted on success
+ */
+static int32_t commitData(uint16_t length)
+{
+    return PIOS_COM_CommitBuffer(reservedPort, length);
+}
+
 /**
  * Set update period of object (it must be already setup for periodic updates)
  * \param[in] obj The object to update
@@ -667,6 +743,24 @@ static void updateTelemetryStats()
         AlarmsClear(SYSTEMALARMS_ALARM_TELEMETRY);
     }
 
+    // Small objects are batched once the ground station asks for it
+    if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED && gcsStats.Batching == GCSTELEMETRYSTATS_BATCHING_ENABLED) {
+        flightStats.Batching = FLIGHTTELEMETRYSTATS_BATCHING_ENABLED;
+    } else {
+        flightStats.Batching = FLIGHTTELEMETRYSTATS_BATCHING_DISABLED;
+    }
+    UAVTalkSetBatching(uavTalkCon, flightStats.Batching == FLIGHTTELEMETRYSTATS_BATCHING_ENABLED);
+
+    // Likewise for sending objects as the fields that changed, the ground station only decodes them
+    if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED && gcsStats.Delta == GCSTELEMETRYSTATS_DELTA_ENABLED) {
+        flightStats.Delta = FLIGHTTELEMETRYSTATS_DELTA_ENABLED;
+    } else {
+        flightStats.Delta = FLIGHTTELEMETRYSTATS_DELTA_DISABLED;
+    }
+    if (UAVTalkSetDelta(uavTalkCon, flightStats.Delta == FLIGHTTELEMETRYSTATS_DELTA_ENABLED, false) != 0) {
+        flightStats.Delta = FLIGHTTELEMETRYSTATS_DELTA_DISABLED;
+    }
+
     // Update object
     FlightTelemetryStatsSet(&flightStats);
 
@@ -36,6 +36,12 @@
 #define STACK_SIZE        (190 + STACK_SAFETYSIZE)
 #define STACK_SAFETYSIZE  8
 #define MAX_SLEEP         1000
+// The delayed heap is kept in segments that are never freed, segment n holds HEAP_SEGMENT << n entries
+#define HEAP_SEGMENT_SHIFT 3
+#define HEAP_SEGMENT      (1 << HEAP_SEGMENT_SHIFT)
+#define HEAP_MAX_SEGMENTS 8
+#define HEAP_SEGMENT_OF(index) (31 - __builtin_clz(((index) >> HEAP_SEGMENT_SHIFT) + 1))
+#define HEAP(task, index) (*heapEntry(task, index))
 
 // Private types
 /**
@@ -43,7 +49,18 @@
  */
 struct DelayedCallbackTaskStruct {
     DelayedCallbackInfo *callbackQueue[CALLBACK_PRIORITY_LOW + 1];
-    DelayedCallbackInfo *queueCursor[CALLBACK_PRIORITY_LOW + 1];
+    // Callbacks waiting for execution, one FIFO per priority, accessed in critical sections only
+    DelayedCallbackInfo *readyHead[CALLBACK_PRIORITY_LOW + 1];
+    DelayedCallbackInfo *readyTail[CALLBACK_PRIORITY_LOW + 1];
+    uint16_t readyCount[CALLBACK_PRIORITY_LOW + 1];
+    uint8_t  readyMask; // bit n set when readyHead[n] is not empty
+    // Callbacks left in the current round of each priority before the next lower one gets a slot
+    uint16_t roundLeft[CALLBACK_PRIORITY_LOW + 1];
+    // Min-heap of the scheduled callbacks ordered by scheduletime, protected by the mutex
+    DelayedCallbackInfo * *delayedHeap[HEAP_MAX_SEGMENTS];
+    uint16_t delayedCount;
+    uint16_t delayedSize;
+    uint16_t numCallbacks;
     xTaskHandle callbackSchedulerTaskHandle;
     char name[3];
     uint32_t    stackSize;
@@ -58,8 +75,18 @@ struct DelayedCallbackTaskStruct {
 struct DelayedCallbackInfoStruct {
     DelayedCallback   cb;
     int16_t callbackID;
-    bool volatile     waiting;
-    uint32_t volatile scheduletime;
+    DelayedCallbackPriority priority;
+    bool volatile     waiting; // in the ready FIFO of its priority
+    uint32_t volatile scheduletime; // in the delayed heap when not zero
+    uint16_t heapIndex; // position in the delayed heap, only valid while scheduletime is not zero
+#ifdef DIAG_TASKS
+    uint32_t readyTime; // PIOS_DELAY_GetRaw() when it was made ready
+    uint32_t readyLate; // how late in us a scheduled callback was made ready
+    uint32_t latencyMax; // worst case time from ready to execution in us
+    uint32_t execTimeMax; // worst case execution time in us
+    uint32_t latencyHistogram[CALLBACK_HISTOGRAM_BUCKETS];
+    uint32_t execTimeHistogram[CALLBACK_HISTOGRAM_BUCKETS];
+#endif
     uint32_t stackSize;
     int32_t  stackFree;
     int32_t  stackNotFree;
@@ -68,6 +95,7 @@ struct DelayedCallbackInfoStruct {
     uint32_t runCount;
     struct DelayedCallbackTaskStruct *task;
     struct DelayedCallbackInfoStruct *next;
+    struct DelayedCallbackInfoStruct *readyNext;
 };
 
 
@@ -78,7 +106,17 @@ static bool schedulerStarted;
 
 // Private functions
 static void CallbackSchedulerTask(void *task);
-static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority);
+static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task);
+static void readyPush(struct DelayedCallbackTaskStruct *task, DelayedCallbackInfo *cbinfo, uint32_t late);
+static DelayedCallbackInfo *readyPop(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority);
+static inline DelayedCallbackInfo * *heapEntry(struct DelayedCallbackTaskStruct *task, uint16_t index);
+static void heapInsert(struct DelayedCallbackTaskStruct *task, DelayedCallbackInfo *cbinfo);
+static void heapRemove(struct DelayedCallbackTaskStruct *task, DelayedCallbackInfo *cbinfo);
+static void heapSiftUp(struct DelayedCallbackTaskStruct *task, uint16_t index);
+static void heapSiftDown(struct DelayedCallbackTaskStruct *task, uint16_t index);
+#ifdef DIAG_TASKS
+static void recordTime(uint32_t us, uint32_t *max, uint32_t *histogram);
+#endif
 
 /**
  * Initialize the scheduler
@@ -183,10 +221,14 @@ int32_t PIOS_CALLBACKSCHEDULER_Schedule(
         // the scheduletime may be updated
         if (!cbinfo->scheduletime) {
             result = 1;
+            cbinfo->scheduletime = new;
+            heapInsert(cbinfo->task, cbinfo);
         } else {
             result = 2;
+            cbinfo->scheduletime = new;
+            heapSiftUp(cbinfo->task, cbinfo->heapIndex);
+            heapSiftDown(cbinfo->task, cbinfo->heapIndex);
         }
-        cbinfo->scheduletime = new;
 
         // scheduler needs to be notified to adapt sleep times
         xSemaphoreGive(cbinfo->task->signal);
@@ -207,8 +249,10 @@ int32_t PIOS_CALLBACKSCHEDULER_Dispatch(DelayedCallbackInfo *cbinfo)
 {
     PIOS_Assert(cbinfo);
 
-    // no semaphore needed for the callback
-    cbinfo->waiting = true;
+    // no semaphore needed for the callback, the ready FIFO is only touched in critical sections
+    taskENTER_CRITICAL();
+    readyPush(cbinfo->task, cbinfo, 0);
+    taskEXIT_CRITICAL();
     // but the scheduler as a whole needs to be notified
     return xSemaphoreGive(cbinfo->task->signal);
 }
@@ -231,8 +275,10 @@ int32_t PIOS_CALLBACKSCHEDULER_DispatchFromISR(DelayedCallbackInfo *cbinfo, long
 {
     PIOS_Assert(cbinfo);
 
-    // no semaphore needed for the callback
-    cbinfo->waiting = true;
+    // no semaphore needed for the callback, the ready FIFO is only touched in critical sections
+    unsigned long mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    readyPush(cbinfo->task, cbinfo, 0);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
     // but the scheduler as a whole needs to be notified
     return xSemaphoreGiveFromISR(cbinfo->task->signal, pxHigherPriorityTaskWoken);
 }
@@ -282,8 +328,18 @@ DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(
         // initialize structure
         for (DelayedCallbackPriority p = 0; p <= CALLBACK_PRIORITY_LOW; p++) {
             task->callbackQueue[p] = NULL;
-            task->queueCursor[p]   = NULL;
+            task->readyHead[p]     = NULL;
+            task->readyTail[p]     = NULL;
+            task->readyCount[p]    = 0;
+            task->roundLeft[p]     = 0;
         }
+        for (uint8_t s = 0; s < HEAP_MAX_SEGMENTS; s++) {
+            task->delayedHeap[s] = NULL;
+        }
+        task->readyMask    = 0;
+        task->delayedCount = 0;
+        task->delayedSize  = 0;
+        task->numCallbacks = 0;
         task->name[0]      = 'C';
         task->name[1]      = 'a' + t;
         task->name[2]      = 0;
@@ -328,6 +384,22 @@ DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(
         return NULL; // error - not enough memory
     }
 
+    // every callback of the task may be scheduled at once, grow the heap now so scheduling never allocates.
+    // The heap grows by a segment at a time and nothing is freed, pios_free() does nothing on heap_1 targets.
+    if (task->numCallbacks == task->delayedSize) {
+        uint8_t segment = HEAP_SEGMENT_OF(task->delayedSize);
+        if (segment == HEAP_MAX_SEGMENTS) {
+            xSemaphoreGiveRecursive(mutex);
+            return NULL; // error - too many callbacks for this task
+        }
+        task->delayedHeap[segment] = (DelayedCallbackInfo * *)pios_malloc((HEAP_SEGMENT << segment) * sizeof(DelayedCallbackInfo *));
+        if (!task->delayedHeap[segment]) {
+            xSemaphoreGiveRecursive(mutex);
+            return NULL; // error - not enough memory
+        }
+        task->delayedSize += HEAP_SEGMENT << segment;
+    }
+
     // initialize callback scheduling info
     DelayedCallbackInfo *info = (DelayedCallbackInfo *)pios_malloc(sizeof(DelayedCallbackInfo));
     if (!info) {
@@ -335,8 +407,19 @@ DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(
         return NULL; // error - not enough memory
     }
     info->next               = NULL;
+    info->readyNext          = NULL;
+    info->priority           = priority;
     info->waiting            = false;
     info->scheduletime       = 0;
+    info->heapIndex          = 0;
+#ifdef DIAG_TASKS
+    info->readyTime          = 0;
+    info->readyLate          = 0;
+    info->latencyMax         = 0;
+    info->execTimeMax        = 0;
+    memset(info->latencyHistogram, 0, sizeof(info->latencyHistogram));
+    memset(info->execTimeHistogram, 0, sizeof(info->execTimeHistogram));
+#endif
     info->task               = task;
     info->cb = cb;
     info->callbackID         = callbackID;
@@ -347,8 +430,9 @@ DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(
     info->stackSafetyCount   = STACK_SAFETYCOUNT;
     info->currentSafetyCount = 0;
 
-    // add to scheduling queue
+    // add to list of callbacks
     LL_APPEND(task->callbackQueue[priority], info);
+    task->numCallbacks++;
 
     xSemaphoreGiveRecursive(mutex);
 
@@ -380,6 +464,12 @@ void PIOS_CALLBACKSCHEDULER_ForEachCallback(CallbackSchedulerCallbackInfoCallbac
                 info.is_running = true;
                 info.stack_remaining    = cbinfo->stackNotFree;
                 info.running_time_count = cbinfo->runCount;
+#ifdef DIAG_TASKS
+                info.latency_max        = cbinfo->latencyMax;
+                info.exec_time_max      = cbinfo->execTimeMax;
+                memcpy(info.latency_histogram, cbinfo->latencyHistogram, sizeof(info.latency_histogram));
+                memcpy(info.exec_time_histogram, cbinfo->execTimeHistogram, sizeof(info.exec_time_histogram));
+#endif
                 xSemaphoreGiveRecursive(mutex);
                 callback(cbinfo->callbackID, &info, context);
             }
@@ -457,76 +547,257 @@ static void checkStack(DelayedCallbackInfo *current)
     }
 }
 
+/**
+ * Make a callback ready for execution, does nothing if it already is.
+ * Must be called from a critical section.
+ * \param[in] task The scheduler task of the callback
+ * \param[in] cbinfo The callback
+ * \param[in] late Time in us since a scheduled callback was due, 0 for a dispatch
+ */
+static void readyPush(struct DelayedCallbackTaskStruct *task, DelayedCallbackInfo *cbinfo, __attribute__((unused)) uint32_t late)
+{
+    if (cbinfo->waiting) {
+        return;
+    }
+    cbinfo->waiting   = true;
+#ifdef DIAG_TASKS
+    cbinfo->readyTime = PIOS_DELAY_GetRaw();
+    cbinfo->readyLate = late;
+#endif
+    cbinfo->readyNext = NULL;
+    if (task->readyTail[cbinfo->priority]) {
+        task->readyTail[cbinfo->priority]->readyNext = cbinfo;
+    } else {
+        task->readyHead[cbinfo->priority] = cbinfo;
+    }
+    task->readyTail[cbinfo->priority] = cbinfo;
+    task->readyCount[cbinfo->priority]++;
+    task->readyMask |= 1 << cbinfo->priority;
+}
+
+/**
+ * Take the next callback to execute at a priority or below, keeping the round robin order.
+ * Within a priority the ready callbacks run in the order they were made ready. After each
+ * round through them one callback of the next lower priority gets a slot.
+ * Must be called from a critical section.
+ * \param[in] task The scheduler task
+ * \param[in] priority The highest priority to look at
+ * \return The callback, NULL if none is ready
+ */
+static DelayedCallbackInfo *readyPop(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority)
+{
+    // skip the empty priorities at once
+    uint8_t mask = task->readyMask >> priority;
+
+    if (!mask) {
+        return NULL;
+    }
+    while (!(mask & 1)) {
+        mask >>= 1;
+        priority++;
+    }
+
+    if (!task->roundLeft[priority]) {
+        // round complete, one slot for a lower priority callback
+        task->roundLeft[priority] = task->readyCount[priority];
+        if (priority < CALLBACK_PRIORITY_LOW) {
+            DelayedCallbackInfo *lower = readyPop(task, priority + 1);
+            if (lower) {
+                return lower;
+            }
+        }
+    }
+    task->roundLeft[priority]--;
+
+    DelayedCallbackInfo *cbinfo = task->readyHead[priority];
+    task->readyHead[priority] = cbinfo->readyNext;
+    if (!task->readyHead[priority]) {
+        task->readyTail[priority] = NULL;
+        task->readyMask &= ~(1 << priority);
+    }
+    task->readyCount[priority]--;
+    if (task->roundLeft[priority] > task->readyCount[priority]) {
+        task->roundLeft[priority] = task->readyCount[priority];
+    }
+    cbinfo->readyNext = NULL;
+    cbinfo->waiting   = false; // the flag is reset just before execution.
+    return cbinfo;
+}
+
+/**
+ * Locate an entry of the delayed heap in its segment
+ */
+static inline DelayedCallbackInfo * *heapEntry(struct DelayedCallbackTaskStruct *task, uint16_t index)
+{
+    uint8_t segment = HEAP_SEGMENT_OF(index);
+
+    return &task->delayedHeap[segment][index - (((1 << segment) - 1) << HEAP_SEGMENT_SHIFT)];
+}
+
+/**
+ * Add a callback to the delayed heap, its scheduletime must be set.
+ * There is always room, the heap grows with the number of callbacks.
+ */
+static void heapInsert(struct DelayedCallbackTaskStruct *task, DelayedCallbackInfo *cbinfo)
+{
+    cbinfo->heapIndex = task->delayedCount;
+    HEAP(task, cbinfo->heapIndex) = cbinfo;
+    task->delayedCount++;
+    heapSiftUp(task, cbinfo->heapIndex);
+}
+
+/**
+ * Remove a callback from the delayed heap
+ */
+static void heapRemove(struct DelayedCallbackTaskStruct *task, DelayedCallbackInfo *cbinfo)
+{
+    uint16_t index = cbinfo->heapIndex;
+    task->delayedCount--;
+    DelayedCallbackInfo *last = HEAP(task, task->delayedCount);
+
+    if (index == task->delayedCount) {
+        return;
+    }
+    HEAP(task, index) = last;
+    last->heapIndex = index;
+    heapSiftUp(task, index);
+    heapSiftDown(task, last->heapIndex);
+}
+
+/**
+ * Move a heap entry towards the top while it is due earlier than its parent.
+ * Times are compared as differences so the tick count wraparound does not matter.
+ */
+static void heapSiftUp(struct DelayedCallbackTaskStruct *task, uint16_t index)
+{
+    DelayedCallbackInfo *cbinfo = HEAP(task, index);
+
+    while (index > 0) {
+        uint16_t parent = (index - 1) / 2;
+        if ((int32_t)(HEAP(task, parent)->scheduletime - cbinfo->scheduletime) <= 0) {
+            break;
+        }
+        HEAP(task, index) = HEAP(task, parent);
+        HEAP(task, index)->heapIndex = index;
+        index = parent;
+    }
+    HEAP(task, index) = cbinfo;
+    cbinfo->heapIndex = index;
+}
+
+/**
+ * Move a heap entry towards the bottom while one of its children is due earlier.
+ */
+static void heapSiftDown(struct DelayedCallbackTaskStruct *task, uint16_t index)
+{
+    DelayedCallbackInfo *cbinfo = HEAP(task, index);
+
+    while (1) {
+        uint16_t child = 2 * index + 1;
+        if (child >= task->delayedCount) {
+            break;
+        }
+        if (child + 1 < task->delayedCount && (int32_t)(HEAP(task, child + 1)->scheduletime - HEAP(task, child)->scheduletime) < 0) {
+            child++;
+        }
+        if ((int32_t)(cbinfo->scheduletime - HEAP(task, child)->scheduletime) <= 0) {
+            break;
+        }
+        HEAP(task, index) = HEAP(task, child);
+        HEAP(task, index)->heapIndex = index;
+        index = child;
+    }
+    HEAP(task, index) = cbinfo;
+    cbinfo->heapIndex = index;
+}
+
+#ifdef DIAG_TASKS
+/**
+ * Update the worst case and the histogram of a callback timing
+ * \param[in] us The measured time
+ * \param[in] max The worst case so far
+ * \param[in] histogram The histogram, see CALLBACK_HISTOGRAM_BUCKETS
+ */
+static void recordTime(uint32_t us, uint32_t *max, uint32_t *histogram)
+{
+    uint8_t bucket = 0;
+
+    if (us > *max) {
+        *max = us;
+    }
+    for (us >>= 2; us && bucket < CALLBACK_HISTOGRAM_BUCKETS - 1; us >>= 2) {
+        bucket++;
+    }
+    histogram[bucket]++;
+}
+#endif /* ifdef DIAG_TASKS */
+
 /**
  * Scheduler subtask
  * \param[in] task The scheduler task in question
- * \param[in] priority The scheduling priority of the callback to search for
  * \return wait time until next scheduled callback is due - 0 if a callback has just been executed
  */
-static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority)
+static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task)
 {
     int32_t result = MAX_SLEEP;
-    int32_t diff   = 0;
 
-    // no such queue
-    if (priority > CALLBACK_PRIORITY_LOW) {
+    // move the callbacks that are due from the delayed heap to the ready FIFOs
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY); // access to scheduletime should be mutex protected
+    uint32_t now = xTaskGetTickCount();
+    while (task->delayedCount) {
+        DelayedCallbackInfo *due = HEAP(task, 0);
+        int32_t diff = due->scheduletime - now;
+        if (diff > 0) {
+            if (diff < result) {
+                result = diff; // adjust sleep time
+            }
+            break;
+        }
+        heapRemove(task, due);
+        due->scheduletime = 0;
+        // the latency of a scheduled callback counts from when it was due
+        taskENTER_CRITICAL();
+        readyPush(task, due, -diff * portTICK_RATE_MS * 1000);
+        taskEXIT_CRITICAL();
+    }
+
+    taskENTER_CRITICAL();
+    DelayedCallbackInfo *current = readyPop(task, CALLBACK_PRIORITY_CRITICAL);
+    taskEXIT_CRITICAL();
+
+    if (!current) {
+        // nothing to do
+        xSemaphoreGiveRecursive(mutex);
         return result;
     }
 
-    // queue is empty, search a lower priority queue
-    if (task->callbackQueue[priority] == NULL) {
-        return runNextCallback(task, priority + 1);
+    // any schedules are reset
+    if (current->scheduletime) {
+        heapRemove(task, current);
+        current->scheduletime = 0;
     }
+    xSemaphoreGiveRecursive(mutex);
 
-    DelayedCallbackInfo *current = task->queueCursor[priority];
-    DelayedCallbackInfo *next;
-    do {
-        if (current == NULL) {
-            next = task->callbackQueue[priority]; // loop around the end of the list
-            // also attempt to run a callback that has lower priority
-            // every time the queue is completely traversed
-            diff = runNextCallback(task, priority + 1);
-            if (!diff) {
-                task->queueCursor[priority] = next; // the recursive call has executed a callback
-                return 0;
-            }
-            if (diff < result) {
-                result = diff; // adjust sleep time
-            }
-        } else {
-            next = current->next;
-            xSemaphoreTakeRecursive(mutex, portMAX_DELAY); // access to scheduletime should be mutex protected
-            if (current->scheduletime) {
-                diff = current->scheduletime - xTaskGetTickCount();
-                if (diff <= 0) {
-                    current->waiting = true;
-                } else if (diff < result) {
-                    result = diff; // adjust sleep time
-                }
-            }
-            if (current->waiting) {
-                task->queueCursor[priority] = next;
-                current->scheduletime = 0; // any schedules are reset
-                current->waiting = false; // the flag is reset just before execution.
-                xSemaphoreGiveRecursive(mutex);
+#ifdef DIAG_TASKS
+    recordTime(PIOS_DELAY_DiffuS(current->readyTime) + current->readyLate, &current->latencyMax, current->latencyHistogram);
+#endif
 
-                /* callback gets invoked here - check stack sizes */
-                markStack(current);
+    /* callback gets invoked here - check stack sizes */
+    markStack(current);
 
-                current->cb(); // call the callback
+#ifdef DIAG_TASKS
+    uint32_t start = PIOS_DELAY_GetRaw();
+    current->cb(); // call the callback
+    recordTime(PIOS_DELAY_DiffuS(start), &current->execTimeMax, current->execTimeHistogram);
+#else
+    current->cb(); // call the callback
+#endif
 
-                checkStack(current);
+    checkStack(current);
 
-                current->runCount++;
+    current->runCount++;
 
-                return 0;
-            }
-            xSemaphoreGiveRecursive(mutex);
-        }
-        current = next;
-    } while (current != task->queueCursor[priority]);
-    // once the list has been traversed entirely without finding any to be executed task, abort (nothing to do)
-    return result;
+    return 0;
 }
 
 /**
@@ -538,7 +809,7 @@ static void CallbackSchedulerTask(void *task)
     uint32_t delay = 0;
 
     while (1) {
-        delay = runNextCallback((struct DelayedCallbackTaskStruct *)task, CALLBACK_PRIORITY_CRITICAL);
+        delay = runNextCallback((struct DelayedCallbackTaskStruct *)task);
         if (delay) {
             // nothing to do but sleep
             xSemaphoreTake(((struct DelayedCallbackTaskStruct *)task)->signal, delay);
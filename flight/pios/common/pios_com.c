@@ -427,6 +427,91 @@ int32_t PIOS_COM_SendBuffer(uint32_t com_id, const uint8_t *buffer, uint16_t len
     return len;
 }
 
+/**
+ * Reserves space for a package in the transmit buffer, so that it can be
+ * written in place instead of being copied (blocking function).
+ * Other senders are locked out until PIOS_COM_CommitBuffer() is called,
+ * which must follow every successful reservation.
+ * \param[in] port COM port
+ * \param[out] span space for the package, in two parts when it wraps around
+ * \param[in] len package length
+ * \return -1 if port not available
+ * \return 0 if the package can never fit in the buffer, use PIOS_COM_SendBuffer()
+ * \return -2 if mutex can't be taken;
+ * \return -3 if the space is not available in the max allotted time of 5000msec
+ * \return number of bytes reserved on success
+ */
+int32_t PIOS_COM_ReserveBuffer(uint32_t com_id, t_fifo_span *span, uint16_t len)
+{
+    struct pios_com_dev *com_dev = (struct pios_com_dev *)com_id;
+
+    if (!PIOS_COM_validate(com_dev)) {
+        /* Undefined COM port for this board (see pios_board.c) */
+        return -1;
+    }
+    PIOS_Assert(com_dev->has_tx);
+    if (len < 1 || len > fifoBuf_getSize(&com_dev->tx)) {
+        /* Cannot be sent in one piece, use PIOS_COM_SendBuffer() */
+        return 0;
+    }
+#if defined(PIOS_INCLUDE_FREERTOS)
+    if (xSemaphoreTake(com_dev->sendbuffer_sem, 5) != pdTRUE) {
+        return -2;
+    }
+#endif /* PIOS_INCLUDE_FREERTOS */
+    if (com_dev->driver->available && !com_dev->driver->available(com_dev->lower_id)) {
+        /* Underlying device is down/unconnected, the package is dropped on commit */
+        fifoBuf_clearData(&com_dev->tx);
+    }
+    while (fifoBuf_reserve(&com_dev->tx, span, len) != len) {
+        /* Device is busy, wait for the underlying device to free some space and retry */
+        /* Make sure the transmitter is running while we wait */
+        if (com_dev->driver->tx_start) {
+            (com_dev->driver->tx_start)(com_dev->lower_id,
+                                        fifoBuf_getUsed(&com_dev->tx));
+        }
+#if defined(PIOS_INCLUDE_FREERTOS)
+        if (xSemaphoreTake(com_dev->tx_sem, 5000) != pdTRUE) {
+            xSemaphoreGive(com_dev->sendbuffer_sem);
+            return -3;
+        }
+#endif
+    }
+    return len;
+}
+
+/**
+ * Sends a package written to the space given by PIOS_COM_ReserveBuffer()
+ * \param[in] port COM port
+ * \param[in] len package length, zero to cancel the reservation
+ * \return -1 if port not available
+ * \return number of bytes transmitted on success
+ */
+int32_t PIOS_COM_CommitBuffer(uint32_t com_id, uint16_t len)
+{
+    struct pios_com_dev *com_dev = (struct pios_com_dev *)com_id;
+
+    if (!PIOS_COM_validate(com_dev)) {
+        /* Undefined COM port for this board (see pios_board.c) */
+        return -1;
+    }
+    if (com_dev->driver->available && !com_dev->driver->available(com_dev->lower_id)) {
+        /* Underlying device is down/unconnected, act like an infinite data sink */
+        fifoBuf_clearData(&com_dev->tx);
+    } else if (len > 0) {
+        fifoBuf_commit(&com_dev->tx, len);
+        /* More data has been put in the tx buffer, make sure the tx is started */
+        if (com_dev->driver->tx_start) {
+            com_dev->driver->tx_start(com_dev->lower_id,
+                                      fifoBuf_getUsed(&com_dev->tx));
+        }
+    }
+#if defined(PIOS_INCLUDE_FREERTOS)
+    xSemaphoreGive(com_dev->sendbuffer_sem);
+#endif /* PIOS_INCLUDE_FREERTOS */
+    return len;
+}
+
 /**
  * Sends a single character over given port
  * \param[in] port COM port
@@ -32,9 +32,36 @@
 #include "pios.h"
 #include "uavobjectmanager.h"
 #include "debuglogentry.h"
+#if defined(PIOS_INCLUDE_CALLBACKSCHEDULER)
+#include "callbackinfo.h"
+#endif
 
 // global definitions
 
+/*
+ * UAVObject updates are streamed into RAM pages, one DebugLogEntry each, and
+ * the full pages are written to flash by a low priority callback.  The
+ * caller only ever copies its data into the page being filled.
+ *
+ * A page of type UAVObjectStream holds Size bytes of records:
+ *   tag     uint8   bits 0-5 page local object index
+ *                   bit 6 set if an instance id follows, instance 0 otherwise
+ *                   bit 7 set if the object id follows, on first use of an object in the page
+ *   objid   uint32  little endian, only with bit 7, it gets the next free index
+ *   instid  uint16  little endian, only with bit 6
+ *   delta   varint  us since the previous record, the first one counts from FlightTime,
+ *                   7 bits per byte starting with the least significant ones, bit 7 set if more follow
+ *   size    uint8   data bytes
+ *   data
+ */
+#define LOG_PAGES                   2
+#define LOG_PAGE_MAX_OBJECTS        64
+#define LOG_RECORD_TAG_INDEX_MASK   0x3F
+#define LOG_RECORD_TAG_INSTANCE     0x40
+#define LOG_RECORD_TAG_OBJECT       0x80
+#define LOG_RECORD_MAX_HEADER_SIZE  (1 + 4 + 2 + 5 + 1)
+
+#define LOG_FLUSH_STACK_SIZE        640
 
 // Global variables
 extern uintptr_t pios_user_fs_id; // flash filesystem for logging
@@ -43,32 +70,63 @@ extern uintptr_t pios_user_fs_id; // flash filesystem for logging
 static xSemaphoreHandle mutex = 0;
 #define mutexlock()   xSemaphoreTakeRecursive(mutex, portMAX_DELAY)
 #define mutexunlock() xSemaphoreGiveRecursive(mutex)
+// held while a page is written, so a format never runs in the middle of a write
+static xSemaphoreHandle flush_mutex = 0;
+#define flushlock()   xSemaphoreTakeRecursive(flush_mutex, portMAX_DELAY)
+#define flushunlock() xSemaphoreGiveRecursive(flush_mutex)
 #else
 #define mutexlock()
 #define mutexunlock()
+#define flushlock()
+#define flushunlock()
 #endif
 
+struct log_page {
+    DebugLogEntryData entry;
+    uint32_t last_time; // time of the last record, the next delta counts from here
+    uint8_t  num_objects;
+    uint16_t num_records; // counted as dropped if the page can't be written
+    uint32_t objects[LOG_PAGE_MAX_OBJECTS];
+};
+
 static bool logging_enabled = false;
 #define MAX_CONSECUTIVE_FAILS_COUNT 10
 static bool log_is_full     = false;
 static uint8_t fails_count  = 0;
 static uint16_t flightnum   = 0;
+// next entry of lognum_flight, entries are numbered as they are written so failed writes leave no gap
 static uint16_t lognum = 0;
-static DebugLogEntryData *buffer = 0;
+static uint16_t lognum_flight = 0;
+static struct log_page *pages = 0;
 #if !defined(PIOS_INCLUDE_FREERTOS)
-static DebugLogEntryData staticbuffer;
+static struct log_page staticpages[LOG_PAGES];
+#endif
+// pages_pending full pages wait for the flush starting at page_write, the one after them is being filled
+static uint8_t page_write    = 0;
+static uint8_t pages_pending = 0;
+
+static uint32_t bytes_written = 0;
+static uint32_t dropped_count = 0;
+static uint32_t rate_bytes    = 0;
+static uint32_t rate_time     = 0;
+
+#if defined(PIOS_INCLUDE_CALLBACKSCHEDULER)
+static DelayedCallbackInfo *flushCallback = 0;
 #endif
 
 #define LOG_ENTRY_MAX_DATA_SIZE (sizeof(((DebugLogEntryData *)0)->Data))
-#define LOG_ENTRY_HEADER_SIZE   (sizeof(DebugLogEntryData) - LOG_ENTRY_MAX_DATA_SIZE)
 // build the obj_id as a DEBUGLOGENTRY ID with least significant byte zeroed and filled with flight number
 #define LOG_GET_FLIGHT_OBJID(x) ((DEBUGLOGENTRY_OBJID & ~0xFF) | (x & 0xFF))
-
-static uint32_t used_buffer_space = 0;
+// flight numbers share the object id byte, so there can't be more than this many in flash
+#define LOG_MAX_FLIGHTS         256
 
 /* Private Function Prototypes */
 static void enqueue_data(uint32_t objid, uint16_t instid, size_t size, uint8_t *data);
-static bool write_current_buffer();
+static struct log_page *fill_page();
+static void submit_page();
+static void flush_pages();
+static bool flight_exists(uint16_t flight);
+
 /**
  * @brief Initialize the log facility
  */
@@ -76,24 +134,41 @@ void PIOS_DEBUGLOG_Initialize()
 {
 #if defined(PIOS_INCLUDE_FREERTOS)
     if (!mutex) {
-        mutex  = xSemaphoreCreateRecursiveMutex();
-        buffer = pios_malloc(sizeof(DebugLogEntryData));
+        mutex = xSemaphoreCreateRecursiveMutex();
+        flush_mutex = xSemaphoreCreateRecursiveMutex();
+        pages = pios_malloc(sizeof(struct log_page) * LOG_PAGES);
+#if defined(PIOS_INCLUDE_CALLBACKSCHEDULER)
+        flushCallback = PIOS_CALLBACKSCHEDULER_Create(&flush_pages, CALLBACK_PRIORITY_LOW, CALLBACK_TASK_AUXILIARY, CALLBACKINFO_RUNNING_DEBUGLOG, LOG_FLUSH_STACK_SIZE);
+#endif
     }
 #else
-    buffer = &staticbuffer;
+    pages = staticpages;
 #endif
-    if (!buffer) {
+    if (!pages) {
         return;
     }
     mutexlock();
-    lognum      = 0;
-    flightnum   = 0;
-    fails_count = 0;
-    used_buffer_space = 0;
-    log_is_full = false;
-    while (PIOS_FLASHFS_ObjLoad(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(flightnum), lognum, (uint8_t *)buffer, sizeof(DebugLogEntryData)) == 0) {
-        flightnum++;
+    lognum        = 0;
+    fails_count   = 0;
+    log_is_full   = false;
+    page_write    = 0;
+    pages_pending = 0;
+
+    // flights are stored one after the other, look for the first one missing
+    uint16_t low  = 0;
+    uint16_t high = LOG_MAX_FLIGHTS - 1;
+    while (low < high) {
+        uint16_t mid = (low + high) / 2;
+        if (flight_exists(mid)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
     }
+    flightnum     = low;
+    lognum_flight = flightnum;
+    pages[0].entry.Size  = 0;
+    pages[0].num_objects = 0;
     mutexunlock();
 }
 
@@ -106,8 +181,13 @@ void PIOS_DEBUGLOG_Enable(uint8_t enabled)
 {
     // increase the flight num as soon as logging is disabled
     if (logging_enabled && !enabled) {
+        mutexlock();
+        // what was logged so far still belongs to this flight
+        if (pages && pages_pending < LOG_PAGES && fill_page()->entry.Size) {
+            submit_page();
+        }
         flightnum++;
-        lognum = 0;
+        mutexunlock();
     }
     logging_enabled = enabled;
 }
@@ -122,7 +202,7 @@ void PIOS_DEBUGLOG_Enable(uint8_t enabled)
  */
 void PIOS_DEBUGLOG_UAVObject(uint32_t objid, uint16_t instid, size_t size, uint8_t *data)
 {
-    if (!logging_enabled || !buffer || log_is_full) {
+    if (!logging_enabled || !pages || log_is_full) {
         return;
     }
     mutexlock();
@@ -139,33 +219,37 @@ void PIOS_DEBUGLOG_UAVObject(uint32_t objid, uint16_t instid, size_t size, uint8
  */
 void PIOS_DEBUGLOG_Printf(char *format, ...)
 {
-    if (!logging_enabled || !buffer || log_is_full) {
+    if (!logging_enabled || !pages || log_is_full) {
         return;
     }
 
     va_list args;
     va_start(args, format);
     mutexlock();
-    // flush any pending buffer before writing debug text
-    if (used_buffer_space) {
-        write_current_buffer();
+    // text gets a page of its own, after any pending uavobjects
+    if (pages_pending < LOG_PAGES && fill_page()->entry.Size) {
+        submit_page();
+    }
+    if (pages_pending == LOG_PAGES) {
+        dropped_count++;
+        mutexunlock();
+        va_end(args);
+        return;
     }
-    memset(buffer->Data, 0xff, sizeof(buffer->Data));
-    vsnprintf((char *)buffer->Data, sizeof(buffer->Data), (char *)format, args);
-    buffer->Flight     = flightnum;
-
-    buffer->FlightTime = PIOS_DELAY_GetuS();
 
-    buffer->Entry      = lognum;
-    buffer->Type       = DEBUGLOGENTRY_TYPE_TEXT;
-    buffer->ObjectID   = 0;
-    buffer->InstanceID = 0;
-    buffer->Size       = strlen((const char *)buffer->Data);
+    DebugLogEntryData *entry = &fill_page()->entry;
+    memset(entry->Data, 0xff, sizeof(entry->Data));
+    vsnprintf((char *)entry->Data, sizeof(entry->Data), (char *)format, args);
+    entry->FlightTime = PIOS_DELAY_GetuS();
+    entry->Type       = DEBUGLOGENTRY_TYPE_TEXT;
+    entry->ObjectID   = 0;
+    entry->InstanceID = 0;
+    entry->Size       = strlen((const char *)entry->Data);
+    fill_page()->num_records = 1;
 
-    if (PIOS_FLASHFS_ObjSave(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(flightnum), lognum, (uint8_t *)buffer, sizeof(DebugLogEntryData)) == 0) {
-        lognum++;
-    }
+    submit_page();
     mutexunlock();
+    va_end(args);
 }
 
 
@@ -200,9 +284,9 @@ void PIOS_DEBUGLOG_Info(uint16_t *flight, uint16_t *entry, uint16_t *free, uint1
         *flight = flightnum;
     }
     if (entry) {
-        *entry = lognum;
+        *entry = (lognum_flight == flightnum) ? lognum : 0;
     }
-    struct PIOS_FLASHFS_Stats stats = { 0, 0 };
+    struct PIOS_FLASHFS_Stats stats = { 0, 0, 0 };
     PIOS_FLASHFS_GetStats(pios_user_fs_id, &stats);
     if (free) {
         *free = stats.num_free_slots;
@@ -212,74 +296,213 @@ void PIOS_DEBUGLOG_Info(uint16_t *flight, uint16_t *entry, uint16_t *free, uint1
     }
 }
 
+/**
+ * @brief Retrieve the throughput of the logging system
+ * @param[out] bytes per second written to flash since the previous call
+ * @param[out] log records dropped so far, because the flush could not keep up, they were too large or writing them failed
+ */
+void PIOS_DEBUGLOG_Throughput(uint32_t *bytes_per_second, uint32_t *dropped)
+{
+    mutexlock();
+    uint32_t elapsed = PIOS_DELAY_GetuSSince(rate_time);
+    if (bytes_per_second) {
+        *bytes_per_second = elapsed ? (uint32_t)((uint64_t)(bytes_written - rate_bytes) * 1000000 / elapsed) : 0;
+    }
+    if (dropped) {
+        *dropped = dropped_count;
+    }
+    rate_bytes = bytes_written;
+    rate_time  = PIOS_DELAY_GetuS();
+    mutexunlock();
+}
+
 /**
  * @brief Format entire flash memory!!!
  */
 void PIOS_DEBUGLOG_Format(void)
 {
+    flushlock();
     mutexlock();
     PIOS_FLASHFS_Format(pios_user_fs_id);
-    lognum      = 0;
-    flightnum   = 0;
-    log_is_full = false;
-    fails_count = 0;
-    used_buffer_space = 0;
+    lognum        = 0;
+    lognum_flight = 0;
+    flightnum     = 0;
+    log_is_full   = false;
+    fails_count   = 0;
+    // anything not written yet is gone with the rest of the log
+    page_write    = 0;
+    pages_pending = 0;
+    if (pages) {
+        pages[0].entry.Size  = 0;
+        pages[0].num_objects = 0;
+    }
     mutexunlock();
+    flushunlock();
 }
 
-void enqueue_data(uint32_t objid, uint16_t instid, size_t size, uint8_t *data)
+/**
+ * @brief Run any pending flushes, for callers that need the log on flash now
+ */
+void PIOS_DEBUGLOG_Flush(void)
 {
-    DebugLogEntryData *entry;
-
-    // start a new block
-    if (!used_buffer_space) {
-        entry = buffer;
-        memset(buffer->Data, 0xff, sizeof(buffer->Data));
-        used_buffer_space += size;
-    } else {
-        // if an instance is being filled and there is enough space, does enqueues new data.
-        if (used_buffer_space + size + LOG_ENTRY_HEADER_SIZE > LOG_ENTRY_MAX_DATA_SIZE) {
-            buffer->Type = DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS;
-            if (!write_current_buffer()) {
-                return;
-            }
-            entry = buffer;
-            memset(buffer->Data, 0xff, sizeof(buffer->Data));
-            used_buffer_space += size;
-        } else {
-            entry = (DebugLogEntryData *)&buffer->Data[used_buffer_space];
-            used_buffer_space += size + LOG_ENTRY_HEADER_SIZE;
+    flush_pages();
+}
+
+/* NOTE: Must be called while holding the mutex, with pages_pending < LOG_PAGES */
+static struct log_page *fill_page()
+{
+    return &pages[(page_write + pages_pending) % LOG_PAGES];
+}
+
+/* NOTE: Must be called while holding the mutex */
+static void submit_page()
+{
+    struct log_page *page = fill_page();
+
+    page->entry.Flight = flightnum;
+    pages_pending++;
+
+    if (pages_pending < LOG_PAGES) {
+        page = fill_page();
+        page->entry.Size  = 0;
+        page->num_objects = 0;
+    }
+
+#if defined(PIOS_INCLUDE_CALLBACKSCHEDULER)
+    if (flushCallback) {
+        PIOS_CALLBACKSCHEDULER_Dispatch(flushCallback);
+        return;
+    }
+#endif
+    // no flush task, write it right away
+    flush_pages();
+}
+
+/* NOTE: Must be called while holding the mutex */
+static void enqueue_data(uint32_t objid, uint16_t instid, size_t size, uint8_t *data)
+{
+    if (pages_pending == LOG_PAGES) {
+        // both pages are waiting for the flash, drop rather than block the caller
+        dropped_count++;
+        return;
+    }
+
+    if (size > LOG_ENTRY_MAX_DATA_SIZE - LOG_RECORD_MAX_HEADER_SIZE) {
+        // records don't span pages, and a truncated one would read back as a valid update
+        dropped_count++;
+        return;
+    }
+
+    struct log_page *page = fill_page();
+    uint32_t now = PIOS_DELAY_GetuS();
+    uint8_t index;
+
+    for (index = 0; index < page->num_objects && page->objects[index] != objid; index++) {
+        ;
+    }
+    if (page->entry.Size + LOG_RECORD_MAX_HEADER_SIZE + size > LOG_ENTRY_MAX_DATA_SIZE ||
+        index == LOG_PAGE_MAX_OBJECTS) {
+        // page is full, hand it to the flush and start the next one
+        submit_page();
+        if (pages_pending == LOG_PAGES) {
+            dropped_count++;
+            return;
         }
+        page  = fill_page();
+        index = 0;
     }
 
-    entry->Flight     = flightnum;
-    entry->FlightTime = PIOS_DELAY_GetuS();
-    entry->Entry = lognum;
-    entry->Type = DEBUGLOGENTRY_TYPE_UAVOBJECT;
-    entry->ObjectID   = objid;
-    entry->InstanceID = instid;
-    if (size > sizeof(buffer->Data)) {
-        size = sizeof(buffer->Data);
+    DebugLogEntryData *entry = &page->entry;
+    if (!entry->Size) {
+        // start a new page
+        memset(entry->Data, 0xff, sizeof(entry->Data));
+        entry->FlightTime = now;
+        entry->Type       = DEBUGLOGENTRY_TYPE_UAVOBJECTSTREAM;
+        entry->ObjectID   = 0;
+        entry->InstanceID = 0;
+        page->last_time   = now;
+        page->num_objects = 0;
+        page->num_records = 0;
+    }
+
+    uint8_t *record = &entry->Data[entry->Size];
+    uint8_t *tag    = record++;
+    *tag = index;
+    if (index == page->num_objects) {
+        page->objects[page->num_objects++] = objid;
+        *tag |= LOG_RECORD_TAG_OBJECT;
+        memcpy(record, &objid, sizeof(objid));
+        record += sizeof(objid);
+    }
+    if (instid) {
+        *tag |= LOG_RECORD_TAG_INSTANCE;
+        memcpy(record, &instid, sizeof(instid));
+        record += sizeof(instid);
     }
-    entry->Size = size;
+    uint32_t delta = now - page->last_time;
+    page->last_time = now;
+    while (delta > 0x7F) {
+        *record++ = (delta & 0x7F) | 0x80;
+        delta   >>= 7;
+    }
+    *record++ = delta;
+    *record++ = size;
+    memcpy(record, data, size);
+    record   += size;
 
-    memcpy(entry->Data, data, size);
+    entry->Size = record - entry->Data;
+    page->num_records++;
 }
 
-bool write_current_buffer()
+/**
+ * @brief Write the pending pages to flash, from the flush callback
+ */
+static void flush_pages()
 {
-    // not enough space, write the block and start a new one
-    if (PIOS_FLASHFS_ObjSave(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(flightnum), lognum, (uint8_t *)buffer, sizeof(DebugLogEntryData)) == 0) {
-        lognum++;
-        fails_count = 0;
-        used_buffer_space = 0;
-    } else {
-        if (fails_count++ > MAX_CONSECUTIVE_FAILS_COUNT) {
-            log_is_full = true;
+    flushlock();
+    mutexlock();
+    while (pages_pending) {
+        struct log_page *page = &pages[page_write];
+        if (page->entry.Flight != lognum_flight) {
+            // pages are written in order, the first one of a flight starts its entries over
+            lognum_flight = page->entry.Flight;
+            lognum = 0;
+        }
+        page->entry.Entry = lognum;
+        mutexunlock();
+
+        // the page is not touched by anyone else until it is released below
+        int32_t rc = PIOS_FLASHFS_ObjSave(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(page->entry.Flight), page->entry.Entry, (uint8_t *)&page->entry, sizeof(DebugLogEntryData));
+
+        mutexlock();
+        if (rc == 0) {
+            lognum++;
+            fails_count    = 0;
+            bytes_written += sizeof(DebugLogEntryData);
+        } else {
+            // the entry number is used by the next page instead
+            dropped_count += page->num_records;
+            if (fails_count++ > MAX_CONSECUTIVE_FAILS_COUNT) {
+                log_is_full = true;
+            }
+        }
+        bool was_full = (pages_pending == LOG_PAGES);
+        page_write = (page_write + 1) % LOG_PAGES;
+        pages_pending--;
+        if (was_full) {
+            // a page is free again, start filling it
+            fill_page()->entry.Size  = 0;
+            fill_page()->num_objects = 0;
         }
-        return false;
     }
-    return true;
+    mutexunlock();
+    flushunlock();
+}
+
+/* NOTE: Must be called while holding the mutex, uses the first page as scratch buffer */
+static bool flight_exists(uint16_t flight)
+{
+    return PIOS_FLASHFS_ObjLoad(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(flight), 0, (uint8_t *)&pages[0].entry, sizeof(DebugLogEntryData)) == 0;
 }
 /**
  * @}
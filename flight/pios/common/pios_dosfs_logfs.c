@@ -264,6 +264,18 @@ int32_t PIOS_FLASHFS_GetStats(__attribute__((unused)) uintptr_t fs_id, __attribu
     return 0;
 }
 
+/**
+ * @brief Run one step of background garbage collection
+ * @param[in] fs_id The filesystem to use for this action
+ * @return 0 if success or error code
+ * @retval -1 if fs_id is not a valid filesystem instance
+ */
+int32_t PIOS_FLASHFS_GarbageCollectStep(__attribute__((unused)) uintptr_t fs_id)
+{
+    /* stub - not implemented */
+    return 0;
+}
+
 #endif /* PIOS_USE_SETTINGS_ON_SDCARD */
 
 /**
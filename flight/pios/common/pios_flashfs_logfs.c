@@ -43,6 +43,17 @@ enum pios_flashfs_logfs_dev_magic {
     PIOS_FLASHFS_LOGFS_DEV_MAGIC = 0x94938201,
 };
 
+/*
+ * Incremental garbage collection erases the next arena ahead of time, one
+ * sector per step, and then migrates the active slots into it a few at a time.
+ */
+enum logfs_gc_state {
+    LOGFS_GC_IDLE, /* one shot gc when the log is full */
+    LOGFS_GC_ERASING, /* erasing the sectors of the next arena */
+    LOGFS_GC_READY, /* next arena is erased, waiting for the log to fill up */
+    LOGFS_GC_MIGRATING, /* copying active slots into the next arena */
+};
+
 struct logfs_state {
     enum pios_flashfs_logfs_dev_magic magic;
     const struct flashfs_logfs_cfg    *cfg;
@@ -56,6 +67,23 @@ struct logfs_state {
     uint16_t num_free_slots; /* slots in free state */
     uint16_t num_active_slots; /* slots in active state */
 
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INDEX
+    /* Tag of the object in each slot of the active arena, 0 if the slot is not active.
+     * Lookups only read the slot headers from flash where the tag matches. */
+    uint16_t *slot_index;
+#endif
+
+    /* Incremental garbage collection, only used when cfg->gc_slots_per_step is set */
+    enum logfs_gc_state gc_state;
+    uint8_t  gc_arena_id; /* arena being erased or filled */
+    uint8_t  gc_sector_id; /* next sector of gc_arena_id to erase */
+    uint16_t gc_src_slot_id; /* next slot of the active arena to migrate */
+    uint16_t gc_dst_slot_id; /* next free slot of gc_arena_id */
+    uint16_t gc_dst_active_slots; /* active slots migrated into gc_arena_id */
+    uint8_t  *gc_migrated; /* one bit per active arena slot that was copied, NULL for one shot gc */
+
+    uint32_t max_blocking_time; /* longest time a single call held the flash, in us */
+
     /* Underlying flash driver glue */
     const struct pios_flash_driver *driver;
     uintptr_t flash_id;
@@ -111,24 +139,31 @@ struct arena_header {
 ****************************************/
 
 /**
- * @brief Erases all sectors within the given arena and sets arena to erased state.
+ * @brief Erases one sector of the given arena.
  * @return 0 if success, < 0 on failure
  * @note Must be called while holding the flash transaction lock
  */
-static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_id)
+static int32_t logfs_erase_arena_sector(const struct logfs_state *logfs, uint8_t arena_id, uint8_t sector_id)
 {
     uintptr_t arena_addr = logfs_get_addr(logfs, arena_id, 0);
 
-    /* Erase all of the sectors in the arena */
-    for (uint8_t sector_id = 0;
-         sector_id < (logfs->cfg->arena_size / logfs->cfg->sector_size);
-         sector_id++) {
-        if (logfs->driver->erase_sector(logfs->flash_id,
-                                        arena_addr + (sector_id * logfs->cfg->sector_size))) {
-            return -1;
-        }
+    if (logfs->driver->erase_sector(logfs->flash_id,
+                                    arena_addr + (sector_id * logfs->cfg->sector_size))) {
+        return -1;
     }
 
+    return 0;
+}
+
+/**
+ * @brief Sets an arena to erased state once all of its sectors have been erased.
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_mark_arena_erased(const struct logfs_state *logfs, uint8_t arena_id)
+{
+    uintptr_t arena_addr = logfs_get_addr(logfs, arena_id, 0);
+
     /* Mark this arena as fully erased */
     struct arena_header arena_hdr = {
         .magic = logfs->cfg->fs_magic,
@@ -139,6 +174,30 @@ static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_
                                   arena_addr,
                                   (uint8_t *)&arena_hdr,
                                   sizeof(arena_hdr)) != 0) {
+        return -1;
+    }
+
+    /* Arena is ready to be activated */
+    return 0;
+}
+
+/**
+ * @brief Erases all sectors within the given arena and sets arena to erased state.
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_id)
+{
+    /* Erase all of the sectors in the arena */
+    for (uint8_t sector_id = 0;
+         sector_id < (logfs->cfg->arena_size / logfs->cfg->sector_size);
+         sector_id++) {
+        if (logfs_erase_arena_sector(logfs, arena_id, sector_id) != 0) {
+            return -1;
+        }
+    }
+
+    if (logfs_mark_arena_erased(logfs, arena_id) != 0) {
         return -2;
     }
 
@@ -146,6 +205,27 @@ static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_
     return 0;
 }
 
+/**
+ * @brief Check whether an arena is fully erased and can be reserved without erasing it again
+ * @return true if the arena header says erased, false otherwise
+ * @note Must be called while holding the flash transaction lock
+ */
+static bool logfs_arena_is_erased(const struct logfs_state *logfs, uint8_t arena_id)
+{
+    struct arena_header arena_hdr;
+
+    if (logfs->driver->read_data(logfs->flash_id,
+                                 logfs_get_addr(logfs, arena_id, 0),
+                                 (uint8_t *)&arena_hdr,
+                                 sizeof(arena_hdr)) != 0) {
+        return false;
+    }
+
+    /* The header is only written once every sector has been erased */
+    return (arena_hdr.state == ARENA_STATE_ERASED) &&
+           (arena_hdr.magic == logfs->cfg->fs_magic);
+}
+
 /**
  * @brief Marks the given arena as reserved so it can be filled.
  * @return 0 if success, < 0 on failure
@@ -353,6 +433,36 @@ struct slot_header {
     uint16_t obj_size;
 } __attribute__((packed));
 
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INDEX
+/**
+ * @brief Compute the slot index tag of an object instance
+ * @return tag, never 0 since that marks slots without an active object
+ */
+static uint16_t logfs_index_tag(uint32_t obj_id, uint16_t obj_inst_id)
+{
+    uint16_t tag = (uint16_t)(obj_id ^ (obj_id >> 16) ^ (obj_inst_id * 0x9E37));
+
+    return tag ? tag : 1;
+}
+#endif
+
+/**
+ * @brief Update the slot index after a slot changed state
+ */
+static void logfs_index_update(struct logfs_state *logfs, uint16_t slot_id, const struct slot_header *slot_hdr)
+{
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INDEX
+    if (logfs->slot_index) {
+        logfs->slot_index[slot_id] = (slot_hdr->state == SLOT_STATE_ACTIVE) ?
+                                     logfs_index_tag(slot_hdr->obj_id, slot_hdr->obj_inst_id) : 0;
+    }
+#else
+    (void)logfs;
+    (void)slot_id;
+    (void)slot_hdr;
+#endif
+}
+
 /* NOTE: Must be called while holding the flash transaction lock */
 static int32_t logfs_raw_copy_bytes(const struct logfs_state *logfs, uintptr_t src_addr, uint16_t src_size, uintptr_t dst_addr)
 {
@@ -466,6 +576,7 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
         case SLOT_STATE_OBSOLETE:
             break;
         }
+        logfs_index_update(logfs, slot_id, &slot_hdr);
     }
 
     /* Scan is complete, mark the arena mounted */
@@ -475,6 +586,276 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
     return 0;
 }
 
+/*
+ * Incremental garbage collection
+ *
+ * Instead of copying the whole arena once the log is full, the next arena is
+ * erased one sector at a time ahead of need and the active slots are migrated
+ * into it a few per call.  When the migration has caught up with the end of
+ * the log the destination arena simply replaces the active one.  Every step
+ * holds the flash for at most one sector erase or gc_slots_per_step slot copies.
+ */
+
+/**
+ * @brief Prepare the arena after the active one as the next destination
+ * @note Must be called while holding the flash transaction lock
+ */
+static void logfs_gc_restart(struct logfs_state *logfs)
+{
+    if (!logfs->gc_migrated) {
+        logfs->gc_state = LOGFS_GC_IDLE;
+        return;
+    }
+
+    logfs->gc_arena_id  = (logfs->active_arena_id + 1) % (logfs->cfg->total_fs_size / logfs->cfg->arena_size);
+    logfs->gc_sector_id = 0;
+
+    /* Still erased after a format or from before a reboot */
+    logfs->gc_state     = logfs_arena_is_erased(logfs, logfs->gc_arena_id) ? LOGFS_GC_READY : LOGFS_GC_ERASING;
+}
+
+/*
+ * Has the migration to be started now to finish before the log is full?
+ * Every save uses up one free slot while migrating gc_slots_per_step slots,
+ * one of which is the slot just appended.  Without obsolete slots there is
+ * nothing to win yet.
+ */
+static bool logfs_gc_is_due(const struct logfs_state *logfs)
+{
+    uint16_t used_slots = (logfs->cfg->arena_size / logfs->cfg->slot_size) - 1 - logfs->num_free_slots;
+
+    return (used_slots > logfs->num_active_slots) &&
+           ((uint32_t)logfs->num_free_slots * (logfs->cfg->gc_slots_per_step - 1) <= used_slots);
+}
+
+/**
+ * @brief Count the slots migrated before the given active arena slot
+ * @return number of migrated slots below slot_id
+ */
+static uint16_t logfs_gc_migrated_before(const struct logfs_state *logfs, uint16_t slot_id)
+{
+    uint16_t count = 0;
+
+    for (uint16_t i = 0; i < slot_id / 8; i++) {
+        count += __builtin_popcount(logfs->gc_migrated[i]);
+    }
+    count += __builtin_popcount(logfs->gc_migrated[slot_id / 8] & ((1 << (slot_id % 8)) - 1));
+
+    return count;
+}
+
+/**
+ * @brief Obsolete the migrated copy of an active arena slot that was just obsoleted
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_obsolete_copy(struct logfs_state *logfs, uint16_t slot_id, const struct slot_header *slot_hdr)
+{
+    if (logfs->gc_state != LOGFS_GC_MIGRATING ||
+        !(logfs->gc_migrated[slot_id / 8] & (1 << (slot_id % 8)))) {
+        /* Not copied (yet), the migration will skip it */
+        return 0;
+    }
+
+    /* Slot 0 holds the arena header, the first migrated slot went to slot 1 */
+    uint16_t dst_slot_id = 1 + logfs_gc_migrated_before(logfs, slot_id);
+    uintptr_t dst_addr   = logfs_get_addr(logfs, logfs->gc_arena_id, dst_slot_id);
+
+    if (logfs->driver->write_data(logfs->flash_id,
+                                  dst_addr,
+                                  (uint8_t *)slot_hdr,
+                                  sizeof(*slot_hdr)) != 0) {
+        return -1;
+    }
+    logfs->gc_dst_active_slots--;
+
+    return 0;
+}
+
+/**
+ * @brief Make the fully migrated destination arena the active one
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_switch_arena(struct logfs_state *logfs)
+{
+    uint8_t src_arena_id = logfs->active_arena_id;
+    uint16_t num_slots   = logfs->cfg->arena_size / logfs->cfg->slot_size;
+
+    /* Activate the destination arena */
+    if (logfs_activate_arena(logfs, logfs->gc_arena_id) != 0) {
+        return -1;
+    }
+
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INDEX
+    /* Migrated slots keep their order, so the index can be compacted in place instead of rescanning the log */
+    if (logfs->slot_index) {
+        uint16_t dst_slot_id = 1;
+        for (uint16_t slot_id = 1; slot_id < logfs->gc_src_slot_id; slot_id++) {
+            if (logfs->gc_migrated[slot_id / 8] & (1 << (slot_id % 8))) {
+                logfs->slot_index[dst_slot_id++] = logfs->slot_index[slot_id];
+            }
+        }
+        for (; dst_slot_id < num_slots; dst_slot_id++) {
+            logfs->slot_index[dst_slot_id] = 0;
+        }
+    }
+#endif
+
+    /* Unmount the source arena */
+    if (logfs_unmount_log(logfs) != 0) {
+        return -2;
+    }
+
+    /* Obsolete the source arena */
+    if (logfs_obsolete_arena(logfs, src_arena_id) != 0) {
+        return -3;
+    }
+
+    /* Mount the new arena, the migration already counted its slots */
+    logfs->active_arena_id  = logfs->gc_arena_id;
+    logfs->num_active_slots = logfs->gc_dst_active_slots;
+    logfs->num_free_slots   = num_slots - logfs->gc_dst_slot_id;
+    logfs->mounted = true;
+
+    logfs_gc_restart(logfs);
+
+    return 0;
+}
+
+/**
+ * @brief Run one bounded step of incremental garbage collection
+ * @param[in] max_slots Number of active arena slots to migrate at most
+ * @param[in] erase Whether a sector may be erased in this step
+ * @param[in] force Start migrating even if the log has plenty of free slots left
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_step(struct logfs_state *logfs, uint16_t max_slots, bool erase, bool force)
+{
+    switch (logfs->gc_state) {
+    case LOGFS_GC_IDLE:
+        return 0;
+
+    case LOGFS_GC_ERASING:
+        if (!erase) {
+            return 0;
+        }
+        if (logfs_erase_arena_sector(logfs, logfs->gc_arena_id, logfs->gc_sector_id) != 0) {
+            return -1;
+        }
+        if (++logfs->gc_sector_id < (logfs->cfg->arena_size / logfs->cfg->sector_size)) {
+            return 0;
+        }
+        if (logfs_mark_arena_erased(logfs, logfs->gc_arena_id) != 0) {
+            return -2;
+        }
+        logfs->gc_state = LOGFS_GC_READY;
+        break;
+
+    case LOGFS_GC_READY:
+    case LOGFS_GC_MIGRATING:
+        break;
+    }
+
+    if (logfs->gc_state == LOGFS_GC_READY) {
+        if (!force && !logfs_gc_is_due(logfs)) {
+            return 0;
+        }
+
+        /* Reserve the destination arena so we can start filling it */
+        if (logfs_reserve_arena(logfs, logfs->gc_arena_id) != 0) {
+            logfs_gc_restart(logfs);
+            return -3;
+        }
+        memset(logfs->gc_migrated, 0, (logfs->cfg->arena_size / logfs->cfg->slot_size + 7) / 8);
+        logfs->gc_src_slot_id      = 1;
+        logfs->gc_dst_slot_id      = 1;
+        logfs->gc_dst_active_slots = 0;
+        logfs->gc_state = LOGFS_GC_MIGRATING;
+    }
+
+    /* Copy active slots, up to the end of the log which keeps growing while we migrate */
+    uint16_t log_end = (logfs->cfg->arena_size / logfs->cfg->slot_size) - logfs->num_free_slots;
+    while (max_slots-- && logfs->gc_src_slot_id < log_end) {
+        uint16_t src_slot_id = logfs->gc_src_slot_id;
+        struct slot_header slot_hdr;
+        uintptr_t src_addr   = logfs_get_addr(logfs, logfs->active_arena_id, src_slot_id);
+        if (logfs->driver->read_data(logfs->flash_id,
+                                     src_addr,
+                                     (uint8_t *)&slot_hdr,
+                                     sizeof(slot_hdr)) != 0) {
+            return -4;
+        }
+
+        if (slot_hdr.state == SLOT_STATE_ACTIVE) {
+            /* Never more destination than source slots in use, so this can't overflow */
+            uintptr_t dst_addr = logfs_get_addr(logfs, logfs->gc_arena_id, logfs->gc_dst_slot_id);
+            if (logfs_raw_copy_bytes(logfs,
+                                     src_addr,
+                                     sizeof(slot_hdr) + slot_hdr.obj_size,
+                                     dst_addr) != 0) {
+                return -5;
+            }
+            logfs->gc_migrated[src_slot_id / 8] |= (1 << (src_slot_id % 8));
+            logfs->gc_dst_slot_id++;
+            logfs->gc_dst_active_slots++;
+        }
+        logfs->gc_src_slot_id++;
+    }
+
+    if (logfs->gc_src_slot_id < log_end) {
+        return 0;
+    }
+
+    /* Everything has been copied */
+    if (logfs_gc_switch_arena(logfs) != 0) {
+        return -6;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Complete the incremental garbage collection in one go, for when the log is full
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_finish(struct logfs_state *logfs)
+{
+    /*
+     * Slots obsoleted after they had been copied still take up room in the
+     * destination arena.  If that leaves it full too, go around once more.
+     */
+    do {
+        uint8_t src_arena_id = logfs->active_arena_id;
+
+        while (logfs->active_arena_id == src_arena_id) {
+#ifdef PIOS_INCLUDE_WDG
+            PIOS_WDG_Clear();
+#endif
+            if (logfs_gc_step(logfs, UINT16_MAX, true, true) != 0) {
+                return -1;
+            }
+        }
+    } while (logfs_log_is_full(logfs));
+
+    return 0;
+}
+
+/**
+ * @brief Track the longest time a call held the flash transaction lock
+ * @param[in] start Raw delay timer value taken after the lock was acquired
+ */
+static void logfs_track_blocking_time(struct logfs_state *logfs, uint32_t start)
+{
+    uint32_t blocking_time = PIOS_DELAY_DiffuS(start);
+
+    if (blocking_time > logfs->max_blocking_time) {
+        logfs->max_blocking_time = blocking_time;
+    }
+}
+
 static bool PIOS_FLASHFS_Logfs_validate(const struct logfs_state *logfs)
 {
     return logfs && (logfs->magic == PIOS_FLASHFS_LOGFS_DEV_MAGIC);
@@ -537,6 +918,9 @@ int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg
     /* We must have at least 2 arenas for garbage collection to work */
     PIOS_Assert((cfg->total_fs_size / cfg->arena_size > 1));
 
+    /* Incremental garbage collection has to migrate more than the one slot each save uses up */
+    PIOS_Assert(cfg->gc_slots_per_step != 1);
+
     /* Make sure the underlying flash driver provides the minimal set of required methods */
     PIOS_Assert(driver->start_transaction);
     PIOS_Assert(driver->end_transaction);
@@ -559,6 +943,23 @@ int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg
     logfs->driver   = driver; /* lower-level flash driver */
     logfs->flash_id = flash_id; /* lower-level flash device id */
     logfs->mounted  = false;
+    logfs->max_blocking_time = 0;
+
+    logfs->gc_migrated = NULL;
+#if defined(PIOS_INCLUDE_FREERTOS)
+    if (cfg->gc_slots_per_step) {
+        /* Without memory for the migration bitmap fall back to one shot garbage collection */
+        logfs->gc_migrated = (uint8_t *)pios_malloc((cfg->arena_size / cfg->slot_size + 7) / 8);
+    }
+#endif
+
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INDEX
+    /* Without memory for the index lookups fall back to scanning the slot headers */
+    logfs->slot_index = NULL;
+    if (cfg->slot_index) {
+        logfs->slot_index = (uint16_t *)pios_malloc((cfg->arena_size / cfg->slot_size) * sizeof(uint16_t));
+    }
+#endif
 
     if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
         rc = -1;
@@ -598,7 +999,9 @@ int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg
         goto out_end_trans;
     }
 
-    /* Log has been mounted */
+    /* Log has been mounted, get the next arena ready */
+    logfs_gc_restart(logfs);
+
     rc     = 0;
 
     *fs_id = (uintptr_t)logfs;
@@ -621,6 +1024,18 @@ int32_t PIOS_FLASHFS_Logfs_Destroy(uintptr_t fs_id)
         goto out_exit;
     }
 
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INDEX
+    if (logfs->slot_index) {
+        pios_free(logfs->slot_index);
+        logfs->slot_index = NULL;
+    }
+#endif
+#if defined(PIOS_INCLUDE_FREERTOS)
+    if (logfs->gc_migrated) {
+        pios_free(logfs->gc_migrated);
+        logfs->gc_migrated = NULL;
+    }
+#endif
     PIOS_FLASHFS_Logfs_free(logfs);
     rc = 0;
 
@@ -714,9 +1129,19 @@ static int16_t logfs_object_find_next(const struct logfs_state *logfs, struct sl
         *curr_slot = 1;
     }
 
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INDEX
+    uint16_t tag = logfs_index_tag(obj_id, obj_inst_id);
+#endif
+
     for (uint16_t slot_id = *curr_slot;
          slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
          slot_id++) {
+#ifdef PIOS_INCLUDE_FLASH_LOGFS_INDEX
+        if (logfs->slot_index && logfs->slot_index[slot_id] != tag) {
+            /* Not active or holding another object, no need to look at the header */
+            continue;
+        }
+#endif
         uintptr_t slot_addr = logfs_get_addr(logfs, logfs->active_arena_id, slot_id);
 
         if (logfs->driver->read_data(logfs->flash_id,
@@ -771,6 +1196,13 @@ static int8_t logfs_delete_object(struct logfs_state *logfs, uint32_t obj_id, ui
             }
             /* Object has been successfully obsoleted and is no longer active */
             logfs->num_active_slots--;
+            logfs_index_update(logfs, curr_slot_id, &slot_hdr);
+
+            /* A copy made by the incremental garbage collection must go too */
+            if (logfs_gc_obsolete_copy(logfs, curr_slot_id, &slot_hdr) != 0) {
+                rc = -3;
+                goto out_exit;
+            }
             break;
         case -1:
             /* Search completed, object not found */
@@ -891,6 +1323,7 @@ static int8_t logfs_append_to_log(struct logfs_state *logfs, uint32_t obj_id, ui
 
     /* Object has been successfully written to the slot */
     logfs->num_active_slots++;
+    logfs_index_update(logfs, free_slot_id, &slot_hdr);
     return 0;
 }
 
@@ -917,6 +1350,8 @@ static int8_t logfs_append_to_log(struct logfs_state *logfs, uint32_t obj_id, ui
  * @retval -5 if garbage collection failed
  * @retval -6 if filesystem is full even after garbage collection should have freed space
  * @retval -7 if writing the new object to the filesystem failed
+ * @note With cfg->gc_slots_per_step set every save also runs one bounded step of the
+ *       incremental garbage collection, see @ref PIOS_FLASHFS_GarbageCollectStep
  */
 int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
 {
@@ -935,6 +1370,7 @@ int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
         rc = -2;
         goto out_exit;
     }
+    uint32_t start = PIOS_DELAY_GetRaw();
 
     if (logfs_delete_object(logfs, obj_id, obj_inst_id) != 0) {
         rc = -3;
@@ -956,7 +1392,7 @@ int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
     /* Is garbage collection required? */
     if (logfs_log_is_full(logfs)) {
         /* Note: Log Full means the log is full but may contain obsolete slots so gc may free some space */
-        if (logfs_garbage_collect(logfs) != 0) {
+        if ((logfs->gc_migrated ? logfs_gc_finish(logfs) : logfs_garbage_collect(logfs)) != 0) {
             rc = -5;
             goto out_end_trans;
         }
@@ -980,10 +1416,17 @@ int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
         goto out_end_trans;
     }
 
+    /*
+     * Keep the incremental garbage collection ahead of the log.  A failed step
+     * leaves the object saved and is retried by the next one.
+     */
+    logfs_gc_step(logfs, logfs->cfg->gc_slots_per_step, logfs_gc_is_due(logfs), false);
+
     /* Object successfully written to the log */
     rc = 0;
 
 out_end_trans:
+    logfs_track_blocking_time(logfs, start);
     logfs->driver->end_transaction(logfs->flash_id);
 
 out_exit:
@@ -1022,6 +1465,8 @@ int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
         goto out_exit;
     }
 
+    uint32_t start = PIOS_DELAY_GetRaw();
+
     /* Find the object in the log */
     uint16_t slot_id = 0;
     struct slot_header slot_hdr;
@@ -1055,6 +1500,7 @@ int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
     rc = 0;
 
 out_end_trans:
+    logfs_track_blocking_time(logfs, start);
     logfs->driver->end_transaction(logfs->flash_id);
 
 out_exit:
@@ -1086,6 +1532,7 @@ int32_t PIOS_FLASHFS_ObjDelete(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_in
         rc = -2;
         goto out_exit;
     }
+    uint32_t start = PIOS_DELAY_GetRaw();
 
     if (logfs_delete_object(logfs, obj_id, obj_inst_id) != 0) {
         rc = -3;
@@ -1096,6 +1543,7 @@ int32_t PIOS_FLASHFS_ObjDelete(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_in
     rc = 0;
 
 out_end_trans:
+    logfs_track_blocking_time(logfs, start);
     logfs->driver->end_transaction(logfs->flash_id);
 
 out_exit:
@@ -1148,6 +1596,7 @@ int32_t PIOS_FLASHFS_Format(uintptr_t fs_id)
         rc = -5;
         goto out_end_trans;
     }
+    logfs_gc_restart(logfs);
 
     /* Chip erased and log remounted successfully */
     rc = 0;
@@ -1172,10 +1621,60 @@ int32_t PIOS_FLASHFS_GetStats(uintptr_t fs_id, struct PIOS_FLASHFS_Stats *stats)
     if (!PIOS_FLASHFS_Logfs_validate(logfs)) {
         return -1;
     }
-    stats->num_active_slots = logfs->num_active_slots;
-    stats->num_free_slots   = logfs->num_free_slots;
+    stats->num_active_slots  = logfs->num_active_slots;
+    stats->num_free_slots    = logfs->num_free_slots;
+    stats->max_blocking_time = logfs->max_blocking_time;
     return 0;
 }
+
+/**
+ * @brief Run one bounded step of the incremental garbage collection
+ * @param[in] fs_id The filesystem to use for this action
+ * @return 0 if success or error code
+ * @retval -1 if fs_id is not a valid filesystem instance
+ * @retval -2 if failed to start transaction
+ * @retval -3 if the garbage collection step failed
+ * @note Meant to be called periodically from a low priority task.  Erases at most
+ *       one sector or migrates at most cfg->gc_slots_per_step slots, so that saves
+ *       rarely have to do either.  Does nothing with one shot garbage collection.
+ */
+int32_t PIOS_FLASHFS_GarbageCollectStep(uintptr_t fs_id)
+{
+    int32_t rc;
+
+    struct logfs_state *logfs = (struct logfs_state *)fs_id;
+
+    if (!PIOS_FLASHFS_Logfs_validate(logfs)) {
+        rc = -1;
+        goto out_exit;
+    }
+
+    if (logfs->gc_state == LOGFS_GC_IDLE || (logfs->gc_state == LOGFS_GC_READY && !logfs_gc_is_due(logfs))) {
+        /* Nothing to do, don't take the flash */
+        rc = 0;
+        goto out_exit;
+    }
+
+    if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
+        rc = -2;
+        goto out_exit;
+    }
+    uint32_t start = PIOS_DELAY_GetRaw();
+
+    if (logfs_gc_step(logfs, logfs->cfg->gc_slots_per_step, true, false) != 0) {
+        rc = -3;
+        goto out_end_trans;
+    }
+
+    rc = 0;
+
+out_end_trans:
+    logfs_track_blocking_time(logfs, start);
+    logfs->driver->end_transaction(logfs->flash_id);
+
+out_exit:
+    return rc;
+}
 #endif /* PIOS_INCLUDE_FLASH */
 
 /**
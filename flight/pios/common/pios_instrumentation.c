@@ -30,6 +30,12 @@ pios_perf_counter_t *pios_instrumentation_perf_counters = NULL;
 int8_t pios_instrumentation_max_counters = -1;
 int8_t pios_instrumentation_last_used_counter = -1;
 
+/* Emit external definitions of the inline helpers for callers that are built without optimisation */
+extern void PIOS_Instrumentation_updateCounter(pios_counter_t counter_handle, int32_t newValue);
+extern void PIOS_Instrumentation_TimeStart(pios_counter_t counter_handle);
+extern void PIOS_Instrumentation_TimeEnd(pios_counter_t counter_handle);
+extern void PIOS_Instrumentation_TrackPeriod(pios_counter_t counter_handle);
+
 void PIOS_Instrumentation_Init(int8_t maxCounters)
 {
     PIOS_Assert(maxCounters >= 0);
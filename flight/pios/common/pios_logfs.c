@@ -287,13 +287,26 @@ int32_t PIOS_FLASHFS_GetStats(
     getDeviceName(fs_id, devicename);
 
     // Get yaffs statistics for that device
-    stats->num_free_slots   = yaffs_freespace(devicename);
-    stats->num_active_slots = yaffs_totalspace(devicename) - stats->num_free_slots;
+    stats->num_free_slots    = yaffs_freespace(devicename);
+    stats->num_active_slots  = yaffs_totalspace(devicename) - stats->num_free_slots;
+    stats->max_blocking_time = 0;
 
     // Return device usage statistics
     return 0;
 }
 
+/**
+ * @brief Run one step of background garbage collection
+ * @param[in] fs_id The filesystem to use for this action
+ * @return 0 if success or error code
+ * @retval -1 if fs_id is not a valid filesystem instance
+ */
+int32_t PIOS_FLASHFS_GarbageCollectStep(__attribute__((unused)) uintptr_t fs_id)
+{
+    // yaffs collects its own garbage
+    return 0;
+}
+
 
 /**
  * @}
@@ -186,6 +186,14 @@ int32_t PIOS_CALLBACKSCHEDULER_Dispatch(DelayedCallbackInfo *cbinfo);
  */
 int32_t PIOS_CALLBACKSCHEDULER_DispatchFromISR(DelayedCallbackInfo *cbinfo, long *pxHigherPriorityTaskWoken);
 
+/**
+ * Execution times and dispatch latencies are counted in histograms with
+ * buckets growing by a factor of 4. Bucket n counts the times below 4^(n+1) us,
+ * the last one everything from 16384 us up.
+ * The timings are only kept with DIAG_TASKS, they cost 80 bytes per callback.
+ */
+#define CALLBACK_HISTOGRAM_BUCKETS 8
+
 /**
  * Information about a running callback that has been registered
  * via a call to PIOS_CALLBACKSCHEDULER_Create().
@@ -197,6 +205,16 @@ struct pios_callback_info {
     bool     is_running;
     /** Count of executions of the callback since system start */
     uint32_t running_time_count;
+#ifdef DIAG_TASKS
+    /** Worst case time from dispatch or schedule until execution in us */
+    uint32_t latency_max;
+    /** Worst case execution time in us, including any preemption by higher priority tasks */
+    uint32_t exec_time_max;
+    /** Execution times since system start, see CALLBACK_HISTOGRAM_BUCKETS */
+    uint32_t exec_time_histogram[CALLBACK_HISTOGRAM_BUCKETS];
+    /** Dispatch latencies since system start, see CALLBACK_HISTOGRAM_BUCKETS */
+    uint32_t latency_histogram[CALLBACK_HISTOGRAM_BUCKETS];
+#endif
 };
 
 /**
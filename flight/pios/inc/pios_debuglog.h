@@ -84,6 +84,18 @@ int32_t PIOS_DEBUGLOG_Read(void *buffer, uint16_t flight, uint16_t inst);
  */
 void PIOS_DEBUGLOG_Info(uint16_t *flight, uint16_t *entry, uint16_t *free, uint16_t *used);
 
+/**
+ * @brief Retrieve the throughput of the logging system
+ * @param[out] bytes per second written to flash since the previous call
+ * @param[out] log records dropped so far, because the flush could not keep up, they were too large or writing them failed
+ */
+void PIOS_DEBUGLOG_Throughput(uint32_t *bytes_per_second, uint32_t *dropped);
+
+/**
+ * @brief Run any pending flushes, for callers that need the log on flash now
+ */
+void PIOS_DEBUGLOG_Flush(void);
+
 /**
  * @brief Format entire flash memory!!!
  */
@@ -32,6 +32,7 @@
 struct PIOS_FLASHFS_Stats {
     uint16_t num_free_slots; /* slots in free state */
     uint16_t num_active_slots; /* slots in active state */
+    uint32_t max_blocking_time; /* longest time a single call held the flash, in us */
 };
 
 // define logfs subdirectory of a yaffs flash device
@@ -42,4 +43,5 @@ int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
 int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size);
 int32_t PIOS_FLASHFS_ObjDelete(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id);
 int32_t PIOS_FLASHFS_GetStats(uintptr_t fs_id, struct PIOS_FLASHFS_Stats *stats);
+int32_t PIOS_FLASHFS_GarbageCollectStep(uintptr_t fs_id);
 #endif /* PIOS_FLASHFS_H */
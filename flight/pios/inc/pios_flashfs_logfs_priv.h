@@ -39,6 +39,9 @@ struct flashfs_logfs_cfg {
     uint32_t start_offset; /* Offset into flash where this filesystem starts */
     uint32_t sector_size; /* Size of a flash erase block */
     uint32_t page_size; /* Maximum flash burst write size */
+
+    uint32_t gc_slots_per_step; /* Slots garbage collection migrates per save, 0 for one shot gc when the log is full */
+    uint32_t slot_index; /* Keep a RAM index of the active arena (2 bytes of heap per slot) with PIOS_INCLUDE_FLASH_LOGFS_INDEX, 0 to scan the slot headers */
 };
 
 int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg *cfg, const struct pios_flash_driver *driver, uintptr_t flash_id);
@@ -362,6 +362,80 @@ int32_t PIOS_COM_SendBuffer(uint32_t com_id, const uint8_t *buffer, uint16_t len
     return rc;
 }
 
+/**
+ * Reserves space for a package in the transmit buffer, so that it can be
+ * written in place instead of being copied (blocking function).
+ * PIOS_COM_CommitBuffer() must follow every successful reservation.
+ * \param[in] port COM port
+ * \param[out] span space for the package, in two parts when it wraps around
+ * \param[in] len package length
+ * \return -1 if port not available
+ * \return 0 if the package can never fit in the buffer, use PIOS_COM_SendBuffer()
+ * \return -3 if the space cannot be waited for
+ * \return number of bytes reserved on success
+ */
+int32_t PIOS_COM_ReserveBuffer(uint32_t com_id, t_fifo_span *span, uint16_t len)
+{
+    struct pios_com_dev *com_dev = PIOS_COM_find_dev(com_id);
+
+    if (!PIOS_COM_validate(com_dev)) {
+        /* Undefined COM port for this board (see pios_board.c) */
+        return -1;
+    }
+
+    PIOS_Assert(com_dev->has_tx);
+
+    if (len < 1 || len > fifoBuf_getSize(&com_dev->tx)) {
+        return 0;
+    }
+
+    while (fifoBuf_reserve(&com_dev->tx, span, len) != len) {
+#if defined(PIOS_INCLUDE_FREERTOS)
+        /* Make sure the transmitter is running while we wait */
+        if (com_dev->driver->tx_start) {
+            (com_dev->driver->tx_start)(com_dev->lower_id,
+                                        fifoBuf_getUsed(&com_dev->tx));
+        }
+        if (xSemaphoreTake(com_dev->tx_sem, portMAX_DELAY) != pdTRUE) {
+            return -3;
+        }
+#endif
+    }
+
+    return len;
+}
+
+/**
+ * Sends a package written to the space given by PIOS_COM_ReserveBuffer()
+ * \param[in] port COM port
+ * \param[in] len package length, zero to cancel the reservation
+ * \return -1 if port not available
+ * \return number of bytes transmitted on success
+ */
+int32_t PIOS_COM_CommitBuffer(uint32_t com_id, uint16_t len)
+{
+    struct pios_com_dev *com_dev = PIOS_COM_find_dev(com_id);
+
+    if (!PIOS_COM_validate(com_dev)) {
+        /* Undefined COM port for this board (see pios_board.c) */
+        return -1;
+    }
+
+    if (len > 0) {
+        PIOS_IRQ_Disable();
+        fifoBuf_commit(&com_dev->tx, len);
+        PIOS_IRQ_Enable();
+
+        /* More data has been put in the tx buffer, make sure the tx is started */
+        if (com_dev->driver->tx_start) {
+            com_dev->driver->tx_start(com_dev->lower_id,
+                                      fifoBuf_getUsed(&com_dev->tx));
+        }
+    }
+
+    return len;
+}
+
 /**
  * Sends a single character over given port
  * \param[in] port COM port
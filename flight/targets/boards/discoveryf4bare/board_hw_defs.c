@@ -586,6 +586,8 @@ static const struct flashfs_logfs_cfg flashfs_internal_cfg = {
     .start_offset  = EE_BANK_BASE, /* start after the bootloader */
     .sector_size   = 0x00004000, /* 16K bytes */
     .page_size     = 0x00004000, /* 16K bytes */
+
+    .slot_index    = 1,          /* 64 slots, 128 bytes of heap */
 };
 
 static const struct flashfs_logfs_cfg flashfs_internal_user_cfg = {
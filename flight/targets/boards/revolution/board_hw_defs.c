@@ -690,6 +690,9 @@ static const struct flashfs_logfs_cfg flashfs_external_user_cfg = {
     .start_offset  = 0x00040000, /* start offset */
     .sector_size   = 0x00010000, /* 64K bytes */
     .page_size     = 0x00000100, /* 256 bytes */
+
+    .gc_slots_per_step = 16, /* debug log keeps saving while flying, never stall it for a whole arena */
+    /* no slot index, the 3584 slots of an arena would take 7 KiB of heap */
 };
 
 static const struct flashfs_logfs_cfg flashfs_external_system_cfg = {
@@ -701,6 +704,8 @@ static const struct flashfs_logfs_cfg flashfs_external_system_cfg = {
     .start_offset  = 0,          /* start at the beginning of the chip */
     .sector_size   = 0x00010000, /* 64K bytes */
     .page_size     = 0x00000100, /* 256 bytes */
+
+    .slot_index    = 1,          /* 256 slots, 512 bytes of heap */
 };
 
 
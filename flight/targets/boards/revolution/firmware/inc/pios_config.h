@@ -57,7 +57,7 @@
 #define PIOS_INCLUDE_TASK_MONITOR
 
 #define PIOS_INCLUDE_INSTRUMENTATION
-#define PIOS_INSTRUMENTATION_MAX_COUNTERS 10
+#define PIOS_INSTRUMENTATION_MAX_COUNTERS 11
 
 /* PIOS hardware peripherals */
 #define PIOS_INCLUDE_IRQ
@@ -119,8 +119,10 @@
 /* #define PIOS_INCLUDE_SDCARD */
 /* #define LOG_FILENAME "startup.log" */
 #define PIOS_INCLUDE_FLASH
+#define PIOS_INCLUDE_FLASH_LOGFS_INDEX
 #define PIOS_INCLUDE_FLASH_INTERNAL
 #define PIOS_INCLUDE_FLASH_LOGFS_SETTINGS
+#define PIOS_INCLUDE_FLASH_LOGFS_INCREMENTAL_GC /* a filesystem sets gc_slots_per_step, collect its garbage in the background */
 #define FLASH_FREERTOS
 /* #define PIOS_INCLUDE_FLASH_EEPROM */
 
@@ -38,6 +38,8 @@
 #define PIOS_INCLUDE_FREERTOS
 #define PIOS_INCLUDE_CALLBACKSCHEDULER
 #define PIOS_INCLUDE_BL_HELPER
+#define PIOS_INCLUDE_INSTRUMENTATION
+#define PIOS_INSTRUMENTATION_MAX_COUNTERS 10
 
 /* Enable/Disable PiOS Modules */
 // #define PIOS_INCLUDE_ADC
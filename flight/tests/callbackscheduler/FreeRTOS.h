@@ -0,0 +1,38 @@
+#include <stdlib.h>
+#include <stdint.h>
+#define pvPortMalloc(xSize) (malloc(xSize))
+#define vPortFree(pv)       (free(pv))
+
+/* Mutexes are backed by pthread mutexes, binary semaphores are plain flags, see unittest_init.c */
+typedef void *xSemaphoreHandle;
+typedef void *xTaskHandle;
+typedef void *xQueueHandle;
+typedef void (*pdTASK_CODE)(void *);
+
+#define pdTRUE           1
+#define pdFALSE          0
+#define portMAX_DELAY    0xffffffff
+#define portTICK_RATE_MS 1
+#define tskIDLE_PRIORITY 0
+
+#define configMINIMAL_STACK_SIZE 128
+
+typedef uint32_t portTickType;
+
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex();
+xSemaphoreHandle xSemaphoreCreateBinary();
+int32_t xSemaphoreTake(xSemaphoreHandle semaphore, uint32_t ticks);
+int32_t xSemaphoreGive(xSemaphoreHandle semaphore);
+int32_t xSemaphoreGiveFromISR(xSemaphoreHandle semaphore, long *pxHigherPriorityTaskWoken);
+#define vSemaphoreCreateBinary(semaphore)     ((semaphore) = xSemaphoreCreateBinary())
+#define xSemaphoreTakeRecursive(mutex, ticks) xSemaphoreTake(mutex, ticks)
+#define xSemaphoreGiveRecursive(mutex)        xSemaphoreGive(mutex)
+
+/* There is only the test thread, critical sections have nothing to exclude */
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+#define portSET_INTERRUPT_MASK_FROM_ISR()     0
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)  ((void)(x))
+
+portTickType xTaskGetTickCount();
+int32_t xTaskCreate(pdTASK_CODE code, const char *name, uint16_t stackDepth, void *parameters, uint32_t priority, xTaskHandle *handle);
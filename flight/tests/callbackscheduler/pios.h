@@ -0,0 +1,32 @@
+#ifndef PIOS_H
+#define PIOS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <pios_helpers.h>
+
+/* PIOS Feature Selection */
+#include "pios_config.h"
+
+#define PIOS_Assert(x) \
+    if (!(x)) { while (1) {; } \
+    }
+#define PIOS_DEBUG_Assert(x) PIOS_Assert(x)
+#define PIOS_STATIC_ASSERT(test) ((void)sizeof(int[1 - 2 * !(test)]))
+
+#include <pios_delay.h>
+
+#ifdef PIOS_INCLUDE_FREERTOS
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+#include <pios_task_monitor.h>
+#endif
+#include "pios_mem.h"
+#include <pios_callbackscheduler.h>
+
+#endif /* PIOS_H */
@@ -0,0 +1,10 @@
+#ifndef TASKINFO_H
+#define TASKINFO_H
+
+/* Stand-in for the generated header */
+#define TASKINFO_RUNNING_CALLBACKSCHEDULER0 0
+#define TASKINFO_RUNNING_CALLBACKSCHEDULER1 1
+#define TASKINFO_RUNNING_CALLBACKSCHEDULER2 2
+#define TASKINFO_RUNNING_CALLBACKSCHEDULER3 3
+
+#endif /* TASKINFO_H */
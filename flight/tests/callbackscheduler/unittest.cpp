@@ -0,0 +1,362 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <string>
+#include <chrono>
+
+extern "C" {
+#include "openpilot.h"
+#include "unittest_priv.h"
+}
+
+#define STACK_SIZE     512
+#define NUM_LETTERS    6
+#define NUM_BENCH      240
+#define BENCH_RUNS     200000
+
+typedef std::chrono::steady_clock BenchClock;
+
+/* Callbacks named after the example in pios_callbackscheduler.h */
+static const char ut_letters[NUM_LETTERS + 1] = "ABcdxy";
+static DelayedCallbackInfo *ut_handle[NUM_LETTERS];
+static bool ut_redispatch;
+static std::string ut_order;
+static uint32_t ut_ran_at[NUM_LETTERS];
+static uint32_t ut_stop_after;
+
+static void recordRun(int n)
+{
+    ut_order += ut_letters[n];
+    ut_ran_at[n] = ut_tick;
+    if (ut_redispatch) {
+        PIOS_CALLBACKSCHEDULER_Dispatch(ut_handle[n]);
+    }
+    if (ut_order.size() == ut_stop_after) {
+        ut_stop_task();
+    }
+}
+
+template<int N>
+static void letterCallback(void)
+{
+    recordRun(N);
+}
+
+static const DelayedCallback ut_letter_cb[NUM_LETTERS] = {
+    letterCallback<0>, letterCallback<1>, letterCallback<2>,
+    letterCallback<3>, letterCallback<4>, letterCallback<5>
+};
+
+static const DelayedCallbackPriority ut_letter_priority[NUM_LETTERS] = {
+    CALLBACK_PRIORITY_CRITICAL, CALLBACK_PRIORITY_CRITICAL,
+    CALLBACK_PRIORITY_REGULAR,  CALLBACK_PRIORITY_REGULAR,
+    CALLBACK_PRIORITY_LOW,      CALLBACK_PRIORITY_LOW
+};
+
+static DelayedCallbackInfo *ut_bench_handle[NUM_BENCH];
+static uint32_t ut_bench_runs;
+
+// Each run makes another callback ready, the number of ready callbacks stays high
+static void benchCallback(void)
+{
+    PIOS_CALLBACKSCHEDULER_Dispatch(ut_bench_handle[(ut_bench_runs * 7) % NUM_BENCH]);
+    if (++ut_bench_runs == BENCH_RUNS) {
+        ut_stop_task();
+    }
+}
+
+static uint32_t ut_scheduled_runs;
+static uint32_t ut_last_run_at;
+static bool ut_runs_in_order;
+
+static void orderCallback(void)
+{
+    if (ut_tick < ut_last_run_at) {
+        ut_runs_in_order = false;
+    }
+    ut_last_run_at = ut_tick;
+    ut_scheduled_runs++;
+}
+
+struct LatencyCheck {
+    uint32_t callbacks;
+    uint32_t runs;
+};
+
+static void checkLatency(__attribute__((unused)) int16_t callback_id, const struct pios_callback_info *info, void *context)
+{
+    struct LatencyCheck *check = (struct LatencyCheck *)context;
+
+    check->callbacks++;
+    check->runs += info->running_time_count;
+    EXPECT_GT(1000000U, info->latency_max);
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class CallbackSchedulerTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        EXPECT_EQ(0, PIOS_CALLBACKSCHEDULER_Initialize());
+        ut_num_tasks  = 0;
+        ut_sleeps     = 0;
+        ut_redispatch = false;
+        ut_stop_after = 0;
+        ut_order.clear();
+        memset(ut_ran_at, 0, sizeof(ut_ran_at));
+        for (int n = 0; n < NUM_LETTERS; n++) {
+            ut_handle[n] = PIOS_CALLBACKSCHEDULER_Create(ut_letter_cb[n], ut_letter_priority[n], CALLBACK_TASK_AUXILIARY, n, STACK_SIZE);
+            ASSERT_TRUE(ut_handle[n] != NULL);
+        }
+    }
+
+    void dispatch(const char *letters)
+    {
+        for (const char *l = letters; *l; l++) {
+            PIOS_CALLBACKSCHEDULER_Dispatch(ut_handle[strchr(ut_letters, *l) - ut_letters]);
+        }
+    }
+
+    // Run the scheduler task until it sleeps past the given time or a callback stops it
+    void runUntil(uint32_t tick)
+    {
+        ut_run_until = tick;
+        if (!setjmp(ut_stop)) {
+            ut_task_code[0](ut_task_param[0]);
+        }
+    }
+
+    void start()
+    {
+        EXPECT_EQ(0, PIOS_CALLBACKSCHEDULER_Start());
+        ASSERT_EQ(1U, ut_num_tasks);
+    }
+};
+
+TEST_F(CallbackSchedulerTest, RoundRobinAcrossPriorities) {
+    ut_redispatch = true;
+    ut_stop_after = 37;
+    dispatch("ABcdxy");
+    start();
+    runUntil(ut_tick + 1000);
+
+    // A lower priority gets one slot per round through the higher one
+    EXPECT_EQ("xABcABdAByABcABdABxABcABdAByABcABdABx", ut_order);
+}
+
+TEST_F(CallbackSchedulerTest, RoundRobinSomeReady) {
+    ut_redispatch = true;
+    ut_stop_after = 16;
+    dispatch("Acx");
+    start();
+    runUntil(ut_tick + 1000);
+    EXPECT_EQ("xAcAxAcAxAcAxAcA", ut_order);
+
+    // Only A and y, equal treatment despite the different priorities
+    ut_redispatch = false;
+    ut_stop_after = 0;
+    ut_order.clear();
+    runUntil(ut_tick + 10);
+    ut_redispatch = true;
+    ut_stop_after = 10;
+    ut_order.clear();
+    dispatch("Ay");
+    runUntil(ut_tick + 1000);
+    EXPECT_EQ("yAyAyAyAyA", ut_order);
+}
+
+TEST_F(CallbackSchedulerTest, DispatchOnceRunsOnce) {
+    dispatch("AAcA");
+    start();
+    runUntil(ut_tick + 100);
+    // A new round starts with the slot for the lower priority
+    EXPECT_EQ("cA", ut_order);
+}
+
+TEST_F(CallbackSchedulerTest, ScheduledCallbacksRunInTimeOrder) {
+    const int32_t delay[NUM_LETTERS] = { 50, 10, 30, 20, 40, 35 };
+    uint32_t now = ut_tick;
+
+    for (int n = 0; n < NUM_LETTERS; n++) {
+        EXPECT_EQ(1, PIOS_CALLBACKSCHEDULER_Schedule(ut_handle[n], delay[n], CALLBACK_UPDATEMODE_NONE));
+    }
+    start();
+    runUntil(now + 100);
+
+    EXPECT_EQ("BdcyxA", ut_order);
+    for (int n = 0; n < NUM_LETTERS; n++) {
+        EXPECT_EQ(now + delay[n], ut_ran_at[n]) << ut_letters[n];
+    }
+    // The task only woke up for the scheduled callbacks
+    EXPECT_GE(8U, ut_sleeps);
+}
+
+TEST_F(CallbackSchedulerTest, ScheduledHeapSpansSegments) {
+    // More callbacks than the first segments of the delayed heap hold, scheduled out of order
+    const int count = 60;
+    uint32_t now    = ut_tick;
+
+    ut_scheduled_runs = 0;
+    ut_last_run_at    = 0;
+    ut_runs_in_order  = true;
+    for (int n = 0; n < count; n++) {
+        DelayedCallbackInfo *cb = PIOS_CALLBACKSCHEDULER_Create(orderCallback, CALLBACK_PRIORITY_REGULAR, CALLBACK_TASK_AUXILIARY, NUM_LETTERS + n, STACK_SIZE);
+        ASSERT_TRUE(cb != NULL);
+        EXPECT_EQ(1, PIOS_CALLBACKSCHEDULER_Schedule(cb, 10 + (n * 37) % count, CALLBACK_UPDATEMODE_NONE));
+    }
+    start();
+    runUntil(now + 100);
+
+    EXPECT_EQ((uint32_t)count, ut_scheduled_runs);
+    EXPECT_TRUE(ut_runs_in_order);
+}
+
+TEST_F(CallbackSchedulerTest, ScheduleUpdateModes) {
+    uint32_t now = ut_tick;
+
+    EXPECT_EQ(1, PIOS_CALLBACKSCHEDULER_Schedule(ut_handle[0], 50, CALLBACK_UPDATEMODE_NONE));
+    EXPECT_EQ(0, PIOS_CALLBACKSCHEDULER_Schedule(ut_handle[0], 20, CALLBACK_UPDATEMODE_NONE));
+    EXPECT_EQ(2, PIOS_CALLBACKSCHEDULER_Schedule(ut_handle[0], 20, CALLBACK_UPDATEMODE_SOONER));
+    EXPECT_EQ(1, PIOS_CALLBACKSCHEDULER_Schedule(ut_handle[1], 20, CALLBACK_UPDATEMODE_NONE));
+    EXPECT_EQ(2, PIOS_CALLBACKSCHEDULER_Schedule(ut_handle[1], 60, CALLBACK_UPDATEMODE_LATER));
+    EXPECT_EQ(1, PIOS_CALLBACKSCHEDULER_Schedule(ut_handle[2], 30, CALLBACK_UPDATEMODE_NONE));
+    EXPECT_EQ(2, PIOS_CALLBACKSCHEDULER_Schedule(ut_handle[2], 5, CALLBACK_UPDATEMODE_OVERRIDE));
+    start();
+    runUntil(now + 100);
+
+    EXPECT_EQ("cAB", ut_order);
+    EXPECT_EQ(now + 20, ut_ran_at[0]);
+    EXPECT_EQ(now + 60, ut_ran_at[1]);
+    EXPECT_EQ(now + 5, ut_ran_at[2]);
+}
+
+TEST_F(CallbackSchedulerTest, DispatchResetsSchedule) {
+    uint32_t now = ut_tick;
+
+    EXPECT_EQ(1, PIOS_CALLBACKSCHEDULER_Schedule(ut_handle[0], 50, CALLBACK_UPDATEMODE_NONE));
+    EXPECT_EQ(1, PIOS_CALLBACKSCHEDULER_Schedule(ut_handle[1], 70, CALLBACK_UPDATEMODE_NONE));
+    dispatch("A");
+    start();
+    runUntil(now + 100);
+
+    EXPECT_EQ("AB", ut_order);
+    EXPECT_EQ(now, ut_ran_at[0]);
+    EXPECT_EQ(now + 70, ut_ran_at[1]);
+}
+
+TEST_F(CallbackSchedulerTest, DispatchFromISR) {
+    long woken = pdFALSE;
+
+    start();
+    runUntil(ut_tick + 10);
+    EXPECT_EQ(pdTRUE, PIOS_CALLBACKSCHEDULER_DispatchFromISR(ut_handle[4], &woken));
+    EXPECT_EQ(pdTRUE, woken);
+    runUntil(ut_tick + 10);
+    EXPECT_EQ("x", ut_order);
+}
+
+TEST_F(CallbackSchedulerTest, DispatchLatencyReported) {
+    struct LatencyCheck check = { 0, 0 };
+
+    ut_redispatch = true;
+    ut_stop_after = 101;
+    dispatch("ABcdxy");
+    start();
+    runUntil(ut_tick + 1000);
+
+    PIOS_CALLBACKSCHEDULER_ForEachCallback(checkLatency, &check);
+    EXPECT_EQ((uint32_t)NUM_LETTERS, check.callbacks);
+    // The run that stopped the task is not counted
+    EXPECT_EQ(100U, check.runs);
+}
+
+static uint32_t ut_busy_us;
+
+static void busyCallback(void)
+{
+    uint32_t start = PIOS_DELAY_GetRaw();
+
+    while (PIOS_DELAY_DiffuS(start) < ut_busy_us) {
+        ;
+    }
+}
+
+static void getTiming(int16_t callback_id, const struct pios_callback_info *info, void *context)
+{
+    if (callback_id == 100) {
+        *(struct pios_callback_info *)context = *info;
+    }
+}
+
+TEST_F(CallbackSchedulerTest, ExecTimeHistogram) {
+    struct pios_callback_info info;
+    DelayedCallbackInfo *busy = PIOS_CALLBACKSCHEDULER_Create(busyCallback, CALLBACK_PRIORITY_REGULAR, CALLBACK_TASK_AUXILIARY, 100, STACK_SIZE);
+
+    ASSERT_TRUE(busy != NULL);
+    start();
+    // Two short runs and one in the 256 - 1023 us bucket
+    ut_busy_us = 0;
+    PIOS_CALLBACKSCHEDULER_Dispatch(busy);
+    runUntil(ut_tick + 10);
+    PIOS_CALLBACKSCHEDULER_Dispatch(busy);
+    runUntil(ut_tick + 10);
+    ut_busy_us = 300;
+    PIOS_CALLBACKSCHEDULER_Dispatch(busy);
+    runUntil(ut_tick + 10);
+
+    memset(&info, 0, sizeof(info));
+    PIOS_CALLBACKSCHEDULER_ForEachCallback(getTiming, &info);
+    EXPECT_EQ(3U, info.running_time_count);
+    EXPECT_LE(300U, info.exec_time_max);
+    EXPECT_EQ(2U, info.exec_time_histogram[0] + info.exec_time_histogram[1]);
+    EXPECT_EQ(1U, info.exec_time_histogram[4]);
+
+    uint32_t latencies = 0;
+    for (int n = 0; n < CALLBACK_HISTOGRAM_BUCKETS; n++) {
+        latencies += info.latency_histogram[n];
+    }
+    EXPECT_EQ(3U, latencies);
+}
+
+TEST_F(CallbackSchedulerTest, ScheduledLatencyFromDeadline) {
+    struct pios_callback_info info;
+    DelayedCallbackInfo *busy = PIOS_CALLBACKSCHEDULER_Create(busyCallback, CALLBACK_PRIORITY_REGULAR, CALLBACK_TASK_AUXILIARY, 100, STACK_SIZE);
+
+    ASSERT_TRUE(busy != NULL);
+    ut_busy_us = 0;
+    PIOS_CALLBACKSCHEDULER_Schedule(busy, 5, CALLBACK_UPDATEMODE_NONE);
+    // The scheduler only gets to run 20 ms after the callback was due
+    ut_tick += 25;
+    start();
+    runUntil(ut_tick + 10);
+
+    memset(&info, 0, sizeof(info));
+    PIOS_CALLBACKSCHEDULER_ForEachCallback(getTiming, &info);
+    EXPECT_EQ(1U, info.running_time_count);
+    EXPECT_LE(20000U, info.latency_max);
+    EXPECT_EQ(1U, info.latency_histogram[7]);
+}
+
+TEST_F(CallbackSchedulerTest, BenchmarkPickNext) {
+    for (int n = 0; n < NUM_BENCH; n++) {
+        ut_bench_handle[n] = PIOS_CALLBACKSCHEDULER_Create(benchCallback, (DelayedCallbackPriority)(n % 3), CALLBACK_TASK_AUXILIARY, n, STACK_SIZE);
+        ASSERT_TRUE(ut_bench_handle[n] != NULL);
+        PIOS_CALLBACKSCHEDULER_Dispatch(ut_bench_handle[n]);
+    }
+    // Scheduled far out, these sit in the delayed heap for the whole run
+    for (int n = 0; n < NUM_LETTERS; n++) {
+        PIOS_CALLBACKSCHEDULER_Schedule(ut_handle[n], 10000 + n, CALLBACK_UPDATEMODE_NONE);
+    }
+    start();
+    ut_bench_runs = 0;
+
+    BenchClock::time_point begin = BenchClock::now();
+    runUntil(ut_tick + 1000);
+    double perRun = std::chrono::duration<double, std::nano>(BenchClock::now() - begin).count() / ut_bench_runs;
+
+    EXPECT_EQ((uint32_t)BENCH_RUNS, ut_bench_runs);
+    printf("[ BENCH    ] %u callbacks, %u scheduled: %5.1f ns per dispatch and run\n",
+           NUM_BENCH + NUM_LETTERS, NUM_LETTERS, perRun);
+}
@@ -0,0 +1,124 @@
+/*
+ * Stand-ins for the parts of FreeRTOS and PiOS the callback scheduler calls out to.
+ * Everything runs on the test thread, time only moves while a scheduler task sleeps.
+ */
+
+#include <pthread.h>
+#include <time.h>
+
+#include "openpilot.h"
+#include "unittest_priv.h"
+
+uint32_t ut_tick;
+uint32_t ut_num_tasks;
+void (*ut_task_code[UT_MAX_TASKS])(void *);
+void *ut_task_param[UT_MAX_TASKS];
+jmp_buf ut_stop;
+uint32_t ut_run_until;
+uint32_t ut_sleeps;
+
+struct ut_semaphore {
+    bool binary;
+    bool given;
+    pthread_mutex_t mutex;
+};
+
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex()
+{
+    pthread_mutexattr_t attr;
+    struct ut_semaphore *semaphore = (struct ut_semaphore *)calloc(1, sizeof(struct ut_semaphore));
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&semaphore->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return (xSemaphoreHandle)semaphore;
+}
+
+xSemaphoreHandle xSemaphoreCreateBinary()
+{
+    struct ut_semaphore *semaphore = (struct ut_semaphore *)calloc(1, sizeof(struct ut_semaphore));
+
+    semaphore->binary = true;
+    semaphore->given  = true;
+    return (xSemaphoreHandle)semaphore;
+}
+
+int32_t xSemaphoreTake(xSemaphoreHandle handle, uint32_t ticks)
+{
+    struct ut_semaphore *semaphore = (struct ut_semaphore *)handle;
+
+    if (!semaphore->binary) {
+        return pthread_mutex_lock(&semaphore->mutex) == 0 ? pdTRUE : pdFALSE;
+    }
+    if (semaphore->given) {
+        semaphore->given = false;
+        return pdTRUE;
+    }
+    // Nobody else can give it, sleep for the full timeout
+    ut_sleeps++;
+    if (ut_run_until - ut_tick <= ticks) {
+        ut_tick = ut_run_until;
+        longjmp(ut_stop, 1);
+    }
+    ut_tick += ticks;
+    return pdFALSE;
+}
+
+int32_t xSemaphoreGive(xSemaphoreHandle handle)
+{
+    struct ut_semaphore *semaphore = (struct ut_semaphore *)handle;
+
+    if (!semaphore->binary) {
+        return pthread_mutex_unlock(&semaphore->mutex) == 0 ? pdTRUE : pdFALSE;
+    }
+    semaphore->given = true;
+    return pdTRUE;
+}
+
+int32_t xSemaphoreGiveFromISR(xSemaphoreHandle semaphore, long *pxHigherPriorityTaskWoken)
+{
+    *pxHigherPriorityTaskWoken = pdTRUE;
+    return xSemaphoreGive(semaphore);
+}
+
+portTickType xTaskGetTickCount()
+{
+    return ut_tick;
+}
+
+int32_t xTaskCreate(pdTASK_CODE code, __attribute__((unused)) const char *name, __attribute__((unused)) uint16_t stackDepth,
+                    void *parameters, __attribute__((unused)) uint32_t priority, xTaskHandle *handle)
+{
+    if (ut_num_tasks == UT_MAX_TASKS) {
+        return pdFALSE;
+    }
+    ut_task_code[ut_num_tasks]  = code;
+    ut_task_param[ut_num_tasks] = parameters;
+    *handle = parameters;
+    ut_num_tasks++;
+    return pdTRUE;
+}
+
+void ut_stop_task(void)
+{
+    longjmp(ut_stop, 1);
+}
+
+int32_t PIOS_TASK_MONITOR_RegisterTask(__attribute__((unused)) uint16_t task_id, __attribute__((unused)) xTaskHandle handle)
+{
+    return 0;
+}
+
+uint32_t PIOS_DELAY_GetRaw()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
+{
+    return PIOS_DELAY_GetRaw() - raw;
+}
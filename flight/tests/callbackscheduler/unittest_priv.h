@@ -0,0 +1,29 @@
+#ifndef UNITTEST_PRIV_H
+#define UNITTEST_PRIV_H
+
+#include <stdint.h>
+#include <setjmp.h>
+
+#define UT_MAX_TASKS 4
+
+/* Simulated system time, the scheduler reads it through xTaskGetTickCount() */
+extern uint32_t ut_tick;
+
+/* Scheduler tasks started through xTaskCreate() */
+extern uint32_t ut_num_tasks;
+extern void (*ut_task_code[UT_MAX_TASKS])(void *);
+extern void *ut_task_param[UT_MAX_TASKS];
+
+/*
+ * The scheduler tasks never return. A task run by the test ends with a
+ * longjmp() to ut_stop, either when it would sleep past ut_run_until or
+ * when ut_stop_task() is called from a callback.
+ */
+extern jmp_buf ut_stop;
+extern uint32_t ut_run_until;
+void ut_stop_task(void);
+
+/* Number of times a scheduler task went to sleep */
+extern uint32_t ut_sleeps;
+
+#endif /* UNITTEST_PRIV_H */
@@ -0,0 +1,15 @@
+#include <stdlib.h>
+#include <stdint.h>
+#define pvPortMalloc(xSize) (malloc(xSize))
+#define vPortFree(pv)       (free(pv))
+
+/* There is only the test thread, the recursive mutex just counts its depth, see unittest_init.c */
+typedef void *xSemaphoreHandle;
+
+#define pdTRUE           1
+#define portMAX_DELAY    0xffffffff
+#define tskIDLE_PRIORITY 0
+
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex();
+int32_t xSemaphoreTakeRecursive(xSemaphoreHandle mutex, uint32_t ticks);
+int32_t xSemaphoreGiveRecursive(xSemaphoreHandle mutex);
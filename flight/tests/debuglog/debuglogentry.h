@@ -0,0 +1,28 @@
+#ifndef DEBUGLOGENTRY_H
+#define DEBUGLOGENTRY_H
+
+#include <stdint.h>
+
+/* Stand-in for the generated header, fields are ordered by size like the generator does */
+#define DEBUGLOGENTRY_OBJID 0xDA69A1E4
+
+typedef enum __attribute__((packed)) {
+    DEBUGLOGENTRY_TYPE_EMPTY = 0,
+    DEBUGLOGENTRY_TYPE_TEXT  = 1,
+    DEBUGLOGENTRY_TYPE_UAVOBJECT = 2,
+    DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS = 3,
+    DEBUGLOGENTRY_TYPE_UAVOBJECTSTREAM    = 4
+} DebugLogEntryTypeOptions;
+
+typedef struct __attribute__((packed)) {
+    uint32_t FlightTime;
+    uint32_t ObjectID;
+    uint16_t Flight;
+    uint16_t Entry;
+    uint16_t InstanceID;
+    uint16_t Size;
+    DebugLogEntryTypeOptions Type;
+    uint8_t  Data[200];
+} DebugLogEntryData;
+
+#endif /* DEBUGLOGENTRY_H */
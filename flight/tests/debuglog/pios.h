@@ -0,0 +1,36 @@
+#ifndef PIOS_H
+#define PIOS_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/* PIOS Feature Selection */
+#include "pios_config.h"
+
+#define PIOS_Assert(x) \
+    if (!(x)) { while (1) {; } \
+    }
+#define PIOS_DEBUG_Assert(x) PIOS_Assert(x)
+
+#include <pios_delay.h>
+
+#ifdef PIOS_INCLUDE_FREERTOS
+/* FreeRTOS Includes */
+#include "FreeRTOS.h"
+#endif
+#include "pios_mem.h"
+#ifdef PIOS_INCLUDE_FLASH
+#include <pios_flash.h>
+#include <pios_flashfs.h>
+#endif
+#ifdef PIOS_INCLUDE_CALLBACKSCHEDULER
+#include <pios_callbackscheduler.h>
+#endif
+#include <pios_debuglog.h>
+
+#endif /* PIOS_H */
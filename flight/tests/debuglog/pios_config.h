@@ -0,0 +1,10 @@
+#ifndef PIOS_CONFIG_H
+#define PIOS_CONFIG_H
+
+/* Enable/Disable PiOS modules */
+#define PIOS_INCLUDE_FLASH
+#define PIOS_INCLUDE_FLASH_LOGFS_INDEX
+#define PIOS_INCLUDE_FREERTOS
+#define PIOS_INCLUDE_CALLBACKSCHEDULER
+
+#endif /* PIOS_CONFIG_H */
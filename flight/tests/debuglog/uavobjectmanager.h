@@ -0,0 +1,6 @@
+#ifndef UAVOBJECTMANAGER_H
+#define UAVOBJECTMANAGER_H
+
+/* Stand-in for the object manager, the log only needs the generated DebugLogEntry header */
+
+#endif /* UAVOBJECTMANAGER_H */
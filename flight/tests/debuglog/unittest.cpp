@@ -0,0 +1,459 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <vector>
+
+extern "C" {
+#include "openpilot.h"
+#include "unittest_priv.h"
+#include "debuglogentry.h"
+
+#include "pios_flash_ut_priv.h"
+
+extern struct pios_flash_ut_cfg flash_config;
+
+#include "pios_flashfs_logfs_priv.h"
+
+extern struct flashfs_logfs_cfg flashfs_config_user;
+extern uintptr_t pios_user_fs_id;
+}
+
+#define OBJ1_ID   0x12345678
+#define OBJ1_SIZE 20
+
+#define OBJ2_ID   0xABCDEFAB
+#define OBJ2_SIZE 37
+
+#define OBJ3_ID   0x99999999
+#define OBJ3_SIZE 4
+
+/* The test flash, with transactions that fail on demand to simulate write errors */
+static struct pios_flash_driver ut_flash_driver;
+static bool ut_fail_transactions;
+
+static int32_t ut_start_transaction(uintptr_t flash_id)
+{
+    if (ut_fail_transactions) {
+        return -1;
+    }
+    return pios_ut_flash_driver.start_transaction(flash_id);
+}
+
+struct record {
+    uint32_t objid;
+    uint16_t instid;
+    uint32_t time;
+    std::vector<uint8_t> data;
+};
+
+/* Decode one UAVObjectStream page the way the GCS does */
+static void decode_page(const DebugLogEntryData *entry, std::vector<struct record> *records)
+{
+    uint32_t objects[64];
+    uint8_t num_objects = 0;
+    uint32_t time = entry->FlightTime;
+    const uint8_t *p   = entry->Data;
+    const uint8_t *end = entry->Data + entry->Size;
+
+    while (p < end) {
+        struct record r;
+        uint8_t tag = *p++;
+        if (tag & 0x80) {
+            memcpy(&objects[num_objects++], p, 4);
+            p += 4;
+        }
+        ASSERT_LT(tag & 0x3F, num_objects);
+        r.objid  = objects[tag & 0x3F];
+        r.instid = 0;
+        if (tag & 0x40) {
+            memcpy(&r.instid, p, 2);
+            p += 2;
+        }
+        uint32_t delta = 0;
+        for (uint8_t shift = 0;; shift += 7) {
+            delta |= (uint32_t)(*p & 0x7F) << shift;
+            if (!(*p++ & 0x80)) {
+                break;
+            }
+        }
+        time  += delta;
+        r.time = time;
+        uint8_t size = *p++;
+        r.data.assign(p, p + size);
+        p     += size;
+        records->push_back(r);
+    }
+    EXPECT_EQ(end, p);
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class DebugLogTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        /* create an empty, appropriately sized flash filesystem */
+        FILE *theflash = fopen(FLASH_IMAGE_FILE, "wb");
+        uint8_t sector[flash_config.size_of_sector];
+
+        memset(sector, 0xFF, sizeof(sector));
+        for (uint32_t i = 0; i < flash_config.size_of_flash / flash_config.size_of_sector; i++) {
+            fwrite(sector, sizeof(sector), 1, theflash);
+        }
+        fclose(theflash);
+
+        for (uint32_t i = 0; i < sizeof(obj1); i++) {
+            obj1[i] = 0x10 + (i % 10);
+        }
+        for (uint32_t i = 0; i < sizeof(obj2); i++) {
+            obj2[i] = 0x20 + (i % 10);
+        }
+        for (uint32_t i = 0; i < sizeof(obj3); i++) {
+            obj3[i] = 0x30 + (i % 10);
+        }
+
+        ut_time_us = 1000;
+        ut_flash_driver = pios_ut_flash_driver;
+        ut_flash_driver.start_transaction = ut_start_transaction;
+        ut_fail_transactions = false;
+        EXPECT_EQ(0, PIOS_Flash_UT_Init(&flash_id, &flash_config));
+        EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&pios_user_fs_id, &flashfs_config_user, &ut_flash_driver, flash_id));
+        PIOS_DEBUGLOG_Initialize();
+    }
+
+    virtual void TearDown()
+    {
+        PIOS_DEBUGLOG_Enable(0);
+        ut_run_flush();
+        EXPECT_EQ(0U, ut_mutex_depth);
+        PIOS_FLASHFS_Logfs_Destroy(pios_user_fs_id);
+        PIOS_Flash_UT_Destroy(flash_id);
+    }
+
+    /* Log a mix of objects, advancing the clock by a varying amount */
+    void logRecords(uint32_t count, std::vector<struct record> *expected)
+    {
+        for (uint32_t i = 0; i < count; i++) {
+            struct record r;
+            switch (i % 3) {
+            case 0:
+                r.objid  = OBJ1_ID;
+                r.instid = 0;
+                r.data.assign(obj1, obj1 + sizeof(obj1));
+                break;
+            case 1:
+                r.objid  = OBJ2_ID;
+                r.instid = i % 2;
+                r.data.assign(obj2, obj2 + sizeof(obj2));
+                break;
+            default:
+                r.objid  = OBJ3_ID;
+                r.instid = 300;
+                r.data.assign(obj3, obj3 + sizeof(obj3));
+                break;
+            }
+            // mostly short gaps, now and then one that needs a longer varint
+            ut_time_us += (i % 7) ? 1000 + i : 300000;
+            r.time = ut_time_us;
+            PIOS_DEBUGLOG_UAVObject(r.objid, r.instid, r.data.size(), &r.data[0]);
+            if (expected) {
+                expected->push_back(r);
+            }
+        }
+    }
+
+    /* Read back all pages of a flight */
+    void readFlight(uint16_t flight, std::vector<struct record> *records, uint16_t *pages)
+    {
+        DebugLogEntryData entry;
+
+        *pages = 0;
+        while (PIOS_DEBUGLOG_Read(&entry, flight, *pages) == 0) {
+            EXPECT_EQ(flight, entry.Flight);
+            EXPECT_EQ(*pages, entry.Entry);
+            if (entry.Type == DEBUGLOGENTRY_TYPE_UAVOBJECTSTREAM) {
+                decode_page(&entry, records);
+            }
+            (*pages)++;
+        }
+    }
+
+    uintptr_t flash_id;
+
+    unsigned char obj1[OBJ1_SIZE];
+    unsigned char obj2[OBJ2_SIZE];
+    unsigned char obj3[OBJ3_SIZE];
+};
+
+TEST_F(DebugLogTest, DisabledLogsNothing) {
+    logRecords(100, NULL);
+    ut_run_flush();
+
+    DebugLogEntryData entry;
+    EXPECT_NE(0, PIOS_DEBUGLOG_Read(&entry, 0, 0));
+}
+
+TEST_F(DebugLogTest, StreamRoundTrip) {
+    std::vector<struct record> expected;
+    std::vector<struct record> records;
+    uint16_t pages;
+
+    PIOS_DEBUGLOG_Enable(1);
+    for (uint32_t i = 0; i < 300; i++) {
+        logRecords(1, &expected);
+        ut_run_flush();
+    }
+    PIOS_DEBUGLOG_Enable(0);
+    ut_run_flush();
+
+    readFlight(0, &records, &pages);
+    EXPECT_LT(0, pages);
+    ASSERT_EQ(expected.size(), records.size());
+    for (uint32_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(expected[i].objid, records[i].objid);
+        EXPECT_EQ(expected[i].instid, records[i].instid);
+        EXPECT_EQ(expected[i].time, records[i].time);
+        EXPECT_EQ(expected[i].data, records[i].data);
+    }
+}
+
+TEST_F(DebugLogTest, CallerDoesNotWriteFlash) {
+    std::vector<struct record> expected;
+
+    PIOS_DEBUGLOG_Enable(1);
+    uint32_t writes = PIOS_Flash_UT_GetWriteCount(flash_id);
+    uint32_t dispatches = ut_dispatch_count;
+
+    // enough to fill the first page, but not both
+    logRecords(8, &expected);
+
+    EXPECT_EQ(writes, PIOS_Flash_UT_GetWriteCount(flash_id));
+    EXPECT_LT(dispatches, ut_dispatch_count);
+
+    ut_run_flush();
+    EXPECT_LT(writes, PIOS_Flash_UT_GetWriteCount(flash_id));
+}
+
+TEST_F(DebugLogTest, DropsWhenFlushFallsBehind) {
+    uint32_t dropped;
+    uint32_t rate;
+
+    PIOS_DEBUGLOG_Throughput(&rate, &dropped);
+    uint32_t dropped_before = dropped;
+
+    PIOS_DEBUGLOG_Enable(1);
+    uint32_t writes = PIOS_Flash_UT_GetWriteCount(flash_id);
+    // the flush never runs, both pages fill up
+    logRecords(100, NULL);
+    EXPECT_EQ(writes, PIOS_Flash_UT_GetWriteCount(flash_id));
+
+    PIOS_DEBUGLOG_Throughput(&rate, &dropped);
+    EXPECT_LT(dropped_before, dropped);
+
+    // once flushed the log goes on where it left off
+    ut_run_flush();
+    std::vector<struct record> expected;
+    logRecords(3, &expected);
+    PIOS_DEBUGLOG_Enable(0);
+    ut_run_flush();
+
+    std::vector<struct record> records;
+    uint16_t pages;
+    readFlight(0, &records, &pages);
+    EXPECT_EQ(3, pages);
+    ASSERT_LE(3U, records.size());
+    EXPECT_EQ(expected[2].time, records.back().time);
+}
+
+TEST_F(DebugLogTest, PrintfGetsItsOwnPage) {
+    DebugLogEntryData entry;
+
+    PIOS_DEBUGLOG_Enable(1);
+    logRecords(2, NULL);
+    PIOS_DEBUGLOG_Printf((char *)"hello %d", 42);
+    ut_run_flush();
+
+    EXPECT_EQ(0, PIOS_DEBUGLOG_Read(&entry, 0, 0));
+    EXPECT_EQ(DEBUGLOGENTRY_TYPE_UAVOBJECTSTREAM, entry.Type);
+
+    EXPECT_EQ(0, PIOS_DEBUGLOG_Read(&entry, 0, 1));
+    EXPECT_EQ(DEBUGLOGENTRY_TYPE_TEXT, entry.Type);
+    EXPECT_EQ(8, entry.Size);
+    EXPECT_EQ(0, memcmp("hello 42", entry.Data, 8));
+}
+
+TEST_F(DebugLogTest, FailedWriteLeavesNoGap) {
+    DebugLogEntryData entry;
+    uint32_t rate;
+    uint32_t dropped_before;
+    uint32_t dropped;
+
+    PIOS_DEBUGLOG_Throughput(&rate, &dropped_before);
+    PIOS_DEBUGLOG_Enable(1);
+    PIOS_DEBUGLOG_Printf((char *)"first");
+    ut_run_flush();
+    ut_fail_transactions = true;
+    PIOS_DEBUGLOG_Printf((char *)"lost");
+    ut_run_flush();
+    ut_fail_transactions = false;
+    PIOS_DEBUGLOG_Printf((char *)"third");
+    ut_run_flush();
+
+    // the page that could not be written is counted, the next one takes its entry
+    PIOS_DEBUGLOG_Throughput(&rate, &dropped);
+    EXPECT_EQ(dropped_before + 1, dropped);
+    EXPECT_EQ(0, PIOS_DEBUGLOG_Read(&entry, 0, 0));
+    EXPECT_EQ(0, memcmp("first", entry.Data, 5));
+    EXPECT_EQ(0, PIOS_DEBUGLOG_Read(&entry, 0, 1));
+    EXPECT_EQ(1, entry.Entry);
+    EXPECT_EQ(0, memcmp("third", entry.Data, 5));
+    EXPECT_NE(0, PIOS_DEBUGLOG_Read(&entry, 0, 2));
+
+    uint16_t flight;
+    uint16_t next;
+    PIOS_DEBUGLOG_Info(&flight, &next, NULL, NULL);
+    EXPECT_EQ(0, flight);
+    EXPECT_EQ(2, next);
+}
+
+TEST_F(DebugLogTest, OversizedObjectIsDropped) {
+    DebugLogEntryData entry;
+    std::vector<uint8_t> large(sizeof(entry.Data), 0x55);
+    uint32_t rate;
+    uint32_t dropped_before;
+    uint32_t dropped;
+
+    PIOS_DEBUGLOG_Throughput(&rate, &dropped_before);
+    PIOS_DEBUGLOG_Enable(1);
+    PIOS_DEBUGLOG_UAVObject(OBJ2_ID, 0, large.size(), &large[0]);
+    PIOS_DEBUGLOG_UAVObject(OBJ1_ID, 0, sizeof(obj1), obj1);
+    PIOS_DEBUGLOG_Enable(0);
+    ut_run_flush();
+
+    PIOS_DEBUGLOG_Throughput(&rate, &dropped);
+    EXPECT_EQ(dropped_before + 1, dropped);
+
+    std::vector<struct record> records;
+    uint16_t pages;
+    readFlight(0, &records, &pages);
+    EXPECT_EQ(1, pages);
+    ASSERT_EQ(1U, records.size());
+    EXPECT_EQ((uint32_t)OBJ1_ID, records[0].objid);
+    EXPECT_EQ(sizeof(obj1), records[0].data.size());
+}
+
+TEST_F(DebugLogTest, InitFindsNextFlight) {
+    for (uint16_t flight = 0; flight < 37; flight++) {
+        PIOS_DEBUGLOG_Enable(1);
+        logRecords(3, NULL);
+        PIOS_DEBUGLOG_Enable(0);
+        ut_run_flush();
+    }
+
+    uint16_t flight;
+    uint16_t entry;
+    PIOS_DEBUGLOG_Info(&flight, &entry, NULL, NULL);
+    EXPECT_EQ(37, flight);
+
+    PIOS_DEBUGLOG_Initialize();
+    PIOS_DEBUGLOG_Info(&flight, &entry, NULL, NULL);
+    EXPECT_EQ(37, flight);
+    EXPECT_EQ(0, entry);
+}
+
+TEST_F(DebugLogTest, FormatDropsPendingPages) {
+    DebugLogEntryData entry;
+
+    PIOS_DEBUGLOG_Enable(1);
+    logRecords(100, NULL);
+    PIOS_DEBUGLOG_Format();
+    ut_run_flush();
+
+    EXPECT_NE(0, PIOS_DEBUGLOG_Read(&entry, 0, 0));
+
+    logRecords(3, NULL);
+    PIOS_DEBUGLOG_Enable(0);
+    ut_run_flush();
+    EXPECT_EQ(0, PIOS_DEBUGLOG_Read(&entry, 0, 0));
+    EXPECT_NE(0, PIOS_DEBUGLOG_Read(&entry, 0, 1));
+}
+
+TEST_F(DebugLogTest, Throughput) {
+    uint32_t rate;
+
+    PIOS_DEBUGLOG_Throughput(&rate, NULL);
+    PIOS_DEBUGLOG_Enable(1);
+
+    // 10 pages in the simulated time logRecords() takes
+    uint32_t start = ut_time_us;
+    uint16_t flight;
+    uint16_t entry = 0;
+    while (entry < 10) {
+        logRecords(1, NULL);
+        ut_run_flush();
+        PIOS_DEBUGLOG_Info(&flight, &entry, NULL, NULL);
+    }
+    uint32_t elapsed = ut_time_us - start;
+
+    PIOS_DEBUGLOG_Throughput(&rate, NULL);
+    EXPECT_EQ((uint64_t)10 * sizeof(DebugLogEntryData) * 1000000 / elapsed, rate);
+
+    // nothing written since the last call
+    ut_time_us += 1000000;
+    PIOS_DEBUGLOG_Throughput(&rate, NULL);
+    EXPECT_EQ(0U, rate);
+}
+
+/*
+ * Records per flash slot and caller side flash writes for 1000 updates of the
+ * object mix above. The previous format packed whole DebugLogEntry headers
+ * (16 bytes) in front of every object and saved the full buffer from the
+ * caller's context.
+ */
+TEST_F(DebugLogTest, BenchmarkRecordsPerSlot) {
+    const uint32_t count = 1000;
+    const uint32_t header = sizeof(DebugLogEntryData) - sizeof(((DebugLogEntryData *)0)->Data);
+    const uint32_t sizes[3] = { OBJ1_SIZE, OBJ2_SIZE, OBJ3_SIZE };
+
+    // the packing of the previous implementation
+    uint32_t old_slots = 1;
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t size = sizes[i % 3];
+        if (!used) {
+            used = size;
+        } else if (used + size + header > sizeof(((DebugLogEntryData *)0)->Data)) {
+            old_slots++;
+            used = size;
+        } else {
+            used += size + header;
+        }
+    }
+
+    PIOS_DEBUGLOG_Enable(1);
+    uint32_t writes = PIOS_Flash_UT_GetWriteCount(flash_id);
+    uint32_t caller_writes = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        logRecords(1, NULL);
+        caller_writes += PIOS_Flash_UT_GetWriteCount(flash_id) - writes;
+        ut_run_flush();
+        writes = PIOS_Flash_UT_GetWriteCount(flash_id);
+    }
+    PIOS_DEBUGLOG_Enable(0);
+    ut_run_flush();
+
+    uint16_t new_slots = 0;
+    DebugLogEntryData entry;
+    while (PIOS_DEBUGLOG_Read(&entry, 0, new_slots) == 0) {
+        new_slots++;
+    }
+
+    printf("[ BENCH    ] %u updates, per entry headers: %u slots (%.1f records/slot), caller saves %u\n",
+           count, old_slots, (double)count / old_slots, old_slots);
+    printf("[ BENCH    ] %u updates, streamed records: %u slots (%.1f records/slot), caller flash writes %u\n",
+           count, new_slots, (double)count / new_slots, caller_writes);
+
+    EXPECT_EQ(0U, caller_writes);
+    EXPECT_LT(new_slots, old_slots);
+}
@@ -0,0 +1,101 @@
+/*
+ * These need to be defined in a .c file so that we can use
+ * designated initializer syntax which c++ doesn't support (yet).
+ */
+
+#include "openpilot.h"
+#include "unittest_priv.h"
+#include "pios_flash_ut_priv.h"
+
+const struct pios_flash_ut_cfg flash_config = {
+    .size_of_flash  = 0x00100000,
+    .size_of_sector = 0x00010000,
+};
+
+#include "pios_flashfs_logfs_priv.h"
+
+/* Same layout as the revolution user partition, scaled down */
+const struct flashfs_logfs_cfg flashfs_config_user = {
+    .fs_magic      = 0x99abceff,
+    .total_fs_size = 0x00100000, /* 1M bytes (16 sectors = entire chip) */
+    .arena_size    = 0x00080000, /* biggest possible arena size fssize/2 */
+    .slot_size     = 0x00000100, /* 256 bytes */
+
+    .start_offset  = 0,          /* start at the beginning of the chip */
+    .sector_size   = 0x00010000, /* 64K bytes */
+    .page_size     = 0x00000100, /* 256 bytes */
+
+    .gc_slots_per_step = 16,
+};
+
+uintptr_t pios_user_fs_id;
+
+uint32_t ut_time_us;
+
+uint32_t PIOS_DELAY_GetuS()
+{
+    return ut_time_us;
+}
+
+uint32_t PIOS_DELAY_GetuSSince(uint32_t t)
+{
+    return ut_time_us - t;
+}
+
+uint32_t PIOS_DELAY_GetRaw()
+{
+    return ut_time_us;
+}
+
+uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
+{
+    return ut_time_us - raw;
+}
+
+uint32_t ut_mutex_depth;
+
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex()
+{
+    return (xSemaphoreHandle)&ut_mutex_depth;
+}
+
+int32_t xSemaphoreTakeRecursive(__attribute__((unused)) xSemaphoreHandle mutex, __attribute__((unused)) uint32_t ticks)
+{
+    ut_mutex_depth++;
+    return pdTRUE;
+}
+
+int32_t xSemaphoreGiveRecursive(__attribute__((unused)) xSemaphoreHandle mutex)
+{
+    ut_mutex_depth--;
+    return pdTRUE;
+}
+
+void (*ut_flush_callback)(void);
+uint32_t ut_dispatch_count;
+static bool flush_dispatched;
+
+DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(DelayedCallback cb,
+                                                   __attribute__((unused)) DelayedCallbackPriority priority,
+                                                   __attribute__((unused)) DelayedCallbackPriorityTask priorityTask,
+                                                   __attribute__((unused)) int16_t callbackID,
+                                                   __attribute__((unused)) uint32_t stacksize)
+{
+    ut_flush_callback = cb;
+    return (DelayedCallbackInfo *)&ut_flush_callback;
+}
+
+int32_t PIOS_CALLBACKSCHEDULER_Dispatch(__attribute__((unused)) DelayedCallbackInfo *cbinfo)
+{
+    ut_dispatch_count++;
+    flush_dispatched = true;
+    return 1;
+}
+
+void ut_run_flush(void)
+{
+    if (flush_dispatched) {
+        flush_dispatched = false;
+        ut_flush_callback();
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef UNITTEST_PRIV_H
+#define UNITTEST_PRIV_H
+
+#include <stdint.h>
+
+/* Simulated system time, the log reads it through PIOS_DELAY_GetuS() */
+extern uint32_t ut_time_us;
+
+/* Current depth of the recursive mutex held by the log */
+extern uint32_t ut_mutex_depth;
+
+/* The flush callback created by the log and the number of times it was dispatched */
+extern void (*ut_flush_callback)(void);
+extern uint32_t ut_dispatch_count;
+
+/* Run the flush callback like its scheduler task would, if it was dispatched */
+void ut_run_flush(void);
+
+#endif /* UNITTEST_PRIV_H */
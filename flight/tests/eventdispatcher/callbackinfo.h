@@ -0,0 +1,7 @@
+#ifndef CALLBACKINFO_H
+#define CALLBACKINFO_H
+
+/* Stand-in for the generated header */
+#define CALLBACKINFO_RUNNING_EVENTDISPATCHER 0
+
+#endif /* CALLBACKINFO_H */
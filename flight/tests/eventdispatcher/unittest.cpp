@@ -0,0 +1,304 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <chrono>
+
+extern "C" {
+#include "openpilot.h"
+#include "unittest_priv.h"
+}
+
+/* About what telemetry and logging register on a full build */
+#define NUM_PERIODIC 300
+#define RUN_TIME_MS  10000
+#define BURST_EVENTS 1000
+
+typedef std::chrono::steady_clock BenchClock;
+
+static uint32_t ut_fired[NUM_PERIODIC];
+static uint32_t ut_last_fired[NUM_PERIODIC];
+static uint32_t ut_bad_period[NUM_PERIODIC];
+static uint16_t ut_period[NUM_PERIODIC];
+
+// The first update comes right away, the later ones follow the randomised phase
+static void periodicCallback(UAVObjEvent *ev)
+{
+    uint16_t n = ev->instId;
+
+    if (ut_fired[n] > 1 && ut_tick - ut_last_fired[n] != ut_period[n]) {
+        ut_bad_period[n]++;
+    }
+    ut_fired[n]++;
+    ut_last_fired[n] = ut_tick;
+}
+
+static uint32_t ut_update_events;
+static uint16_t ut_update_instance;
+
+static void updateCallback(UAVObjEvent *ev)
+{
+    ut_update_events++;
+    ut_update_instance = ev->instId;
+}
+
+static uint16_t testPeriod(uint16_t n)
+{
+    return 10 * (1 + n % 50);
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class EventDispatcherTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        // The event task keeps its next update time across tests, time must not go back
+        ut_tick += 2 * RUN_TIME_MS;
+        EXPECT_EQ(0, EventDispatcherInitialize());
+        ASSERT_TRUE(ut_event_task != NULL);
+
+        memset(ut_fired, 0, sizeof(ut_fired));
+        memset(ut_bad_period, 0, sizeof(ut_bad_period));
+        ut_update_events = 0;
+    }
+
+    UAVObjEvent updateEvent(uint16_t instId)
+    {
+        UAVObjEvent ev;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.instId = instId;
+        ev.event  = EV_UPDATED;
+        return ev;
+    }
+
+    void createPeriodic(uint16_t n, uint16_t periodMs)
+    {
+        UAVObjEvent ev;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.instId     = n;
+        ev.event      = EV_UPDATED_PERIODIC;
+        ut_period[n]  = periodMs;
+        EXPECT_EQ(0, EventPeriodicCallbackCreate(&ev, periodicCallback, periodMs));
+    }
+
+    // Run the event task once per ms, the way the callback scheduler would when busy
+    void runFor(uint32_t ms)
+    {
+        for (uint32_t end = ut_tick + ms; ut_tick < end; ut_tick++) {
+            ut_event_task();
+        }
+    }
+};
+
+TEST_F(EventDispatcherTest, PeriodicCallbacksKeepTheirPeriod) {
+    for (uint16_t n = 0; n < NUM_PERIODIC; n++) {
+        createPeriodic(n, testPeriod(n));
+    }
+
+    runFor(RUN_TIME_MS);
+
+    for (uint16_t n = 0; n < NUM_PERIODIC; n++) {
+        // One extra for the immediate first update
+        EXPECT_NEAR(RUN_TIME_MS / testPeriod(n) + 1, ut_fired[n], 1) << "entry " << n;
+        EXPECT_EQ(0U, ut_bad_period[n]) << "entry " << n;
+    }
+}
+
+TEST_F(EventDispatcherTest, PeriodicCreateDuplicate) {
+    UAVObjEvent ev;
+
+    createPeriodic(0, 100);
+    memset(&ev, 0, sizeof(ev));
+    ev.event = EV_UPDATED_PERIODIC;
+    EXPECT_EQ(-1, EventPeriodicCallbackCreate(&ev, periodicCallback, 100));
+}
+
+TEST_F(EventDispatcherTest, PeriodicUpdateChangesPeriod) {
+    UAVObjEvent ev;
+
+    createPeriodic(0, 100);
+    createPeriodic(1, 100);
+    runFor(1000);
+    EXPECT_NEAR(10, ut_fired[0], 1);
+
+    // Faster, then stopped
+    memset(&ev, 0, sizeof(ev));
+    ev.event = EV_UPDATED_PERIODIC;
+    ut_period[0] = 10;
+    EXPECT_EQ(0, EventPeriodicCallbackUpdate(&ev, periodicCallback, 10));
+    ut_fired[0]  = 0;
+    runFor(1000);
+    // The new period applies once the event task wakes up for the previously scheduled update
+    EXPECT_LE(90U, ut_fired[0]);
+    EXPECT_GE(101U, ut_fired[0]);
+    EXPECT_EQ(0U, ut_bad_period[0]);
+
+    EXPECT_EQ(0, EventPeriodicCallbackUpdate(&ev, periodicCallback, 0));
+    ut_fired[0] = 0;
+    runFor(1000);
+    EXPECT_EQ(0U, ut_fired[0]);
+
+    // And started again
+    EXPECT_EQ(0, EventPeriodicCallbackUpdate(&ev, periodicCallback, 10));
+    runFor(1000);
+    EXPECT_LE(90U, ut_fired[0]);
+    EXPECT_GE(101U, ut_fired[0]);
+
+    // The other entry is not affected
+    EXPECT_NEAR(40, ut_fired[1], 1);
+    EXPECT_EQ(0U, ut_bad_period[1]);
+
+    ev.instId = 2;
+    EXPECT_EQ(-1, EventPeriodicCallbackUpdate(&ev, periodicCallback, 10));
+}
+
+TEST_F(EventDispatcherTest, PeriodicQueue) {
+    UAVObjEvent ev;
+    xQueueHandle queue = xQueueCreate(20, sizeof(UAVObjEvent));
+
+    memset(&ev, 0, sizeof(ev));
+    ev.instId = 7;
+    ev.event  = EV_UPDATED_PERIODIC;
+    EXPECT_EQ(0, EventPeriodicQueueCreate(&ev, queue, 100));
+
+    runFor(1000);
+
+    uint32_t received = 0;
+    while (xQueueReceive(queue, &ev, 0) == pdTRUE) {
+        EXPECT_EQ(7, ev.instId);
+        received++;
+    }
+    EXPECT_NEAR(10, received, 1);
+}
+
+TEST_F(EventDispatcherTest, NextUpdateIsScheduled) {
+    createPeriodic(0, 100);
+    runFor(1);
+
+    // Nothing is due until the next period
+    EXPECT_GT(ut_schedule_delay, 0);
+    EXPECT_LE(ut_schedule_delay, 100);
+}
+
+TEST_F(EventDispatcherTest, DispatchStats) {
+    EventStats stats;
+
+    for (uint16_t n = 0; n < 10; n++) {
+        createPeriodic(n, 100);
+    }
+    EventClearStats();
+    runFor(1000);
+
+    EventGetStats(&stats);
+    EXPECT_LE(stats.lastDispatchTime, stats.maxDispatchTime);
+    EXPECT_LE(stats.lastDispatchCount, 10);
+    EXPECT_EQ(0U, stats.eventErrors);
+}
+
+TEST_F(EventDispatcherTest, BenchmarkPeriodicUpdates) {
+    EventStats stats;
+
+    for (uint16_t n = 0; n < NUM_PERIODIC; n++) {
+        createPeriodic(n, testPeriod(n));
+    }
+    EventClearStats();
+
+    BenchClock::time_point start = BenchClock::now();
+    runFor(RUN_TIME_MS);
+    double perTick = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / RUN_TIME_MS;
+
+    uint32_t fired = 0;
+    for (uint16_t n = 0; n < NUM_PERIODIC; n++) {
+        fired += ut_fired[n];
+    }
+    EventGetStats(&stats);
+    printf("[ BENCH    ] %u periodic entries: %7.1f ns per tick, %.1f due per tick, max tick %u us\n",
+           NUM_PERIODIC, perTick, (double)fired / RUN_TIME_MS, stats.maxDispatchTime);
+}
+
+TEST_F(EventDispatcherTest, CoalescedCallbackMergesUpdates) {
+    EventCoalescedCallback *coalesced = EventCoalescedCallbackCreate(updateCallback);
+    UAVObjEvent ev = updateEvent(0);
+
+    ASSERT_TRUE(coalesced != NULL);
+    EventClearStats();
+    for (uint32_t n = 0; n < 5; n++) {
+        EXPECT_EQ(pdTRUE, EventCallbackDispatchCoalesced(coalesced, &ev));
+    }
+    runFor(1);
+    EXPECT_EQ(1U, ut_update_events);
+
+    // Idle again, the next update is dispatched
+    EXPECT_EQ(pdTRUE, EventCallbackDispatchCoalesced(coalesced, &ev));
+    runFor(1);
+    EXPECT_EQ(2U, ut_update_events);
+
+    EventStats stats;
+    EventGetStats(&stats);
+    EXPECT_EQ(4U, stats.coalescedEvents);
+
+    EventCoalescedCallbackDelete(coalesced);
+}
+
+TEST_F(EventDispatcherTest, CoalescedCallbackOtherInstance) {
+    EventCoalescedCallback *coalesced = EventCoalescedCallbackCreate(updateCallback);
+    UAVObjEvent ev0 = updateEvent(0);
+    UAVObjEvent ev1 = updateEvent(1);
+
+    // The pending event is for instance 0, instance 1 goes through the queue
+    EXPECT_EQ(pdTRUE, EventCallbackDispatchCoalesced(coalesced, &ev0));
+    EXPECT_EQ(pdTRUE, EventCallbackDispatchCoalesced(coalesced, &ev1));
+    runFor(1);
+    EXPECT_EQ(2U, ut_update_events);
+
+    EventCoalescedCallbackDelete(coalesced);
+}
+
+TEST_F(EventDispatcherTest, CoalescedCallbackDeletedWhilePending) {
+    EventCoalescedCallback *coalesced = EventCoalescedCallbackCreate(updateCallback);
+    UAVObjEvent ev = updateEvent(0);
+
+    EXPECT_EQ(pdTRUE, EventCallbackDispatchCoalesced(coalesced, &ev));
+    EventCoalescedCallbackDelete(coalesced);
+    runFor(1);
+    EXPECT_EQ(0U, ut_update_events);
+}
+
+// A burst of updates faster than the event task runs, like a high rate sensor
+TEST_F(EventDispatcherTest, BenchmarkUpdateBurst) {
+    EventCoalescedCallback *coalesced = EventCoalescedCallbackCreate(updateCallback);
+    UAVObjEvent ev = updateEvent(0);
+    uint32_t dropped = 0;
+
+    BenchClock::time_point start = BenchClock::now();
+    for (uint32_t n = 0; n < BURST_EVENTS; n++) {
+        if (EventCallbackDispatch(&ev, updateCallback) != pdTRUE) {
+            dropped++;
+        }
+    }
+    double queued = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / BURST_EVENTS;
+    runFor(1);
+    uint32_t queuedEvents  = ut_update_events;
+    uint32_t queuedDropped = dropped;
+
+    ut_update_events = 0;
+    dropped = 0;
+    start = BenchClock::now();
+    for (uint32_t n = 0; n < BURST_EVENTS; n++) {
+        if (EventCallbackDispatchCoalesced(coalesced, &ev) != pdTRUE) {
+            dropped++;
+        }
+    }
+    double merged = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / BURST_EVENTS;
+    runFor(1);
+
+    EXPECT_EQ(0U, dropped);
+    EXPECT_EQ(1U, ut_update_events);
+    printf("[ BENCH    ] %u updates in one burst: queued %5.1f ns each, %u dropped, %u callbacks; coalesced %5.1f ns each, %u dropped, %u callbacks\n",
+           BURST_EVENTS, queued, queuedDropped, queuedEvents, merged, dropped, ut_update_events);
+
+    EventCoalescedCallbackDelete(coalesced);
+}
@@ -0,0 +1,134 @@
+/*
+ * Stand-ins for the parts of the firmware the event dispatcher calls out to.
+ * Everything runs on the test thread, time only moves when the test says so.
+ */
+
+#include <pthread.h>
+#include <time.h>
+
+#include "openpilot.h"
+#include "unittest_priv.h"
+
+uint32_t ut_tick;
+void (*ut_event_task)(void);
+int32_t ut_schedule_delay;
+
+struct ut_queue {
+    uint32_t length;
+    uint32_t itemSize;
+    uint32_t head;
+    uint32_t count;
+    uint8_t  items[];
+};
+
+static xSemaphoreHandle createMutex(int type)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutex_t *mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t));
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, type);
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return (xSemaphoreHandle)mutex;
+}
+
+xSemaphoreHandle xSemaphoreCreateMutex()
+{
+    return createMutex(PTHREAD_MUTEX_NORMAL);
+}
+
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex()
+{
+    return createMutex(PTHREAD_MUTEX_RECURSIVE);
+}
+
+int32_t xSemaphoreTake(xSemaphoreHandle mutex, __attribute__((unused)) uint32_t ticks)
+{
+    return pthread_mutex_lock((pthread_mutex_t *)mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+int32_t xSemaphoreGive(xSemaphoreHandle mutex)
+{
+    return pthread_mutex_unlock((pthread_mutex_t *)mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+portTickType xTaskGetTickCount()
+{
+    return ut_tick;
+}
+
+xQueueHandle xQueueCreate(uint32_t length, uint32_t itemSize)
+{
+    struct ut_queue *queue = (struct ut_queue *)malloc(sizeof(struct ut_queue) + length * itemSize);
+
+    queue->length   = length;
+    queue->itemSize = itemSize;
+    queue->head     = 0;
+    queue->count    = 0;
+    return (xQueueHandle)queue;
+}
+
+int32_t xQueueSend(xQueueHandle handle, const void *item, __attribute__((unused)) uint32_t ticks)
+{
+    struct ut_queue *queue = (struct ut_queue *)handle;
+
+    if (queue->count == queue->length) {
+        return pdFALSE;
+    }
+    memcpy(&queue->items[((queue->head + queue->count) % queue->length) * queue->itemSize], item, queue->itemSize);
+    queue->count++;
+    return pdTRUE;
+}
+
+int32_t xQueueReceive(xQueueHandle handle, void *item, __attribute__((unused)) uint32_t ticks)
+{
+    struct ut_queue *queue = (struct ut_queue *)handle;
+
+    if (queue->count == 0) {
+        return pdFALSE;
+    }
+    memcpy(item, &queue->items[queue->head * queue->itemSize], queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+uint32_t PIOS_DELAY_GetRaw()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
+{
+    return PIOS_DELAY_GetRaw() - raw;
+}
+
+DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(DelayedCallback cb,
+                                                   __attribute__((unused)) DelayedCallbackPriority priority,
+                                                   __attribute__((unused)) DelayedCallbackPriorityTask priorityTask,
+                                                   __attribute__((unused)) int16_t callbackID,
+                                                   __attribute__((unused)) uint32_t stacksize)
+{
+    ut_event_task = cb;
+    return (DelayedCallbackInfo *)&ut_event_task;
+}
+
+int32_t PIOS_CALLBACKSCHEDULER_Schedule(__attribute__((unused)) DelayedCallbackInfo *cbinfo, int32_t milliseconds, __attribute__((unused)) DelayedCallbackUpdateMode updatemode)
+{
+    ut_schedule_delay = milliseconds;
+    return 1;
+}
+
+int32_t PIOS_CALLBACKSCHEDULER_Dispatch(__attribute__((unused)) DelayedCallbackInfo *cbinfo)
+{
+    return -1;
+}
+
+uint32_t UAVObjGetID(__attribute__((unused)) UAVObjHandle obj)
+{
+    return 0;
+}
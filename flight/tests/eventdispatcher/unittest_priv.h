@@ -0,0 +1,15 @@
+#ifndef UNITTEST_PRIV_H
+#define UNITTEST_PRIV_H
+
+#include <stdint.h>
+
+/* Simulated system time, the dispatcher reads it through xTaskGetTickCount() */
+extern uint32_t ut_tick;
+
+/* Callback the dispatcher registered with the callback scheduler */
+extern void (*ut_event_task)(void);
+
+/* Delay requested by the last PIOS_CALLBACKSCHEDULER_Schedule() */
+extern int32_t ut_schedule_delay;
+
+#endif /* UNITTEST_PRIV_H */
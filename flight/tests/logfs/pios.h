@@ -8,7 +8,10 @@
 /* FreeRTOS Includes */
 #include "FreeRTOS.h"
 #endif
+#include <stdint.h>
+#include <string.h>
 #include "pios_mem.h"
+#include <pios_delay.h>
 #ifdef PIOS_INCLUDE_FLASH
 #include <pios_flash.h>
 #include <pios_flashfs.h>
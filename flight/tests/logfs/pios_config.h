@@ -3,6 +3,7 @@
 
 /* Enable/Disable PiOS modules */
 #define PIOS_INCLUDE_FLASH
+#define PIOS_INCLUDE_FLASH_LOGFS_INDEX
 // #define PIOS_FLASHFS_LOGFS_MAX_DEVS 5
 #define PIOS_INCLUDE_FREERTOS
 
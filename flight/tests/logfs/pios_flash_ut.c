@@ -15,6 +15,9 @@ struct flash_ut_dev {
     const struct pios_flash_ut_cfg *cfg;
     bool transaction_in_progress;
     FILE *flash_file;
+    uint32_t read_count;
+    uint32_t erase_count;
+    uint32_t write_count;
 };
 
 static struct flash_ut_dev *PIOS_Flash_UT_Alloc(void)
@@ -40,6 +43,9 @@ int32_t PIOS_Flash_UT_Init(uintptr_t *flash_id, const struct pios_flash_ut_cfg *
 
     flash_dev->cfg = cfg;
     flash_dev->transaction_in_progress = false;
+    flash_dev->read_count  = 0;
+    flash_dev->erase_count = 0;
+    flash_dev->write_count = 0;
 
     flash_dev->flash_file = fopen(FLASH_IMAGE_FILE, "rb+");
     if (flash_dev->flash_file == NULL) {
@@ -55,6 +61,27 @@ int32_t PIOS_Flash_UT_Init(uintptr_t *flash_id, const struct pios_flash_ut_cfg *
     return 0;
 }
 
+uint32_t PIOS_Flash_UT_GetReadCount(uintptr_t flash_id)
+{
+    struct flash_ut_dev *flash_dev = (struct flash_ut_dev *)flash_id;
+
+    return flash_dev->read_count;
+}
+
+uint32_t PIOS_Flash_UT_GetEraseCount(uintptr_t flash_id)
+{
+    struct flash_ut_dev *flash_dev = (struct flash_ut_dev *)flash_id;
+
+    return flash_dev->erase_count;
+}
+
+uint32_t PIOS_Flash_UT_GetWriteCount(uintptr_t flash_id)
+{
+    struct flash_ut_dev *flash_dev = (struct flash_ut_dev *)flash_id;
+
+    return flash_dev->write_count;
+}
+
 int32_t PIOS_Flash_UT_Destroy(uintptr_t flash_id)
 {
     /* Check inputs */
@@ -110,6 +137,8 @@ static int32_t PIOS_Flash_UT_EraseSector(uintptr_t flash_id, uint32_t addr)
 
     assert(flash_dev->transaction_in_progress);
 
+    flash_dev->erase_count++;
+
     if (fseek(flash_dev->flash_file, addr, SEEK_SET) != 0) {
         assert(0);
     }
@@ -135,6 +164,8 @@ static int32_t PIOS_Flash_UT_WriteData(uintptr_t flash_id, uint32_t addr, uint8_
 
     assert(flash_dev->transaction_in_progress);
 
+    flash_dev->write_count++;
+
     if (fseek(flash_dev->flash_file, addr, SEEK_SET) != 0) {
         assert(0);
     }
@@ -156,6 +187,8 @@ static int32_t PIOS_Flash_UT_ReadData(uintptr_t flash_id, uint32_t addr, uint8_t
 
     assert(flash_dev->transaction_in_progress);
 
+    flash_dev->read_count++;
+
     if (fseek(flash_dev->flash_file, addr, SEEK_SET) != 0) {
         assert(0);
     }
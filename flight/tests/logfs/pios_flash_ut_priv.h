@@ -8,6 +8,14 @@ struct pios_flash_ut_cfg {
 int32_t PIOS_Flash_UT_Init(uintptr_t *flash_id, const struct pios_flash_ut_cfg *cfg);
 
 int32_t PIOS_Flash_UT_Destroy(uintptr_t flash_id);
+
+/* Number of read_data calls so far, every one is a bus transfer on real flash */
+uint32_t PIOS_Flash_UT_GetReadCount(uintptr_t flash_id);
+
+/* Number of erase_sector calls so far, each one stalls real flash for a long time */
+uint32_t PIOS_Flash_UT_GetEraseCount(uintptr_t flash_id);
+
+uint32_t PIOS_Flash_UT_GetWriteCount(uintptr_t flash_id);
 extern const struct pios_flash_driver pios_ut_flash_driver;
 
 #if !defined(FLASH_IMAGE_FILE)
@@ -3,6 +3,8 @@
 #include <stdio.h> /* printf */
 #include <stdlib.h> /* abort */
 #include <string.h> /* memset */
+#include <algorithm>
+#include <chrono>
 
 extern "C" {
 #include "pios_flash.h" /* PIOS_FLASH_* API */
@@ -14,6 +16,7 @@ extern struct pios_flash_ut_cfg flash_config;
 
 extern struct flashfs_logfs_cfg flashfs_config_partition_a;
 extern struct flashfs_logfs_cfg flashfs_config_partition_b;
+extern struct flashfs_logfs_cfg flashfs_config_incremental;
 
 #include "pios_flashfs.h" /* PIOS_FLASHFS_* */
 }
@@ -297,6 +300,57 @@ TEST_F(LogfsTestCooked, WriteManyVerify) {
     EXPECT_EQ(0, memcmp(obj3, obj3_check, sizeof(obj3)));
 }
 
+/* Settings sized objects filling most of the arena, the way a full settings partition looks at boot */
+#define BENCH_OBJECTS 200
+
+TEST_F(LogfsTestCooked, BenchmarkLookupFlashReads) {
+    typedef std::chrono::steady_clock BenchClock;
+    unsigned char obj1_check[OBJ1_SIZE];
+
+    for (uint32_t i = 0; i < BENCH_OBJECTS; i++) {
+        obj1[0] = i;
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID + i, i % 3, obj1, sizeof(obj1)));
+    }
+
+    /* Remount, the lookups must work from what the mount scan finds */
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+
+    uint32_t reads = PIOS_Flash_UT_GetReadCount(flash_id);
+    BenchClock::time_point start = BenchClock::now();
+    for (uint32_t i = 0; i < BENCH_OBJECTS; i++) {
+        obj1[0] = i;
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID + i, i % 3, obj1_check, sizeof(obj1_check)));
+        EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+    }
+    double loadTime = std::chrono::duration<double, std::micro>(BenchClock::now() - start).count() / BENCH_OBJECTS;
+    double loadReads = (double)(PIOS_Flash_UT_GetReadCount(flash_id) - reads) / BENCH_OBJECTS;
+
+    /* Other instances of the same objects are not there */
+    reads = PIOS_Flash_UT_GetReadCount(flash_id);
+    for (uint32_t i = 0; i < BENCH_OBJECTS; i++) {
+        EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID + i, 3, obj1_check, sizeof(obj1_check)));
+    }
+    double missReads = (double)(PIOS_Flash_UT_GetReadCount(flash_id) - reads) / BENCH_OBJECTS;
+
+    /* Saving again obsoletes the old version and appends, gc included */
+    reads = PIOS_Flash_UT_GetReadCount(flash_id);
+    for (uint32_t i = 0; i < BENCH_OBJECTS; i++) {
+        obj1_alt[0] = i;
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID + i, i % 3, obj1_alt, sizeof(obj1_alt)));
+    }
+    double saveReads = (double)(PIOS_Flash_UT_GetReadCount(flash_id) - reads) / BENCH_OBJECTS;
+
+    for (uint32_t i = 0; i < BENCH_OBJECTS; i++) {
+        obj1_alt[0] = i;
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID + i, i % 3, obj1_check, sizeof(obj1_check)));
+        EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+    }
+
+    printf("[ BENCH    ] %u objects: %.1f flash reads per load (%.1f us), %.1f per missing object, %.1f per save\n",
+           BENCH_OBJECTS, loadReads, loadTime, missReads, saveReads);
+}
+
 class LogfsTestCookedMultiPart : public LogfsTestRaw {
 protected:
     virtual void SetUp()
@@ -392,3 +446,192 @@ TEST_F(LogfsTestCookedMultiPart, WriteLarge) {
     memset(obj4_check, 0, sizeof(obj4_check));
     EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id_b, OBJ4_ID, 0, obj4_check, sizeof(obj4_check)));
 }
+
+/* Objects kept alive while the incremental garbage collection churns through the arenas */
+#define GC_OBJECTS 100
+#define GC_SAVES   20000
+
+class LogfsTestIncremental : public LogfsTestRaw {
+protected:
+    virtual void SetUp()
+    {
+        LogfsTestRaw::SetUp();
+
+        EXPECT_EQ(0, PIOS_Flash_UT_Init(&flash_id, &flash_config));
+        EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_incremental, &pios_ut_flash_driver, flash_id));
+
+        memset(version, 0, sizeof(version));
+    }
+
+    virtual void TearDown()
+    {
+        PIOS_FLASHFS_Logfs_Destroy(fs_id);
+        PIOS_Flash_UT_Destroy(flash_id);
+    }
+
+    /* Save a new version of object n, deleted objects come back */
+    void save(uint32_t n)
+    {
+        version[n]++;
+        if (version[n] == 0) {
+            version[n] = 1;
+        }
+        obj1[0] = version[n];
+        obj1[1] = n;
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID + n, 0, obj1, sizeof(obj1))) << "object " << n;
+    }
+
+    void remove(uint32_t n)
+    {
+        version[n] = 0;
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID + n, 0));
+    }
+
+    /* Every object has its latest version and the deleted ones are gone */
+    void verify()
+    {
+        unsigned char obj1_check[OBJ1_SIZE];
+        uint16_t live = 0;
+
+        for (uint32_t n = 0; n < GC_OBJECTS; n++) {
+            if (version[n] == 0) {
+                EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID + n, 0, obj1_check, sizeof(obj1_check))) << "object " << n;
+                continue;
+            }
+            live++;
+            ASSERT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID + n, 0, obj1_check, sizeof(obj1_check))) << "object " << n;
+            EXPECT_EQ(version[n], obj1_check[0]) << "object " << n;
+            EXPECT_EQ((uint8_t)n, obj1_check[1]) << "object " << n;
+            EXPECT_EQ(0, memcmp(obj1 + 2, obj1_check + 2, sizeof(obj1) - 2)) << "object " << n;
+        }
+
+        struct PIOS_FLASHFS_Stats stats;
+        EXPECT_EQ(0, PIOS_FLASHFS_GetStats(fs_id, &stats));
+        EXPECT_EQ(live, stats.num_active_slots);
+    }
+
+    uintptr_t flash_id;
+    uintptr_t fs_id;
+    uint8_t version[GC_OBJECTS];
+};
+
+TEST_F(LogfsTestIncremental, FillFilesystemAndGarbageCollect) {
+    /* Fill up the entire filesystem, the migration can't keep up so the last saves finish it */
+    for (uint32_t i = 0; i < (flashfs_config_incremental.arena_size / flashfs_config_incremental.slot_size) - 1; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+    }
+
+    EXPECT_EQ(-4, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1_alt, sizeof(obj1_alt)));
+
+    unsigned char obj1_check[OBJ1_SIZE];
+    for (uint32_t i = 1; i < (flashfs_config_incremental.arena_size / flashfs_config_incremental.slot_size) - 1; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+        EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+    }
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+}
+
+TEST_F(LogfsTestIncremental, ChurnWithBackgroundSteps) {
+    for (uint32_t n = 0; n < GC_OBJECTS; n++) {
+        save(n);
+    }
+
+    /* With the background keeping the next arena erased, saves never erase */
+    uint32_t save_erases = 0;
+    for (uint32_t i = 0; i < GC_SAVES; i++) {
+        uint32_t erases = PIOS_Flash_UT_GetEraseCount(flash_id);
+        save((i * 7) % GC_OBJECTS);
+        save_erases += PIOS_Flash_UT_GetEraseCount(flash_id) - erases;
+
+        if (i % 4 == 0) {
+            EXPECT_EQ(0, PIOS_FLASHFS_GarbageCollectStep(fs_id));
+        }
+    }
+    verify();
+
+    EXPECT_EQ(0U, save_erases);
+    /* Every arena has been used a couple of times */
+    EXPECT_LT(2 * flashfs_config_incremental.total_fs_size / flashfs_config_incremental.sector_size,
+              PIOS_Flash_UT_GetEraseCount(flash_id));
+}
+
+TEST_F(LogfsTestIncremental, ChurnWithDeletes) {
+    /* No background steps, saves do all of the work, deletes hit slots already migrated */
+    for (uint32_t i = 0; i < GC_SAVES; i++) {
+        uint32_t n = (i * 13) % GC_OBJECTS;
+        if (i % 5 == 0) {
+            remove((n + 50) % GC_OBJECTS);
+        }
+        save(n);
+        if (i % 1000 == 0) {
+            verify();
+        }
+    }
+    verify();
+}
+
+TEST_F(LogfsTestIncremental, RemountWhileMigrating) {
+    for (uint32_t i = 0; i < GC_SAVES / 4; i++) {
+        save((i * 7) % GC_OBJECTS);
+
+        if (i % 97 == 0) {
+            /* The half filled destination arena is thrown away and erased again */
+            PIOS_FLASHFS_Logfs_Destroy(fs_id);
+            ASSERT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_incremental, &pios_ut_flash_driver, flash_id));
+            verify();
+        }
+    }
+    verify();
+}
+
+TEST_F(LogfsTestIncremental, FormatKeepsWorking) {
+    for (uint32_t i = 0; i < GC_SAVES / 4; i++) {
+        save(i % GC_OBJECTS);
+    }
+    EXPECT_EQ(0, PIOS_FLASHFS_Format(fs_id));
+    memset(version, 0, sizeof(version));
+    verify();
+
+    for (uint32_t i = 0; i < GC_SAVES / 4; i++) {
+        save(i % GC_OBJECTS);
+    }
+    verify();
+}
+
+/* Worst case cost of a single save while logging continuously */
+TEST_F(LogfsTestIncremental, BenchmarkWorstCaseSave) {
+    struct flashfs_logfs_cfg oneshot_config = flashfs_config_incremental;
+    oneshot_config.gc_slots_per_step = 0;
+
+    for (uint32_t mode = 0; mode < 3; mode++) {
+        /* One shot, incremental with saves doing all the work, incremental with background steps */
+        PIOS_FLASHFS_Logfs_Destroy(fs_id);
+        ASSERT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, mode ? &flashfs_config_incremental : &oneshot_config, &pios_ut_flash_driver, flash_id));
+        ASSERT_EQ(0, PIOS_FLASHFS_Format(fs_id));
+        memset(version, 0, sizeof(version));
+
+        uint32_t max_reads  = 0;
+        uint32_t max_erases = 0;
+        for (uint32_t i = 0; i < GC_SAVES / 2; i++) {
+            uint32_t reads  = PIOS_Flash_UT_GetReadCount(flash_id);
+            uint32_t erases = PIOS_Flash_UT_GetEraseCount(flash_id);
+            save(i % GC_OBJECTS);
+            max_reads  = std::max(max_reads, PIOS_Flash_UT_GetReadCount(flash_id) - reads);
+            max_erases = std::max(max_erases, PIOS_Flash_UT_GetEraseCount(flash_id) - erases);
+
+            if (mode == 2 && i % 4 == 0) {
+                EXPECT_EQ(0, PIOS_FLASHFS_GarbageCollectStep(fs_id));
+            }
+        }
+        verify();
+
+        struct PIOS_FLASHFS_Stats stats;
+        EXPECT_EQ(0, PIOS_FLASHFS_GetStats(fs_id, &stats));
+        /* The longest flash hold includes the background steps */
+        printf("[ BENCH    ] %-25s worst save: %4u flash reads, %u sector erases; longest flash hold %u us\n",
+               mode == 0 ? "one shot gc:" : mode == 1 ? "incremental gc:" : "incremental + background:",
+               max_reads, max_erases, stats.max_blocking_time);
+    }
+}
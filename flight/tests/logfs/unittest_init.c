@@ -22,8 +22,11 @@ const struct flashfs_logfs_cfg flashfs_config_partition_a = {
     .start_offset  = 0,          /* start at the beginning of the chip */
     .sector_size   = 0x00010000, /* 64K bytes */
     .page_size     = 0x00000100, /* 256 bytes */
+
+    .slot_index    = 1,
 };
 
+/* Without the slot index, lookups scan the slot headers */
 const struct flashfs_logfs_cfg flashfs_config_partition_b = {
     .fs_magic      = 0x89abceef,
     .total_fs_size = 0x00100000, /* 1M bytes (16 sectors) */
@@ -34,3 +37,33 @@ const struct flashfs_logfs_cfg flashfs_config_partition_b = {
     .sector_size   = 0x00010000, /* 64K bytes */
     .page_size     = 0x00000100, /* 256 bytes */
 };
+
+/* Same flash as partition a, with multi sector arenas and incremental garbage collection */
+const struct flashfs_logfs_cfg flashfs_config_incremental = {
+    .fs_magic      = 0x89abcfef,
+    .total_fs_size = 0x00200000, /* 2M bytes (32 sectors) */
+    .arena_size    = 0x00020000, /* 512 * slot size */
+    .slot_size     = 0x00000100, /* 256 bytes */
+
+    .start_offset  = 0,          /* start at the beginning of the chip */
+    .sector_size   = 0x00010000, /* 64K bytes */
+    .page_size     = 0x00000100, /* 256 bytes */
+
+    .gc_slots_per_step = 8,
+    .slot_index    = 1,
+};
+
+#include <time.h>
+
+uint32_t PIOS_DELAY_GetRaw()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+
+uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
+{
+    return PIOS_DELAY_GetRaw() - raw;
+}
@@ -0,0 +1,327 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+extern "C" {
+#include "openpilot.h"
+#include "uavobjectprivate.h"
+#include "unittest_priv.h"
+}
+
+#define OBJ_SIZE       32
+#define BENCH_LOOKUPS  1000000
+#define BENCH_READS    1000000
+#define NUM_INSTANCES  200
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double nsPerOp(BenchClock::time_point start, uint32_t ops)
+{
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / ops;
+}
+
+// Reference implementation of the old lookup, a linear search of the handle table
+static UAVObjHandle linearGetByID(uint32_t id)
+{
+    UAVO_LIST_ITERATE(tmp_obj)
+    if (tmp_obj->id == id) {
+        return (UAVObjHandle)tmp_obj;
+    }
+    if (MetaObjectId(tmp_obj->id) == id) {
+        return (UAVObjHandle) & (tmp_obj->metaObj);
+    }
+}
+return NULL;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVObjManagerTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        EXPECT_EQ(0, UAVObjInitialize());
+
+        for (uint32_t i = 0; i < UT_NUM_OBJECTS; i++) {
+            ut_handles[i] = UAVObjRegister(UT_ObjId(i), (i % 4) != 0, false, false, OBJ_SIZE, NULL);
+            ASSERT_TRUE(ut_handles[i] != NULL);
+        }
+    }
+};
+
+TEST_F(UAVObjManagerTest, GetByIDFindsObjects) {
+    for (uint32_t i = 0; i < UT_NUM_OBJECTS; i++) {
+        EXPECT_EQ(ut_handles[i], UAVObjGetByID(UT_ObjId(i)));
+        EXPECT_EQ(UT_ObjId(i), UAVObjGetID(ut_handles[i]));
+    }
+}
+
+TEST_F(UAVObjManagerTest, GetByIDFindsMetaobjects) {
+    for (uint32_t i = 0; i < UT_NUM_OBJECTS; i++) {
+        UAVObjHandle meta = UAVObjGetByID(MetaObjectId(UT_ObjId(i)));
+
+        ASSERT_TRUE(meta != NULL);
+        EXPECT_TRUE(UAVObjIsMetaobject(meta));
+        EXPECT_EQ(ut_handles[i], UAVObjGetLinkedObj(meta));
+    }
+}
+
+TEST_F(UAVObjManagerTest, GetByIDUnknown) {
+    EXPECT_TRUE(UAVObjGetByID(0) == NULL);
+    EXPECT_TRUE(UAVObjGetByID(UT_ObjId(UT_NUM_OBJECTS)) == NULL);
+    EXPECT_TRUE(UAVObjGetByID(MetaObjectId(UT_ObjId(UT_NUM_OBJECTS))) == NULL);
+}
+
+TEST_F(UAVObjManagerTest, RegisterDuplicate) {
+    EXPECT_TRUE(UAVObjRegister(UT_ObjId(0), true, false, false, OBJ_SIZE, NULL) == NULL);
+    EXPECT_EQ(ut_handles[0], UAVObjGetByID(UT_ObjId(0)));
+}
+
+TEST_F(UAVObjManagerTest, BenchmarkGetByID) {
+    uintptr_t sum = 0;
+
+    for (uint32_t n = 25; n <= UT_NUM_OBJECTS; n *= 2) {
+        BenchClock::time_point start = BenchClock::now();
+        for (uint32_t i = 0; i < BENCH_LOOKUPS; i++) {
+            sum += (uintptr_t)linearGetByID(UT_ObjId(i % n));
+        }
+        double linear = nsPerOp(start, BENCH_LOOKUPS);
+
+        start = BenchClock::now();
+        for (uint32_t i = 0; i < BENCH_LOOKUPS; i++) {
+            sum += (uintptr_t)UAVObjGetByID(UT_ObjId(i % n));
+        }
+        double indexed = nsPerOp(start, BENCH_LOOKUPS);
+
+        printf("[ BENCH    ] UAVObjGetByID over %3u objects: linear %7.1f ns, indexed %7.1f ns\n", n, linear, indexed);
+    }
+    EXPECT_NE(0U, sum);
+}
+
+static void eventCallback(__attribute__((unused)) UAVObjEvent *ev) {}
+
+TEST_F(UAVObjManagerTest, ConnectCallbackCoalesced) {
+    uint8_t data[OBJ_SIZE] = { 0 };
+
+    ut_callback_events  = 0;
+    ut_coalesced_events = 0;
+
+    EXPECT_EQ(0, UAVObjConnectCallbackCoalesced(ut_handles[1], eventCallback, EV_MASK_ALL_UPDATES));
+    EXPECT_EQ(0, UAVObjSetData(ut_handles[1], data));
+    EXPECT_EQ(0U, ut_callback_events);
+    EXPECT_EQ(1U, ut_coalesced_events);
+
+    // Connecting again switches the dispatch mode
+    EXPECT_EQ(0, UAVObjConnectCallback(ut_handles[1], eventCallback, EV_MASK_ALL_UPDATES));
+    EXPECT_EQ(0, UAVObjSetData(ut_handles[1], data));
+    EXPECT_EQ(1U, ut_callback_events);
+    EXPECT_EQ(1U, ut_coalesced_events);
+
+    EXPECT_EQ(0, UAVObjConnectCallbackCoalesced(ut_handles[1], eventCallback, EV_MASK_ALL_UPDATES));
+    EXPECT_EQ(0, UAVObjDisconnectCallback(ut_handles[1], eventCallback));
+    EXPECT_EQ(0, UAVObjSetData(ut_handles[1], data));
+    EXPECT_EQ(1U, ut_callback_events);
+    EXPECT_EQ(1U, ut_coalesced_events);
+}
+
+TEST_F(UAVObjManagerTest, MultiInstanceSetGet) {
+    uint8_t data[OBJ_SIZE];
+
+    // Creating a high instance fills in the ones below it
+    memset(data, 0, sizeof(data));
+    EXPECT_EQ(0, UAVObjUnpack(ut_handles[0], NUM_INSTANCES - 1, data));
+    EXPECT_EQ(NUM_INSTANCES, UAVObjGetNumInstances(ut_handles[0]));
+    EXPECT_EQ(NUM_INSTANCES, UAVObjCreateInstance(ut_handles[0], NULL));
+    EXPECT_EQ(NUM_INSTANCES + 1, UAVObjGetNumInstances(ut_handles[0]));
+
+    for (uint16_t i = 0; i <= NUM_INSTANCES; i++) {
+        memset(data, i, sizeof(data));
+        EXPECT_EQ(0, UAVObjSetInstanceData(ut_handles[0], i, data));
+    }
+    for (uint16_t i = 0; i <= NUM_INSTANCES; i++) {
+        EXPECT_EQ(0, UAVObjGetInstanceData(ut_handles[0], i, data));
+        EXPECT_EQ((uint8_t)i, data[0]);
+        EXPECT_EQ((uint8_t)i, data[OBJ_SIZE - 1]);
+    }
+    EXPECT_EQ(-1, UAVObjGetInstanceData(ut_handles[0], NUM_INSTANCES + 1, data));
+}
+
+TEST_F(UAVObjManagerTest, MultiInstanceGrowthKeepsData) {
+    uint8_t data[OBJ_SIZE];
+
+    // Across the first few chunks, each twice the size of the one before
+    for (uint16_t n = 0; n < 40; n++) {
+        if (n > 0) {
+            EXPECT_EQ(n, UAVObjCreateInstance(ut_handles[0], NULL));
+        }
+        memset(data, n + 1, sizeof(data));
+        EXPECT_EQ(0, UAVObjSetInstanceData(ut_handles[0], n, data));
+
+        for (uint16_t i = 0; i <= n; i++) {
+            EXPECT_EQ(0, UAVObjGetInstanceData(ut_handles[0], i, data));
+            EXPECT_EQ((uint8_t)(i + 1), data[0]);
+            EXPECT_EQ((uint8_t)(i + 1), data[OBJ_SIZE - 1]);
+        }
+    }
+}
+
+TEST_F(UAVObjManagerTest, BenchmarkInstanceAccess) {
+    uint8_t data[OBJ_SIZE] = { 0 };
+
+    EXPECT_EQ(0, UAVObjUnpack(ut_handles[0], NUM_INSTANCES - 1, data));
+
+    BenchClock::time_point start = BenchClock::now();
+    for (uint32_t i = 0; i < BENCH_READS; i++) {
+        UAVObjGetInstanceData(ut_handles[0], i % NUM_INSTANCES, data);
+    }
+    printf("[ BENCH    ] UAVObjGetInstanceData over %u instances: %7.1f ns\n", NUM_INSTANCES, nsPerOp(start, BENCH_READS));
+}
+
+TEST_F(UAVObjManagerTest, SeqLockOnlySingleInstance) {
+    EXPECT_EQ(-1, UAVObjEnableSeqLock(ut_handles[0]));
+    EXPECT_EQ(-1, UAVObjEnableSeqLock(UAVObjGetLinkedObj(ut_handles[1])));
+    EXPECT_EQ(0, UAVObjEnableSeqLock(ut_handles[1]));
+    EXPECT_EQ(0, UAVObjEnableSeqLock(ut_handles[1]));
+}
+
+TEST_F(UAVObjManagerTest, SeqLockSetGet) {
+    uint8_t in[OBJ_SIZE];
+    uint8_t out[OBJ_SIZE];
+
+    for (uint32_t i = 0; i < OBJ_SIZE; i++) {
+        in[i] = i;
+    }
+
+    EXPECT_EQ(0, UAVObjEnableSeqLock(ut_handles[1]));
+    EXPECT_EQ(0, UAVObjSetData(ut_handles[1], in));
+    EXPECT_EQ(0, UAVObjGetData(ut_handles[1], out));
+    EXPECT_EQ(0, memcmp(in, out, OBJ_SIZE));
+
+    uint8_t field = 0xAA;
+    EXPECT_EQ(0, UAVObjSetDataField(ut_handles[1], &field, 5, 1));
+    EXPECT_EQ(0, UAVObjGetDataField(ut_handles[1], out, 4, 2));
+    EXPECT_EQ(4, out[0]);
+    EXPECT_EQ(0xAA, out[1]);
+
+    EXPECT_EQ(-1, UAVObjSetDataField(ut_handles[1], in, OBJ_SIZE - 1, 2));
+    EXPECT_EQ(-1, UAVObjGetInstanceData(ut_handles[1], 1, out));
+
+    EXPECT_EQ(0, UAVObjUnpack(ut_handles[1], 0, in));
+    EXPECT_EQ(0, UAVObjPack(ut_handles[1], 0, out));
+    EXPECT_EQ(0, memcmp(in, out, OBJ_SIZE));
+}
+
+TEST_F(UAVObjManagerTest, SeqLockReadOnly) {
+    uint8_t data[OBJ_SIZE] = { 0 };
+    UAVObjMetadata metadata;
+
+    EXPECT_EQ(0, UAVObjEnableSeqLock(ut_handles[1]));
+    EXPECT_EQ(0, UAVObjGetMetadata(ut_handles[1], &metadata));
+    UAVObjSetAccess(&metadata, ACCESS_READONLY);
+    EXPECT_EQ(0, UAVObjSetMetadata(ut_handles[1], &metadata));
+
+    EXPECT_EQ(-1, UAVObjSetData(ut_handles[1], data));
+    EXPECT_EQ(0, UAVObjUnpack(ut_handles[1], 0, data));
+}
+
+// Writer fills the whole object with one value, readers must never see a mix
+TEST_F(UAVObjManagerTest, SeqLockConcurrentReads) {
+    std::atomic<bool> done(false);
+
+    EXPECT_EQ(0, UAVObjEnableSeqLock(ut_handles[1]));
+
+    std::thread writer([&] {
+        uint8_t data[OBJ_SIZE];
+        for (uint32_t n = 0; !done; n++) {
+            memset(data, n, sizeof(data));
+            UAVObjSetData(ut_handles[1], data);
+        }
+    });
+
+    uint32_t torn = 0;
+    for (uint32_t i = 0; i < BENCH_READS; i++) {
+        uint8_t data[OBJ_SIZE];
+        UAVObjGetData(ut_handles[1], data);
+        for (uint32_t j = 1; j < OBJ_SIZE; j++) {
+            if (data[j] != data[0]) {
+                torn++;
+                break;
+            }
+        }
+    }
+    done = true;
+    writer.join();
+
+    EXPECT_EQ(0U, torn);
+}
+
+// An in place write, like a settings load from flash, is never seen half done
+TEST_F(UAVObjManagerTest, SeqLockInPlaceWrite) {
+    std::atomic<bool> done(false);
+
+    EXPECT_EQ(0, UAVObjEnableSeqLock(ut_handles[1]));
+    EXPECT_EQ(NULL, seqLockBegin(ut_handles[0], true));
+
+    std::thread writer([&] {
+        for (uint32_t n = 0; !done; n++) {
+            struct UAVOSingle *obj = seqLockBegin(ut_handles[1], true);
+            for (uint32_t j = 0; j < OBJ_SIZE; j++) {
+                obj->instance0[j] = n;
+            }
+            seqLockEnd(obj, true);
+        }
+    });
+
+    uint32_t torn = 0;
+    for (uint32_t i = 0; i < BENCH_READS; i++) {
+        uint8_t data[OBJ_SIZE];
+        UAVObjGetData(ut_handles[1], data);
+        for (uint32_t j = 1; j < OBJ_SIZE; j++) {
+            if (data[j] != data[0]) {
+                torn++;
+                break;
+            }
+        }
+    }
+    done = true;
+    writer.join();
+
+    EXPECT_EQ(0U, torn);
+}
+
+// Read cost while another thread keeps updating unrelated objects,
+// like telemetry and logging do alongside the control loop
+TEST_F(UAVObjManagerTest, BenchmarkSeqLockRead) {
+    std::atomic<bool> done(false);
+
+    EXPECT_EQ(0, UAVObjEnableSeqLock(ut_handles[2]));
+
+    std::thread writer([&] {
+        uint8_t data[OBJ_SIZE] = { 0 };
+        while (!done) {
+            UAVObjSetData(ut_handles[3], data);
+        }
+    });
+
+    uint8_t data[OBJ_SIZE];
+    BenchClock::time_point start = BenchClock::now();
+    for (uint32_t i = 0; i < BENCH_READS; i++) {
+        UAVObjGetData(ut_handles[1], data);
+    }
+    double locked = nsPerOp(start, BENCH_READS);
+
+    start = BenchClock::now();
+    for (uint32_t i = 0; i < BENCH_READS; i++) {
+        UAVObjGetData(ut_handles[2], data);
+    }
+    double seqlocked = nsPerOp(start, BENCH_READS);
+
+    done = true;
+    writer.join();
+
+    printf("[ BENCH    ] UAVObjGetData with concurrent writer: locked %7.1f ns, seqlock %7.1f ns\n", locked, seqlocked);
+}
@@ -0,0 +1,27 @@
+#include <stdlib.h>
+#include <stdint.h>
+#define pvPortMalloc(xSize) (malloc(xSize))
+#define vPortFree(pv)       (free(pv))
+
+/* Semaphores are backed by pthread mutexes, see unittest_init.c */
+typedef void *xSemaphoreHandle;
+typedef void *xQueueHandle;
+
+#define pdTRUE           1
+#define pdFALSE          0
+#define portMAX_DELAY    0xffffffff
+#define portTICK_RATE_MS 1
+
+typedef uint32_t portTickType;
+
+xSemaphoreHandle xSemaphoreCreateMutex();
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex();
+int32_t xSemaphoreTake(xSemaphoreHandle mutex, uint32_t ticks);
+int32_t xSemaphoreGive(xSemaphoreHandle mutex);
+#define xSemaphoreTakeRecursive(mutex, ticks) xSemaphoreTake(mutex, ticks)
+#define xSemaphoreGiveRecursive(mutex)        xSemaphoreGive(mutex)
+#define vSemaphoreCreateBinary(sema)          (sema) = xSemaphoreCreateMutex()
+
+portTickType xTaskGetTickCount();
+
+int32_t xQueueSend(xQueueHandle queue, const void *item, uint32_t ticks);
@@ -0,0 +1,1006 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <chrono>
+#include <vector>
+
+extern "C" {
+#include "openpilot.h"
+#include "uavtalk_priv.h"
+#include "unittest_priv.h"
+}
+
+/* Same layout as the Waypoint object: Position[3], Velocity and Action */
+#define WAYPOINT_SIZE      17
+#define MISSION_WAYPOINTS  200
+#define BENCH_MISSIONS     200
+#define OPL_LOG_PACKETS    20000
+#define OPL_REPLAYS        20
+#define TX_FIFO_SIZE       256
+#define BENCH_SENDS        20000
+#define BATCH_WAYPOINTS    30
+#define DELTA_OBJECT_SIZE  200
+#define DELTA_RUN_TIME_MS  20000
+
+typedef std::chrono::steady_clock BenchClock;
+
+static uint32_t ut_tx_acks;
+static uint32_t ut_tx_nacks;
+static uint32_t ut_tx_requests;
+
+// Flight side output stream, the GCS only waits for the ACKs
+static int32_t outputStream(uint8_t *data, int32_t length)
+{
+    if (data[1] == UAVTALK_TYPE_ACK) {
+        ut_tx_acks++;
+    } else if (data[1] == UAVTALK_TYPE_NACK) {
+        ut_tx_nacks++;
+    } else if (data[1] == UAVTALK_TYPE_OBJ_REQ) {
+        ut_tx_requests++;
+    }
+    return length;
+}
+
+// Transmit side, a COM port fifo for the zero copy output and a plain buffer for the copying one
+static t_fifo_buffer ut_tx_fifo;
+static uint8_t ut_tx_fifo_buf[TX_FIFO_SIZE];
+static std::vector<uint8_t> ut_tx_stream;
+
+static int32_t reserveStream(t_fifo_span *span, uint16_t length)
+{
+    if (length > fifoBuf_getSize(&ut_tx_fifo)) {
+        return 0;
+    }
+    return fifoBuf_reserve(&ut_tx_fifo, span, length);
+}
+
+static int32_t commitStream(uint16_t length)
+{
+    fifoBuf_commit(&ut_tx_fifo, length);
+    return length;
+}
+
+static int32_t copyStream(uint8_t *data, int32_t length)
+{
+    ut_tx_stream.insert(ut_tx_stream.end(), data, data + length);
+    return length;
+}
+
+// Send through PIOS_COM_SendBuffer() as before, one copy into the fifo
+static int32_t fifoStream(uint8_t *data, int32_t length)
+{
+    return fifoBuf_putData(&ut_tx_fifo, data, length);
+}
+
+// Only count what goes over the link
+static uint32_t ut_link_bytes;
+
+static int32_t countStream(__attribute__((unused)) uint8_t *data, int32_t length)
+{
+    ut_link_bytes += length;
+    return length;
+}
+
+static void drainFifo(std::vector<uint8_t> & out)
+{
+    uint8_t buf[TX_FIFO_SIZE];
+    uint16_t n = fifoBuf_getData(&ut_tx_fifo, buf, sizeof(buf));
+
+    out.insert(out.end(), buf, buf + n);
+}
+
+// Encode one packet the way the GCS does
+static void appendPacket(std::vector<uint8_t> & stream, uint8_t type, uint32_t objId, uint16_t instId, const uint8_t *data, uint16_t length)
+{
+    size_t start = stream.size();
+    uint16_t packetSize = UAVTALK_MIN_HEADER_LENGTH + length;
+
+    stream.push_back(UAVTALK_SYNC_VAL);
+    stream.push_back(type);
+    stream.push_back(packetSize & 0xFF);
+    stream.push_back(packetSize >> 8);
+    for (int i = 0; i < 4; i++) {
+        stream.push_back((objId >> (8 * i)) & 0xFF);
+    }
+    stream.push_back(instId & 0xFF);
+    stream.push_back(instId >> 8);
+    stream.insert(stream.end(), data, data + length);
+    stream.push_back(PIOS_CRC_updateCRC(0, &stream[start], packetSize));
+}
+
+// Append a record the way the GCS LogFile does: timestamp (ms), data size, data
+static void appendLogRecord(std::vector<uint8_t> & log, uint32_t timestamp, const std::vector<uint8_t> & data)
+{
+    int64_t size = data.size();
+
+    log.insert(log.end(), (const uint8_t *)&timestamp, (const uint8_t *)&timestamp + sizeof(timestamp));
+    log.insert(log.end(), (const uint8_t *)&size, (const uint8_t *)&size + sizeof(size));
+    log.insert(log.end(), data.begin(), data.end());
+}
+
+// Load the .opl log named by UT_OPL_LOG, or synthesize one with a telemetry like mix of object sizes
+static void loadLog(std::vector<uint8_t> & log)
+{
+    const char *path = getenv("UT_OPL_LOG");
+
+    if (path) {
+        FILE *f = fopen(path, "rb");
+        if (f) {
+            uint8_t buf[4096];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+                log.insert(log.end(), buf, buf + n);
+            }
+            fclose(f);
+            return;
+        }
+        printf("[ BENCH    ] cannot open %s, using a synthetic log\n", path);
+    }
+
+    static const uint16_t sizes[] = { 4, 12, 16, 20, 36, 40, 64, 100, 180, 250 };
+    uint8_t data[256];
+    std::vector<uint8_t> packet;
+
+    srand(1);
+    for (uint32_t n = 0; n < OPL_LOG_PACKETS; n++) {
+        uint16_t length = sizes[rand() % (sizeof(sizes) / sizeof(sizes[0]))];
+        for (uint16_t i = 0; i < length; i++) {
+            data[i] = rand();
+        }
+        packet.clear();
+        appendPacket(packet, UAVTALK_TYPE_OBJ, 0x10000000 + length, 0, data, length);
+        appendLogRecord(log, n, packet);
+    }
+}
+
+// Feed the UAVTalk data of every log record through the parser, byte by byte or in chunks
+// of at most chunk bytes. Returns the number of packets received.
+static uint32_t replayLog(UAVTalkConnection connection, const std::vector<uint8_t> & log, uint32_t chunk)
+{
+    uint32_t packets = 0;
+    size_t pos = 0;
+
+    while (pos + sizeof(uint32_t) + sizeof(int64_t) <= log.size()) {
+        int64_t size;
+        memcpy(&size, &log[pos + sizeof(uint32_t)], sizeof(size));
+        pos += sizeof(uint32_t) + sizeof(int64_t);
+        if (size < 1 || (uint64_t)size > log.size() - pos) {
+            break;
+        }
+        const uint8_t *p   = &log[pos];
+        const uint8_t *end = p + size;
+        if (chunk == 0) {
+            for (; p < end; p++) {
+                if (UAVTalkProcessInputStreamQuiet(connection, *p) == UAVTALK_STATE_COMPLETE) {
+                    packets++;
+                }
+            }
+        } else {
+            while (p < end) {
+                uint32_t length = (end - p) < chunk ? (end - p) : chunk;
+                uint32_t consumed;
+                if (UAVTalkProcessInputBufferQuiet(connection, p, length, &consumed) == UAVTALK_STATE_COMPLETE) {
+                    packets++;
+                }
+                p += consumed;
+            }
+        }
+        pos += size;
+    }
+    return packets;
+}
+
+TEST(FifoReserve, WrapAround) {
+    t_fifo_buffer fifo;
+    uint8_t buf[16] = { 0 };
+    uint8_t data[16];
+    uint8_t out[16];
+    t_fifo_span span;
+
+    fifoBuf_init(&fifo, buf, sizeof(buf));
+    for (uint8_t i = 0; i < sizeof(data); i++) {
+        data[i] = i + 1;
+    }
+
+    // Move the write position close to the end
+    EXPECT_EQ(12, fifoBuf_putData(&fifo, data, 12));
+    EXPECT_EQ(12, fifoBuf_getData(&fifo, out, 12));
+
+    EXPECT_EQ(0, fifoBuf_reserve(&fifo, &span, 16));
+    ASSERT_EQ(10, fifoBuf_reserve(&fifo, &span, 10));
+    EXPECT_EQ(4, span.len[0]);
+    EXPECT_EQ(6, span.len[1]);
+    EXPECT_EQ(&buf[12], span.ptr[0]);
+    EXPECT_EQ(&buf[0], span.ptr[1]);
+
+    // Nothing is visible before the commit
+    fifoBuf_spanWrite(&span, 0, data, 3);
+    fifoBuf_spanWrite(&span, 3, data + 3, 7);
+    EXPECT_EQ(0, fifoBuf_getUsed(&fifo));
+    fifoBuf_commit(&fifo, 10);
+    EXPECT_EQ(10, fifoBuf_getUsed(&fifo));
+    EXPECT_EQ(10, fifoBuf_getData(&fifo, out, sizeof(out)));
+    EXPECT_EQ(0, memcmp(data, out, 10));
+
+    t_fifo_span slice;
+    fifoBuf_reserve(&fifo, &span, 10);
+    fifoBuf_spanSlice(&span, 2, 5, &slice);
+    EXPECT_EQ(span.ptr[0] + 2, slice.ptr[0]);
+    EXPECT_EQ(5, slice.len[0] + slice.len[1]);
+}
+
+TEST(UAVTalkCrc, CheckValue) {
+    const uint8_t check[] = "123456789";
+
+    EXPECT_EQ(0xF4, PIOS_CRC_updateCRC(0, check, 9));
+}
+
+TEST(UAVTalkCrc, BulkMatchesBytewise) {
+    uint8_t data[300];
+
+    srand(2);
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        data[i] = rand();
+    }
+
+    // Every length and alignment, so both the four byte and the tail loop get covered
+    for (uint32_t offset = 0; offset < 8; offset++) {
+        for (uint32_t length = 0; length + offset <= sizeof(data); length++) {
+            uint8_t crc = 0x5A;
+            for (uint32_t i = 0; i < length; i++) {
+                crc = PIOS_CRC_updateByte(crc, data[offset + i]);
+            }
+            ASSERT_EQ(crc, PIOS_CRC_updateCRC(0x5A, &data[offset], length)) << "offset " << offset << " length " << length;
+        }
+    }
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVTalkTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        EXPECT_EQ(0, UAVObjInitialize());
+
+        ut_handles[0] = UAVObjRegister(UT_ObjId(0), false, false, false, WAYPOINT_SIZE, NULL);
+        ASSERT_TRUE(ut_handles[0] != NULL);
+        waypoint = ut_handles[0];
+        connection = UAVTalkInitialize(outputStream);
+        ASSERT_TRUE(connection != NULL);
+
+        ut_tx_acks     = 0;
+        ut_tx_nacks    = 0;
+        ut_tx_requests = 0;
+    }
+
+    // Acknowledged waypoint updates, as sent by the GCS when uploading a mission
+    void buildMission(std::vector<uint8_t> & stream, uint8_t seed)
+    {
+        uint8_t data[WAYPOINT_SIZE];
+
+        for (uint16_t i = 0; i < MISSION_WAYPOINTS; i++) {
+            memset(data, (uint8_t)(seed + i), sizeof(data));
+            appendPacket(stream, UAVTALK_TYPE_OBJ_ACK, UT_ObjId(0), i, data, sizeof(data));
+        }
+    }
+
+    void processStream(const std::vector<uint8_t> & stream)
+    {
+        for (size_t i = 0; i < stream.size(); i++) {
+            UAVTalkProcessInputStream(connection, stream[i]);
+        }
+    }
+
+    UAVObjHandle waypoint;
+    UAVTalkConnection connection;
+};
+
+TEST_F(UAVTalkTest, MissionUploadCreatesInstances) {
+    std::vector<uint8_t> stream;
+
+    buildMission(stream, 0);
+    processStream(stream);
+
+    EXPECT_EQ(MISSION_WAYPOINTS, UAVObjGetNumInstances(waypoint));
+    EXPECT_EQ((uint32_t)MISSION_WAYPOINTS, ut_tx_acks);
+    EXPECT_EQ(0U, ut_tx_nacks);
+
+    for (uint16_t i = 0; i < MISSION_WAYPOINTS; i++) {
+        uint8_t data[WAYPOINT_SIZE];
+        EXPECT_EQ(0, UAVObjGetInstanceData(waypoint, i, data));
+        EXPECT_EQ((uint8_t)i, data[0]);
+        EXPECT_EQ((uint8_t)i, data[WAYPOINT_SIZE - 1]);
+    }
+}
+
+TEST_F(UAVTalkTest, BenchmarkMissionUpload) {
+    std::vector<uint8_t> stream;
+
+    buildMission(stream, 0);
+
+    // First upload creates the instances
+    BenchClock::time_point start = BenchClock::now();
+    processStream(stream);
+    double create = std::chrono::duration<double, std::micro>(BenchClock::now() - start).count();
+
+    // Later uploads overwrite them
+    start = BenchClock::now();
+    for (uint32_t n = 0; n < BENCH_MISSIONS; n++) {
+        processStream(stream);
+    }
+    double update = std::chrono::duration<double, std::micro>(BenchClock::now() - start).count() / BENCH_MISSIONS;
+
+    EXPECT_EQ((uint32_t)MISSION_WAYPOINTS * (BENCH_MISSIONS + 1), ut_tx_acks);
+    printf("[ BENCH    ] %u waypoint mission upload: first %7.1f us, again %7.1f us\n", MISSION_WAYPOINTS, create, update);
+}
+
+TEST_F(UAVTalkTest, CorruptPacketIsRejected) {
+    std::vector<uint8_t> stream;
+    uint8_t data[WAYPOINT_SIZE];
+    UAVTalkStats stats;
+
+    memset(data, 0x55, sizeof(data));
+    appendPacket(stream, UAVTALK_TYPE_OBJ_ACK, UT_ObjId(0), 0, data, sizeof(data));
+    appendPacket(stream, UAVTALK_TYPE_OBJ_ACK, UT_ObjId(0), 0, data, sizeof(data));
+    // Flip one bit in the payload of the first and in the header of the second
+    stream[UAVTALK_MIN_HEADER_LENGTH + 3] ^= 0x10;
+    stream[stream.size() / 2 + 9]        ^= 0x01;
+
+    UAVTalkGetStats(connection, &stats, true);
+    processStream(stream);
+    UAVTalkGetStats(connection, &stats, true);
+
+    EXPECT_EQ(2U, stats.rxCrcErrors);
+    EXPECT_EQ(0U, stats.rxObjects);
+    EXPECT_EQ(0U, ut_tx_acks);
+}
+
+TEST_F(UAVTalkTest, BufferMatchesPerByte) {
+    std::vector<uint8_t> stream;
+    UAVTalkStats byteStats;
+    UAVTalkStats bufferStats;
+
+    // Line noise between and inside packets
+    buildMission(stream, 0);
+    stream.insert(stream.begin(), 7, 0x55);
+    stream.insert(stream.begin() + stream.size() / 2, 5, UAVTALK_SYNC_VAL);
+    stream.insert(stream.end(), 3, 0xAA);
+
+    UAVTalkResetStats(connection);
+    processStream(stream);
+    UAVTalkGetStats(connection, &byteStats, true);
+    uint32_t byteAcks = ut_tx_acks;
+
+    ut_tx_acks = 0;
+    srand(3);
+    int32_t packets = 0;
+    for (size_t pos = 0; pos < stream.size();) {
+        uint32_t length = 1 + rand() % 64;
+        if (length > stream.size() - pos) {
+            length = stream.size() - pos;
+        }
+        packets += UAVTalkProcessInputBuffer(connection, &stream[pos], length);
+        pos     += length;
+    }
+    UAVTalkGetStats(connection, &bufferStats, true);
+
+    EXPECT_EQ(byteAcks, ut_tx_acks);
+    EXPECT_EQ(byteStats.rxObjects, (uint32_t)packets);
+    EXPECT_EQ(byteStats.rxBytes, bufferStats.rxBytes);
+    EXPECT_EQ(byteStats.rxObjects, bufferStats.rxObjects);
+    EXPECT_EQ(byteStats.rxObjectBytes, bufferStats.rxObjectBytes);
+    EXPECT_EQ(byteStats.rxSyncErrors, bufferStats.rxSyncErrors);
+    EXPECT_EQ(byteStats.rxErrors, bufferStats.rxErrors);
+    // The noise in the middle breaks one packet
+    EXPECT_EQ((uint32_t)MISSION_WAYPOINTS - 1, bufferStats.rxObjects);
+}
+
+TEST_F(UAVTalkTest, BufferQuietStopsAfterPacket) {
+    std::vector<uint8_t> stream;
+    uint8_t data[WAYPOINT_SIZE];
+    uint32_t consumed;
+
+    memset(data, 0, sizeof(data));
+    appendPacket(stream, UAVTALK_TYPE_OBJ, UT_ObjId(0), 0, data, sizeof(data));
+    size_t first = stream.size();
+    appendPacket(stream, UAVTALK_TYPE_OBJ, UT_ObjId(0), 0, data, sizeof(data));
+
+    EXPECT_EQ(UAVTALK_STATE_COMPLETE, UAVTalkProcessInputBufferQuiet(connection, &stream[0], stream.size(), &consumed));
+    EXPECT_EQ(first, consumed);
+    EXPECT_EQ(UT_ObjId(0), UAVTalkGetPacketObjId(connection));
+    EXPECT_EQ(UAVTALK_STATE_COMPLETE, UAVTalkProcessInputBufferQuiet(connection, &stream[first], stream.size() - first, &consumed));
+    EXPECT_EQ(stream.size() - first, consumed);
+}
+
+TEST_F(UAVTalkTest, BenchmarkLogReplay) {
+    std::vector<uint8_t> log;
+    // Byte by byte, a serial port read and a USB HID report
+    static const uint32_t chunks[] = { 0, 16, 64 };
+
+    loadLog(log);
+    uint32_t packets = replayLog(connection, log, 0);
+    EXPECT_LT(0U, packets);
+
+    for (uint32_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        BenchClock::time_point start = BenchClock::now();
+        for (uint32_t n = 0; n < OPL_REPLAYS; n++) {
+            EXPECT_EQ(packets, replayLog(connection, log, chunks[c]));
+        }
+        double elapsed = std::chrono::duration<double>(BenchClock::now() - start).count();
+
+        printf("[ BENCH    ] .opl replay, %2u byte reads: %u packets, %u bytes, %7.1f MB/s, %7.1f ns per packet\n",
+               chunks[c] ? chunks[c] : 1, packets, (uint32_t)log.size(), log.size() * OPL_REPLAYS / elapsed / 1e6, elapsed * 1e9 / (packets * OPL_REPLAYS));
+    }
+}
+
+TEST_F(UAVTalkTest, ZeroCopyMatchesCopy) {
+    UAVTalkConnection reserved = UAVTalkInitializeReserve(reserveStream, commitStream, NULL);
+    UAVTalkConnection copying  = UAVTalkInitialize(copyStream);
+    std::vector<uint8_t> inPlace;
+    uint8_t data[WAYPOINT_SIZE];
+
+    ASSERT_TRUE(reserved != NULL);
+    fifoBuf_init(&ut_tx_fifo, ut_tx_fifo_buf, sizeof(ut_tx_fifo_buf));
+    ut_tx_stream.clear();
+
+    // Enough packets for the fifo to wrap around in every possible place
+    for (uint32_t n = 0; n < 2 * TX_FIFO_SIZE; n++) {
+        memset(data, n, sizeof(data));
+        UAVObjSetInstanceData(waypoint, 0, data);
+        EXPECT_EQ(0, UAVTalkSendObject(reserved, waypoint, 0, 0, 0));
+        EXPECT_EQ(0, UAVTalkSendObject(copying, waypoint, 0, 0, 0));
+        drainFifo(inPlace);
+    }
+
+    EXPECT_EQ(ut_tx_stream.size(), inPlace.size());
+    EXPECT_TRUE(ut_tx_stream == inPlace);
+
+    UAVTalkStats stats;
+    UAVTalkGetStats(reserved, &stats, false);
+    EXPECT_EQ(2U * TX_FIFO_SIZE, stats.txObjects);
+    EXPECT_EQ(0U, stats.txErrors);
+}
+
+TEST_F(UAVTalkTest, ZeroCopyFallsBackForLargePackets) {
+    UAVTalkConnection reserved = UAVTalkInitializeReserve(reserveStream, commitStream, copyStream);
+    UAVTalkConnection noStream = UAVTalkInitializeReserve(reserveStream, commitStream, NULL);
+    UAVTalkStats stats;
+
+    // Like the 65 byte USB HID fifo
+    fifoBuf_init(&ut_tx_fifo, ut_tx_fifo_buf, 20);
+    ut_tx_stream.clear();
+
+    EXPECT_EQ(0, UAVTalkSendObject(reserved, waypoint, 0, 0, 0));
+    EXPECT_EQ((size_t)UAVTALK_MIN_HEADER_LENGTH + WAYPOINT_SIZE + UAVTALK_CHECKSUM_LENGTH, ut_tx_stream.size());
+    EXPECT_EQ(0, fifoBuf_getUsed(&ut_tx_fifo));
+
+    EXPECT_EQ(-1, UAVTalkSendObject(noStream, waypoint, 0, 0, 0));
+    UAVTalkGetStats(noStream, &stats, false);
+    EXPECT_EQ(1U, stats.txErrors);
+}
+
+// Changes the waypoint while the output buffer is reserved, like a writer that got the
+// object lock while the packet was being written
+static int32_t reserveAndUpdate(t_fifo_span *span, uint16_t length)
+{
+    uint8_t data[WAYPOINT_SIZE];
+
+    memset(data, 0xBB, sizeof(data));
+    UAVObjSetInstanceData(ut_handles[0], 0, data);
+    return reserveStream(span, length);
+}
+
+TEST_F(UAVTalkTest, ZeroCopyPacksBeforeReserving) {
+    UAVTalkConnection reserved = UAVTalkInitializeReserve(reserveAndUpdate, commitStream, copyStream);
+    std::vector<uint8_t> inPlace;
+    uint8_t data[WAYPOINT_SIZE];
+
+    fifoBuf_init(&ut_tx_fifo, ut_tx_fifo_buf, sizeof(ut_tx_fifo_buf));
+    memset(data, 0xAA, sizeof(data));
+    UAVObjSetInstanceData(waypoint, 0, data);
+
+    // The object lock is not taken with the output buffer reserved
+    EXPECT_EQ(0, UAVTalkSendObject(reserved, waypoint, 0, 0, 0));
+    drainFifo(inPlace);
+    ASSERT_EQ((size_t)UAVTALK_MIN_HEADER_LENGTH + WAYPOINT_SIZE + UAVTALK_CHECKSUM_LENGTH, inPlace.size());
+    EXPECT_EQ(0xAA, inPlace[UAVTALK_MIN_HEADER_LENGTH]);
+    EXPECT_EQ(0xAA, inPlace[UAVTALK_MIN_HEADER_LENGTH + WAYPOINT_SIZE - 1]);
+}
+
+// Time sending an object and emptying the fifo, best of a few rounds
+static double timeSend(UAVTalkConnection connection, UAVObjHandle obj)
+{
+    uint8_t out[TX_FIFO_SIZE];
+    double best = 1e9;
+
+    for (uint32_t round = 0; round < 5; round++) {
+        BenchClock::time_point start = BenchClock::now();
+        for (uint32_t n = 0; n < BENCH_SENDS; n++) {
+            UAVTalkSendObject(connection, obj, 0, 0, 0);
+            fifoBuf_getData(&ut_tx_fifo, out, sizeof(out));
+        }
+        double elapsed = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / BENCH_SENDS;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+TEST_F(UAVTalkTest, BenchmarkTransmit) {
+    UAVTalkConnection reserved = UAVTalkInitializeReserve(reserveStream, commitStream, NULL);
+    UAVTalkConnection copying  = UAVTalkInitialize(fifoStream);
+    // A waypoint and an object about the size of the largest settings
+    UAVObjHandle large = ut_handles[1] = UAVObjRegister(UT_ObjId(1), true, false, false, 200, NULL);
+    UAVObjHandle objects[] = { waypoint, large };
+
+    ASSERT_TRUE(large != NULL);
+    fifoBuf_init(&ut_tx_fifo, ut_tx_fifo_buf, sizeof(ut_tx_fifo_buf));
+
+    for (uint32_t o = 0; o < sizeof(objects) / sizeof(objects[0]); o++) {
+        double copied  = timeSend(copying, objects[o]);
+        double inPlace = timeSend(reserved, objects[o]);
+
+        printf("[ BENCH    ] %3u byte object sent: through txBuffer %5.1f ns, in place %5.1f ns\n",
+               UAVObjGetNumBytes(objects[o]), copied, inPlace);
+    }
+}
+
+// Size of each packet in a stream, from the size field
+static std::vector<uint16_t> packetSizes(const std::vector<uint8_t> & stream)
+{
+    std::vector<uint16_t> sizes;
+
+    for (size_t pos = 0; pos + UAVTALK_BATCH_HEADER_LENGTH <= stream.size();) {
+        uint16_t size = stream[pos + 2] | (stream[pos + 3] << 8);
+        sizes.push_back(size);
+        pos += size + UAVTALK_CHECKSUM_LENGTH;
+    }
+    return sizes;
+}
+
+TEST_F(UAVTalkTest, BatchRoundTrip) {
+    UAVTalkConnection sender = UAVTalkInitialize(copyStream);
+    uint8_t data[WAYPOINT_SIZE];
+    UAVTalkStats stats;
+
+    ASSERT_EQ(0, UAVTalkSetBatching(sender, true));
+    ut_tx_stream.clear();
+    for (uint16_t i = 0; i < BATCH_WAYPOINTS; i++) {
+        memset(data, i + 1, sizeof(data));
+        UAVObjUnpack(waypoint, i, data);
+        EXPECT_EQ(0, UAVTalkSendObject(sender, waypoint, i, 0, 0));
+    }
+    EXPECT_EQ(0, UAVTalkFlush(sender));
+
+    // Instance 0 has the short entry header, the others carry their instance ID
+    std::vector<uint16_t> sizes = packetSizes(ut_tx_stream);
+    size_t expected = BATCH_WAYPOINTS * (UAVTALK_BATCH_ENTRY_LENGTH + 2 + WAYPOINT_SIZE) - 2;
+    size_t total    = 0;
+    ASSERT_LT(1U, sizes.size());
+    for (size_t n = 0; n < sizes.size(); n++) {
+        EXPECT_EQ(UAVTALK_TYPE_MULTI, ut_tx_stream[total + 1]);
+        EXPECT_GE(UAVTALK_BATCH_HEADER_LENGTH + UAVTALK_BATCH_MAX_LENGTH, sizes[n]);
+        total += sizes[n] + UAVTALK_CHECKSUM_LENGTH;
+    }
+    EXPECT_EQ(ut_tx_stream.size(), total);
+    EXPECT_EQ(expected + sizes.size() * (UAVTALK_BATCH_HEADER_LENGTH + UAVTALK_CHECKSUM_LENGTH), total);
+
+    UAVTalkGetStats(sender, &stats, false);
+    EXPECT_EQ((uint32_t)BATCH_WAYPOINTS, stats.txObjects);
+    EXPECT_EQ(total, stats.txBytes);
+
+    // Clear the local copy and receive it back
+    memset(data, 0, sizeof(data));
+    for (uint16_t i = 0; i < BATCH_WAYPOINTS; i++) {
+        UAVObjSetInstanceData(waypoint, i, data);
+    }
+    processStream(ut_tx_stream);
+    for (uint16_t i = 0; i < BATCH_WAYPOINTS; i++) {
+        EXPECT_EQ(0, UAVObjGetInstanceData(waypoint, i, data));
+        EXPECT_EQ(i + 1, data[0]);
+        EXPECT_EQ(i + 1, data[WAYPOINT_SIZE - 1]);
+    }
+    UAVTalkGetStats(connection, &stats, false);
+    EXPECT_EQ(0U, stats.rxErrors);
+}
+
+TEST_F(UAVTalkTest, BatchKeepsOrder) {
+    UAVTalkConnection sender = UAVTalkInitialize(copyStream);
+    UAVObjHandle large = ut_handles[1] = UAVObjRegister(UT_ObjId(1), true, false, false, 200, NULL);
+
+    ASSERT_EQ(0, UAVTalkSetBatching(sender, true));
+    ut_tx_stream.clear();
+
+    EXPECT_EQ(0, UAVTalkSendObject(sender, waypoint, 0, 0, 0));
+    EXPECT_EQ(0U, ut_tx_stream.size());
+
+    // Too large for an entry, the waypoint goes out first
+    EXPECT_EQ(0, UAVTalkSendObject(sender, large, 0, 0, 0));
+    std::vector<uint16_t> sizes = packetSizes(ut_tx_stream);
+    ASSERT_EQ(2U, sizes.size());
+    EXPECT_EQ(UAVTALK_TYPE_MULTI, ut_tx_stream[1]);
+    EXPECT_EQ(UAVTALK_BATCH_HEADER_LENGTH + UAVTALK_BATCH_ENTRY_LENGTH + WAYPOINT_SIZE, sizes[0]);
+    EXPECT_EQ(UAVTALK_TYPE_OBJ, ut_tx_stream[sizes[0] + UAVTALK_CHECKSUM_LENGTH + 1]);
+
+    // Disabling sends what is left
+    EXPECT_EQ(0, UAVTalkSendObject(sender, waypoint, 0, 0, 0));
+    EXPECT_EQ(0, UAVTalkSetBatching(sender, false));
+    EXPECT_EQ(3U, packetSizes(ut_tx_stream).size());
+}
+
+// The ground modem drops the first object, receives the second one and relays the rest
+static UAVTalkRelayAction relayFilter(uint32_t objId)
+{
+    if (objId == UT_ObjId(1)) {
+        return UAVTALK_RELAY_DROP;
+    } else if (objId == UT_ObjId(2)) {
+        return UAVTALK_RELAY_RECEIVE;
+    }
+    return UAVTALK_RELAY_FORWARD;
+}
+
+static void relayStream(UAVTalkConnection in, UAVTalkConnection out, const std::vector<uint8_t> & stream)
+{
+    for (size_t pos = 0; pos < stream.size();) {
+        uint32_t consumed;
+        if (UAVTalkProcessInputBufferQuiet(in, &stream[pos], stream.size() - pos, &consumed) == UAVTALK_STATE_COMPLETE) {
+            EXPECT_EQ(0, UAVTalkRelayPacketFiltered(in, out, relayFilter));
+        }
+        pos += consumed;
+    }
+}
+
+TEST_F(UAVTalkTest, RelayFiltersBatchEntries) {
+    UAVTalkConnection sender = UAVTalkInitialize(copyStream);
+    UAVTalkConnection relay  = UAVTalkInitialize(copyStream);
+    UAVObjHandle dropped     = ut_handles[1] = UAVObjRegister(UT_ObjId(1), true, false, false, 8, NULL);
+    UAVObjHandle received    = ut_handles[2] = UAVObjRegister(UT_ObjId(2), true, false, false, 8, NULL);
+    uint8_t data[WAYPOINT_SIZE];
+    uint8_t zero[WAYPOINT_SIZE] = { 0 };
+
+    ASSERT_EQ(0, UAVTalkSetBatching(sender, true));
+    ut_tx_stream.clear();
+    memset(data, 0x11, sizeof(data));
+    UAVObjUnpack(waypoint, 0, data);
+    UAVObjUnpack(dropped, 0, data);
+    UAVObjUnpack(received, 0, data);
+    EXPECT_EQ(0, UAVTalkSendObject(sender, dropped, 0, 0, 0));
+    EXPECT_EQ(0, UAVTalkSendObject(sender, waypoint, 0, 0, 0));
+    EXPECT_EQ(0, UAVTalkSendObject(sender, received, 0, 0, 0));
+    EXPECT_EQ(0, UAVTalkFlush(sender));
+    ASSERT_EQ(1U, packetSizes(ut_tx_stream).size());
+    ASSERT_EQ(UAVTALK_TYPE_MULTI, ut_tx_stream[1]);
+
+    // Only the waypoint goes on, the received object is updated locally
+    std::vector<uint8_t> stream;
+    stream.swap(ut_tx_stream);
+    UAVObjUnpack(waypoint, 0, zero);
+    UAVObjUnpack(dropped, 0, zero);
+    UAVObjUnpack(received, 0, zero);
+    relayStream(connection, relay, stream);
+    std::vector<uint16_t> sizes = packetSizes(ut_tx_stream);
+    ASSERT_EQ(1U, sizes.size());
+    EXPECT_EQ(UAVTALK_TYPE_MULTI, ut_tx_stream[1]);
+    EXPECT_EQ(UAVTALK_BATCH_HEADER_LENGTH + UAVTALK_BATCH_ENTRY_LENGTH + WAYPOINT_SIZE, sizes[0]);
+    EXPECT_EQ(0, UAVObjGetData(received, data));
+    EXPECT_EQ(0x11, data[0]);
+    EXPECT_EQ(0, UAVObjGetData(dropped, data));
+    EXPECT_EQ(0, data[0]);
+    EXPECT_EQ(0, UAVObjGetData(waypoint, data));
+    EXPECT_EQ(0, data[0]);
+
+    // The relayed packet is valid
+    processStream(ut_tx_stream);
+    EXPECT_EQ(0, UAVObjGetData(waypoint, data));
+    EXPECT_EQ(0x11, data[0]);
+
+    // Single object packets are filtered the same way, nothing is relayed when all entries are filtered out
+    ASSERT_EQ(0, UAVTalkSetBatching(sender, false));
+    ut_tx_stream.clear();
+    EXPECT_EQ(0, UAVTalkSendObject(sender, dropped, 0, 0, 0));
+    EXPECT_EQ(0, UAVTalkSetBatching(sender, true));
+    EXPECT_EQ(0, UAVTalkSendObject(sender, received, 0, 0, 0));
+    EXPECT_EQ(0, UAVTalkFlush(sender));
+    stream.clear();
+    stream.swap(ut_tx_stream);
+    relayStream(connection, relay, stream);
+    EXPECT_EQ(0U, ut_tx_stream.size());
+}
+
+// A decoded object update from a log
+typedef struct {
+    uint32_t timestamp;
+    uint32_t objId;
+    uint16_t instId;
+    std::vector<uint8_t> data;
+} LogObject;
+
+// Decode the object updates of a log, registering the objects it contains after the waypoint
+static void decodeLog(UAVTalkConnection connection, const std::vector<uint8_t> & log, std::vector<LogObject> & objects)
+{
+    UAVTalkConnectionData *conn = (UAVTalkConnectionData *)connection;
+    uint32_t handles = 1;
+    size_t pos = 0;
+
+    while (pos + sizeof(uint32_t) + sizeof(int64_t) <= log.size()) {
+        uint32_t timestamp;
+        int64_t size;
+        memcpy(&timestamp, &log[pos], sizeof(timestamp));
+        memcpy(&size, &log[pos + sizeof(uint32_t)], sizeof(size));
+        pos += sizeof(uint32_t) + sizeof(int64_t);
+        if (size < 1 || (uint64_t)size > log.size() - pos) {
+            break;
+        }
+        for (int64_t i = 0; i < size; i++) {
+            if (UAVTalkProcessInputStreamQuiet(connection, log[pos + i]) != UAVTALK_STATE_COMPLETE) {
+                continue;
+            }
+            uint8_t type = conn->iproc.type & ~UAVTALK_TIMESTAMPED;
+            if ((type != UAVTALK_TYPE_OBJ && type != UAVTALK_TYPE_OBJ_ACK) || conn->iproc.length == 0) {
+                continue;
+            }
+            LogObject object;
+            object.timestamp = timestamp;
+            object.objId     = conn->iproc.objId;
+            object.instId    = conn->iproc.instId;
+            object.data.assign(conn->rxBuffer, conn->rxBuffer + conn->iproc.length);
+            if (!UAVObjGetByID(object.objId)) {
+                if (handles == UT_NUM_OBJECTS) {
+                    continue;
+                }
+                ut_handles[handles++] = UAVObjRegister(object.objId, false, false, false, object.data.size(), NULL);
+            }
+            objects.push_back(object);
+        }
+        pos += size;
+    }
+}
+
+// Send the logged updates again, the telemetry task flushes once per window
+static uint32_t resendLog(UAVTalkConnection sender, const std::vector<LogObject> & objects, uint32_t window)
+{
+    uint32_t current = 0;
+
+    ut_link_bytes = 0;
+    for (size_t n = 0; n < objects.size(); n++) {
+        if (window && objects[n].timestamp / window != current) {
+            UAVTalkFlush(sender);
+            current = objects[n].timestamp / window;
+        }
+        UAVObjHandle obj = UAVObjGetByID(objects[n].objId);
+        UAVObjUnpack(obj, objects[n].instId, &objects[n].data[0]);
+        UAVTalkSendObject(sender, obj, objects[n].instId, 0, 0);
+    }
+    UAVTalkFlush(sender);
+    return ut_link_bytes;
+}
+
+TEST_F(UAVTalkTest, BenchmarkBatchBandwidth) {
+    UAVTalkConnection sender = UAVTalkInitialize(countStream);
+    std::vector<uint8_t> log;
+    std::vector<LogObject> objects;
+    // How long the telemetry task collects updates before it runs out of work
+    static const uint32_t windows[] = { 1, 5, 20 };
+
+    loadLog(log);
+    decodeLog(connection, log, objects);
+    ASSERT_LT(0U, objects.size());
+
+    uint32_t objectBytes = 0;
+    for (size_t n = 0; n < objects.size(); n++) {
+        objectBytes += objects[n].data.size();
+    }
+    double seconds = (objects.back().timestamp - objects.front().timestamp + 1) / 1000.0;
+
+    uint32_t single = resendLog(sender, objects, 0);
+    printf("[ BENCH    ] .opl resend, %u objects in %.1f s, one packet per object: %u bytes, %5.1f%% object data, %6.1f kbit/s\n",
+           (uint32_t)objects.size(), seconds, single, 100.0 * objectBytes / single, single * 8 / seconds / 1000);
+
+    ASSERT_EQ(0, UAVTalkSetBatching(sender, true));
+    for (uint32_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+        uint32_t batched = resendLog(sender, objects, windows[w]);
+        EXPECT_GT(single, batched);
+        printf("[ BENCH    ] .opl resend, %u objects in %.1f s, batched every %2u ms:    %u bytes, %5.1f%% object data, %6.1f kbit/s\n",
+               (uint32_t)objects.size(), seconds, windows[w], batched, 100.0 * objectBytes / batched, batched * 8 / seconds / 1000);
+    }
+}
+
+// Send the object and return its packet, with the local copy cleared so receiving it shows what arrived
+static std::vector<uint8_t> sendAndClear(UAVTalkConnection sender, UAVObjHandle obj, const uint8_t *data)
+{
+    uint8_t zero[DELTA_OBJECT_SIZE] = { 0 };
+
+    ut_tx_stream.clear();
+    UAVObjSetData(obj, data);
+    EXPECT_EQ(0, UAVTalkSendObject(sender, obj, 0, 0, 0));
+    UAVObjSetData(obj, zero);
+    return ut_tx_stream;
+}
+
+TEST_F(UAVTalkTest, DeltaRoundTrip) {
+    UAVTalkConnection sender = UAVTalkInitialize(copyStream);
+    UAVObjHandle obj = ut_handles[1] = UAVObjRegister(UT_ObjId(1), true, false, false, DELTA_OBJECT_SIZE, NULL);
+    uint8_t data[DELTA_OBJECT_SIZE];
+    uint8_t out[DELTA_OBJECT_SIZE];
+    UAVTalkStats stats;
+
+    ASSERT_EQ(0, UAVTalkSetDelta(sender, true, false));
+    ASSERT_EQ(0, UAVTalkSetDelta(connection, false, true));
+    for (uint16_t i = 0; i < sizeof(data); i++) {
+        data[i] = i;
+    }
+
+    // The first update goes in full
+    std::vector<uint8_t> packet = sendAndClear(sender, obj, data);
+    EXPECT_EQ(UAVTALK_TYPE_OBJ, packet[1]);
+    processStream(packet);
+
+    // Then only the two changed blocks, one of them the short one at the end
+    for (uint32_t update = 1; update < UAVTALK_DELTA_KEYFRAME; update++) {
+        data[10] = update;
+        data[DELTA_OBJECT_SIZE - 1] = update;
+        packet = sendAndClear(sender, obj, data);
+        ASSERT_EQ(UAVTALK_TYPE_OBJ_DELTA, packet[1]) << "update " << update;
+        EXPECT_EQ((size_t)(UAVTALK_MIN_HEADER_LENGTH + 1 + UAVTALK_DELTA_MASK_LENGTH(DELTA_OBJECT_SIZE) + 2 * UAVTALK_DELTA_BLOCK + UAVTALK_CHECKSUM_LENGTH), packet.size());
+        processStream(packet);
+        UAVObjGetData(obj, out);
+        ASSERT_EQ(0, memcmp(data, out, sizeof(data))) << "update " << update;
+    }
+
+    // Nothing changed, but a keyframe is due
+    packet = sendAndClear(sender, obj, data);
+    EXPECT_EQ(UAVTALK_TYPE_OBJ, packet[1]);
+    processStream(packet);
+    UAVObjGetData(obj, out);
+    EXPECT_EQ(0, memcmp(data, out, sizeof(data)));
+
+    UAVTalkGetStats(connection, &stats, false);
+    EXPECT_EQ(0U, stats.rxErrors);
+    EXPECT_EQ(0U, ut_tx_requests);
+}
+
+TEST_F(UAVTalkTest, DeltaReenableKeepsCache) {
+    UAVTalkConnection sender = UAVTalkInitialize(copyStream);
+    UAVObjHandle obj = ut_handles[1] = UAVObjRegister(UT_ObjId(1), true, false, false, DELTA_OBJECT_SIZE, NULL);
+    uint8_t data[DELTA_OBJECT_SIZE] = { 0 };
+
+    ASSERT_EQ(0, UAVTalkSetDelta(sender, true, false));
+    UAVTalkDeltaCache *cache = ((UAVTalkConnectionData *)sender)->txDelta;
+    ASSERT_TRUE(cache != NULL);
+    sendAndClear(sender, obj, data);
+    data[0] = 1;
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_DELTA, sendAndClear(sender, obj, data)[1]);
+
+    // A reconnect reuses the images, but the first update after it goes in full
+    ASSERT_EQ(0, UAVTalkSetDelta(sender, false, false));
+    EXPECT_EQ(UAVTALK_TYPE_OBJ, sendAndClear(sender, obj, data)[1]);
+    ASSERT_EQ(0, UAVTalkSetDelta(sender, true, false));
+    EXPECT_EQ(cache, ((UAVTalkConnectionData *)sender)->txDelta);
+    data[0] = 2;
+    EXPECT_EQ(UAVTALK_TYPE_OBJ, sendAndClear(sender, obj, data)[1]);
+    data[0] = 3;
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_DELTA, sendAndClear(sender, obj, data)[1]);
+}
+
+TEST_F(UAVTalkTest, DeltaLostUpdateRequestsObject) {
+    UAVTalkConnection sender = UAVTalkInitialize(copyStream);
+    UAVObjHandle obj = ut_handles[1] = UAVObjRegister(UT_ObjId(1), true, false, false, DELTA_OBJECT_SIZE, NULL);
+    uint8_t data[DELTA_OBJECT_SIZE] = { 0 };
+    uint8_t out[DELTA_OBJECT_SIZE];
+
+    ASSERT_EQ(0, UAVTalkSetDelta(sender, true, false));
+    ASSERT_EQ(0, UAVTalkSetDelta(connection, false, true));
+
+    processStream(sendAndClear(sender, obj, data));
+    data[0] = 1;
+    sendAndClear(sender, obj, data);
+    data[100] = 2;
+    std::vector<uint8_t> packet = sendAndClear(sender, obj, data);
+    ASSERT_EQ(UAVTALK_TYPE_OBJ_DELTA, packet[1]);
+
+    // The receiver does not have the image the delta applies to
+    processStream(packet);
+    EXPECT_EQ(1U, ut_tx_requests);
+    UAVObjGetData(obj, out);
+    EXPECT_EQ(0, out[100]);
+
+    // The request is answered with the full object
+    std::vector<uint8_t> request;
+    appendPacket(request, UAVTALK_TYPE_OBJ_REQ, UT_ObjId(1), 0, NULL, 0);
+    UAVObjSetData(obj, data);
+    ut_tx_stream.clear();
+    for (size_t i = 0; i < request.size(); i++) {
+        UAVTalkProcessInputStream(sender, request[i]);
+    }
+    ASSERT_LT(1U, ut_tx_stream.size());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ, ut_tx_stream[1]);
+    memset(out, 0, sizeof(out));
+    UAVObjSetData(obj, out);
+    processStream(ut_tx_stream);
+    UAVObjGetData(obj, out);
+    EXPECT_EQ(0, memcmp(data, out, sizeof(data)));
+
+    // And deltas apply again
+    data[50] = 3;
+    processStream(sendAndClear(sender, obj, data));
+    UAVObjGetData(obj, out);
+    EXPECT_EQ(0, memcmp(data, out, sizeof(data)));
+    EXPECT_EQ(1U, ut_tx_requests);
+}
+
+// Periodic telemetry: object size, 4 byte fields changing on every update, update period
+typedef struct {
+    uint16_t length;
+    uint16_t changing;
+    uint16_t periodMs;
+} TelemetryObject;
+
+// Without UT_OPL_LOG, updates shaped like a flight: attitude and actuators change a lot,
+// stats and the GPS in a few fields, settings not at all
+static void telemetryLog(std::vector<LogObject> & objects)
+{
+    static const TelemetryObject telemetry[] = {
+        { 28,  7,  50  }, // AttitudeState
+        { 44,  4,  100 }, // ActuatorCommand
+        { 40,  2,  500 }, // GPSPositionSensor
+        { 60,  2,  1000 }, // SystemStats
+        { 20,  1,  1000 }, // FlightBatteryState
+        { 200, 0,  5000 }, // StabilizationSettings
+    };
+    uint32_t numObjects = sizeof(telemetry) / sizeof(telemetry[0]);
+
+    for (uint32_t n = 0; n < numObjects; n++) {
+        ut_handles[n + 1] = UAVObjRegister(UT_ObjId(n + 1), true, false, false, telemetry[n].length, NULL);
+    }
+    for (uint32_t ms = 0; ms < DELTA_RUN_TIME_MS; ms++) {
+        for (uint32_t n = 0; n < numObjects; n++) {
+            if (ms % telemetry[n].periodMs != 0) {
+                continue;
+            }
+            LogObject object;
+            object.timestamp = ms;
+            object.objId     = UT_ObjId(n + 1);
+            object.instId    = 0;
+            object.data.assign(telemetry[n].length, (uint8_t)n);
+            for (uint16_t field = 0; field < telemetry[n].changing; field++) {
+                uint32_t value = ms + field;
+                memcpy(&object.data[4 * field], &value, sizeof(value));
+            }
+            objects.push_back(object);
+        }
+    }
+}
+
+TEST_F(UAVTalkTest, BenchmarkDeltaBandwidth) {
+    UAVTalkConnection sender = UAVTalkInitialize(countStream);
+    std::vector<LogObject> objects;
+
+    if (getenv("UT_OPL_LOG")) {
+        std::vector<uint8_t> log;
+        loadLog(log);
+        decodeLog(connection, log, objects);
+    } else {
+        telemetryLog(objects);
+    }
+    ASSERT_LT(0U, objects.size());
+    double seconds = (objects.back().timestamp - objects.front().timestamp + 1) / 1000.0;
+
+    uint32_t single  = resendLog(sender, objects, 0);
+    ASSERT_EQ(0, UAVTalkSetBatching(sender, true));
+    uint32_t batched = resendLog(sender, objects, 5);
+    ASSERT_EQ(0, UAVTalkSetBatching(sender, false));
+
+    ASSERT_EQ(0, UAVTalkSetDelta(sender, true, false));
+    uint32_t delta = resendLog(sender, objects, 0);
+    ASSERT_EQ(0, UAVTalkSetBatching(sender, true));
+    uint32_t both  = resendLog(sender, objects, 5);
+
+    EXPECT_GT(single, delta);
+    EXPECT_GE(batched, both);
+    printf("[ BENCH    ] %u updates in %.1f s: full %6.1f kbit/s, delta %6.1f kbit/s; batched every 5 ms: full %6.1f kbit/s, delta %6.1f kbit/s\n",
+           (uint32_t)objects.size(), seconds, single * 8 / seconds / 1000, delta * 8 / seconds / 1000,
+           batched * 8 / seconds / 1000, both * 8 / seconds / 1000);
+}
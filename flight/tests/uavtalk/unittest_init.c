@@ -0,0 +1,106 @@
+/*
+ * Stand-ins for the generated object code and for the parts of the
+ * firmware the object manager and UAVTalk call out to.
+ */
+
+#include <pthread.h>
+#include <time.h>
+
+#include "openpilot.h"
+#include "unittest_priv.h"
+
+/* Same section the generated $(NAME).c files put their handles in */
+UAVObjHandle ut_handles[UT_NUM_OBJECTS] __attribute__((section("_uavo_handles")));
+
+uint32_t ut_queue_events;
+uint32_t ut_callback_events;
+uint32_t ut_coalesced_events;
+
+static xSemaphoreHandle createMutex(int type)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutex_t *mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t));
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, type);
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return (xSemaphoreHandle)mutex;
+}
+
+xSemaphoreHandle xSemaphoreCreateMutex()
+{
+    return createMutex(PTHREAD_MUTEX_NORMAL);
+}
+
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex()
+{
+    return createMutex(PTHREAD_MUTEX_RECURSIVE);
+}
+
+int32_t xSemaphoreTake(xSemaphoreHandle mutex, uint32_t ticks)
+{
+    if (ticks == 0) {
+        return pthread_mutex_trylock((pthread_mutex_t *)mutex) == 0 ? pdTRUE : pdFALSE;
+    }
+    return pthread_mutex_lock((pthread_mutex_t *)mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+int32_t xSemaphoreGive(xSemaphoreHandle mutex)
+{
+    return pthread_mutex_unlock((pthread_mutex_t *)mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+portTickType xTaskGetTickCount()
+{
+    return PIOS_DELAY_GetRaw() / 1000;
+}
+
+uint32_t PIOS_DELAY_GetRaw()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
+{
+    return PIOS_DELAY_GetRaw() - raw;
+}
+
+int32_t xQueueSend(__attribute__((unused)) xQueueHandle queue, __attribute__((unused)) const void *item, __attribute__((unused)) uint32_t ticks)
+{
+    ut_queue_events++;
+    return pdTRUE;
+}
+
+int32_t EventCallbackDispatch(__attribute__((unused)) UAVObjEvent *ev, __attribute__((unused)) UAVObjEventCallback cb)
+{
+    ut_callback_events++;
+    return pdTRUE;
+}
+
+EventCoalescedCallback *EventCoalescedCallbackCreate(__attribute__((unused)) UAVObjEventCallback cb)
+{
+    return (EventCoalescedCallback *)malloc(1);
+}
+
+void EventCoalescedCallbackDelete(EventCoalescedCallback *coalesced)
+{
+    free(coalesced);
+}
+
+int32_t EventCallbackDispatchCoalesced(__attribute__((unused)) EventCoalescedCallback *coalesced, __attribute__((unused)) UAVObjEvent *ev)
+{
+    ut_coalesced_events++;
+    return pdTRUE;
+}
+
+void PIOS_DEBUGLOG_UAVObject(__attribute__((unused)) uint32_t objid, __attribute__((unused)) uint16_t instid, __attribute__((unused)) size_t size, __attribute__((unused)) uint8_t *data) {}
+
+/* Object ids are hashes with the lowest bit cleared, the metaobject gets id + 1 */
+uint32_t UT_ObjId(uint32_t n)
+{
+    return ((n + 1) * 0x9E3779B9UL) & 0xFFFFFFFE;
+}
@@ -0,0 +1,15 @@
+#ifndef UNITTEST_PRIV_H
+#define UNITTEST_PRIV_H
+
+#include <stdint.h>
+
+#define UT_NUM_OBJECTS 64
+
+extern UAVObjHandle ut_handles[UT_NUM_OBJECTS];
+extern uint32_t ut_queue_events;
+extern uint32_t ut_callback_events;
+extern uint32_t ut_coalesced_events;
+
+uint32_t UT_ObjId(uint32_t n);
+
+#endif /* UNITTEST_PRIV_H */
@@ -44,6 +44,11 @@
 #define CALLBACK_PRIORITY    CALLBACK_PRIORITY_CRITICAL
 #define TASK_PRIORITY        CALLBACK_TASK_FLIGHTCONTROL
 #define MAX_UPDATE_PERIOD_MS 1000
+// The update heap is kept in segments that are never freed, see heapInsert()
+#define HEAP_SEGMENT_SHIFT   5
+#define HEAP_SEGMENT         (1 << HEAP_SEGMENT_SHIFT)
+#define HEAP_MAX_SEGMENTS    32
+#define HEAP(index)          mHeap[(index) >> HEAP_SEGMENT_SHIFT][(index) & (HEAP_SEGMENT - 1)]
 
 // Private types
 
@@ -65,16 +70,38 @@ struct PeriodicObjectListStruct {
     EventCallbackInfo evInfo; /** Event callback information */
     uint16_t updatePeriodMs; /** Update period in ms or 0 if no periodic updates are needed */
     int32_t  timeToNextUpdateMs; /** Time delay to the next update */
+    uint16_t heapIndex; /** Position in the update heap, only valid while updatePeriodMs > 0 */
     struct PeriodicObjectListStruct *next; /** Needed by linked list library (utlist.h) */
 };
 typedef struct PeriodicObjectListStruct PeriodicObjectList;
 
+/**
+ * Coalesced callback state, linked into the ready list while an event is pending.
+ * The ready list is a lock-free stack: listeners push with compare and swap,
+ * the event task takes the whole list at once.
+ */
+struct EventCoalescedCallbackStruct {
+    struct EventCoalescedCallbackStruct *next; /** Next entry in the ready list */
+    UAVObjEventCallback cb; /** The callback function */
+    UAVObjEvent ev; /** The pending event, only written while idle */
+    volatile uint8_t    state; /** One of the COALESCED_* states */
+};
+
+#define COALESCED_IDLE     0
+#define COALESCED_PENDING  1
+#define COALESCED_DELETED  2
+
 // Private variables
 static PeriodicObjectList *mObjList;
+// Min-heap of the periodic entries ordered by timeToNextUpdateMs, so a tick only touches due entries
+static PeriodicObjectList * * *mHeap;
+static uint16_t mHeapCount;
+static uint16_t mHeapSize;
 static xQueueHandle mQueue;
 static DelayedCallbackInfo *eventSchedulerCallback;
 static xSemaphoreHandle mMutex;
 static EventStats mStats;
+static EventCoalescedCallback *volatile mReadyList;
 
 // Private functions
 static int32_t processPeriodicUpdates();
@@ -82,6 +109,11 @@ static void eventTask();
 static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static uint16_t randomizePeriod(uint16_t periodMs);
+static void processCoalescedCallbacks();
+static int32_t heapInsert(PeriodicObjectList *objEntry);
+static void heapRemove(PeriodicObjectList *objEntry);
+static void heapSiftUp(uint16_t index);
+static void heapSiftDown(uint16_t index);
 
 
 /**
@@ -91,7 +123,11 @@ static uint16_t randomizePeriod(uint16_t periodMs);
 int32_t EventDispatcherInitialize()
 {
     // Initialize variables
-    mObjList = NULL;
+    mObjList   = NULL;
+    mHeap      = NULL;
+    mHeapCount = 0;
+    mHeapSize  = 0;
+    mReadyList = NULL;
     memset(&mStats, 0, sizeof(EventStats));
 
     // Create mMutex
@@ -153,6 +189,78 @@ int32_t EventCallbackDispatch(UAVObjEvent *ev, UAVObjEventCallback cb)
     return result;
 }
 
+/**
+ * Create a coalesced callback. Events dispatched through it while an earlier one
+ * is still pending are merged into the pending one instead of being queued.
+ * Only suitable for callbacks that read the current object data and do not need
+ * to see every update.
+ * \param[in] cb The callback function
+ * \return The coalesced callback or NULL if failed
+ */
+EventCoalescedCallback *EventCoalescedCallbackCreate(UAVObjEventCallback cb)
+{
+    EventCoalescedCallback *coalesced = (EventCoalescedCallback *)pios_malloc(sizeof(EventCoalescedCallback));
+
+    if (coalesced == NULL) {
+        return NULL;
+    }
+    memset(coalesced, 0, sizeof(EventCoalescedCallback));
+    coalesced->cb    = cb;
+    coalesced->state = COALESCED_IDLE;
+    return coalesced;
+}
+
+/**
+ * Delete a coalesced callback. If an event is still pending the event task
+ * frees it instead of invoking the callback.
+ * Must not race with EventCallbackDispatchCoalesced() on the same callback.
+ * \param[in] coalesced The coalesced callback
+ */
+void EventCoalescedCallbackDelete(EventCoalescedCallback *coalesced)
+{
+    while (1) {
+        if (__sync_bool_compare_and_swap(&coalesced->state, COALESCED_IDLE, COALESCED_DELETED)) {
+            pios_free(coalesced);
+            return;
+        }
+        if (__sync_bool_compare_and_swap(&coalesced->state, COALESCED_PENDING, COALESCED_DELETED)) {
+            return;
+        }
+    }
+}
+
+/**
+ * Dispatch an event through a coalesced callback. The function returns
+ * immediately, the callback is invoked from the event task. If an event
+ * for the same instance is already pending the two are merged, events for
+ * other instances of a multi instance object are queued as usual.
+ * Calls for the same coalesced callback must be serialised by the caller.
+ * \param[in] coalesced The coalesced callback
+ * \param[in] ev The event to be dispatched
+ * \return Success (pdTRUE), failure (pdFALSE)
+ */
+int32_t EventCallbackDispatchCoalesced(EventCoalescedCallback *coalesced, UAVObjEvent *ev)
+{
+    if (!__sync_bool_compare_and_swap(&coalesced->state, COALESCED_IDLE, COALESCED_PENDING)) {
+        if (coalesced->ev.instId != ev->instId) {
+            return EventCallbackDispatch(ev, coalesced->cb);
+        }
+        __sync_fetch_and_add(&mStats.coalescedEvents, 1);
+        return pdTRUE;
+    }
+    memcpy(&coalesced->ev, ev, sizeof(UAVObjEvent));
+
+    // Push to the ready list
+    EventCoalescedCallback *head;
+    do {
+        head = mReadyList;
+        coalesced->next = head;
+    } while (!__sync_bool_compare_and_swap(&mReadyList, head, coalesced));
+
+    PIOS_CALLBACKSCHEDULER_Dispatch(eventSchedulerCallback);
+    return pdTRUE;
+}
+
 /**
  * Dispatch an event at periodic intervals.
  * \param[in] ev The event to be dispatched
@@ -230,6 +338,7 @@ static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
     // Create handle
     objEntry = (PeriodicObjectList *)pios_malloc(sizeof(PeriodicObjectList));
     if (objEntry == NULL) {
+        xSemaphoreGiveRecursive(mMutex);
         return -1;
     }
     objEntry->evInfo.ev.obj      = ev->obj;
@@ -239,6 +348,12 @@ static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
     objEntry->evInfo.queue       = queue;
     objEntry->updatePeriodMs     = periodMs;
     objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
+    // Schedule it
+    if (periodMs > 0 && heapInsert(objEntry) != 0) {
+        pios_free(objEntry);
+        xSemaphoreGiveRecursive(mMutex);
+        return -1;
+    }
     // Add to list
     LL_APPEND(mObjList, objEntry);
     // Release lock
@@ -267,12 +382,20 @@ static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
             objEntry->evInfo.ev.obj == ev->obj &&
             objEntry->evInfo.ev.instId == ev->instId &&
             objEntry->evInfo.ev.event == ev->event) {
-            // Object found, update period
+            // Object found, update period and reschedule
+            int32_t result = 0;
+            if (objEntry->updatePeriodMs > 0) {
+                heapRemove(objEntry);
+            }
             objEntry->updatePeriodMs     = periodMs;
             objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
+            if (periodMs > 0 && heapInsert(objEntry) != 0) {
+                objEntry->updatePeriodMs = 0;
+                result = -1;
+            }
             // Release lock
             xSemaphoreGiveRecursive(mMutex);
-            return 0;
+            return result;
         }
     }
     // If this point is reached the object was not found
@@ -302,6 +425,8 @@ static void eventTask()
         }
     }
 
+    processCoalescedCallbacks();
+
     // Process periodic updates
     if ((xTaskGetTickCount() * portTICK_RATE_MS) >= timeToNextUpdateMs) {
         timeToNextUpdateMs = processPeriodicUpdates();
@@ -310,6 +435,38 @@ static void eventTask()
     PIOS_CALLBACKSCHEDULER_Schedule(eventSchedulerCallback, timeToNextUpdateMs - (xTaskGetTickCount() * portTICK_RATE_MS), CALLBACK_UPDATEMODE_SOONER);
 }
 
+/**
+ * Invoke the callbacks of all pending coalesced events, oldest first.
+ */
+static void processCoalescedCallbacks()
+{
+    EventCoalescedCallback *ready = __sync_lock_test_and_set(&mReadyList, NULL);
+    EventCoalescedCallback *fifo  = NULL;
+
+    // The ready list is a stack, reverse it to keep the dispatch order
+    while (ready) {
+        EventCoalescedCallback *next = ready->next;
+        ready->next = fifo;
+        fifo  = ready;
+        ready = next;
+    }
+
+    while (fifo) {
+        EventCoalescedCallback *coalesced = fifo;
+        fifo = coalesced->next;
+
+        // Copy the event before going idle, updates from here on queue a new event
+        UAVObjEvent ev = coalesced->ev;
+        UAVObjEventCallback cb = coalesced->cb;
+        if (__sync_bool_compare_and_swap(&coalesced->state, COALESCED_PENDING, COALESCED_IDLE)) {
+            cb(&ev); // the function is expected to copy the event information
+        } else {
+            // Deleted while pending
+            pios_free(coalesced);
+        }
+    }
+}
+
 /**
  * Handle periodic updates for all objects.
  * \return The system time until the next update (in ms) or -1 if failed
@@ -320,48 +477,157 @@ static int32_t processPeriodicUpdates()
     int32_t timeNow;
     int32_t timeToNextUpdate;
     int32_t offset;
+    uint32_t dispatchStart = PIOS_DELAY_GetRaw();
+    uint16_t dispatched    = 0;
 
     // Get lock
     xSemaphoreTakeRecursive(mMutex, portMAX_DELAY);
 
-    // Iterate through each object and update its timer, if zero then transmit object.
-    // Also calculate smallest delay to next update.
-    timeToNextUpdate = xTaskGetTickCount() * portTICK_RATE_MS + MAX_UPDATE_PERIOD_MS;
-    LL_FOREACH(mObjList, objEntry) {
-        // If object is configured for periodic updates
-        if (objEntry->updatePeriodMs > 0) {
-            // Check if time for the next update
-            timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
-            if (objEntry->timeToNextUpdateMs <= timeNow) {
-                // Reset timer
-                offset = (timeNow - objEntry->timeToNextUpdateMs) % objEntry->updatePeriodMs;
-                objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - offset;
-                // Invoke callback, if one
-                if (objEntry->evInfo.cb != 0) {
-                    objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
-                }
-                // Push event to queue, if one
-                if (objEntry->evInfo.queue != 0) {
-                    if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE && !objEntry->evInfo.ev.lowPriority) { // do not block if queue is full
-                        if (objEntry->evInfo.ev.obj != NULL) {
-                            mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
-                        }
-                        ++mStats.eventErrors;
-                    }
+    // Pop the due objects off the heap, update their timers and transmit them.
+    // Each object is visited at most once, callbacks may reschedule objects.
+    for (uint16_t n = mHeapCount; n > 0 && mHeapCount > 0; n--) {
+        objEntry = HEAP(0);
+        // Check if time for the next update
+        timeNow  = xTaskGetTickCount() * portTICK_RATE_MS;
+        if (objEntry->timeToNextUpdateMs > timeNow) {
+            break;
+        }
+        // Reset timer
+        offset = (timeNow - objEntry->timeToNextUpdateMs) % objEntry->updatePeriodMs;
+        objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - offset;
+        heapSiftDown(0);
+        ++dispatched;
+        // Invoke callback, if one
+        if (objEntry->evInfo.cb != 0) {
+            objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
+        }
+        // Push event to queue, if one
+        if (objEntry->evInfo.queue != 0) {
+            if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE && !objEntry->evInfo.ev.lowPriority) { // do not block if queue is full
+                if (objEntry->evInfo.ev.obj != NULL) {
+                    mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
                 }
-            }
-            // Update minimum delay
-            if (objEntry->timeToNextUpdateMs < timeToNextUpdate) {
-                timeToNextUpdate = objEntry->timeToNextUpdateMs;
+                ++mStats.eventErrors;
             }
         }
     }
 
+    // The earliest update is on top of the heap
+    timeToNextUpdate = xTaskGetTickCount() * portTICK_RATE_MS + MAX_UPDATE_PERIOD_MS;
+    if (mHeapCount > 0 && HEAP(0)->timeToNextUpdateMs < timeToNextUpdate) {
+        timeToNextUpdate = HEAP(0)->timeToNextUpdateMs;
+    }
+
+    // Account for the time spent in this tick
+    mStats.lastDispatchCount = dispatched;
+    mStats.lastDispatchTime  = PIOS_DELAY_DiffuS(dispatchStart);
+    if (mStats.lastDispatchTime > mStats.maxDispatchTime) {
+        mStats.maxDispatchTime = mStats.lastDispatchTime;
+    }
+
     // Done
     xSemaphoreGiveRecursive(mMutex);
     return timeToNextUpdate;
 }
 
+/**
+ * Add an object to the update heap, growing the heap if needed.
+ * The heap grows by a segment of HEAP_SEGMENT entries at a time and never
+ * shrinks or moves: pios_free() does nothing on the heap_1 targets, a
+ * reallocated array would leak the old one.
+ * \return Success (0), failure (-1)
+ */
+static int32_t heapInsert(PeriodicObjectList *objEntry)
+{
+    if (mHeapCount == mHeapSize) {
+        if (mHeapSize == HEAP_MAX_SEGMENTS * HEAP_SEGMENT) {
+            return -1;
+        }
+        if (mHeap == NULL) {
+            mHeap = (PeriodicObjectList * * *)pios_malloc(HEAP_MAX_SEGMENTS * sizeof(PeriodicObjectList * *));
+            if (mHeap == NULL) {
+                return -1;
+            }
+        }
+        PeriodicObjectList * *segment = (PeriodicObjectList * *)pios_malloc(HEAP_SEGMENT * sizeof(PeriodicObjectList *));
+        if (segment == NULL) {
+            return -1;
+        }
+        mHeap[mHeapSize >> HEAP_SEGMENT_SHIFT] = segment;
+        mHeapSize += HEAP_SEGMENT;
+    }
+    objEntry->heapIndex = mHeapCount;
+    HEAP(mHeapCount)    = objEntry;
+    mHeapCount++;
+    heapSiftUp(objEntry->heapIndex);
+    return 0;
+}
+
+/**
+ * Remove an object from the update heap.
+ */
+static void heapRemove(PeriodicObjectList *objEntry)
+{
+    uint16_t index = objEntry->heapIndex;
+
+    mHeapCount--;
+    PeriodicObjectList *last = HEAP(mHeapCount);
+
+    if (index == mHeapCount) {
+        return;
+    }
+    HEAP(index)     = last;
+    last->heapIndex = index;
+    heapSiftUp(index);
+    heapSiftDown(last->heapIndex);
+}
+
+/**
+ * Move a heap entry towards the top while it is due earlier than its parent.
+ */
+static void heapSiftUp(uint16_t index)
+{
+    PeriodicObjectList *objEntry = HEAP(index);
+
+    while (index > 0) {
+        uint16_t parent = (index - 1) / 2;
+        if (HEAP(parent)->timeToNextUpdateMs <= objEntry->timeToNextUpdateMs) {
+            break;
+        }
+        HEAP(index) = HEAP(parent);
+        HEAP(index)->heapIndex = index;
+        index = parent;
+    }
+    HEAP(index) = objEntry;
+    objEntry->heapIndex = index;
+}
+
+/**
+ * Move a heap entry towards the bottom while one of its children is due earlier.
+ */
+static void heapSiftDown(uint16_t index)
+{
+    PeriodicObjectList *objEntry = HEAP(index);
+
+    while (1) {
+        uint32_t child = 2 * (uint32_t)index + 1;
+        if (child >= mHeapCount) {
+            break;
+        }
+        if (child + 1 < mHeapCount && HEAP(child + 1)->timeToNextUpdateMs < HEAP(child)->timeToNextUpdateMs) {
+            child++;
+        }
+        if (objEntry->timeToNextUpdateMs <= HEAP(child)->timeToNextUpdateMs) {
+            break;
+        }
+        HEAP(index) = HEAP(child);
+        HEAP(index)->heapIndex = index;
+        index = child;
+    }
+    HEAP(index) = objEntry;
+    objEntry->heapIndex = index;
+}
+
 /**
  * Return a psedorandom integer from 0 to periodMs
  * Based on the Park-Miller-Carta Pseudo-Random Number Generator
@@ -33,13 +33,25 @@
 typedef struct {
     uint32_t lastErrorID;
     uint32_t eventErrors;
+    uint32_t lastDispatchTime; /** Time spent on the last periodic update tick (us) */
+    uint32_t maxDispatchTime; /** Longest periodic update tick (us) */
+    uint16_t lastDispatchCount; /** Periodic events dispatched on the last tick */
+    uint32_t coalescedEvents; /** Events merged into an already pending coalesced callback */
 } EventStats;
 
+/**
+ * Coalesced callback, at most one event per listener is pending at any time
+ */
+typedef struct EventCoalescedCallbackStruct EventCoalescedCallback;
+
 // Public functions
 int32_t EventDispatcherInitialize();
 void EventGetStats(EventStats *statsOut);
 void EventClearStats();
 int32_t EventCallbackDispatch(UAVObjEvent *ev, UAVObjEventCallback cb);
+EventCoalescedCallback *EventCoalescedCallbackCreate(UAVObjEventCallback cb);
+void EventCoalescedCallbackDelete(EventCoalescedCallback *coalesced);
+int32_t EventCallbackDispatchCoalesced(EventCoalescedCallback *coalesced, UAVObjEvent *ev);
 int32_t EventPeriodicCallbackCreate(UAVObjEvent *ev, UAVObjEventCallback cb, uint16_t periodMs);
 int32_t EventPeriodicCallbackUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, uint16_t periodMs);
 int32_t EventPeriodicQueueCreate(UAVObjEvent *ev, xQueueHandle queue, uint16_t periodMs);
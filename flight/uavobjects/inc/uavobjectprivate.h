@@ -33,6 +33,13 @@
 
 // Constants
 
+/*
+ * Instances beyond instance 0 of a multi instance UAVO are allocated in chunks,
+ * chunk n holds the 2^n instances starting at instance 2^n. Enough of them for
+ * UAVOBJ_MAX_INSTANCES.
+ */
+#define UAVO_INSTANCE_CHUNKS 10
+
 // Private types
 
 // Macros
@@ -72,17 +79,20 @@ struct ObjectEventEntry {
     struct ObjectEventEntry *next;
     xQueueHandle queue;
     UAVObjEventCallback     cb;
+    /* NULL unless connected with UAVObjConnectCallbackCoalesced() */
+    EventCoalescedCallback *coalesced;
     uint8_t eventMask;
 };
 
 /*
    MetaInstance   == [UAVOBase [UAVObjMetadata]]
-   SingleInstance == [UAVOBase [UAVOData [InstanceData]]]
-   MultiInstance  == [UAVOBase [UAVOData [NumInstances [InstanceData0 [next]]]]
-                                                  ____________________/
-   \-->[InstanceData1 [next]]
-                                                  _________...________/
-   \-->[InstanceDataN [next]]
+   SingleInstance == [UAVOBase [UAVOData [SeqLock [InstanceData]]]]
+   MultiInstance  == [UAVOBase [UAVOData [NumInstances [Chunks [InstanceData0]]]]]
+                                                   ______/
+   \-->[Chunk0 [Chunk1 [Chunk2 [...]]]]
+         |       |       \-->[InstanceData4 .. InstanceData7]
+         |       \-->[InstanceData2 InstanceData3]
+         \-->[InstanceData1]
  */
 
 /*
@@ -121,9 +131,21 @@ struct UAVOData {
     uint16_t instance_size;
 } __attribute__((packed, aligned(4)));
 
+/*
+ * Sequence lock for single instance objects that allow lockless reads.
+ * The sequence is odd while a write is in progress, writers of the
+ * same object serialise on writeLock.
+ */
+struct UAVOSeqLock {
+    volatile uint32_t sequence;
+    xSemaphoreHandle  writeLock;
+};
+
 /* Augmented type for Single Instance Data UAVO */
 struct UAVOSingle {
-    struct UAVOData uavo;
+    struct UAVOData    uavo;
+    /* NULL unless enabled by UAVObjEnableSeqLock() */
+    struct UAVOSeqLock *seqlock;
 
     uint8_t instance0[];
     /*
@@ -132,21 +154,17 @@ struct UAVOSingle {
      */
 } __attribute__((packed));
 
-/* Part of a linked list of instances chained off of a multi instance UAVO. */
-struct UAVOMultiInst {
-    struct UAVOMultiInst *next;
-    uint8_t instance[];
-    /*
-     * Additional space will be malloc'd here to hold the
-     * the data for this instance.
-     */
-} __attribute__((packed));
-
 /* Augmented type for Multi Instance Data UAVO */
 struct UAVOMulti {
     struct UAVOData uavo;
     uint16_t num_instances;
-    struct UAVOMultiInst instance0 __attribute__((aligned(4)));
+    /*
+     * Table of UAVO_INSTANCE_CHUNKS instance chunks, allocated with the
+     * first chunk. Chunks are only ever added, never moved or freed,
+     * which heap_1 targets could not give back.
+     */
+    uint8_t * *chunks;
+    uint8_t instance0[] __attribute__((aligned(4)));
     /*
      * Additional space will be malloc'd here to hold the
      * the data for instance 0.
@@ -162,11 +180,13 @@ struct UAVOMulti {
 
 /** all information about instances are dependant on object type **/
 #define ObjSingleInstanceDataOffset(obj) ((void *)(&(((struct UAVOSingle *)obj)->instance0)))
-#define InstanceDataOffset(inst)         ((void *)&(((struct UAVOMultiInst *)inst)->instance))
+#define InstanceStride(obj)              (((obj)->instance_size + 3) & ~3)
 #define InstanceData(instance)           ((void *)instance)
 
 // Private functions
 int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType event);
 InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId);
+struct UAVOSingle *seqLockBegin(UAVObjHandle obj_handle, bool write);
+void seqLockEnd(struct UAVOSingle *obj, bool write);
 
 #endif /* UAVOBJECTPRIVATE_H_ */
@@ -35,11 +35,26 @@
 #include "pios_struct_helper.h"
 #include "inc/uavobjectprivate.h"
 
+#define PIOS_INSTRUMENT_MODULE
+#include <pios_instrumentation_helper.h>
+
+// Constants
+#define SEQLOCK_MAX_RETRIES 3
+// One of this many uncontended lockless reads is timed, contended ones always are
+#define SEQLOCK_TIMING_RATE 64
+
 // Private functions
 static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId);
-static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb, uint8_t eventMask);
+static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb, uint8_t eventMask, bool coalesce);
 static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb);
 static void instanceAutoUpdated(UAVObjHandle obj_handle, uint16_t instId);
+static void initObjIndex();
+static void addObjToIndex(struct UAVOData *obj);
+static struct UAVOData *findObjInIndex(uint32_t id);
+static struct UAVOSingle *getSeqLocked(UAVObjHandle obj_handle);
+static int32_t setSeqLockedData(struct UAVOSingle *obj, uint16_t instId, const void *dataIn, uint32_t offset, uint32_t size, UAVObjEventType event);
+static int32_t getSeqLockedData(struct UAVOSingle *obj, uint16_t instId, void *dataOut, uint32_t offset, uint32_t size, uint32_t split, void *dataOutWrapped);
+static inline void copySplit(void *dataOut, uint32_t split, void *dataOutWrapped, const void *data, uint32_t size);
 
 
 int32_t UAVObjPers_stub(__attribute__((unused)) UAVObjHandle obj_handle, __attribute__((unused))  uint16_t instId)
@@ -67,6 +82,27 @@ static const UAVObjMetadata defMetadata = {
 
 static UAVObjStats stats;
 
+/*
+ * Object ID index, an open addressing hash table (linear probing) of all
+ * registered data objects. Entries are only ever added, and each entry is
+ * published with a single pointer store, so lookups can run without the lock.
+ */
+static struct UAVOData * *objIndex;
+static uint8_t objIndexShift;
+static uint16_t objIndexCount;
+static bool objIndexOverflow;
+
+// Contended lockless reads, those retried or fallen back to the write lock, and lockless read time
+PERF_DEFINE_COUNTER(counterSeqLockContention);
+PERF_DEFINE_COUNTER(counterSeqLockReadTime);
+static uint32_t seqLockContention;
+#ifdef PIOS_INCLUDE_INSTRUMENTATION
+static uint32_t seqLockReads;
+#define SEQLOCK_TIMED_READ() ((__sync_add_and_fetch(&seqLockReads, 1) % SEQLOCK_TIMING_RATE) == 0)
+#else
+#define SEQLOCK_TIMED_READ() false
+#endif
+
 /**
  * Initialize the object manager
  * \return 0 Success
@@ -94,6 +130,13 @@ int32_t UAVObjInitialize()
         return -1;
     }
 
+    // Size the object ID index from the uavo handle table
+    initObjIndex();
+
+    seqLockContention = 0;
+    PERF_INIT_COUNTER(counterSeqLockContention, 0x0B1E0001);
+    PERF_INIT_COUNTER(counterSeqLockReadTime, 0x0B1E0002);
+
     // Done
     return 0;
 }
@@ -159,6 +202,9 @@ static struct UAVOData *UAVObjAllocSingle(uint32_t num_bytes)
     uavo_base->flags.isSingle = true;
     uavo_base->next_event     = NULL;
 
+    /* Reads take the object manager lock until UAVObjEnableSeqLock() */
+    uavo_single->seqlock = NULL;
+
     /* Clear the instance data carried in the UAVO */
     memset(&(uavo_single->instance0), 0, num_bytes);
 
@@ -186,9 +232,10 @@ static struct UAVOData *UAVObjAllocMulti(uint32_t num_bytes)
 
     /* Set up the type-specific part of the UAVO */
     uavo_multi->num_instances = 1;
+    uavo_multi->chunks = NULL;
 
     /* Clear the multi instance data carried in the UAVO */
-    memset(&(uavo_multi->instance0), 0, sizeof(struct UAVOMultiInst) + num_bytes);
+    memset(&(uavo_multi->instance0), 0, num_bytes);
 
     /* Give back the generic UAVO part */
     return &(uavo_multi->uavo);
@@ -246,6 +293,9 @@ UAVObjHandle UAVObjRegister(uint32_t id,
     /* Initialize the embedded meta UAVO */
     UAVObjInitMetaData(&uavo_data->metaObj);
 
+    /* Make the object visible to UAVObjGetByID() */
+    addObjToIndex(uavo_data);
+
     /* Initialize object fields and metadata to default values */
     if (initCb) {
         initCb((UAVObjHandle)uavo_data, 0);
@@ -277,6 +327,25 @@ UAVObjHandle UAVObjGetByID(uint32_t id)
 {
     UAVObjHandle *found_obj = (UAVObjHandle *)NULL;
 
+    // Look for object in the index, this does not need the lock
+    if (objIndex) {
+        struct UAVOData *obj = findObjInIndex(id);
+        if (obj) {
+            return (UAVObjHandle)obj;
+        }
+
+        // Metaobject IDs follow the ID of their parent object
+        obj = findObjInIndex(id - 1);
+        if (obj && MetaObjectId(obj->id) == id) {
+            return (UAVObjHandle) & (obj->metaObj);
+        }
+
+        // Only objects that did not fit in the index need the slow path
+        if (!objIndexOverflow) {
+            return NULL;
+        }
+    }
+
     // Get lock
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
@@ -493,6 +562,56 @@ bool UAVObjIsPriority(UAVObjHandle obj_handle)
     return uavo_base->flags.isPriority;
 }
 
+/**
+ * Switch a single instance object to lockless reads. Readers then copy the data
+ * without taking the object manager lock and retry if a write happened meanwhile,
+ * writers only serialise against other writers of the same object.
+ * Intended for high rate state objects with many readers, settings are not supported.
+ * Call it from module initialisation, before the object is updated concurrently.
+ * \param[in] obj The object handle
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjEnableSeqLock(UAVObjHandle obj_handle)
+{
+    PIOS_Assert(obj_handle);
+
+    if (UAVObjIsMetaobject(obj_handle) || !UAVObjIsSingleInstance(obj_handle) || UAVObjIsSettings(obj_handle)) {
+        return -1;
+    }
+
+    // Lock
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+
+    int32_t rc = 0;
+    struct UAVOSingle *uavo_single = (struct UAVOSingle *)obj_handle;
+
+    if (uavo_single->seqlock) {
+        goto unlock_exit;
+    }
+
+    struct UAVOSeqLock *seqlock = (struct UAVOSeqLock *)pios_malloc(sizeof(struct UAVOSeqLock));
+    if (!seqlock) {
+        rc = -1;
+        goto unlock_exit;
+    }
+    seqlock->sequence  = 0;
+    seqlock->writeLock = xSemaphoreCreateMutex();
+    if (seqlock->writeLock == NULL) {
+        pios_free(seqlock);
+        rc = -1;
+        goto unlock_exit;
+    }
+
+    // Must be enabled before the object is written concurrently,
+    // writes that already passed the check above are not seqlocked.
+    WRITE_MEMORY_BARRIER();
+    uavo_single->seqlock = seqlock;
+
+unlock_exit:
+    xSemaphoreGiveRecursive(mutex);
+    return rc;
+}
+
 
 /**
  * Unpack an object from a byte array
@@ -505,6 +624,11 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *da
 {
     PIOS_Assert(obj_handle);
 
+    struct UAVOSingle *seqlocked = getSeqLocked(obj_handle);
+    if (seqlocked) {
+        return setSeqLockedData(seqlocked, instId, dataIn, 0, seqlocked->uavo.instance_size, EV_UNPACKED);
+    }
+
     // Lock
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
@@ -553,9 +677,28 @@ unlock_exit:
  * \return 0 if success or -1 if failure
  */
 int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut)
+{
+    return UAVObjPackSplit(obj_handle, instId, dataOut, UINT16_MAX, NULL);
+}
+
+/**
+ * Pack an object to a byte array that wraps around, like the free space of a ring buffer
+ * \param[in] obj The object handle
+ * \param[in] instId The instance ID
+ * \param[out] dataOut Where the first \a split bytes go
+ * \param[in] split Number of bytes that fit at \a dataOut
+ * \param[out] dataOutWrapped Where the remaining bytes go
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjPackSplit(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut, uint16_t split, uint8_t *dataOutWrapped)
 {
     PIOS_Assert(obj_handle);
 
+    struct UAVOSingle *seqlocked = getSeqLocked(obj_handle);
+    if (seqlocked) {
+        return getSeqLockedData(seqlocked, instId, dataOut, 0, seqlocked->uavo.instance_size, split, dataOutWrapped);
+    }
+
     // Lock
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
@@ -565,7 +708,7 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut)
         if (instId != 0) {
             goto unlock_exit;
         }
-        memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
+        copySplit(dataOut, split, dataOutWrapped, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -579,7 +722,7 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut)
             goto unlock_exit;
         }
         // Pack data
-        memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
+        copySplit(dataOut, split, dataOutWrapped, InstanceData(instEntry), obj->instance_size);
     }
 
     rc = 0;
@@ -620,8 +763,10 @@ uint8_t UAVObjUpdateCRC(UAVObjHandle obj_handle, uint16_t instId, uint8_t crc)
         if (instEntry == NULL) {
             goto unlock_exit;
         }
-        // Update crc
+        // Update crc, seqlocked objects are not written under the object manager lock
+        struct UAVOSingle *seqlocked = seqLockBegin(obj_handle, false);
         crc = PIOS_CRC_updateCRC(crc, (uint8_t *)InstanceData(instEntry), (int32_t)obj->instance_size);
+        seqLockEnd(seqlocked, false);
     }
 
 unlock_exit:
@@ -658,8 +803,10 @@ void UAVObjInstanceWriteToLog(UAVObjHandle obj_handle, uint16_t instId)
         if (instEntry == NULL) {
             goto unlock_exit;
         }
-        // Pack data
+        // Pack data, seqlocked objects are not written under the object manager lock
+        struct UAVOSingle *seqlocked = seqLockBegin(obj_handle, false);
         PIOS_DEBUGLOG_UAVObject(UAVObjGetID(obj_handle), instId, obj->instance_size, (uint8_t *)InstanceData(instEntry));
+        seqLockEnd(seqlocked, false);
     }
 
 unlock_exit:
@@ -893,6 +1040,11 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 {
     PIOS_Assert(obj_handle);
 
+    struct UAVOSingle *seqlocked = getSeqLocked(obj_handle);
+    if (seqlocked) {
+        return setSeqLockedData(seqlocked, instId, dataIn, 0, seqlocked->uavo.instance_size, EV_UPDATED);
+    }
+
     // Lock
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
@@ -943,6 +1095,11 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
 {
     PIOS_Assert(obj_handle);
 
+    struct UAVOSingle *seqlocked = getSeqLocked(obj_handle);
+    if (seqlocked) {
+        return setSeqLockedData(seqlocked, instId, dataIn, offset, size, EV_UPDATED);
+    }
+
     // Lock
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
@@ -1010,6 +1167,11 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 {
     PIOS_Assert(obj_handle);
 
+    struct UAVOSingle *seqlocked = getSeqLocked(obj_handle);
+    if (seqlocked) {
+        return getSeqLockedData(seqlocked, instId, dataOut, 0, seqlocked->uavo.instance_size, seqlocked->uavo.instance_size, NULL);
+    }
+
     // Lock
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
@@ -1056,6 +1218,11 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 {
     PIOS_Assert(obj_handle);
 
+    struct UAVOSingle *seqlocked = getSeqLocked(obj_handle);
+    if (seqlocked) {
+        return getSeqLockedData(seqlocked, instId, dataOut, offset, size, size, NULL);
+    }
+
     // Lock
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
@@ -1343,7 +1510,7 @@ int32_t UAVObjConnectQueue(UAVObjHandle obj_handle, xQueueHandle queue,
     PIOS_Assert(queue);
     int32_t res;
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-    res = connectObj(obj_handle, queue, 0, eventMask);
+    res = connectObj(obj_handle, queue, 0, eventMask, false);
     xSemaphoreGiveRecursive(mutex);
     return res;
 }
@@ -1379,7 +1546,28 @@ int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb,
     PIOS_Assert(obj_handle);
     int32_t res;
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-    res = connectObj(obj_handle, 0, cb, eventMask);
+    res = connectObj(obj_handle, 0, cb, eventMask, false);
+    xSemaphoreGiveRecursive(mutex);
+    return res;
+}
+
+/**
+ * Connect a coalesced event callback to the object, if the callback is already connected then the event mask is only updated.
+ * Unlike UAVObjConnectCallback() at most one event is pending for the callback, further updates of the
+ * same instance are merged into it instead of filling up the event queue. Use it for callbacks that only
+ * need the latest object data.
+ * \param[in] obj The object handle
+ * \param[in] cb The event callback
+ * \param[in] eventMask The event mask, if EV_MASK_ALL then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjConnectCallbackCoalesced(UAVObjHandle obj_handle, UAVObjEventCallback cb,
+                                       uint8_t eventMask)
+{
+    PIOS_Assert(obj_handle);
+    int32_t res;
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    res = connectObj(obj_handle, 0, cb, eventMask, true);
     xSemaphoreGiveRecursive(mutex);
     return res;
 }
@@ -1533,7 +1721,13 @@ int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType trigger
             // Invoke callback (from event task) if a valid one is registered
             if (event->cb) {
                 // invoke callback from the event task, will not block
-                if (EventCallbackDispatch(&msg, event->cb) != pdTRUE) {
+                int32_t result;
+                if (event->coalesced) {
+                    result = EventCallbackDispatchCoalesced(event->coalesced, &msg);
+                } else {
+                    result = EventCallbackDispatch(&msg, event->cb);
+                }
+                if (result != pdTRUE) {
                     ++stats.eventCallbackErrors;
                     stats.lastCallbackErrorID = UAVObjGetID(obj);
                 }
@@ -1544,12 +1738,92 @@ int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType trigger
     return 0;
 }
 
+/**
+ * Allocate the object ID index. It is sized for twice the number of handles in
+ * the uavo handle table so the load factor never exceeds 50%.
+ */
+static void initObjIndex()
+{
+    uint32_t num_handles = 0;
+
+    if (__start__uavo_handles) {
+        num_handles = __stop__uavo_handles - __start__uavo_handles;
+    }
+
+    objIndexCount    = 0;
+    objIndexOverflow = false;
+    objIndexShift    = 32 - 3;
+    while ((1UL << (32 - objIndexShift)) < 2 * num_handles) {
+        objIndexShift--;
+    }
+
+    uint32_t size = sizeof(*objIndex) << (32 - objIndexShift);
+    objIndex = (struct UAVOData * *)pios_malloc(size);
+    if (objIndex) {
+        memset(objIndex, 0, size);
+    }
+}
+
+/**
+ * First index slot to probe for an object ID (Fibonacci hashing)
+ */
+static inline uint32_t objIndexSlot(uint32_t id)
+{
+    return (uint32_t)(id * 0x9E3779B1U) >> objIndexShift;
+}
+
+/**
+ * Add a newly registered object to the index, must be called with the lock held.
+ * Objects that do not fit are only reachable through the linear search.
+ */
+static void addObjToIndex(struct UAVOData *obj)
+{
+    if (!objIndex) {
+        return;
+    }
+
+    uint32_t mask = (1UL << (32 - objIndexShift)) - 1;
+
+    if (2 * (objIndexCount + 1UL) > mask + 1) {
+        objIndexOverflow = true;
+        return;
+    }
+
+    uint32_t slot = objIndexSlot(obj->id);
+    while (objIndex[slot]) {
+        slot = (slot + 1) & mask;
+    }
+
+    // Make sure the object is complete before it becomes visible to readers
+    WRITE_MEMORY_BARRIER();
+    objIndex[slot] = obj;
+    objIndexCount++;
+}
+
+/**
+ * Look up a data object by its ID in the index
+ * \return The object or NULL if not found.
+ */
+static struct UAVOData *findObjInIndex(uint32_t id)
+{
+    uint32_t mask = (1UL << (32 - objIndexShift)) - 1;
+
+    // The index is never full, so an empty slot always ends the probe sequence
+    for (uint32_t slot = objIndexSlot(id);; slot = (slot + 1) & mask) {
+        struct UAVOData *obj = objIndex[slot];
+        READ_MEMORY_BARRIER();
+        if (obj == NULL || obj->id == id) {
+            return obj;
+        }
+    }
+}
+
 /**
  * Create a new object instance, return the instance info or NULL if failure.
  */
 static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId)
 {
-    struct UAVOMultiInst *instEntry;
+    struct UAVOMulti *uavo_multi = (struct UAVOMulti *)obj;
 
     /* Don't allow more than one instance for single instance objects */
     if (UAVObjIsSingleInstance(&(obj->base))) {
@@ -1574,22 +1848,39 @@ static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId)
         }
     }
 
-    /* Create the actual instance */
-    uint32_t size = sizeof(struct UAVOMultiInst) + obj->instance_size;
-    instEntry = (struct UAVOMultiInst *)pios_malloc(size);
-    if (!instEntry) {
-        return NULL;
+    PIOS_STATIC_ASSERT((1 << UAVO_INSTANCE_CHUNKS) > UAVOBJ_MAX_INSTANCES);
+
+    /*
+     * Instance 0 is embedded in the UAVO, all others live in chunks that double
+     * in size (1, 2, 4, ...) so that a few instances only take a few strides.
+     * Nothing is reallocated, heap_1 targets never get freed memory back.
+     */
+    if (!uavo_multi->chunks) {
+        uavo_multi->chunks = (uint8_t * *)pios_malloc(UAVO_INSTANCE_CHUNKS * sizeof(uint8_t *));
+        if (!uavo_multi->chunks) {
+            return NULL;
+        }
+        memset(uavo_multi->chunks, 0, UAVO_INSTANCE_CHUNKS * sizeof(uint8_t *));
+    }
+
+    /* Allocate a new chunk when the first instance in it is created */
+    if ((instId & (instId - 1)) == 0) {
+        uint16_t chunk = 31 - __builtin_clz(instId);
+        uint32_t size  = instId * InstanceStride(obj);
+        uavo_multi->chunks[chunk] = (uint8_t *)pios_malloc(size);
+        if (!uavo_multi->chunks[chunk]) {
+            return NULL;
+        }
+        memset(uavo_multi->chunks[chunk], 0, size);
     }
-    memset(instEntry, 0, size);
-    LL_APPEND(((struct UAVOMulti *)obj)->instance0.next, instEntry);
 
-    ((struct UAVOMulti *)obj)->num_instances++;
+    uavo_multi->num_instances++;
 
     // Fire event
     instanceAutoUpdated((UAVObjHandle)obj, instId);
 
     // Done
-    return InstanceDataOffset(instEntry);
+    return getInstance(obj, instId);
 }
 
 /**
@@ -1625,18 +1916,157 @@ InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId)
             return NULL;
         }
 
-        // Look for specified instance ID
-        uint16_t instance = 0;
-        struct UAVOMultiInst *instEntry;
-        LL_FOREACH(&(uavo_multi->instance0), instEntry) {
-            if (instance++ == instId) {
-                /* Found it */
-                return &(instEntry->instance);
-            }
+        if (instId == 0) {
+            return &(uavo_multi->instance0);
         }
-        /* Instance was not found */
+
+        // Index the chunk holding the specified instance ID, chunk n starts at instance 2^n
+        uint16_t chunk = 31 - __builtin_clz(instId);
+        return uavo_multi->chunks[chunk] + (instId - (1 << chunk)) * InstanceStride(obj);
+    }
+}
+
+/**
+ * Get the object if it is a single instance object in seqlock mode, NULL otherwise
+ */
+static struct UAVOSingle *getSeqLocked(UAVObjHandle obj_handle)
+{
+    struct UAVOBase *uavo_base = (struct UAVOBase *)obj_handle;
+
+    if (uavo_base->flags.isMeta || !uavo_base->flags.isSingle) {
         return NULL;
     }
+
+    struct UAVOSingle *uavo_single = (struct UAVOSingle *)obj_handle;
+    return uavo_single->seqlock ? uavo_single : NULL;
+}
+
+/**
+ * Write (part of) the data of a seqlocked object and fire the event.
+ * Only the event dispatch takes the object manager lock.
+ * \return 0 if success or -1 if failure
+ */
+static int32_t setSeqLockedData(struct UAVOSingle *obj, uint16_t instId, const void *dataIn, uint32_t offset, uint32_t size, UAVObjEventType event)
+{
+    struct UAVOSeqLock *seqlock = obj->seqlock;
+
+    if (instId != 0 || (size + offset) > obj->uavo.instance_size) {
+        return -1;
+    }
+
+    // Check access level, unpacking is not subject to it
+    if (event != EV_UNPACKED && UAVObjReadOnly((UAVObjHandle)obj)) {
+        return -1;
+    }
+
+    xSemaphoreTake(seqlock->writeLock, portMAX_DELAY);
+    seqlock->sequence++;
+    WRITE_MEMORY_BARRIER();
+
+    memcpy(obj->instance0 + offset, dataIn, size);
+
+    WRITE_MEMORY_BARRIER();
+    seqlock->sequence++;
+    xSemaphoreGive(seqlock->writeLock);
+
+    // Fire event
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    sendEvent(&obj->uavo.base, instId, event);
+    xSemaphoreGiveRecursive(mutex);
+
+    return 0;
+}
+
+/**
+ * Read (part of) the data of a seqlocked object without taking any lock.
+ * The copy is retried if a writer got in between. If a writer is preempted
+ * halfway or the retries run out, the read waits on the write lock instead,
+ * which also lends the writer our priority so it can finish.
+ * \return 0 if success or -1 if failure
+ */
+static int32_t getSeqLockedData(struct UAVOSingle *obj, uint16_t instId, void *dataOut, uint32_t offset, uint32_t size, uint32_t split, void *dataOutWrapped)
+{
+    struct UAVOSeqLock *seqlock = obj->seqlock;
+
+    if (instId != 0 || (size + offset) > obj->uavo.instance_size) {
+        return -1;
+    }
+
+#ifdef PIOS_INCLUDE_INSTRUMENTATION
+    uint32_t start = PIOS_DELAY_GetRaw();
+#endif
+
+    for (uint8_t retries = 0;; retries++) {
+        uint32_t sequence = seqlock->sequence;
+        READ_MEMORY_BARRIER();
+
+        if ((sequence & 1) || retries >= SEQLOCK_MAX_RETRIES) {
+            xSemaphoreTake(seqlock->writeLock, portMAX_DELAY);
+            copySplit(dataOut, split, dataOutWrapped, obj->instance0 + offset, size);
+            xSemaphoreGive(seqlock->writeLock);
+        } else {
+            copySplit(dataOut, split, dataOutWrapped, obj->instance0 + offset, size);
+            READ_MEMORY_BARRIER();
+            if (seqlock->sequence != sequence) {
+                continue;
+            }
+        }
+
+        // Updating a counter enters a critical section, uncontended reads are only sampled
+        if (retries || (sequence & 1)) {
+            PERF_TRACK_VALUE(counterSeqLockContention, __sync_add_and_fetch(&seqLockContention, 1));
+            PERF_TRACK_VALUE(counterSeqLockReadTime, PIOS_DELAY_DiffuS(start));
+        } else if (SEQLOCK_TIMED_READ()) {
+            PERF_TRACK_VALUE(counterSeqLockReadTime, PIOS_DELAY_DiffuS(start));
+        }
+        break;
+    }
+
+    return 0;
+}
+
+/**
+ * Lock a seqlocked object to access its data in place, for the users
+ * that can't go through a copy like the flash persistence. A write
+ * also makes the lockless readers retry or wait until seqLockEnd().
+ * eturn the object to pass to seqLockEnd(), NULL if it is not seqlocked
+ */
+struct UAVOSingle *seqLockBegin(UAVObjHandle obj_handle, bool write)
+{
+    struct UAVOSingle *obj = getSeqLocked(obj_handle);
+
+    if (obj) {
+        xSemaphoreTake(obj->seqlock->writeLock, portMAX_DELAY);
+        if (write) {
+            obj->seqlock->sequence++;
+            WRITE_MEMORY_BARRIER();
+        }
+    }
+    return obj;
+}
+
+void seqLockEnd(struct UAVOSingle *obj, bool write)
+{
+    if (obj) {
+        if (write) {
+            WRITE_MEMORY_BARRIER();
+            obj->seqlock->sequence++;
+        }
+        xSemaphoreGive(obj->seqlock->writeLock);
+    }
+}
+
+/**
+ * Copy object data, the first split bytes to dataOut and the rest to dataOutWrapped
+ */
+static inline void copySplit(void *dataOut, uint32_t split, void *dataOutWrapped, const void *data, uint32_t size)
+{
+    if (split >= size) {
+        memcpy(dataOut, data, size);
+    } else {
+        memcpy(dataOut, data, split);
+        memcpy(dataOutWrapped, (const uint8_t *)data + split, size - split);
+    }
 }
 
 /**
@@ -1645,10 +2075,11 @@ InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId)
  * \param[in] queue The event queue
  * \param[in] cb The event callback
  * \param[in] eventMask The event mask, if EV_MASK_ALL then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \param[in] coalesce Merge callback events while one is pending
  * \return 0 if success or -1 if failure
  */
 static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
-                          UAVObjEventCallback cb, uint8_t eventMask)
+                          UAVObjEventCallback cb, uint8_t eventMask, bool coalesce)
 {
     struct ObjectEventEntry *event;
     struct UAVOBase *obj;
@@ -1657,7 +2088,16 @@ static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
     obj = (struct UAVOBase *)obj_handle;
     LL_FOREACH(obj->next_event, event) {
         if (event->queue == queue && event->cb == cb) {
-            // Already connected, update event mask and return
+            // Already connected, update event mask and dispatch mode and return
+            if (coalesce && !event->coalesced) {
+                event->coalesced = EventCoalescedCallbackCreate(cb);
+                if (event->coalesced == NULL) {
+                    return -1;
+                }
+            } else if (!coalesce && event->coalesced) {
+                EventCoalescedCallbackDelete(event->coalesced);
+                event->coalesced = NULL;
+            }
             event->eventMask = eventMask;
             return 0;
         }
@@ -1668,6 +2108,14 @@ static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
     if (event == NULL) {
         return -1;
     }
+    event->coalesced = NULL;
+    if (coalesce) {
+        event->coalesced = EventCoalescedCallbackCreate(cb);
+        if (event->coalesced == NULL) {
+            vPortFree(event);
+            return -1;
+        }
+    }
     event->queue     = queue;
     event->cb        = cb;
     event->eventMask = eventMask;
@@ -1696,6 +2144,9 @@ static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue,
         if ((event->queue == queue
              && event->cb == cb)) {
             LL_DELETE(obj->next_event, event);
+            if (event->coalesced) {
+                EventCoalescedCallbackDelete(event->coalesced);
+            }
             vPortFree(event);
             return 0;
         }
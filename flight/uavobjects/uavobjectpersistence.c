@@ -62,7 +62,11 @@ int32_t UAVObjSave(UAVObjHandle obj_handle, uint16_t instId)
             return -1;
         }
 
-        if (PIOS_FLASHFS_ObjSave(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, InstanceData(instEntry), UAVObjGetNumBytes(obj_handle)) != 0) {
+        // Seqlocked objects are written without the object manager lock, keep them whole while saved
+        struct UAVOSingle *seqlocked = seqLockBegin(obj_handle, false);
+        int32_t rc = PIOS_FLASHFS_ObjSave(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, InstanceData(instEntry), UAVObjGetNumBytes(obj_handle));
+        seqLockEnd(seqlocked, false);
+        if (rc != 0) {
             return -1;
         }
     }
@@ -100,8 +104,13 @@ int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId)
             return -1;
         }
 
+        // Seqlocked objects are read without any lock, make their readers wait for the whole load
+        struct UAVOSingle *seqlocked = seqLockBegin(obj_handle, true);
+        int32_t rc = PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, InstanceData(instEntry), UAVObjGetNumBytes(obj_handle));
+        seqLockEnd(seqlocked, true);
+
         // Fire event on success
-        if (PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, InstanceData(instEntry), UAVObjGetNumBytes(obj_handle)) == 0) {
+        if (rc == 0) {
             sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
         } else {
             return -1;
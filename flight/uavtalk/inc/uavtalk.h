@@ -29,8 +29,14 @@
 #ifndef UAVTALK_H
 #define UAVTALK_H
 
+#include <fifo_buffer.h>
+
 // Public types
 typedef int32_t (*UAVTalkOutputStream)(uint8_t *data, int32_t length);
+// Get space for a packet of length bytes in the output buffer, returns length on success and 0 if it can never fit
+typedef int32_t (*UAVTalkOutputReserve)(t_fifo_span *span, uint16_t length);
+// Send the packet written to the reserved space, or release it when length is zero
+typedef int32_t (*UAVTalkOutputCommit)(uint16_t length);
 
 typedef struct {
     uint32_t txBytes;
@@ -48,18 +54,29 @@ typedef struct {
 
 typedef void *UAVTalkConnection;
 
+// What a relay does with the packets of an object
+typedef enum { UAVTALK_RELAY_FORWARD = 0, UAVTALK_RELAY_RECEIVE, UAVTALK_RELAY_DROP } UAVTalkRelayAction;
+typedef UAVTalkRelayAction (*UAVTalkRelayFilter)(uint32_t objId);
+
 typedef enum { UAVTALK_STATE_ERROR = 0, UAVTALK_STATE_SYNC, UAVTALK_STATE_TYPE, UAVTALK_STATE_SIZE, UAVTALK_STATE_OBJID, UAVTALK_STATE_INSTID, UAVTALK_STATE_TIMESTAMP, UAVTALK_STATE_DATA, UAVTALK_STATE_CS, UAVTALK_STATE_COMPLETE } UAVTalkRxState;
 
 // Public functions
 UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream);
+UAVTalkConnection UAVTalkInitializeReserve(UAVTalkOutputReserve outputReserve, UAVTalkOutputCommit outputCommit, UAVTalkOutputStream outputStream);
 int32_t UAVTalkSetOutputStream(UAVTalkConnection connection, UAVTalkOutputStream outputStream);
 UAVTalkOutputStream UAVTalkGetOutputStream(UAVTalkConnection connection);
 int32_t UAVTalkSendObject(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
 int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
+int32_t UAVTalkSetBatching(UAVTalkConnection connection, bool enable);
+int32_t UAVTalkFlush(UAVTalkConnection connection);
+int32_t UAVTalkSetDelta(UAVTalkConnection connection, bool encode, bool decode);
 int32_t UAVTalkSendObjectRequest(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs);
 UAVTalkRxState UAVTalkProcessInputStream(UAVTalkConnection connection, uint8_t rxbyte);
 UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connection, uint8_t rxbyte);
+int32_t UAVTalkProcessInputBuffer(UAVTalkConnection connection, const uint8_t *buf, uint32_t length);
+UAVTalkRxState UAVTalkProcessInputBufferQuiet(UAVTalkConnection connection, const uint8_t *buf, uint32_t length, uint32_t *consumed);
 int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle);
+int32_t UAVTalkRelayPacketFiltered(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, UAVTalkRelayFilter filter);
 int32_t UAVTalkReceiveObject(UAVTalkConnection connectionHandle);
 void UAVTalkGetStats(UAVTalkConnection connection, UAVTalkStats *stats, bool reset);
 void UAVTalkAddStats(UAVTalkConnection connection, UAVTalkStats *stats, bool reset);
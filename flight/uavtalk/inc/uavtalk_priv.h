@@ -39,9 +39,39 @@
 // max header : sync(1), type (1), size(2), object ID(4), instance ID(2), timestamp(2)
 #define UAVTALK_MAX_HEADER_LENGTH  12
 
+// multi object packet header : sync(1), type (1), size(2)
+#define UAVTALK_BATCH_HEADER_LENGTH 4
+
+// multi object packet entry : object length and instance flag(1), object ID(4), instance ID(2) if flagged
+#define UAVTALK_BATCH_ENTRY_LENGTH  5
+#define UAVTALK_BATCH_INSTANCE      0x80
+#define UAVTALK_BATCH_LENGTH_MASK   0x7F
+
+// multi object packet payload, the GCS takes payloads up to 255 bytes
+#define UAVTALK_BATCH_MAX_LENGTH    255
+
+// delta packet payload : CRC of the image it applies to(1), changed block mask, changed blocks
+#define UAVTALK_DELTA_BLOCK        4
+#define UAVTALK_DELTA_MASK_LENGTH(length) (((length) + 8 * UAVTALK_DELTA_BLOCK - 1) / (8 * UAVTALK_DELTA_BLOCK))
+
+// Send the full object every so many updates, so a receiver that missed one catches up
+#define UAVTALK_DELTA_KEYFRAME     16
+
+// Images of the objects last sent or received, per connection and direction
+#ifndef UAVTALK_DELTA_CACHE_SIZE
+#define UAVTALK_DELTA_CACHE_SIZE   1024
+#endif
+#define UAVTALK_DELTA_SLOTS        32
+#define UAVTALK_DELTA_MAX_LENGTH   (UAVTALK_DELTA_CACHE_SIZE / 4)
+
 #define UAVTALK_CHECKSUM_LENGTH    1
 
+// Relays (OPLink) must pass multi object packets even when their own objects are smaller
+#if UAVOBJECTS_LARGEST + 1 > UAVTALK_BATCH_MAX_LENGTH
 #define UAVTALK_MAX_PAYLOAD_LENGTH (UAVOBJECTS_LARGEST + 1)
+#else
+#define UAVTALK_MAX_PAYLOAD_LENGTH (UAVTALK_BATCH_MAX_LENGTH + 1)
+#endif
 
 #define UAVTALK_MIN_PACKET_LENGTH  UAVTALK_MAX_HEADER_LENGTH + UAVTALK_CHECKSUM_LENGTH
 #define UAVTALK_MAX_PACKET_LENGTH  UAVTALK_MIN_PACKET_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH
@@ -58,11 +88,33 @@ typedef struct {
     uint32_t rxCount;
     UAVTalkRxState state;
     uint16_t rxPacketLength;
+    uint8_t  header[UAVTALK_MAX_HEADER_LENGTH];
 } UAVTalkInputProcessor;
 
+typedef struct {
+    uint32_t objId;
+    uint16_t instId;
+    uint16_t offset;
+    uint16_t length;
+    uint8_t  crc;
+    uint8_t  updates;
+} UAVTalkDeltaEntry;
+
+typedef struct {
+    UAVTalkDeltaEntry entry[UAVTALK_DELTA_SLOTS];
+    uint8_t  numEntries;
+    uint16_t used;
+    uint8_t  data[UAVTALK_DELTA_CACHE_SIZE];
+    // The object being sent, packed to compare it with its last image
+    uint8_t  image[UAVTALK_DELTA_MAX_LENGTH];
+} UAVTalkDeltaCache;
+
 typedef struct {
     uint8_t canari;
     UAVTalkOutputStream outStream;
+    UAVTalkOutputReserve outReserve;
+    UAVTalkOutputCommit outCommit;
+    bool txReserved;
     xSemaphoreHandle    lock;
     xSemaphoreHandle    transLock;
     xSemaphoreHandle    respSema;
@@ -73,6 +125,14 @@ typedef struct {
     UAVTalkInputProcessor iproc;
     uint8_t      *rxBuffer;
     uint8_t      *txBuffer;
+    uint8_t      *batchBuffer;
+    uint16_t     batchLength;
+    bool batching;
+    // The images are allocated on the first enable and kept, disabling only drops their entries
+    UAVTalkDeltaCache *txDelta;
+    UAVTalkDeltaCache *rxDelta;
+    bool txDeltaEnabled;
+    bool rxDeltaEnabled;
 } UAVTalkConnectionData;
 
 #define UAVTALK_CANARI          0xCA
@@ -86,6 +146,8 @@ typedef struct {
 #define UAVTALK_TYPE_OBJ_ACK    (UAVTALK_TYPE_VER | 0x02)
 #define UAVTALK_TYPE_ACK        (UAVTALK_TYPE_VER | 0x03)
 #define UAVTALK_TYPE_NACK       (UAVTALK_TYPE_VER | 0x04)
+#define UAVTALK_TYPE_MULTI      (UAVTALK_TYPE_VER | 0x05)
+#define UAVTALK_TYPE_OBJ_DELTA  (UAVTALK_TYPE_VER | 0x06)
 #define UAVTALK_TYPE_OBJ_TS     (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ)
 #define UAVTALK_TYPE_OBJ_ACK_TS (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ_ACK)
 
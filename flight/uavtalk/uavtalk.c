@@ -51,8 +51,24 @@
 static int32_t objectTransaction(UAVTalkConnectionData *connection, uint8_t type, UAVObjHandle obj, uint16_t instId, int32_t timeout);
 static int32_t sendObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, UAVObjHandle obj);
 static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, UAVObjHandle obj);
-static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t *data);
+static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t *data, uint32_t length);
+static int32_t receiveBatch(UAVTalkConnectionData *connection, uint8_t *data, uint32_t length);
+static int32_t relayPacket(UAVTalkConnectionData *outConnection, uint8_t type, uint32_t objId, uint16_t instId, const uint8_t *data, uint32_t length);
 static void updateAck(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId);
+static UAVTalkRxState processInputByte(UAVTalkConnectionData *connection, uint8_t rxbyte);
+static UAVTalkRxState processInputBuffer(UAVTalkConnectionData *connection, const uint8_t *buf, uint32_t length, uint32_t *consumed);
+static UAVTalkConnectionData *createConnection();
+static int32_t txReserve(UAVTalkConnectionData *connection, t_fifo_span *span, uint16_t length);
+static int32_t txCommit(UAVTalkConnectionData *connection, uint16_t length);
+static int32_t txHeader(uint8_t *header, uint8_t type, uint32_t objId, uint16_t instId, uint16_t length);
+static int32_t batchObject(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj, const uint8_t *image, uint16_t length);
+static int32_t flushBatch(UAVTalkConnectionData *connection);
+static int32_t sendDelta(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj, uint16_t length, const uint8_t **image);
+static int32_t receiveDelta(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj, uint8_t *data, uint32_t length);
+static UAVTalkDeltaEntry *deltaFind(UAVTalkDeltaCache *cache, uint32_t objId, uint16_t instId);
+static void deltaStore(UAVTalkDeltaCache *cache, uint32_t objId, uint16_t instId, const uint8_t *data, uint16_t length);
+static void deltaKeyframe(UAVTalkDeltaCache *cache, uint32_t objId, uint16_t instId);
+static bool deltaEnable(UAVTalkDeltaCache **cache, bool *enabled, bool enable);
 
 /**
  * Initialize the UAVTalk library
@@ -62,6 +78,53 @@ static void updateAck(UAVTalkConnectionData *connection, uint8_t type, uint32_t
  * \return -1 Failure
  */
 UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
+{
+    UAVTalkConnectionData *connection = createConnection();
+
+    if (!connection) {
+        return 0;
+    }
+    connection->outStream = outputStream;
+    connection->txBuffer  = pios_malloc(UAVTALK_MAX_PACKET_LENGTH);
+    if (!connection->txBuffer) {
+        return 0;
+    }
+    return (UAVTalkConnection)connection;
+}
+
+/**
+ * Initialize the UAVTalk library for an output that packets can be written into in place,
+ * such as the transmit buffer of a COM port.
+ * \param[in] outputReserve Function pointer that is called to get space for a packet
+ * \param[in] outputCommit Function pointer that is called to send the packet written to that space
+ * \param[in] outputStream Function pointer that is called to send packets that do not fit in the
+ *            output buffer, can be NULL. The transmit buffer is only allocated when it is set,
+ *            objects are then packed there before the output buffer is reserved.
+ * \return The connection, or 0 on failure
+ */
+UAVTalkConnection UAVTalkInitializeReserve(UAVTalkOutputReserve outputReserve, UAVTalkOutputCommit outputCommit, UAVTalkOutputStream outputStream)
+{
+    UAVTalkConnectionData *connection = createConnection();
+
+    if (!connection) {
+        return 0;
+    }
+    connection->outReserve = outputReserve;
+    connection->outCommit  = outputCommit;
+    connection->outStream  = outputStream;
+    if (outputStream) {
+        connection->txBuffer = pios_malloc(UAVTALK_MAX_PACKET_LENGTH);
+        if (!connection->txBuffer) {
+            return 0;
+        }
+    }
+    return (UAVTalkConnection)connection;
+}
+
+/**
+ * Allocate a connection without output
+ */
+static UAVTalkConnectionData *createConnection()
 {
     // allocate object
     UAVTalkConnectionData *connection = pios_malloc(sizeof(UAVTalkConnectionData));
@@ -69,10 +132,10 @@ UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
     if (!connection) {
         return 0;
     }
+    memset(connection, 0, sizeof(UAVTalkConnectionData));
     connection->canari      = UAVTALK_CANARI;
     connection->iproc.rxPacketLength = 0;
     connection->iproc.state = UAVTALK_STATE_SYNC;
-    connection->outStream   = outputStream;
     connection->lock = xSemaphoreCreateRecursiveMutex();
     connection->transLock   = xSemaphoreCreateRecursiveMutex();
     // allocate buffers
@@ -80,14 +143,10 @@ UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
     if (!connection->rxBuffer) {
         return 0;
     }
-    connection->txBuffer = pios_malloc(UAVTALK_MAX_PACKET_LENGTH);
-    if (!connection->txBuffer) {
-        return 0;
-    }
     vSemaphoreCreateBinary(connection->respSema);
     xSemaphoreTake(connection->respSema, 0); // reset to zero
     UAVTalkResetStats((UAVTalkConnection)connection);
-    return (UAVTalkConnection)connection;
+    return connection;
 }
 
 /**
@@ -106,8 +165,19 @@ int32_t UAVTalkSetOutputStream(UAVTalkConnection connectionHandle, UAVTalkOutput
     // Lock
     xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
 
+    // A connection created with UAVTalkInitializeReserve() needs a buffer to pack into first
+    if (outputStream && !connection->txBuffer) {
+        connection->txBuffer = pios_malloc(UAVTALK_MAX_PACKET_LENGTH);
+        if (!connection->txBuffer) {
+            xSemaphoreGiveRecursive(connection->lock);
+            return -1;
+        }
+    }
+
     // set output stream
-    connection->outStream = outputStream;
+    connection->outStream  = outputStream;
+    connection->outReserve = NULL;
+    connection->outCommit  = NULL;
 
     // Release lock
     xSemaphoreGiveRecursive(connection->lock);
@@ -128,6 +198,97 @@ UAVTalkOutputStream UAVTalkGetOutputStream(UAVTalkConnection connectionHandle)
     return connection->outStream;
 }
 
+/**
+ * Collect small unacked objects into multi object packets. Only enable this once the other
+ * end has announced that it can decode them.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] enable True to collect objects until UAVTalkFlush() or the packet is full,
+ *            false to send the collected objects and return to one packet per object
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSetBatching(UAVTalkConnection connectionHandle, bool enable)
+{
+    UAVTalkConnectionData *connection;
+    int32_t ret = 0;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    // Lock
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+    if (enable && !connection->batchBuffer) {
+        connection->batchBuffer = pios_malloc(UAVTALK_BATCH_MAX_LENGTH);
+        if (!connection->batchBuffer) {
+            enable = false;
+            ret    = -1;
+        }
+    }
+    if (!enable) {
+        flushBatch(connection);
+    }
+    connection->batching = enable;
+
+    // Release lock
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Send the objects collected since the last flush, if any.
+ * Called by the sender whenever it runs out of updates to send.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkFlush(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    // Lock
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+    int32_t ret = flushBatch(connection);
+
+    // Release lock
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Send objects as the blocks that changed since they were last sent, and decode such updates.
+ * Only enable encoding once the other end has announced that it can decode them.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] encode True to keep an image of the objects sent and send delta packets
+ * \param[in] decode True to keep an image of the objects received and accept delta packets
+ * \return 0 Success
+ * \return -1 Failure, the images could not be allocated
+ */
+int32_t UAVTalkSetDelta(UAVTalkConnection connectionHandle, bool encode, bool decode)
+{
+    UAVTalkConnectionData *connection;
+    int32_t ret = 0;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    // Lock
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+    if (!deltaEnable(&connection->txDelta, &connection->txDeltaEnabled, encode) ||
+        !deltaEnable(&connection->rxDelta, &connection->rxDeltaEnabled, decode)) {
+        ret = -1;
+    }
+
+    // Release lock
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
 /**
  * Get communication statistics counters
  * \param[in] connection UAVTalkConnection to be used
@@ -359,6 +520,120 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 
     CHECKCONHANDLE(connectionHandle, connection, return -1);
 
+    return processInputByte(connection, rxbyte);
+}
+
+/**
+ * Process a buffer from the telemetry stream, stopping after the first complete packet.
+ * \param[in] connectionHandle UAVTalkConnection to be used
+ * \param[in] buf Received data
+ * \param[in] length Number of bytes in \a buf
+ * \param[out] consumed Number of bytes processed, less than \a length when a packet completed before the end of \a buf
+ * \return UAVTalkRxState after the last processed byte
+ */
+UAVTalkRxState UAVTalkProcessInputBufferQuiet(UAVTalkConnection connectionHandle, const uint8_t *buf, uint32_t length, uint32_t *consumed)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    return processInputBuffer(connection, buf, length, consumed);
+}
+
+/**
+ * Process a buffer from the telemetry stream and receive every complete packet in it.
+ * \param[in] connectionHandle UAVTalkConnection to be used
+ * \param[in] buf Received data
+ * \param[in] length Number of bytes in \a buf
+ * \return Number of packets received
+ * \return -1 Failure
+ */
+int32_t UAVTalkProcessInputBuffer(UAVTalkConnection connectionHandle, const uint8_t *buf, uint32_t length)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    UAVTalkInputProcessor *iproc = &connection->iproc;
+    int32_t packets = 0;
+    uint32_t consumed;
+
+    while (length > 0) {
+        if (processInputBuffer(connection, buf, length, &consumed) == UAVTALK_STATE_COMPLETE) {
+            receiveObject(connection, iproc->type, iproc->objId, iproc->instId, connection->rxBuffer, iproc->length);
+            packets++;
+        }
+        buf    += consumed;
+        length -= consumed;
+    }
+
+    return packets;
+}
+
+/**
+ * Run the receive state machine over a buffer. Bytes outside of a packet are skipped up
+ * to the next sync byte and the payload is copied in one go, the header still goes through
+ * the state machine byte by byte.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] buf Received data
+ * \param[in] length Number of bytes in \a buf
+ * \param[out] consumed Number of bytes processed
+ * \return UAVTalkRxState after the last processed byte
+ */
+static UAVTalkRxState processInputBuffer(UAVTalkConnectionData *connection, const uint8_t *buf, uint32_t length, uint32_t *consumed)
+{
+    UAVTalkInputProcessor *iproc = &connection->iproc;
+    const uint8_t *p   = buf;
+    const uint8_t *end = buf + length;
+
+    while (p < end) {
+        if (iproc->state == UAVTALK_STATE_SYNC || iproc->state == UAVTALK_STATE_ERROR || iproc->state == UAVTALK_STATE_COMPLETE) {
+            const uint8_t *sync = memchr(p, UAVTALK_SYNC_VAL, end - p);
+            uint32_t skipped    = (sync ? sync : end) - p;
+
+            // Same accounting as feeding the bytes one by one
+            connection->stats.rxBytes      += skipped;
+            connection->stats.rxSyncErrors += skipped;
+            p += skipped;
+            iproc->state = UAVTALK_STATE_SYNC;
+            if (p == end) {
+                break;
+            }
+        } else if (iproc->state == UAVTALK_STATE_DATA) {
+            uint32_t count = iproc->length - iproc->rxCount;
+
+            if (count > (uint32_t)(end - p)) {
+                count = end - p;
+            }
+            memcpy(&connection->rxBuffer[iproc->rxCount], p, count);
+            connection->stats.rxBytes += count;
+            iproc->rxPacketLength     += count;
+            iproc->rxCount += count;
+            p += count;
+            if (iproc->rxCount == iproc->length) {
+                iproc->rxCount = 0;
+                iproc->state   = UAVTALK_STATE_CS;
+            }
+            continue;
+        }
+
+        if (processInputByte(connection, *p++) == UAVTALK_STATE_COMPLETE) {
+            break;
+        }
+    }
+
+    *consumed = p - buf;
+    return iproc->state;
+}
+
+/**
+ * Run the receive state machine for one byte
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] rxbyte Received byte
+ * \return UAVTalkRxState
+ */
+static UAVTalkRxState processInputByte(UAVTalkConnectionData *connection, uint8_t rxbyte)
+{
     UAVTalkInputProcessor *iproc = &connection->iproc;
 
     ++connection->stats.rxBytes;
@@ -381,8 +656,8 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
             break;
         }
 
-        // Initialize and update the CRC
-        iproc->cs = PIOS_CRC_updateByte(0, rxbyte);
+        // Keep the header, the CRC is computed once the packet is complete
+        iproc->header[0] = rxbyte;
 
         iproc->rxPacketLength = 1;
         iproc->rxCount = 0;
@@ -399,8 +674,7 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
             break;
         }
 
-        // update the CRC
-        iproc->cs    = PIOS_CRC_updateByte(iproc->cs, rxbyte);
+        iproc->header[iproc->rxPacketLength - 1] = rxbyte;
 
         iproc->type  = rxbyte;
 
@@ -410,8 +684,7 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 
     case UAVTALK_STATE_SIZE:
 
-        // update the CRC
-        iproc->cs = PIOS_CRC_updateByte(iproc->cs, rxbyte);
+        iproc->header[iproc->rxPacketLength - 1] = rxbyte;
 
         if (iproc->rxCount == 0) {
             iproc->packet_size += rxbyte;
@@ -421,6 +694,23 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
         iproc->packet_size += rxbyte << 8;
         iproc->rxCount      = 0;
 
+        if (iproc->type == UAVTALK_TYPE_MULTI) {
+            // No object and instance ID, the payload is a list of objects
+            if (iproc->packet_size <= UAVTALK_BATCH_HEADER_LENGTH || iproc->packet_size > UAVTALK_BATCH_HEADER_LENGTH + UAVTALK_BATCH_MAX_LENGTH) {
+                // incorrect packet size
+                connection->stats.rxErrors++;
+                iproc->state = UAVTALK_STATE_ERROR;
+                break;
+            }
+
+            iproc->objId  = 0;
+            iproc->instId = 0;
+            iproc->timestampLength = 0;
+            iproc->length = iproc->packet_size - UAVTALK_BATCH_HEADER_LENGTH;
+            iproc->state  = UAVTALK_STATE_DATA;
+            break;
+        }
+
         if (iproc->packet_size < UAVTALK_MIN_HEADER_LENGTH || iproc->packet_size > UAVTALK_MAX_HEADER_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH) {
             // incorrect packet size
             connection->stats.rxErrors++;
@@ -434,8 +724,7 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 
     case UAVTALK_STATE_OBJID:
 
-        // update the CRC
-        iproc->cs     = PIOS_CRC_updateByte(iproc->cs, rxbyte);
+        iproc->header[iproc->rxPacketLength - 1] = rxbyte;
 
         iproc->objId += rxbyte << (8 * (iproc->rxCount++));
         if (iproc->rxCount < 4) {
@@ -449,8 +738,7 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 
     case UAVTALK_STATE_INSTID:
 
-        // update the CRC
-        iproc->cs      = PIOS_CRC_updateByte(iproc->cs, rxbyte);
+        iproc->header[iproc->rxPacketLength - 1] = rxbyte;
 
         iproc->instId += rxbyte << (8 * (iproc->rxCount++));
         if (iproc->rxCount < 2) {
@@ -466,7 +754,7 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
             iproc->timestampLength = 0;
         } else {
             iproc->timestampLength = (iproc->type & UAVTALK_TIMESTAMPED) ? 2 : 0;
-            if (obj) {
+            if (obj && iproc->type != UAVTALK_TYPE_OBJ_DELTA) {
                 iproc->length = UAVObjGetNumBytes(obj);
             } else {
                 iproc->length = iproc->packet_size - iproc->rxPacketLength - iproc->timestampLength;
@@ -506,8 +794,7 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 
     case UAVTALK_STATE_TIMESTAMP:
 
-        // update the CRC
-        iproc->cs = PIOS_CRC_updateByte(iproc->cs, rxbyte);
+        iproc->header[iproc->rxPacketLength - 1] = rxbyte;
 
         iproc->timestamp += rxbyte << (8 * (iproc->rxCount++));
         if (iproc->rxCount < 2) {
@@ -525,9 +812,6 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 
     case UAVTALK_STATE_DATA:
 
-        // update the CRC
-        iproc->cs = PIOS_CRC_updateByte(iproc->cs, rxbyte);
-
         connection->rxBuffer[iproc->rxCount++] = rxbyte;
         if (iproc->rxCount < iproc->length) {
             break;
@@ -539,6 +823,10 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 
     case UAVTALK_STATE_CS:
 
+        // Compute the CRC over the header and payload in two spans, the sizes were checked in UAVTALK_STATE_INSTID
+        iproc->cs = PIOS_CRC_updateCRC(0, iproc->header, iproc->packet_size - iproc->length);
+        iproc->cs = PIOS_CRC_updateCRC(iproc->cs, connection->rxBuffer, iproc->length);
+
         // Check the CRC byte
         if (rxbyte != iproc->cs) {
             // packet error - faulty CRC
@@ -616,58 +904,147 @@ int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnecti
     UAVTalkConnectionData *outConnection;
     CHECKCONHANDLE(outConnectionHandle, outConnection, return -1);
 
-    if (!outConnection->outStream) {
-        outConnection->stats.txErrors++;
+    return relayPacket(outConnection, inIproc->type, inIproc->objId, inIproc->instId, inConnection->rxBuffer, inIproc->length);
+}
+
+/**
+ * Relay, receive or drop a parsed packet depending on its object.
+ * The entries of a multi object packet are handled one by one: those to be received are
+ * received on the input connection and the others are relayed in a single multi object packet.
+ * \param[in] inConnectionHandle UAVTalkConnection the packet was received on
+ * \param[in] outConnectionHandle UAVTalkConnection to relay to
+ * \param[in] filter Tells what to do with each object ID
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkRelayPacketFiltered(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, UAVTalkRelayFilter filter)
+{
+    UAVTalkConnectionData *inConnection;
+
+    CHECKCONHANDLE(inConnectionHandle, inConnection, return -1);
+    UAVTalkInputProcessor *inIproc = &inConnection->iproc;
+
+    if (inIproc->state != UAVTALK_STATE_COMPLETE) {
+        inConnection->stats.rxErrors++;
 
         return -1;
     }
 
-    // Lock
-    xSemaphoreTakeRecursive(outConnection->lock, portMAX_DELAY);
+    if (inIproc->type != UAVTALK_TYPE_MULTI) {
+        switch (filter(inIproc->objId)) {
+        case UAVTALK_RELAY_RECEIVE:
+            return UAVTalkReceiveObject(inConnectionHandle);
 
-    outConnection->txBuffer[0] = UAVTALK_SYNC_VAL;
-    // Setup type
-    outConnection->txBuffer[1] = inIproc->type;
-    // next 2 bytes are reserved for data length (inserted here later)
-    // Setup object ID
-    outConnection->txBuffer[4] = (uint8_t)(inIproc->objId & 0xFF);
-    outConnection->txBuffer[5] = (uint8_t)((inIproc->objId >> 8) & 0xFF);
-    outConnection->txBuffer[6] = (uint8_t)((inIproc->objId >> 16) & 0xFF);
-    outConnection->txBuffer[7] = (uint8_t)((inIproc->objId >> 24) & 0xFF);
-    // Setup instance ID
-    outConnection->txBuffer[8] = (uint8_t)(inIproc->instId & 0xFF);
-    outConnection->txBuffer[9] = (uint8_t)((inIproc->instId >> 8) & 0xFF);
-    int32_t headerLength = 10;
-
-    // Add timestamp when the transaction type is appropriate
-    if (inIproc->type & UAVTALK_TIMESTAMPED) {
-        portTickType time = xTaskGetTickCount();
-        outConnection->txBuffer[10] = (uint8_t)(time & 0xFF);
-        outConnection->txBuffer[11] = (uint8_t)((time >> 8) & 0xFF);
-        headerLength += 2;
+        case UAVTALK_RELAY_DROP:
+            return 0;
+
+        default:
+            return UAVTalkRelayPacket(inConnectionHandle, outConnectionHandle);
+        }
     }
 
-    // Copy data (if any)
-    if (inIproc->length > 0) {
-        memcpy(&outConnection->txBuffer[headerLength], inConnection->rxBuffer, inIproc->length);
+    UAVTalkConnectionData *outConnection;
+    CHECKCONHANDLE(outConnectionHandle, outConnection, return -1);
+
+    // The entries to relay are moved to the front of the receive buffer
+    uint8_t *data   = inConnection->rxBuffer;
+    uint32_t length = inIproc->length;
+    uint32_t offset = 0;
+    uint32_t relayLength = 0;
+    int32_t ret = 0;
+
+    while (offset < length) {
+        uint8_t *entry = &data[offset];
+        uint32_t headerLength = UAVTALK_BATCH_ENTRY_LENGTH;
+        uint32_t objLength    = entry[0] & UAVTALK_BATCH_LENGTH_MASK;
+        uint16_t instId = 0;
+
+        if (entry[0] & UAVTALK_BATCH_INSTANCE) {
+            headerLength += 2;
+        }
+        if (offset + headerLength + objLength > length) {
+            inConnection->stats.rxErrors++;
+            ret = -1;
+            break;
+        }
+
+        uint32_t objId = entry[1] | (entry[2] << 8) | (entry[3] << 16) | ((uint32_t)entry[4] << 24);
+        if (entry[0] & UAVTALK_BATCH_INSTANCE) {
+            instId = entry[5] | (entry[6] << 8);
+        }
+
+        switch (filter(objId)) {
+        case UAVTALK_RELAY_RECEIVE:
+        {
+            UAVObjHandle obj = UAVObjGetByID(objId);
+            if (!obj || UAVObjGetNumBytes(obj) != objLength ||
+                receiveObject(inConnection, UAVTALK_TYPE_OBJ, objId, instId, &entry[headerLength], objLength) == -1) {
+                ret = -1;
+            }
+            break;
+        }
+
+        case UAVTALK_RELAY_DROP:
+            break;
+
+        default:
+            if (relayLength != offset) {
+                memmove(&data[relayLength], entry, headerLength + objLength);
+            }
+            relayLength += headerLength + objLength;
+            break;
+        }
+
+        offset += headerLength + objLength;
     }
 
-    // Store the packet length
-    outConnection->txBuffer[2] = (uint8_t)((headerLength + inIproc->length) & 0xFF);
-    outConnection->txBuffer[3] = (uint8_t)(((headerLength + inIproc->length) >> 8) & 0xFF);
+    if (relayLength > 0 && relayPacket(outConnection, UAVTALK_TYPE_MULTI, 0, 0, data, relayLength) == -1) {
+        ret = -1;
+    }
 
-    // Copy the checksum
-    outConnection->txBuffer[headerLength + inIproc->length] = inIproc->cs;
+    return ret;
+}
 
-    // Send the buffer.
-    int32_t rc = (*outConnection->outStream)(outConnection->txBuffer, headerLength + inIproc->length + UAVTALK_CHECKSUM_LENGTH);
+/**
+ * Send a packet received on another connection.
+ * \param[in] outConnection UAVTalkConnection to send on
+ * \param[in] type Packet type
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID
+ * \param[in] data The packet payload
+ * \param[in] length The payload length
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t relayPacket(UAVTalkConnectionData *outConnection, uint8_t type, uint32_t objId, uint16_t instId, const uint8_t *data, uint32_t length)
+{
+    // Lock
+    xSemaphoreTakeRecursive(outConnection->lock, portMAX_DELAY);
+
+    uint8_t header[UAVTALK_MAX_HEADER_LENGTH];
+    int32_t headerLength = txHeader(header, type, objId, instId, length);
+    uint16_t tx_msg_len  = headerLength + length + UAVTALK_CHECKSUM_LENGTH;
+    t_fifo_span span;
+    int32_t rc = txReserve(outConnection, &span, tx_msg_len);
+
+    if (rc == tx_msg_len) {
+        // Header and data go straight to the output, the checksum is recomputed as the timestamp may have changed
+        uint8_t cs = PIOS_CRC_updateCRC(0, header, headerLength);
+        cs = PIOS_CRC_updateCRC(cs, data, length);
+        fifoBuf_spanWrite(&span, 0, header, headerLength);
+        fifoBuf_spanWrite(&span, headerLength, data, length);
+        fifoBuf_spanWrite(&span, headerLength + length, &cs, UAVTALK_CHECKSUM_LENGTH);
+
+        // Send the buffer.
+        rc = txCommit(outConnection, tx_msg_len);
+    }
 
     // Update stats
     outConnection->stats.txBytes += (rc > 0) ? rc : 0;
 
     // evaluate return value before releasing the lock
     int32_t ret = 0;
-    if (rc != (int32_t)(headerLength + inIproc->length + UAVTALK_CHECKSUM_LENGTH)) {
+    if (rc != tx_msg_len) {
         outConnection->stats.txErrors++;
         ret = -1;
     }
@@ -696,7 +1073,7 @@ int32_t UAVTalkReceiveObject(UAVTalkConnection connectionHandle)
         return -1;
     }
 
-    return receiveObject(connection, iproc->type, iproc->objId, iproc->instId, connection->rxBuffer);
+    return receiveObject(connection, iproc->type, iproc->objId, iproc->instId, connection->rxBuffer, iproc->length);
 }
 
 /**
@@ -723,7 +1100,7 @@ uint32_t UAVTalkGetPacketObjId(UAVTalkConnection connectionHandle)
  * In that case we want to nack as there is no point in the sender retrying to send invalid objects.
  *
  * \param[in] connection UAVTalkConnection to be used
- * \param[in] type Type of received message (UAVTALK_TYPE_OBJ, UAVTALK_TYPE_OBJ_REQ, UAVTALK_TYPE_OBJ_ACK, UAVTALK_TYPE_ACK, UAVTALK_TYPE_NACK)
+ * \param[in] type Type of received message (UAVTALK_TYPE_OBJ, UAVTALK_TYPE_OBJ_REQ, UAVTALK_TYPE_OBJ_ACK, UAVTALK_TYPE_ACK, UAVTALK_TYPE_NACK, UAVTALK_TYPE_MULTI, UAVTALK_TYPE_OBJ_DELTA)
  * \param[in] objId ID of the object to work on
  * \param[in] instId The instance ID of UAVOBJ_ALL_INSTANCES for all instances.
  * \param[in] data Data buffer
@@ -731,7 +1108,7 @@ uint32_t UAVTalkGetPacketObjId(UAVTalkConnection connectionHandle)
  * \return 0 Success
  * \return -1 Failure
  */
-static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t *data)
+static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t *data, uint32_t length)
 {
     UAVObjHandle obj;
     int32_t ret = 0;
@@ -754,6 +1131,10 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
         if (obj && (instId != UAVOBJ_ALL_INSTANCES)) {
             // Unpack object, if the instance does not exist it will be created!
             if (UAVObjUnpack(obj, instId, data) == 0) {
+                // Keep the image later delta packets apply to
+                if (connection->rxDeltaEnabled && length <= UAVTALK_DELTA_MAX_LENGTH) {
+                    deltaStore(connection->rxDelta, objId, instId, data, length);
+                }
                 // Check if this object acks a pending OBJ_REQ message
                 // any OBJ message can ack a pending OBJ_REQ message
                 // even one that was not sent in response to the OBJ_REQ message
@@ -774,6 +1155,9 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
             // Unpack object, if the instance does not exist it will be created!
             if (UAVObjUnpack(obj, instId, data) == 0) {
                 UAVT_DEBUGLOG_CPRINTF(objId, "OBJ ACK %X %d", objId, instId);
+                if (connection->rxDeltaEnabled && length <= UAVTALK_DELTA_MAX_LENGTH) {
+                    deltaStore(connection->rxDelta, objId, instId, data, length);
+                }
                 // Object updated or created, transmit ACK
                 sendObject(connection, UAVTALK_TYPE_ACK, objId, instId, NULL);
             } else {
@@ -793,9 +1177,15 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
         // Check if requested object exists
         UAVT_DEBUGLOG_CPRINTF(objId, "REQ %X %d", objId, instId);
         if (obj) {
+            // The receiver may have lost track of the object, it has to be sent in full
+            if (connection->txDeltaEnabled) {
+                deltaKeyframe(connection->txDelta, objId, instId);
+            }
             // Object found, transmit it
             // The sent object will ack the object request on the receiver side
             ret = sendObject(connection, UAVTALK_TYPE_OBJ, objId, instId, obj);
+            // Answer right away instead of with the next batch
+            flushBatch(connection);
         } else {
             ret = -1;
         }
@@ -827,6 +1217,14 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
         }
         break;
 
+    case UAVTALK_TYPE_MULTI:
+        ret = receiveBatch(connection, data, length);
+        break;
+
+    case UAVTALK_TYPE_OBJ_DELTA:
+        ret = receiveDelta(connection, objId, instId, obj, data, length);
+        break;
+
     default:
         ret = -1;
     }
@@ -838,6 +1236,55 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
     return ret;
 }
 
+/**
+ * Receive the objects of a multi object packet.
+ * Entries for unknown objects or with a wrong length are skipped.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] data The packet payload
+ * \param[in] length The payload length
+ * \return 0 Success
+ * \return -1 Failure, at least one entry was not received
+ */
+static int32_t receiveBatch(UAVTalkConnectionData *connection, uint8_t *data, uint32_t length)
+{
+    int32_t ret = 0;
+    uint32_t offset = 0;
+
+    while (offset < length) {
+        uint8_t *entry = &data[offset];
+        uint32_t headerLength = UAVTALK_BATCH_ENTRY_LENGTH;
+        uint32_t objLength    = entry[0] & UAVTALK_BATCH_LENGTH_MASK;
+        uint16_t instId = 0;
+
+        if (entry[0] & UAVTALK_BATCH_INSTANCE) {
+            headerLength += 2;
+        }
+        if (offset + headerLength + objLength > length) {
+            // truncated entry, the CRC matched so the sender is broken
+            connection->stats.rxErrors++;
+            return -1;
+        }
+
+        uint32_t objId = entry[1] | (entry[2] << 8) | (entry[3] << 16) | ((uint32_t)entry[4] << 24);
+        if (entry[0] & UAVTALK_BATCH_INSTANCE) {
+            instId = entry[5] | (entry[6] << 8);
+        }
+
+        UAVObjHandle obj = UAVObjGetByID(objId);
+        if (obj && UAVObjGetNumBytes(obj) == objLength) {
+            if (receiveObject(connection, UAVTALK_TYPE_OBJ, objId, instId, &entry[headerLength], objLength) == -1) {
+                ret = -1;
+            }
+        } else {
+            ret = -1;
+        }
+
+        offset += headerLength + objLength;
+    }
+
+    return ret;
+}
+
 /**
  * Check if an ack is pending on an object and give response semaphore
  * \param[in] connection UAVTalkConnection to be used
@@ -923,34 +1370,6 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
 {
     // IMPORTANT : obj can be null (when type is NACK for example)
 
-    if (!connection->outStream) {
-        connection->stats.txErrors++;
-        return -1;
-    }
-
-    // Setup sync byte
-    connection->txBuffer[0] = UAVTALK_SYNC_VAL;
-    // Setup type
-    connection->txBuffer[1] = type;
-    // next 2 bytes are reserved for data length (inserted here later)
-    // Setup object ID
-    connection->txBuffer[4] = (uint8_t)(objId & 0xFF);
-    connection->txBuffer[5] = (uint8_t)((objId >> 8) & 0xFF);
-    connection->txBuffer[6] = (uint8_t)((objId >> 16) & 0xFF);
-    connection->txBuffer[7] = (uint8_t)((objId >> 24) & 0xFF);
-    // Setup instance ID
-    connection->txBuffer[8] = (uint8_t)(instId & 0xFF);
-    connection->txBuffer[9] = (uint8_t)((instId >> 8) & 0xFF);
-    int32_t headerLength = 10;
-
-    // Add timestamp when the transaction type is appropriate
-    if (type & UAVTALK_TIMESTAMPED) {
-        portTickType time = xTaskGetTickCount();
-        connection->txBuffer[10] = (uint8_t)(time & 0xFF);
-        connection->txBuffer[11] = (uint8_t)((time >> 8) & 0xFF);
-        headerLength += 2;
-    }
-
     // Determine data length
     int32_t length;
     if (type == UAVTALK_TYPE_OBJ_REQ || type == UAVTALK_TYPE_ACK || type == UAVTALK_TYPE_NACK) {
@@ -965,24 +1384,79 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
         return -1;
     }
 
-    // Copy data (if any)
-    if (length > 0) {
-        if (UAVObjPack(obj, instId, &connection->txBuffer[headerLength]) == -1) {
+    // Image of the object when it was already packed for the delta encoding
+    const uint8_t *image = NULL;
+    if (connection->txDeltaEnabled && obj) {
+        if (type == UAVTALK_TYPE_OBJ) {
+            int32_t rc = sendDelta(connection, objId, instId, obj, length, &image);
+            if (rc <= 0) {
+                return rc;
+            }
+        } else if (type != UAVTALK_TYPE_OBJ_REQ) {
+            // The receiver keeps acked and timestamped objects too, the next update goes in full
+            deltaKeyframe(connection->txDelta, objId, instId);
+        }
+    }
+
+    if (connection->batching) {
+        // Small unacked objects are collected into one multi object packet
+        if (type == UAVTALK_TYPE_OBJ && length <= UAVTALK_BATCH_LENGTH_MASK) {
+            return batchObject(connection, objId, instId, obj, image, length);
+        }
+        // Anything else is sent after the objects collected so far
+        flushBatch(connection);
+    }
+
+    uint8_t header[UAVTALK_MAX_HEADER_LENGTH];
+    int32_t headerLength = txHeader(header, type, objId, instId, length);
+    uint16_t tx_msg_len  = headerLength + length + UAVTALK_CHECKSUM_LENGTH;
+
+    // Pack the object before reserving the output buffer, packing can wait on the object
+    // lock and every other sender on the port would wait along. Only connections without
+    // txBuffer pack in place.
+    if (!image && length > 0 && connection->txBuffer) {
+        if (UAVObjPack(obj, instId, connection->txBuffer + headerLength) == -1) {
             connection->stats.txErrors++;
             return -1;
         }
+        image = connection->txBuffer + headerLength;
     }
 
-    // Store the packet length
-    connection->txBuffer[2] = (uint8_t)((headerLength + length) & 0xFF);
-    connection->txBuffer[3] = (uint8_t)(((headerLength + length) >> 8) & 0xFF);
+    // Get space for the packet, in the output buffer itself if the output allows it
+    t_fifo_span span;
+    int32_t rc = txReserve(connection, &span, tx_msg_len);
+    if (rc != tx_msg_len) {
+        connection->stats.txErrors++;
+        return -1;
+    }
+
+    fifoBuf_spanWrite(&span, 0, header, headerLength);
+    uint8_t cs = PIOS_CRC_updateCRC(0, header, headerLength);
 
-    // Calculate and store checksum
-    connection->txBuffer[headerLength + length] = PIOS_CRC_updateCRC(0, connection->txBuffer, headerLength + length);
+    // Copy data (if any)
+    if (image) {
+        // Already in place when the packet itself goes through txBuffer
+        if (span.ptr[0] + headerLength != image) {
+            fifoBuf_spanWrite(&span, headerLength, image, length);
+        }
+        cs = PIOS_CRC_updateCRC(cs, image, length);
+    } else if (length > 0) {
+        t_fifo_span data;
+        fifoBuf_spanSlice(&span, headerLength, length, &data);
+        if (UAVObjPackSplit(obj, instId, data.ptr[0], data.len[0], data.ptr[1]) == -1) {
+            txCommit(connection, 0);
+            connection->stats.txErrors++;
+            return -1;
+        }
+        cs = PIOS_CRC_updateCRC(cs, data.ptr[0], data.len[0]);
+        cs = PIOS_CRC_updateCRC(cs, data.ptr[1], data.len[1]);
+    }
+
+    // Store checksum
+    fifoBuf_spanWrite(&span, headerLength + length, &cs, UAVTALK_CHECKSUM_LENGTH);
 
     // Send object
-    uint16_t tx_msg_len = headerLength + length + UAVTALK_CHECKSUM_LENGTH;
-    int32_t rc = (*connection->outStream)(connection->txBuffer, tx_msg_len);
+    rc = txCommit(connection, tx_msg_len);
 
     // Update stats
     if (rc == tx_msg_len) {
@@ -1000,6 +1474,462 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
     return 0;
 }
 
+/**
+ * Add an object to the multi object packet, sending the packet first if the object does not fit anymore
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID
+ * \param[in] obj Object handle to send
+ * \param[in] image The object already packed, or NULL to pack it here
+ * \param[in] length The object length, at most UAVTALK_BATCH_LENGTH_MASK
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t batchObject(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj, const uint8_t *image, uint16_t length)
+{
+    uint16_t headerLength = UAVTALK_BATCH_ENTRY_LENGTH + (instId ? 2 : 0);
+
+    if (connection->batchLength + headerLength + length > UAVTALK_BATCH_MAX_LENGTH) {
+        flushBatch(connection);
+    }
+
+    uint8_t *entry = &connection->batchBuffer[connection->batchLength];
+    entry[0] = (uint8_t)length | (instId ? UAVTALK_BATCH_INSTANCE : 0);
+    entry[1] = (uint8_t)(objId & 0xFF);
+    entry[2] = (uint8_t)((objId >> 8) & 0xFF);
+    entry[3] = (uint8_t)((objId >> 16) & 0xFF);
+    entry[4] = (uint8_t)((objId >> 24) & 0xFF);
+    if (instId) {
+        entry[5] = (uint8_t)(instId & 0xFF);
+        entry[6] = (uint8_t)((instId >> 8) & 0xFF);
+    }
+
+    if (image) {
+        memcpy(&entry[headerLength], image, length);
+    } else if (length > 0 && UAVObjPack(obj, instId, &entry[headerLength]) == -1) {
+        connection->stats.txErrors++;
+        return -1;
+    }
+    connection->batchLength += headerLength + length;
+
+    // Update stats, the bytes are counted when the packet is sent
+    ++connection->stats.txObjects;
+    connection->stats.txObjectBytes += length;
+
+    return 0;
+}
+
+/**
+ * Send the multi object packet, if there is anything in it
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t flushBatch(UAVTalkConnectionData *connection)
+{
+    if (connection->batchLength == 0) {
+        return 0;
+    }
+
+    uint8_t header[UAVTALK_MAX_HEADER_LENGTH];
+    int32_t headerLength = txHeader(header, UAVTALK_TYPE_MULTI, 0, 0, connection->batchLength);
+    uint16_t tx_msg_len  = headerLength + connection->batchLength + UAVTALK_CHECKSUM_LENGTH;
+    t_fifo_span span;
+    int32_t rc = txReserve(connection, &span, tx_msg_len);
+
+    if (rc == tx_msg_len) {
+        uint8_t cs = PIOS_CRC_updateCRC(0, header, headerLength);
+        cs = PIOS_CRC_updateCRC(cs, connection->batchBuffer, connection->batchLength);
+        fifoBuf_spanWrite(&span, 0, header, headerLength);
+        fifoBuf_spanWrite(&span, headerLength, connection->batchBuffer, connection->batchLength);
+        fifoBuf_spanWrite(&span, headerLength + connection->batchLength, &cs, UAVTALK_CHECKSUM_LENGTH);
+
+        rc = txCommit(connection, tx_msg_len);
+    }
+
+    // The objects are dropped on failure, like single packets
+    connection->batchLength = 0;
+
+    // Update stats
+    if (rc != tx_msg_len) {
+        connection->stats.txErrors++;
+        connection->stats.txBytes += (rc > 0) ? rc : 0;
+        return -1;
+    }
+    connection->stats.txBytes += tx_msg_len;
+
+    return 0;
+}
+
+/**
+ * Send an object as the blocks that changed since it was last sent on this connection.
+ * The object is sent in full when it has no previous image, is due for a keyframe or
+ * when that is not larger than the delta.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID
+ * \param[in] obj Object handle to send
+ * \param[in] length The object length
+ * \param[out] image The packed object, when it has to be sent in full
+ * \return 0 Success
+ * \return -1 Failure
+ * \return 1 The object has to be sent in full
+ */
+static int32_t sendDelta(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj, uint16_t length, const uint8_t **image)
+{
+    UAVTalkDeltaCache *cache = connection->txDelta;
+
+    if (length == 0 || length > UAVTALK_DELTA_MAX_LENGTH) {
+        return 1;
+    }
+    if (UAVObjPack(obj, instId, cache->image) == -1) {
+        connection->stats.txErrors++;
+        return -1;
+    }
+    *image = cache->image;
+
+    UAVTalkDeltaEntry *entry = deltaFind(cache, objId, instId);
+    if (!entry || entry->length != length || entry->updates >= UAVTALK_DELTA_KEYFRAME - 1) {
+        deltaStore(cache, objId, instId, cache->image, length);
+        return 1;
+    }
+
+    // Mark the blocks that changed since the last image
+    uint8_t *previous = &cache->data[entry->offset];
+    uint8_t mask[UAVTALK_DELTA_MASK_LENGTH(UAVTALK_DELTA_MAX_LENGTH)];
+    uint16_t maskLength = UAVTALK_DELTA_MASK_LENGTH(length);
+    uint16_t changed    = 0;
+    memset(mask, 0, maskLength);
+    for (uint16_t offset = 0; offset < length; offset += UAVTALK_DELTA_BLOCK) {
+        uint16_t blockLength = (length - offset < UAVTALK_DELTA_BLOCK) ? length - offset : UAVTALK_DELTA_BLOCK;
+        if (memcmp(&cache->image[offset], &previous[offset], blockLength) != 0) {
+            uint16_t block = offset / UAVTALK_DELTA_BLOCK;
+            mask[block / 8] |= 1 << (block % 8);
+            changed += blockLength;
+        }
+    }
+
+    // Only worth it when smaller than the full object, in its own packet or as a multi object entry
+    uint16_t deltaLength = 1 + maskLength + changed;
+    uint16_t fullLength  = UAVTALK_MIN_HEADER_LENGTH + length + UAVTALK_CHECKSUM_LENGTH;
+    if (connection->batching && length <= UAVTALK_BATCH_LENGTH_MASK) {
+        fullLength = UAVTALK_BATCH_ENTRY_LENGTH + (instId ? 2 : 0) + length;
+    }
+    if (UAVTALK_MIN_HEADER_LENGTH + deltaLength + UAVTALK_CHECKSUM_LENGTH >= fullLength) {
+        deltaStore(cache, objId, instId, cache->image, length);
+        return 1;
+    }
+
+    // Anything collected so far goes first, to keep the order
+    flushBatch(connection);
+
+    uint8_t header[UAVTALK_MAX_HEADER_LENGTH];
+    int32_t headerLength = txHeader(header, UAVTALK_TYPE_OBJ_DELTA, objId, instId, deltaLength);
+    uint16_t tx_msg_len  = headerLength + deltaLength + UAVTALK_CHECKSUM_LENGTH;
+    t_fifo_span span;
+    int32_t rc = txReserve(connection, &span, tx_msg_len);
+
+    if (rc == tx_msg_len) {
+        uint16_t pos = headerLength;
+        uint8_t cs   = PIOS_CRC_updateCRC(0, header, headerLength);
+        fifoBuf_spanWrite(&span, 0, header, headerLength);
+
+        // The image the receiver has to apply the changes to
+        cs = PIOS_CRC_updateByte(cs, entry->crc);
+        fifoBuf_spanWrite(&span, pos++, &entry->crc, 1);
+        cs = PIOS_CRC_updateCRC(cs, mask, maskLength);
+        fifoBuf_spanWrite(&span, pos, mask, maskLength);
+        pos += maskLength;
+        for (uint16_t offset = 0; offset < length; offset += UAVTALK_DELTA_BLOCK) {
+            uint16_t block = offset / UAVTALK_DELTA_BLOCK;
+            if (mask[block / 8] & (1 << (block % 8))) {
+                uint16_t blockLength = (length - offset < UAVTALK_DELTA_BLOCK) ? length - offset : UAVTALK_DELTA_BLOCK;
+                cs   = PIOS_CRC_updateCRC(cs, &cache->image[offset], blockLength);
+                fifoBuf_spanWrite(&span, pos, &cache->image[offset], blockLength);
+                pos += blockLength;
+            }
+        }
+        fifoBuf_spanWrite(&span, pos, &cs, UAVTALK_CHECKSUM_LENGTH);
+
+        rc = txCommit(connection, tx_msg_len);
+    }
+
+    // Update stats
+    if (rc != tx_msg_len) {
+        // The receiver did not get this one, resynchronise with the next update
+        entry->updates = UAVTALK_DELTA_KEYFRAME;
+        connection->stats.txErrors++;
+        connection->stats.txBytes += (rc > 0) ? rc : 0;
+        return -1;
+    }
+    ++connection->stats.txObjects;
+    connection->stats.txObjectBytes += deltaLength;
+    connection->stats.txBytes += tx_msg_len;
+
+    memcpy(previous, cache->image, length);
+    entry->crc = PIOS_CRC_updateCRC(0, previous, length);
+    entry->updates++;
+
+    return 0;
+}
+
+/**
+ * Apply a delta packet to the image of the object last received, then unpack it.
+ * A full copy is requested when the image is missing or is not the one the sender used.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID
+ * \param[in] obj Object handle, NULL if unknown
+ * \param[in] data The packet payload
+ * \param[in] length The payload length
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t receiveDelta(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj, uint8_t *data, uint32_t length)
+{
+    UAVTalkDeltaCache *cache = connection->rxDelta;
+
+    if (!connection->rxDeltaEnabled || !obj || instId == UAVOBJ_ALL_INSTANCES || length == 0) {
+        return -1;
+    }
+
+    uint16_t objLength = UAVObjGetNumBytes(obj);
+    UAVTalkDeltaEntry *entry = deltaFind(cache, objId, instId);
+    if (!entry || entry->length != objLength || entry->crc != data[0]) {
+        // Missed an update, ask for the full object
+        sendObject(connection, UAVTALK_TYPE_OBJ_REQ, objId, instId, NULL);
+        return -1;
+    }
+
+    // The changed blocks must add up to the payload
+    uint8_t *mask     = &data[1];
+    uint32_t expected = 1 + UAVTALK_DELTA_MASK_LENGTH(objLength);
+    if (length < expected) {
+        connection->stats.rxErrors++;
+        return -1;
+    }
+    for (uint16_t offset = 0; offset < objLength; offset += UAVTALK_DELTA_BLOCK) {
+        uint16_t block = offset / UAVTALK_DELTA_BLOCK;
+        if (mask[block / 8] & (1 << (block % 8))) {
+            expected += (objLength - offset < UAVTALK_DELTA_BLOCK) ? objLength - offset : UAVTALK_DELTA_BLOCK;
+        }
+    }
+    if (length != expected) {
+        connection->stats.rxErrors++;
+        return -1;
+    }
+
+    uint8_t *image = &cache->data[entry->offset];
+    uint32_t pos   = 1 + UAVTALK_DELTA_MASK_LENGTH(objLength);
+    for (uint16_t offset = 0; offset < objLength; offset += UAVTALK_DELTA_BLOCK) {
+        uint16_t block = offset / UAVTALK_DELTA_BLOCK;
+        if (mask[block / 8] & (1 << (block % 8))) {
+            uint16_t blockLength = (objLength - offset < UAVTALK_DELTA_BLOCK) ? objLength - offset : UAVTALK_DELTA_BLOCK;
+            memcpy(&image[offset], &data[pos], blockLength);
+            pos += blockLength;
+        }
+    }
+    entry->crc = PIOS_CRC_updateCRC(0, image, objLength);
+
+    if (UAVObjUnpack(obj, instId, image) == -1) {
+        return -1;
+    }
+    // Acks a pending OBJ_REQ message like a full object
+    updateAck(connection, UAVTALK_TYPE_OBJ, objId, instId);
+
+    return 0;
+}
+
+/**
+ * Find the image of an object instance
+ * \param[in] cache The images of one direction
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID
+ * \return The entry, NULL if there is none
+ */
+static UAVTalkDeltaEntry *deltaFind(UAVTalkDeltaCache *cache, uint32_t objId, uint16_t instId)
+{
+    for (uint8_t n = 0; n < cache->numEntries; n++) {
+        if (cache->entry[n].objId == objId && cache->entry[n].instId == instId) {
+            return &cache->entry[n];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Keep the image of an object instance. All images are dropped when the cache is full,
+ * the objects are then sent in full again.
+ * \param[in] cache The images of one direction
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID
+ * \param[in] data The packed object
+ * \param[in] length The object length, at most UAVTALK_DELTA_MAX_LENGTH
+ */
+static void deltaStore(UAVTalkDeltaCache *cache, uint32_t objId, uint16_t instId, const uint8_t *data, uint16_t length)
+{
+    UAVTalkDeltaEntry *entry = deltaFind(cache, objId, instId);
+
+    if (entry && entry->length != length) {
+        entry->objId = 0;
+        entry = NULL;
+    }
+    if (!entry) {
+        if (cache->numEntries == UAVTALK_DELTA_SLOTS || cache->used + length > UAVTALK_DELTA_CACHE_SIZE) {
+            cache->numEntries = 0;
+            cache->used = 0;
+        }
+        entry = &cache->entry[cache->numEntries++];
+        entry->objId  = objId;
+        entry->instId = instId;
+        entry->offset = cache->used;
+        entry->length = length;
+        cache->used  += length;
+    }
+
+    memcpy(&cache->data[entry->offset], data, length);
+    entry->crc     = PIOS_CRC_updateCRC(0, data, length);
+    entry->updates = 0;
+}
+
+/**
+ * Have the next update of an object sent in full
+ * \param[in] cache The images sent
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances
+ */
+static void deltaKeyframe(UAVTalkDeltaCache *cache, uint32_t objId, uint16_t instId)
+{
+    for (uint8_t n = 0; n < cache->numEntries; n++) {
+        if (cache->entry[n].objId == objId && (instId == UAVOBJ_ALL_INSTANCES || cache->entry[n].instId == instId)) {
+            cache->entry[n].updates = UAVTALK_DELTA_KEYFRAME;
+        }
+    }
+}
+
+/**
+ * Start or stop keeping the images of one direction. The images are allocated
+ * on the first enable and kept for the lifetime of the connection, stopping
+ * only drops the entries so the next objects are sent in full.
+ * \param[in,out] cache The images
+ * \param[in,out] enabled The flag telling whether the images are in use
+ * \param[in] enable True to keep images
+ * \return false if the images could not be allocated
+ */
+static bool deltaEnable(UAVTalkDeltaCache **cache, bool *enabled, bool enable)
+{
+    if (enable && !*cache) {
+        *cache = pios_malloc(sizeof(UAVTalkDeltaCache));
+        if (!*cache) {
+            *enabled = false;
+            return false;
+        }
+        (*cache)->numEntries = 0;
+        (*cache)->used = 0;
+    } else if (!enable && *cache) {
+        (*cache)->numEntries = 0;
+        (*cache)->used = 0;
+    }
+    *enabled = enable;
+    return true;
+}
+
+/**
+ * Get space for an outgoing packet. That is the output buffer itself for connections
+ * created with UAVTalkInitializeReserve(), and txBuffer otherwise or when the packet
+ * does not fit in the output buffer.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[out] span The space for the packet
+ * \param[in] length The packet length
+ * \return length on success, negative on failure
+ */
+static int32_t txReserve(UAVTalkConnectionData *connection, t_fifo_span *span, uint16_t length)
+{
+    connection->txReserved = false;
+    if (connection->outReserve) {
+        int32_t rc = (*connection->outReserve)(span, length);
+        if (rc != 0 || !connection->outStream) {
+            connection->txReserved = (rc > 0);
+            return rc;
+        }
+        // Too large for the output buffer, go through txBuffer
+    }
+    if (!connection->outStream) {
+        return -1;
+    }
+    span->ptr[0] = connection->txBuffer;
+    span->len[0] = length;
+    span->ptr[1] = connection->txBuffer;
+    span->len[1] = 0;
+    return length;
+}
+
+/**
+ * Send a packet written to the space given by txReserve()
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] length The packet length, zero to drop the packet
+ * \return Number of bytes sent, negative on failure
+ */
+static int32_t txCommit(UAVTalkConnectionData *connection, uint16_t length)
+{
+    if (connection->txReserved) {
+        return (*connection->outCommit)(length);
+    }
+    if (length == 0) {
+        return 0;
+    }
+    return (*connection->outStream)(connection->txBuffer, length);
+}
+
+/**
+ * Build a packet header
+ * \param[out] header Buffer of UAVTALK_MAX_HEADER_LENGTH bytes
+ * \param[in] type The packet type
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID
+ * \param[in] length The data length
+ * \return The header length
+ */
+static int32_t txHeader(uint8_t *header, uint8_t type, uint32_t objId, uint16_t instId, uint16_t length)
+{
+    int32_t headerLength;
+
+    // Setup sync byte
+    header[0] = UAVTALK_SYNC_VAL;
+    // Setup type
+    header[1] = type;
+    // next 2 bytes are reserved for data length (inserted here later)
+
+    if (type == UAVTALK_TYPE_MULTI) {
+        // Multi object packets have no object and instance ID
+        headerLength = UAVTALK_BATCH_HEADER_LENGTH;
+    } else {
+        // Setup object ID
+        header[4]    = (uint8_t)(objId & 0xFF);
+        header[5]    = (uint8_t)((objId >> 8) & 0xFF);
+        header[6]    = (uint8_t)((objId >> 16) & 0xFF);
+        header[7]    = (uint8_t)((objId >> 24) & 0xFF);
+        // Setup instance ID
+        header[8]    = (uint8_t)(instId & 0xFF);
+        header[9]    = (uint8_t)((instId >> 8) & 0xFF);
+        headerLength = 10;
+
+        // Add timestamp when the transaction type is appropriate
+        if (type & UAVTALK_TIMESTAMPED) {
+            portTickType time = xTaskGetTickCount();
+            header[10]    = (uint8_t)(time & 0xFF);
+            header[11]    = (uint8_t)((time >> 8) & 0xFF);
+            headerLength += 2;
+        }
+    }
+
+    // Store the packet length
+    header[2] = (uint8_t)((headerLength + length) & 0xFF);
+    header[3] = (uint8_t)(((headerLength + length) >> 8) & 0xFF);
+
+    return headerLength;
+}
+
 /**
  * @}
  * @}
@@ -31,13 +31,14 @@
 namespace core {
 qlonglong PureImageCache::ConnCounter = 0;
 
-PureImageCache::PureImageCache()
+PureImageCache::PureImageCache() : generation(0)
 {}
 
 void PureImageCache::setGtileCache(const QString &value)
 {
     lock.lockForWrite();
     gtilecache = value;
+    ++generation;
     QDir d;
     if (!d.exists(gtilecache)) {
         d.mkdir(gtilecache);
@@ -150,6 +151,14 @@ bool PureImageCache::CreateEmptyDB(const QString &file)
     if (query.numRowsAffected() == -1) {
 #ifdef DEBUG_PUREIMAGECACHE
         qDebug() << "CreateEmptyDB: " << query.lastError().driverText();
+#endif // DEBUG_PUREIMAGECACHE
+        db.close();
+        return false;
+    }
+    query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+    if (query.numRowsAffected() == -1) {
+#ifdef DEBUG_PUREIMAGECACHE
+        qDebug() << "CreateEmptyDB: " << query.lastError().driverText();
 #endif // DEBUG_PUREIMAGECACHE
         db.close();
         return false;
@@ -158,89 +167,139 @@ bool PureImageCache::CreateEmptyDB(const QString &file)
     QSqlDatabase::removeDatabase(QLatin1String("CreateConn"));
     return true;
 }
-bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type, const Point &pos, const int &zoom)
+/**
+ * Write tiles in a single transaction, none of them is written if one fails
+ */
+bool PureImageCache::PutImagesToCache(const QList<CacheItemQueue *> &tiles)
 {
+    QReadLocker locker(&lock);
+
     if (gtilecache.isEmpty() | gtilecache.isNull()) {
         return false;
     }
-    lock.lockForRead();
 #ifdef DEBUG_PUREIMAGECACHE
-    qDebug() << "PutImageToCache Start:"; // <<pos;
+    qDebug() << "PutImagesToCache Start:" << tiles.count();
 #endif // DEBUG_PUREIMAGECACHE
-    Mcounter.lock();
-    qlonglong id = ++ConnCounter;
-    Mcounter.unlock();
-    {
-        QSqlDatabase cn;
-        cn = QSqlDatabase::addDatabase("QSQLITE", QString::number(id));
-        QString db = gtilecache + "Data.qmdb";
-        cn.setDatabaseName(db);
-        cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-        if (cn.open()) {
-            {
-                QSqlQuery query(cn);
-                query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                query.addBindValue(pos.X());
-                query.addBindValue(pos.Y());
-                query.addBindValue(zoom);
-
-                query.addBindValue((int)type);
-                query.addBindValue(QDateTime::currentDateTime().toString());
-                query.exec();
-            }
-            {
-                QSqlQuery query(cn);
-                query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                query.addBindValue(tile);
-                query.exec();
-            }
-            cn.close();
+    Connection *cn = connection();
+    if (cn == NULL || !cn->db.transaction()) {
+        return false;
+    }
+    QString date = QDateTime::currentDateTime().toString();
+    bool ok = true;
+    foreach(CacheItemQueue * tile, tiles) {
+        if (!putTile(cn, tile->GetImg(), tile->GetMapType(), tile->GetPosition(), tile->GetZoom(), date)) {
+            ok = false;
+            break;
         }
     }
-    QSqlDatabase::removeDatabase(QString::number(id));
-    lock.unlock();
+    if (!ok || !cn->db.commit()) {
+#ifdef DEBUG_PUREIMAGECACHE
+        qDebug() << "PutImagesToCache: " << cn->db.lastError().driverText();
+#endif // DEBUG_PUREIMAGECACHE
+        cn->db.rollback();
+        return false;
+    }
     return true;
 }
+bool PureImageCache::putTile(Connection *cn, const QByteArray &tile, const MapType::Types &type, const Point &pos, const int &zoom, const QString &date)
+{
+    cn->putTile.bindValue(0, pos.X());
+    cn->putTile.bindValue(1, pos.Y());
+    cn->putTile.bindValue(2, zoom);
+    cn->putTile.bindValue(3, (int)type);
+    cn->putTile.bindValue(4, date);
+    if (!cn->putTile.exec()) {
+        return false;
+    }
+    cn->putTileData.bindValue(0, tile);
+    return cn->putTileData.exec();
+}
 QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
 {
-    lock.lockForRead();
+    QReadLocker locker(&lock);
     QByteArray ar;
+
     if (gtilecache.isEmpty() | gtilecache.isNull()) {
         return ar;
     }
-    QString dir  = gtilecache;
+#ifdef DEBUG_PUREIMAGECACHE
+    qDebug() << "Cache dir=" << gtilecache << " Try to GET:" << pos.X() + "," + pos.Y();
+#endif // DEBUG_PUREIMAGECACHE
+
+    Connection *cn = connection();
+    if (cn == NULL) {
+        return ar;
+    }
+    cn->getTile.bindValue(0, pos.X());
+    cn->getTile.bindValue(1, pos.Y());
+    cn->getTile.bindValue(2, zoom);
+    cn->getTile.bindValue(3, (int)type);
+    if (cn->getTile.exec() && cn->getTile.next()) {
+        ar = cn->getTile.value(0).toByteArray();
+    }
+    // Ends the read transaction, so that the writer can checkpoint
+    cn->getTile.finish();
+    return ar;
+}
+/**
+ * Connection of the calling thread, opened on first use and kept until the thread
+ * exits or the cache location changes. Called with the lock held.
+ * @returns NULL if the database could not be opened
+ */
+PureImageCache::Connection *PureImageCache::connection()
+{
+    Connection *cn = connections.localData();
+
+    if (cn != NULL && cn->generation == generation) {
+        return cn;
+    }
     Mcounter.lock();
     qlonglong id = ++ConnCounter;
     Mcounter.unlock();
+
+    cn = new Connection;
+    cn->name       = QString::number(id);
+    cn->generation = generation;
+    // Also closes the connection to the previous location
+    connections.setLocalData(cn);
+
+    cn->db = QSqlDatabase::addDatabase("QSQLITE", cn->name);
+    cn->db.setDatabaseName(gtilecache + "Data.qmdb");
+    cn->db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if (!cn->db.open()) {
 #ifdef DEBUG_PUREIMAGECACHE
-    qDebug() << "Cache dir=" << dir << " Try to GET:" << pos.X() + "," + pos.Y();
+        qDebug() << "Unable to open the cache:" << cn->db.lastError().driverText();
 #endif // DEBUG_PUREIMAGECACHE
-
+        // Retried on the next access
+        connections.setLocalData(NULL);
+        return NULL;
+    }
     {
-        QString db = dir + "Data.qmdb";
-        {
-            QSqlDatabase cn;
-
-            cn = QSqlDatabase::addDatabase("QSQLITE", QString::number(id));
-
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if (cn.open()) {
-                {
-                    QSqlQuery query(cn);
-                    query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int)type));
-                    query.next();
-                    if (query.isValid()) {
-                        ar = query.value(0).toByteArray();
-                    }
-                }
-                cn.close();
-            }
-        }
+        QSqlQuery query(cn->db);
+        // Readers do not block the writer and the other way around
+        query.exec("PRAGMA journal_mode=WAL");
+        query.exec("PRAGMA synchronous=NORMAL");
+        // Caches created before the index was added to CreateEmptyDB
+        query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
     }
-    QSqlDatabase::removeDatabase(QString::number(id));
-    lock.unlock();
-    return ar;
+    cn->getTile = QSqlQuery(cn->db);
+    cn->getTile.setForwardOnly(true);
+    cn->getTile.prepare("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=?)");
+    cn->putTile = QSqlQuery(cn->db);
+    cn->putTile.prepare("INSERT INTO Tiles(X, Y, Zoom, Type, Date) VALUES(?, ?, ?, ?, ?)");
+    cn->putTileData = QSqlQuery(cn->db);
+    cn->putTileData.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
+    return cn;
+}
+PureImageCache::Connection::~Connection()
+{
+    // The queries and the database handle have to go before the connection is removed
+    getTile     = QSqlQuery();
+    putTile     = QSqlQuery();
+    putTileData = QSqlQuery();
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(name);
 }
 void PureImageCache::deleteOlderTiles(int const & days)
 {
@@ -42,22 +42,41 @@
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
+#include "cacheitemqueue.h"
 namespace core {
 class PureImageCache {
 public:
     PureImageCache();
     static bool CreateEmptyDB(const QString &file);
-    bool PutImageToCache(const QByteArray &tile, const MapType::Types &type, const core::Point &pos, const int &zoom);
+    bool PutImagesToCache(const QList<CacheItemQueue *> &tiles);
     QByteArray GetImageFromCache(MapType::Types type, core::Point pos, int zoom);
     QString GtileCache();
     void setGtileCache(const QString &value);
     static bool ExportMapDataToDB(QString sourceFile, QString destFile);
     void deleteOlderTiles(int const & days);
 private:
+    // Database connection of one thread, kept open with its statements prepared
+    struct Connection {
+        QString name;
+        int generation;
+        QSqlDatabase db;
+        QSqlQuery getTile;
+        QSqlQuery putTile;
+        QSqlQuery putTileData;
+        ~Connection();
+    };
+
     QString gtilecache;
     QMutex Mcounter;
     QReadWriteLock lock;
     static qlonglong ConnCounter;
+    QThreadStorage<Connection *> connections;
+    // Changed with the cache location, connections to the old database are reopened
+    int generation;
+
+    Connection *connection();
+    bool putTile(Connection *cn, const QByteArray &tile, const MapType::Types &type, const core::Point &pos, const int &zoom, const QString &date);
 };
 }
 #endif // PUREIMAGECACHE_H
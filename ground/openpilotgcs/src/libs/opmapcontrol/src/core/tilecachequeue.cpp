@@ -30,7 +30,7 @@
 // #define DEBUG_TILECACHEQUEUE
 
 namespace core {
-TileCacheQueue::TileCacheQueue()
+TileCacheQueue::TileCacheQueue() : running(false)
 {}
 TileCacheQueue::~TileCacheQueue()
 {
@@ -42,27 +42,29 @@ void TileCacheQueue::EnqueueCacheTask(CacheItemQueue *task)
 #ifdef DEBUG_TILECACHEQUEUE
     qDebug() << "DB Do I EnqueueCacheTask" << task->GetPosition().X() << "," << task->GetPosition().Y();
 #endif // DEBUG_TILECACHEQUEUE
-    if (!tileCacheQueue.contains(task)) {
+    QMutexLocker locker(&mutex);
+
+    if (tileCacheQueue.contains(task)) {
+        return;
+    }
 #ifdef DEBUG_TILECACHEQUEUE
-        qDebug() << "EnqueueCacheTask" << task->GetPosition().X() << "," << task->GetPosition().Y();
+    qDebug() << "EnqueueCacheTask" << task->GetPosition().X() << "," << task->GetPosition().Y();
 #endif // DEBUG_TILECACHEQUEUE
-        mutex.lock();
-        tileCacheQueue.enqueue(task);
-        mutex.unlock();
-        if (this->isRunning()) {
+    tileCacheQueue.enqueue(task);
+    if (running) {
 #ifdef DEBUG_TILECACHEQUEUE
-            qDebug() << "Wake Thread";
+        qDebug() << "Wake Thread";
 #endif // DEBUG_TILECACHEQUEUE
-            // this->start(QThread::NormalPriority);
-            // waitmutex.lock();
-            waitc.wakeAll();
-            // waitmutex.unlock();
-        } else {
+        waitc.wakeAll();
+    } else {
 #ifdef DEBUG_TILECACHEQUEUE
-            qDebug() << "Start Thread";
+        qDebug() << "Start Thread";
 #endif // DEBUG_TILECACHEQUEUE
-            this->start(QThread::NormalPriority);
-        }
+        running = true;
+        locker.unlock();
+        // The thread may still be returning from its previous run
+        this->wait();
+        this->start(QThread::NormalPriority);
     }
 }
 void TileCacheQueue::run()
@@ -70,40 +72,36 @@ void TileCacheQueue::run()
 #ifdef DEBUG_TILECACHEQUEUE
     qDebug() << "Cache Engine Start";
 #endif // DEBUG_TILECACHEQUEUE
+    QMutexLocker locker(&mutex);
+
     while (true) {
-        CacheItemQueue *task;
-#ifdef DEBUG_TILECACHEQUEUE
-        qDebug() << "Cache";
-#endif // DEBUG_TILECACHEQUEUE
-        if (tileCacheQueue.count() > 0) {
-            mutex.lock();
-            task = tileCacheQueue.dequeue();
-            mutex.unlock();
+        if (tileCacheQueue.isEmpty()) {
 #ifdef DEBUG_TILECACHEQUEUE
-            qDebug() << "Cache engine Put:" << task->GetPosition().X() << "," << task->GetPosition().Y();
-#endif // DEBUG_TILECACHEQUEUE
-            Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(), task->GetMapType(), task->GetPosition(), task->GetZoom());
-            usleep(44);
-            delete task;
-        } else {
             qDebug() << "Cache engine BEGIN WAIT";
-            waitmutex.lock();
-            int tout = 4000;
-            if (!waitc.wait(&waitmutex, tout)) {
-                waitmutex.unlock();
+#endif // DEBUG_TILECACHEQUEUE
+            if (!waitc.wait(&mutex, IDLE_TIMEOUT) && tileCacheQueue.isEmpty()) {
 #ifdef DEBUG_TILECACHEQUEUE
                 qDebug() << "Cache Engine TimeOut";
 #endif // DEBUG_TILECACHEQUEUE
-                mutex.lock();
-                if (tileCacheQueue.count() == 0) {
-                    mutex.unlock();
-                    break;
-                }
-                mutex.unlock();
+                running = false;
+                break;
             }
-            qDebug() << "Cache Engine DID NOT TimeOut";
-            waitmutex.unlock();
+            continue;
         }
+        // Let the tiles being downloaded join this flush
+        locker.unlock();
+        msleep(FLUSH_DELAY);
+        locker.relock();
+
+        QList<CacheItemQueue *> tasks;
+        tasks.swap(tileCacheQueue);
+        locker.unlock();
+#ifdef DEBUG_TILECACHEQUEUE
+        qDebug() << "Cache engine Put:" << tasks.count();
+#endif // DEBUG_TILECACHEQUEUE
+        Cache::Instance()->ImageCache.PutImagesToCache(tasks);
+        qDeleteAll(tasks);
+        locker.relock();
     }
 #ifdef DEBUG_TILECACHEQUEUE
     qDebug() << "Cache Engine Stopped";
@@ -49,10 +49,14 @@ public:
 protected:
     QQueue<CacheItemQueue *> tileCacheQueue;
 private:
+    // Time given to more tiles to arrive, so that they are written in one transaction
+    static const unsigned long FLUSH_DELAY = 200; // ms
+    static const unsigned long IDLE_TIMEOUT = 4000; // ms
+
     void run();
     QMutex mutex;
-    QMutex waitmutex;
     QWaitCondition waitc;
+    bool running;
 };
 }
 #endif // TILECACHEQUEUE_H
@@ -1,6 +1,10 @@
 #include "logfile.h"
 #include <QDebug>
 #include <QtGlobal>
+#include <QtEndian>
+#include <QDataStream>
+#include <QFileInfo>
+#include <algorithm>
 
 LogFile::LogFile(QObject *parent) :
     QIODevice(parent),
@@ -9,7 +13,10 @@ LogFile::LogFile(QObject *parent) :
     m_timeOffset(0),
     m_playbackSpeed(1.0),
     m_nextTimeStamp(0),
-    m_useProvidedTimeStamp(false)
+    m_useProvidedTimeStamp(false),
+    m_indexValid(false),
+    m_lastIndexTime(0),
+    m_lastRecordTime(0)
 {
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(timerFired()));
 }
@@ -36,6 +43,13 @@ bool LogFile::open(OpenMode mode)
         return false;
     }
 
+    // A new log is indexed while it is written, an existing one the first time it is seeked
+    m_index.clear();
+    m_indexValid = false;
+    m_lastRecords.clear();
+    m_lastIndexTime  = 0;
+    m_lastRecordTime = 0;
+
     // TODO: Write a header at the beginng describing objects so that in future
     // they can be read back if ID's change
 
@@ -54,6 +68,12 @@ void LogFile::close()
     if (m_timer.isActive()) {
         m_timer.stop();
     }
+    if (m_file.isWritable() && !m_index.isEmpty()) {
+        m_file.flush();
+        m_lastRecords.clear();
+        m_indexValid = true;
+        saveIndex();
+    }
     m_file.close();
     QIODevice::close();
 }
@@ -68,6 +88,8 @@ qint64 LogFile::writeData(const char *data, qint64 dataSize)
     // This is used when saving logs from on-board logging
     quint32 timeStamp = m_useProvidedTimeStamp ? m_nextTimeStamp : m_myTime.elapsed();
 
+    indexRecord(timeStamp, m_file.pos(), data, dataSize);
+
     m_file.write((char *)&timeStamp, sizeof(timeStamp));
     m_file.write((char *)&dataSize, sizeof(dataSize));
 
@@ -182,3 +204,281 @@ void LogFile::resumeReplay()
     m_timeOffset = m_myTime.elapsed();
     m_timer.start();
 }
+
+/**
+ * Moves the replay to the given log time. The last update of every object
+ * instance logged up to that time is replayed at once, then the replay
+ * goes on from there at the current speed.
+ */
+bool LogFile::seekReplay(quint32 time)
+{
+    if (!m_file.isOpen() || m_file.isWritable() || !buildIndex()) {
+        return false;
+    }
+
+    // Find the last checkpoint at or before time
+    int low  = 0;
+    int high = m_index.size() - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (m_index[mid].timeStamp <= time) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    const IndexEntry &entry = m_index[low];
+
+    // The objects as they were at the checkpoint...
+    RecordMap lastRecords;
+    quint32 timeStamp;
+    QByteArray data;
+    foreach(qint64 offset, entry.snapshot) {
+        if (readRecord(offset, &timeStamp, &data)) {
+            trackRecord(&lastRecords, offset, data.constData(), data.size());
+        }
+    }
+
+    // ...updated with what was logged between the checkpoint and time
+    qint64 offset = entry.offset;
+    while (readRecord(offset, &timeStamp, &data) && timeStamp <= time) {
+        trackRecord(&lastRecords, offset, data.constData(), data.size());
+        offset = m_file.pos();
+    }
+
+    // Replay them in the order they were logged
+    QVector<qint64> offsets = replayOffsets(lastRecords);
+    m_mutex.lock();
+    m_dataBuffer.clear();
+    foreach(qint64 record, offsets) {
+        if (readRecord(record, &timeStamp, &data)) {
+            m_dataBuffer.append(data);
+        }
+    }
+    m_mutex.unlock();
+    emit readyRead();
+
+    // Leave the file where timerFired() expects it, after the time stamp of the next record
+    m_file.seek(offset);
+    if (m_file.read((char *)&m_lastTimeStamp, sizeof(m_lastTimeStamp)) != sizeof(m_lastTimeStamp)) {
+        m_lastTimeStamp = time;
+    }
+    m_lastPlayed = time;
+    m_timeOffset = m_myTime.elapsed();
+
+    return true;
+}
+
+quint32 LogFile::replayDuration()
+{
+    if (m_file.isWritable()) {
+        return m_lastRecordTime;
+    }
+    return buildIndex() ? m_lastRecordTime : 0;
+}
+
+/**
+ * Adds a record to the records needed to restore the object instances it
+ * updates, keyed by object and instance id. The records hold UAVTalk
+ * packets, decoded like UAVTalkLogDecoder does: a full update, or every
+ * entry of a multi object packet, replaces the records of the instance,
+ * a delta update is appended to them. Deltas without a full update
+ * before them can't be applied and are left out.
+ */
+void LogFile::trackRecord(RecordMap *records, qint64 offset, const char *data, qint64 dataSize)
+{
+    const uchar *bytes = (const uchar *)data;
+    qint64 pos = 0;
+
+    while (dataSize - pos >= BATCH_HEADER_LENGTH + CHECKSUM_LENGTH) {
+        // header : sync(1), type (1), size(2), object ID(4), instance ID(2)
+        const uchar *packet = &bytes[pos];
+        qint32 packetSize   = qFromLittleEndian<quint16>(&packet[2]);
+        if (packet[0] != SYNC_VAL || packetSize < BATCH_HEADER_LENGTH || packetSize + CHECKSUM_LENGTH > dataSize - pos) {
+            return;
+        }
+        pos += packetSize + CHECKSUM_LENGTH;
+
+        if (packet[1] == TYPE_MULTI) {
+            // The multi object header has no object or instance id, each entry has its own
+            const uchar *payload = &packet[BATCH_HEADER_LENGTH];
+            qint32 length        = packetSize - BATCH_HEADER_LENGTH;
+            qint32 entry         = 0;
+            while (entry + BATCH_ENTRY_LENGTH <= length) {
+                quint8 flags = payload[entry];
+                qint32 entryLength = BATCH_ENTRY_LENGTH + ((flags & BATCH_INSTANCE) ? 2 : 0);
+                if (entry + entryLength + (flags & BATCH_LENGTH_MASK) > length) {
+                    break;
+                }
+                quint16 instId = (flags & BATCH_INSTANCE) ? qFromLittleEndian<quint16>(&payload[entry + BATCH_ENTRY_LENGTH]) : 0;
+                qint64 key     = ((qint64)qFromLittleEndian<quint32>(&payload[entry + 1]) << 16) | instId;
+                (*records)[key] = QVector<qint64>() << offset;
+                entry += entryLength + (flags & BATCH_LENGTH_MASK);
+            }
+            continue;
+        }
+
+        if (packetSize < HEADER_LENGTH) {
+            continue;
+        }
+        qint64 key = ((qint64)qFromLittleEndian<quint32>(&packet[4]) << 16) | qFromLittleEndian<quint16>(&packet[8]);
+        if (packet[1] == TYPE_OBJ || packet[1] == TYPE_OBJ_ACK) {
+            (*records)[key] = QVector<qint64>() << offset;
+        } else if (packet[1] == TYPE_OBJ_DELTA) {
+            RecordMap::iterator it = records->find(key);
+            if (it != records->end() && it->last() != offset) {
+                it->append(offset);
+            }
+        }
+    }
+}
+
+/**
+ * Offsets of the records to replay, in the order they were logged. A
+ * record updating several instances is replayed once.
+ */
+QVector<qint64> LogFile::replayOffsets(const RecordMap &records)
+{
+    QVector<qint64> offsets;
+
+    foreach(const QVector<qint64> &instance, records) {
+        offsets += instance;
+    }
+    std::sort(offsets.begin(), offsets.end());
+    offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+    return offsets;
+}
+
+void LogFile::indexRecord(quint32 timeStamp, qint64 offset, const char *data, qint64 dataSize)
+{
+    if (m_index.isEmpty() || timeStamp >= m_lastIndexTime + INDEX_INTERVAL) {
+        IndexEntry entry;
+        entry.timeStamp = timeStamp;
+        entry.offset    = offset;
+        entry.snapshot  = replayOffsets(m_lastRecords);
+        m_index << entry;
+        m_lastIndexTime = timeStamp;
+    }
+
+    trackRecord(&m_lastRecords, offset, data, dataSize);
+    m_lastRecordTime = timeStamp;
+}
+
+bool LogFile::readRecord(qint64 offset, quint32 *timeStamp, QByteArray *data)
+{
+    qint64 dataSize;
+
+    if (!m_file.seek(offset) ||
+        m_file.read((char *)timeStamp, sizeof(*timeStamp)) != sizeof(*timeStamp) ||
+        m_file.read((char *)&dataSize, sizeof(dataSize)) != sizeof(dataSize) ||
+        dataSize < 1 || dataSize > (1024 * 1024)) {
+        return false;
+    }
+    *data = m_file.read(dataSize);
+    return data->size() == dataSize;
+}
+
+QString LogFile::indexFileName() const
+{
+    return m_file.fileName() + ".idx";
+}
+
+/**
+ * Logs without an up to date index file next to them are scanned once.
+ */
+bool LogFile::buildIndex()
+{
+    if (m_indexValid || loadIndex()) {
+        return true;
+    }
+
+    QFile file(m_file.fileName());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    qint64 size = file.size();
+    const uchar *map = file.map(0, size);
+    if (!map) {
+        qDebug() << "Unable to map" << file.fileName() << "for indexing";
+        return false;
+    }
+
+    m_index.clear();
+    m_lastRecords.clear();
+    m_lastIndexTime  = 0;
+    m_lastRecordTime = 0;
+
+    qint64 offset = 0;
+    while (offset + (qint64)(sizeof(quint32) + sizeof(qint64)) <= size) {
+        quint32 timeStamp;
+        qint64 dataSize;
+        memcpy(&timeStamp, map + offset, sizeof(timeStamp));
+        memcpy(&dataSize, map + offset + sizeof(timeStamp), sizeof(dataSize));
+        qint64 dataOffset = offset + sizeof(timeStamp) + sizeof(dataSize);
+        // Same checks as the replay, the index ends where the replay would
+        if (dataSize < 1 || dataSize > (1024 * 1024) || dataOffset + dataSize > size) {
+            break;
+        }
+        indexRecord(timeStamp, offset, (const char *)map + dataOffset, dataSize);
+        offset = dataOffset + dataSize;
+    }
+
+    file.unmap((uchar *)map);
+    m_lastRecords.clear();
+
+    m_indexValid = !m_index.isEmpty();
+    if (m_indexValid) {
+        saveIndex();
+    }
+    return m_indexValid;
+}
+
+bool LogFile::loadIndex()
+{
+    QFile file(indexFileName());
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 magic;
+    quint32 version;
+    qint64 logSize;
+    quint32 count;
+    in >> magic >> version >> logSize >> m_lastRecordTime >> count;
+    // An index of another version or of a log that changed since is rebuilt
+    if (in.status() != QDataStream::Ok || magic != INDEX_MAGIC || version != INDEX_VERSION ||
+        logSize != QFileInfo(m_file.fileName()).size()) {
+        return false;
+    }
+
+    m_index.resize(count);
+    for (quint32 i = 0; i < count; i++) {
+        in >> m_index[i].timeStamp >> m_index[i].offset >> m_index[i].snapshot;
+    }
+    if (in.status() != QDataStream::Ok || m_index.isEmpty()) {
+        m_index.clear();
+        return false;
+    }
+    m_indexValid = true;
+    return true;
+}
+
+void LogFile::saveIndex()
+{
+    QFile file(indexFileName());
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Unable to write index" << file.fileName();
+        return;
+    }
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    out << INDEX_MAGIC << INDEX_VERSION << QFileInfo(m_file.fileName()).size() << m_lastRecordTime << (quint32)m_index.size();
+    foreach(const IndexEntry &entry, m_index) {
+        out << entry.timeStamp << entry.offset << entry.snapshot;
+    }
+}
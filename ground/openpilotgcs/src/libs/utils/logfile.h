@@ -8,6 +8,8 @@
 #include <QDebug>
 #include <QBuffer>
 #include <QFile>
+#include <QHash>
+#include <QVector>
 #include "utils_global.h"
 
 class QTCREATOR_UTILS_EXPORT LogFile : public QIODevice {
@@ -40,6 +42,14 @@ public:
         m_nextTimeStamp = nextTimestamp;
     }
 
+    // Log time of the last record, builds the index if needed
+    quint32 replayDuration();
+    // Log time the replay got to
+    quint32 replayPosition() const
+    {
+        return m_lastPlayed;
+    }
+
 public slots:
     void setReplaySpeed(double val)
     {
@@ -48,6 +58,7 @@ public slots:
     };
     void pauseReplay();
     void resumeReplay();
+    bool seekReplay(quint32 time);
 
 protected slots:
     void timerFired();
@@ -73,6 +84,51 @@ protected:
 private:
     quint32 m_nextTimeStamp;
     bool m_useProvidedTimeStamp;
+
+    // Replay index, one checkpoint every INDEX_INTERVAL ms of log time.
+    // A checkpoint holds the offset of its first record and, for every
+    // object instance logged before it, of its last full update and the
+    // delta updates since. Replaying those restores the state of all
+    // objects at that time.
+    struct IndexEntry {
+        quint32 timeStamp;
+        qint64  offset;
+        QVector<qint64> snapshot;
+    };
+    static const quint32 INDEX_INTERVAL = 10000;
+    static const quint32 INDEX_MAGIC    = 0x494c504f; // "OPLI"
+    static const quint32 INDEX_VERSION  = 2;
+
+    // Same framing as UAVTalk, see uavtalk.h
+    static const quint8 SYNC_VAL       = 0x3C;
+    static const quint8 TYPE_OBJ       = 0x20;
+    static const quint8 TYPE_OBJ_ACK   = 0x22;
+    static const quint8 TYPE_MULTI     = 0x25;
+    static const quint8 TYPE_OBJ_DELTA = 0x26;
+    static const int HEADER_LENGTH       = 10;
+    static const int BATCH_HEADER_LENGTH = 4;
+    static const int BATCH_ENTRY_LENGTH  = 5;
+    static const int BATCH_INSTANCE      = 0x80;
+    static const int BATCH_LENGTH_MASK   = 0x7F;
+    static const int CHECKSUM_LENGTH     = 1;
+
+    typedef QHash<qint64, QVector<qint64> > RecordMap;
+
+    QVector<IndexEntry> m_index;
+    bool m_indexValid;
+    // Records of every object instance while recording or indexing
+    RecordMap m_lastRecords;
+    quint32 m_lastIndexTime;
+    quint32 m_lastRecordTime;
+
+    static void trackRecord(RecordMap *records, qint64 offset, const char *data, qint64 dataSize);
+    static QVector<qint64> replayOffsets(const RecordMap &records);
+    void indexRecord(quint32 timeStamp, qint64 offset, const char *data, qint64 dataSize);
+    bool readRecord(qint64 offset, quint32 *timeStamp, QByteArray *data);
+    QString indexFileName() const;
+    bool buildIndex();
+    bool loadIndex();
+    void saveIndex();
 };
 
 #endif // LOGFILE_H
@@ -30,6 +30,7 @@
 
 #include <QApplication>
 #include <QFileDialog>
+#include <QTimer>
 #include <QXmlStreamReader>
 #include <QMessageBox>
 #include <QDebug>
@@ -191,8 +192,6 @@ void FlightLogManager::retrieveLogs(int flightToRetrieve)
     setDisableControls(true);
     QApplication::setOverrideCursor(Qt::WaitCursor);
     m_cancelDownload = false;
-    UAVObjectUpdaterHelper updateHelper;
-    UAVObjectRequestHelper requestHelper;
 
     clearLogList();
 
@@ -200,67 +199,23 @@ void FlightLogManager::retrieveLogs(int flightToRetrieve)
     int startFlight = (flightToRetrieve == -1) ? 0 : flightToRetrieve;
     int endFlight   = (flightToRetrieve == -1) ? m_flightLogStatus->getFlight() : flightToRetrieve;
 
-    // Prepare to send request for event retrieval
-    m_flightLogControl->setOperation(DebugLogControl::OPERATION_RETRIEVE);
-    for (int flight = startFlight; flight <= endFlight; flight++) {
-        m_flightLogControl->setFlight(flight);
-        bool gotLast = false;
-        int slot     = 0;
-        while (!gotLast) {
-            // Send request for loading flight entry on flight side and wait for ack/nack
-            m_flightLogControl->setEntry(slot);
-
-            if (updateHelper.doObjectAndWait(m_flightLogControl, UAVTALK_TIMEOUT) == UAVObjectUpdaterHelper::SUCCESS &&
-                requestHelper.doObjectAndWait(m_flightLogEntry, UAVTALK_TIMEOUT) == UAVObjectUpdaterHelper::SUCCESS) {
-                if (m_flightLogEntry->getType() != DebugLogEntry::TYPE_EMPTY) {
-                    // Ok, we retrieved the entry, and it was the correct one. clone it and add it to the list
-                    ExtendedDebugLogEntry *logEntry = new ExtendedDebugLogEntry();
-
-                    logEntry->setData(m_flightLogEntry->getData(), m_objectManager);
-                    m_logEntries << logEntry;
-                    if (logEntry->getData().Type == DebugLogEntry::TYPE_MULTIPLEUAVOBJECTS) {
-                        const quint32 total_len  = sizeof(DebugLogEntry::DataFields);
-                        const quint32 data_len   = sizeof(((DebugLogEntry::DataFields *)0)->Data);
-                        const quint32 header_len = total_len - data_len;
-
-                        DebugLogEntry::DataFields fields;
-                        quint32 start = logEntry->getData().Size;
-
-                        // cycle until there is space for another object
-                        while (start + header_len + 1 < data_len) {
-                            memset(&fields, 0xFF, total_len);
-                            memcpy(&fields, &logEntry->getData().Data[start], header_len);
-                            // check wether a packed object is found
-                            // note that empty data blocks are set as 0xFF in flight side to minimize flash wearing
-                            // thus as soon as this read outside of used area, the test will fail as lenght would be 0xFFFF
-                            quint32 toread = header_len + fields.Size;
-                            if (!(toread + start > data_len)) {
-                                memcpy(&fields, &logEntry->getData().Data[start], toread);
-                                ExtendedDebugLogEntry *subEntry = new ExtendedDebugLogEntry();
-                                subEntry->setData(fields, m_objectManager);
-                                m_logEntries << subEntry;
-                            }
-                            start += toread;
-                        }
-                    }
+    // Entries are streamed into all instances of DebugLogEntry, new ones are created as they arrive
+    foreach(UAVObject * object, m_objectManager->getObjectInstances(DebugLogEntry::OBJID)) {
+        connect(object, SIGNAL(objectUnpacked(UAVObject *)), this, SLOT(streamedEntryReceived(UAVObject *)));
+    }
+    connect(m_objectManager, SIGNAL(newInstance(UAVObject *)), this, SLOT(entryInstanceAdded(UAVObject *)));
 
-                    // Increment to get next entry from flight side
-                    slot++;
-                } else {
-                    // We are done, not more entries on this flight
-                    gotLast = true;
-                }
-            } else {
-                // We failed for some reason
-                break;
-            }
-            if (m_cancelDownload) {
-                break;
-            }
-        }
+    for (int flight = startFlight; flight <= endFlight; flight++) {
+        retrieveFlight(flight);
         if (m_cancelDownload) {
             break;
         }
+        emit logEntriesChanged();
+    }
+
+    disconnect(m_objectManager, SIGNAL(newInstance(UAVObject *)), this, SLOT(entryInstanceAdded(UAVObject *)));
+    foreach(UAVObject * object, m_objectManager->getObjectInstances(DebugLogEntry::OBJID)) {
+        disconnect(object, SIGNAL(objectUnpacked(UAVObject *)), this, SLOT(streamedEntryReceived(UAVObject *)));
     }
 
     if (m_cancelDownload) {
@@ -275,6 +230,136 @@ void FlightLogManager::retrieveLogs(int flightToRetrieve)
     setDisableControls(false);
 }
 
+void FlightLogManager::retrieveFlight(int flight)
+{
+    UAVObjectUpdaterHelper updateHelper;
+    QTimer timeoutTimer;
+    int retries = 0;
+
+    timeoutTimer.setSingleShot(true);
+    connect(&timeoutTimer, SIGNAL(timeout()), &m_streamLoop, SLOT(quit()));
+
+    m_streamedEntries.clear();
+    m_streamFlight = flight;
+    m_streamNext   = 0;
+    m_streamEnd    = -1;
+
+    while (!m_cancelDownload) {
+        // Ask for a window starting at the first entry still missing, whatever arrived after it is kept
+        m_streamWindowEnd = m_streamNext + STREAM_WINDOW;
+        m_flightLogControl->setOperation(DebugLogControl::OPERATION_RETRIEVESTREAM);
+        m_flightLogControl->setFlight(flight);
+        m_flightLogControl->setEntry(m_streamNext);
+        m_flightLogControl->setCount(STREAM_WINDOW);
+        if (updateHelper.doObjectAndWait(m_flightLogControl, UAVTALK_TIMEOUT) != UAVObjectUpdaterHelper::SUCCESS) {
+            // We failed for some reason
+            return;
+        }
+
+        // The entries may all be here already, otherwise wait for the rest of the window
+        if (!streamWindowComplete()) {
+            timeoutTimer.start(STREAM_TIMEOUT);
+            m_streamLoop.exec();
+            timeoutTimer.stop();
+        }
+
+        // Add what we have in order, a gap stops it and is asked for again
+        int first = m_streamNext;
+        while (m_streamedEntries.contains(m_streamNext)) {
+            addLogEntry(m_streamedEntries.take(m_streamNext));
+            m_streamNext++;
+        }
+        if (m_streamEnd >= 0 && m_streamNext >= m_streamEnd) {
+            // We are done, not more entries on this flight
+            return;
+        }
+        if (m_streamNext == first && ++retries > STREAM_RETRIES) {
+            qDebug() << "Log download of flight" << flight << "stalled at entry" << m_streamNext;
+            return;
+        } else if (m_streamNext != first) {
+            retries = 0;
+        }
+    }
+}
+
+bool FlightLogManager::streamWindowComplete()
+{
+    for (int entry = m_streamNext; entry < m_streamWindowEnd; entry++) {
+        if (entry == m_streamEnd) {
+            return true;
+        }
+        if (!m_streamedEntries.contains(entry)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FlightLogManager::entryInstanceAdded(UAVObject *object)
+{
+    if (object->getObjID() == DebugLogEntry::OBJID) {
+        connect(object, SIGNAL(objectUnpacked(UAVObject *)), this, SLOT(streamedEntryReceived(UAVObject *)));
+    }
+}
+
+void FlightLogManager::streamedEntryReceived(UAVObject *object)
+{
+    DebugLogEntry::DataFields data = static_cast<DebugLogEntry *>(object)->getData();
+
+    // Leftovers of a previous request may still arrive
+    if (data.Flight != m_streamFlight || data.Entry < m_streamNext) {
+        return;
+    }
+    if (data.Type == DebugLogEntry::TYPE_EMPTY) {
+        m_streamEnd = (m_streamEnd < 0) ? data.Entry : qMin(m_streamEnd, (int)data.Entry);
+    } else {
+        m_streamedEntries.insert(data.Entry, data);
+    }
+    if (m_streamLoop.isRunning() && streamWindowComplete()) {
+        m_streamLoop.quit();
+    }
+}
+
+void FlightLogManager::addLogEntry(const DebugLogEntry::DataFields &data)
+{
+    if (data.Type == DebugLogEntry::TYPE_UAVOBJECTSTREAM) {
+        // A page of streamed records, each one becomes an entry of its own
+        addStreamEntries(data);
+        return;
+    }
+
+    // Ok, we retrieved the entry, and it was the correct one. clone it and add it to the list
+    ExtendedDebugLogEntry *logEntry = new ExtendedDebugLogEntry();
+
+    logEntry->setData(data, m_objectManager);
+    m_logEntries << logEntry;
+    if (logEntry->getData().Type == DebugLogEntry::TYPE_MULTIPLEUAVOBJECTS) {
+        const quint32 total_len  = sizeof(DebugLogEntry::DataFields);
+        const quint32 data_len   = sizeof(((DebugLogEntry::DataFields *)0)->Data);
+        const quint32 header_len = total_len - data_len;
+
+        DebugLogEntry::DataFields fields;
+        quint32 start = logEntry->getData().Size;
+
+        // cycle until there is space for another object
+        while (start + header_len + 1 < data_len) {
+            memset(&fields, 0xFF, total_len);
+            memcpy(&fields, &logEntry->getData().Data[start], header_len);
+            // check wether a packed object is found
+            // note that empty data blocks are set as 0xFF in flight side to minimize flash wearing
+            // thus as soon as this read outside of used area, the test will fail as lenght would be 0xFFFF
+            quint32 toread = header_len + fields.Size;
+            if (!(toread + start > data_len)) {
+                memcpy(&fields, &logEntry->getData().Data[start], toread);
+                ExtendedDebugLogEntry *subEntry = new ExtendedDebugLogEntry();
+                subEntry->setData(fields, m_objectManager);
+                m_logEntries << subEntry;
+            }
+            start += toread;
+        }
+    }
+}
+
 void FlightLogManager::exportToOPL(QString fileName)
 {
     // Fix the file name
@@ -321,6 +406,71 @@ void FlightLogManager::exportToOPL(QString fileName)
     }
 }
 
+void FlightLogManager::addStreamEntries(const DebugLogEntry::DataFields &page)
+{
+    // See pios_debuglog.c for the record layout
+    const quint8 *p   = page.Data;
+    const quint8 *end = page.Data + qMin((quint32)page.Size, (quint32)sizeof(page.Data));
+    quint32 objects[64];
+    quint8 numObjects = 0;
+    quint32 time = page.FlightTime;
+
+    while (p < end) {
+        quint8 tag = *p++;
+        if (tag & 0x80) {
+            if (p + 4 > end || numObjects == 64) {
+                break;
+            }
+            memcpy(&objects[numObjects++], p, 4);
+            p += 4;
+        }
+        if ((tag & 0x3F) >= numObjects) {
+            qDebug() << "Malformed log record in flight" << page.Flight << "entry" << page.Entry;
+            break;
+        }
+        quint16 instId = 0;
+        if (tag & 0x40) {
+            if (p + 2 > end) {
+                break;
+            }
+            memcpy(&instId, p, 2);
+            p += 2;
+        }
+        quint32 delta = 0;
+        for (int shift = 0; p < end && shift < 32; shift += 7) {
+            delta |= (quint32)(*p & 0x7F) << shift;
+            if (!(*p++ & 0x80)) {
+                break;
+            }
+        }
+        time += delta;
+        if (p >= end || p + 1 + *p > end) {
+            break;
+        }
+        quint8 size = *p++;
+
+        DebugLogEntry::DataFields fields;
+        memset(&fields, 0xFF, sizeof(fields));
+        fields.Flight     = page.Flight;
+        fields.FlightTime = time;
+        fields.Entry      = page.Entry;
+        fields.Type       = DebugLogEntry::TYPE_UAVOBJECT;
+        fields.ObjectID   = objects[tag & 0x3F];
+        fields.InstanceID = instId;
+        fields.Size       = size;
+        memcpy(fields.Data, p, size);
+        p += size;
+
+        // Objects this GCS doesn't know about can't be shown, skip them
+        if (!m_objectManager->getObject(fields.ObjectID, fields.InstanceID)) {
+            continue;
+        }
+        ExtendedDebugLogEntry *subEntry = new ExtendedDebugLogEntry();
+        subEntry->setData(fields, m_objectManager);
+        m_logEntries << subEntry;
+    }
+}
+
 void FlightLogManager::exportToCSV(QString fileName)
 {
     QFile csvFile(fileName);
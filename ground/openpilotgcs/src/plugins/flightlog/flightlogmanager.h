@@ -31,6 +31,8 @@
 #include <QObject>
 #include <QList>
 #include <QHash>
+#include <QMap>
+#include <QEventLoop>
 #include <QQmlListProperty>
 #include <QSemaphore>
 #include <QXmlStreamWriter>
@@ -319,6 +321,8 @@ private slots:
     void setupLogStatuses();
     void connectionStatusChanged();
     bool updateLogWrapper(QString name, int level, int period);
+    void entryInstanceAdded(UAVObject *object);
+    void streamedEntryReceived(UAVObject *object);
 
 private:
     UAVObjectManager *m_objectManager;
@@ -331,6 +335,14 @@ private:
     ObjectPersistence *m_objectPersistence;
 
     QList<ExtendedDebugLogEntry *> m_logEntries;
+
+    // State of the download of one flight
+    QEventLoop m_streamLoop;
+    QMap<int, DebugLogEntry::DataFields> m_streamedEntries;
+    int m_streamFlight;
+    int m_streamNext;
+    int m_streamWindowEnd;
+    int m_streamEnd;
     QStringList m_flightEntries;
     QStringList m_logSettings;
     QStringList m_logStatuses;
@@ -341,8 +353,17 @@ private:
     void exportToOPL(QString fileName);
     void exportToCSV(QString fileName);
     void exportToXML(QString fileName);
+    void retrieveFlight(int flight);
+    bool streamWindowComplete();
+    void addLogEntry(const DebugLogEntry::DataFields &data);
+    void addStreamEntries(const DebugLogEntry::DataFields &page);
 
     static const int UAVTALK_TIMEOUT = 4000;
+    // Entries asked for at once, the flight side sends at most 8
+    static const int STREAM_WINDOW   = 8;
+    // How long to wait for the rest of a window before asking for the gap again
+    static const int STREAM_TIMEOUT  = 1000;
+    static const int STREAM_RETRIES  = 5;
     static const int LOG_SETTINGS_FILE_VERSION = 1;
     bool m_disableControls;
     bool m_disableExport;
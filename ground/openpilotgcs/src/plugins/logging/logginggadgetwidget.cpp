@@ -35,13 +35,17 @@
 #include <QPushButton>
 #include <loggingplugin.h>
 
-LoggingGadgetWidget::LoggingGadgetWidget(QWidget *parent) : QLabel(parent)
+LoggingGadgetWidget::LoggingGadgetWidget(QWidget *parent) : QLabel(parent), loggingPlugin(NULL), duration(0)
 {
     m_logging = new Ui_Logging();
     m_logging->setupUi(this);
 
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
     scpPlugin = pm->getObject<ScopeGadgetFactory>();
+
+    positionTimer.setInterval(500);
+    connect(&positionTimer, SIGNAL(timeout()), this, SLOT(updatePosition()));
+    connect(m_logging->positionSlider, SIGNAL(sliderReleased()), this, SLOT(seek()));
 }
 
 LoggingGadgetWidget::~LoggingGadgetWidget()
@@ -66,6 +70,42 @@ void LoggingGadgetWidget::setPlugin(LoggingPlugin *p)
 void LoggingGadgetWidget::stateChanged(QString status)
 {
     m_logging->statusLabel->setText(status);
+
+    // The position slider is only there for replays, the duration comes from the replay index
+    bool replay = (status == "REPLAY");
+    duration = replay ? loggingPlugin->getLogfile()->replayDuration() : 0;
+    m_logging->positionSlider->setRange(0, duration);
+    m_logging->positionSlider->setEnabled(replay && duration > 0);
+    if (replay) {
+        positionTimer.start();
+    } else {
+        positionTimer.stop();
+    }
+    updatePosition();
+}
+
+static QString formatTime(quint32 ms)
+{
+    quint32 seconds = ms / 1000;
+
+    return QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+}
+
+void LoggingGadgetWidget::updatePosition()
+{
+    quint32 position = duration ? qMin(loggingPlugin->getLogfile()->replayPosition(), duration) : 0;
+
+    // Leave the slider alone while it is dragged
+    if (!m_logging->positionSlider->isSliderDown()) {
+        m_logging->positionSlider->setValue(position);
+    }
+    m_logging->positionLabel->setText(formatTime(m_logging->positionSlider->value()) + " / " + formatTime(duration));
+}
+
+void LoggingGadgetWidget::seek()
+{
+    loggingPlugin->getLogfile()->seekReplay(m_logging->positionSlider->value());
+    updatePosition();
 }
 
 /**
@@ -29,6 +29,7 @@
 #define LoggingGADGETWIDGET_H_
 
 #include <QLabel>
+#include <QTimer>
 #include "extensionsystem/pluginmanager.h"
 #include "scope/scopeplugin.h"
 #include "scope/scopegadgetfactory.h"
@@ -47,6 +48,8 @@ public:
 
 protected slots:
     void stateChanged(QString status);
+    void updatePosition();
+    void seek();
 
 signals:
     void pause();
@@ -56,6 +59,8 @@ private:
     Ui_Logging *m_logging;
     LoggingPlugin *loggingPlugin;
     ScopeGadgetFactory *scpPlugin;
+    QTimer positionTimer;
+    quint32 duration;
 };
 
 #endif /* LoggingGADGETWIDGET_H_ */
@@ -38,10 +38,13 @@
 #include <QList>
 #include <QErrorMessage>
 #include <QWriteLocker>
+#include <QApplication>
+#include <QFileInfo>
 
 #include <extensionsystem/pluginmanager.h>
 #include <QKeySequence>
 #include "uavobjectmanager.h"
+#include <uavtalk/uavtalklogexporter.h>
 
 
 LoggingConnection::LoggingConnection(LoggingPlugin *loggingPlugin) :
@@ -294,7 +297,8 @@ LoggingPlugin::LoggingPlugin() :
     loggingThread(NULL),
     logConnection(new LoggingConnection(this)),
     mf(NULL),
-    cmd(NULL)
+    cmd(NULL),
+    exportCmd(NULL)
 {}
 
 LoggingPlugin::~LoggingPlugin()
@@ -333,6 +337,16 @@ bool LoggingPlugin::initialize(const QStringList & args, QString *errMsg)
 
     connect(cmd->action(), SIGNAL(triggered(bool)), this, SLOT(toggleLogging()));
 
+    // Command to convert a log to columns
+    exportCmd = am->registerAction(new QAction(this),
+                                   "LoggingPlugin.ExportColumns",
+                                   QList<int>() <<
+                                   Core::Constants::C_GLOBAL_ID);
+    exportCmd->action()->setText(tr("Export log columns..."));
+    ac->addAction(exportCmd, "Logging");
+
+    connect(exportCmd->action(), SIGNAL(triggered(bool)), this, SLOT(exportColumns()));
+
 
     mf = new LoggingGadgetFactory(this);
     addAutoReleasedObject(mf);
@@ -435,6 +449,36 @@ void LoggingPlugin::replayStarted()
     emit stateChanged("REPLAY");
 }
 
+/**
+ * Convert a log to a column store next to it, one file per field element
+ * so that a single field can be plotted without replaying the whole log.
+ */
+void LoggingPlugin::exportColumns()
+{
+    QString fileName = QFileDialog::getOpenFileName(NULL, tr("Export log columns"), QString(""), tr("OpenPilot Log (*.opl)"));
+
+    if (fileName.isEmpty()) {
+        return;
+    }
+    QString directory = QFileDialog::getExistingDirectory(NULL, tr("Export columns to"), QFileInfo(fileName).path());
+    if (directory.isEmpty()) {
+        return;
+    }
+
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+    UAVTalkLogExporter exporter(objManager);
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool success = exporter.exportLog(fileName, directory + "/" + QFileInfo(fileName).completeBaseName());
+    QApplication::restoreOverrideCursor();
+    if (!success) {
+        QErrorMessage err;
+        err.showMessage(exporter.errorString());
+        err.exec();
+    }
+}
+
 
 void LoggingPlugin::extensionsInitialized()
 {
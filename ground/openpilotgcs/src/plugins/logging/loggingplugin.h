@@ -159,10 +159,12 @@ private slots:
     void loggingStopped();
     void replayStarted();
     void replayStopped();
+    void exportColumns();
 
 private:
     LoggingGadgetFactory *mf;
     Core::Command *cmd;
+    Core::Command *exportCmd;
 };
 #endif /* LoggingPLUGIN_H_ */
 /**
@@ -30,12 +30,217 @@
 #include <math.h>
 #include <QDebug>
 
+// Chrono plots do not know their sample rate, their buffer grows from this
+#define PLOT_SERIES_INITIAL_CAPACITY 1024
+
+PlotSeriesData::PlotSeriesData() :
+    m_first(0), m_count(0), m_appended(0), m_growable(true), m_relativeX(false), m_xOffset(0.0),
+    m_decimated(false), m_columnWidth(0.0), m_folded(0)
+{
+    m_x.resize(PLOT_SERIES_INITIAL_CAPACITY);
+    m_y.resize(PLOT_SERIES_INITIAL_CAPACITY);
+}
+
+/*!
+   \brief Set the number of samples kept. A growable buffer doubles instead of
+   dropping the oldest sample, the stale samples are removed by removeOlderThan().
+ */
+void PlotSeriesData::setCapacity(int capacity, bool growable)
+{
+    clear();
+    m_growable = growable;
+    m_x.resize(capacity);
+    m_y.resize(capacity);
+}
+
+void PlotSeriesData::append(double x, double y)
+{
+    if (m_count == m_x.size()) {
+        if (m_growable) {
+            // Unwrap into a buffer twice the size
+            QVector<double> xs(2 * m_x.size());
+            QVector<double> ys(2 * m_y.size());
+            for (int i = 0; i < m_count; ++i) {
+                xs[i] = m_x.at(index(i));
+                ys[i] = m_y.at(index(i));
+            }
+            m_x.swap(xs);
+            m_y.swap(ys);
+            m_first = 0;
+        } else {
+            m_first = (m_first + 1) % m_x.size();
+            m_count--;
+        }
+    }
+    int last = index(m_count);
+    m_x[last] = x;
+    m_y[last] = y;
+    m_count++;
+    m_appended++;
+}
+
+/*!
+   \brief Remove the oldest samples until the buffer spans no more than window.
+ */
+void PlotSeriesData::removeOlderThan(double window)
+{
+    if (m_count == 0) {
+        return;
+    }
+    double lastX = m_x.at(index(m_count - 1));
+    while (m_count > 0 && lastX - m_x.at(m_first) > window) {
+        m_first = (m_first + 1) % m_x.size();
+        m_count--;
+    }
+}
+
+void PlotSeriesData::clear()
+{
+    m_first     = 0;
+    m_count     = 0;
+    m_decimated = false;
+    m_columns.clear();
+    m_points.clear();
+    d_boundingRect = QRectF(0.0, 0.0, -1.0, -1.0);
+}
+
+/*!
+   \brief Prepare the samples for the next replot.
+   \param window Span of the x axis
+   \param pixels Width of the plot canvas
+ */
+void PlotSeriesData::update(double window, int pixels)
+{
+    m_xOffset = (m_relativeX && m_count > 0) ? -m_x.at(m_first) : 0.0;
+    d_boundingRect = QRectF(0.0, 0.0, -1.0, -1.0);
+
+    if (pixels <= 0 || window <= 0 || m_count <= 2 * pixels) {
+        // Few enough to draw them all straight from the buffer
+        m_decimated = false;
+        m_columns.clear();
+        m_points.clear();
+        return;
+    }
+
+    double columnWidth = window / pixels;
+    qint64 oldest = m_appended - m_count;
+    if (!m_decimated || columnWidth != m_columnWidth || m_folded < oldest) {
+        // Window or canvas resized, or the columns are too old: start over
+        m_decimated   = true;
+        m_columnWidth = columnWidth;
+        m_folded = oldest;
+        m_columns.clear();
+    }
+    for (; m_folded < m_appended; ++m_folded) {
+        int i = index((int)(m_folded - oldest));
+        fold(m_x.at(i), m_y.at(i));
+    }
+
+    // Drop the columns left of the oldest sample, the first one may have lost samples
+    qint64 first = (qint64)floor(m_x.at(m_first) / m_columnWidth);
+    int stale    = 0;
+    while (stale < m_columns.size() && m_columns.at(stale).index < first) {
+        stale++;
+    }
+    m_columns.remove(0, stale);
+    refoldFirstColumn();
+
+    // Each column is drawn as its extremes in x order
+    m_points.resize(0);
+    m_points.reserve(2 * m_columns.size());
+    foreach(const Column &column, m_columns) {
+        QPointF min(column.minX + m_xOffset, column.minY);
+        QPointF max(column.maxX + m_xOffset, column.maxY);
+
+        if (column.minX == column.maxX) {
+            m_points.append(min);
+        } else if (column.minX < column.maxX) {
+            m_points.append(min);
+            m_points.append(max);
+        } else {
+            m_points.append(max);
+            m_points.append(min);
+        }
+    }
+}
+
+void PlotSeriesData::fold(double x, double y)
+{
+    qint64 i = (qint64)floor(x / m_columnWidth);
+
+    if (m_columns.isEmpty() || m_columns.last().index != i) {
+        Column column = { i, x, y, x, y };
+        m_columns.append(column);
+        return;
+    }
+    Column &column = m_columns.last();
+    if (y < column.minY) {
+        column.minX = x;
+        column.minY = y;
+    }
+    if (y > column.maxY) {
+        column.maxX = x;
+        column.maxY = y;
+    }
+}
+
+void PlotSeriesData::refoldFirstColumn()
+{
+    if (m_columns.isEmpty()) {
+        return;
+    }
+    Column &column = m_columns.first();
+    double x = m_x.at(m_first);
+    double y = m_y.at(m_first);
+
+    column.minX = column.maxX = x;
+    column.minY = column.maxY = y;
+    for (int i = 1; i < m_count; ++i) {
+        x = m_x.at(index(i));
+        if ((qint64)floor(x / m_columnWidth) != column.index) {
+            break;
+        }
+        y = m_y.at(index(i));
+        if (y < column.minY) {
+            column.minX = x;
+            column.minY = y;
+        }
+        if (y > column.maxY) {
+            column.maxX = x;
+            column.maxY = y;
+        }
+    }
+}
+
+size_t PlotSeriesData::size() const
+{
+    return m_decimated ? m_points.size() : m_count;
+}
+
+QPointF PlotSeriesData::sample(size_t i) const
+{
+    if (m_decimated) {
+        return m_points.at(i);
+    }
+    int n = index((int)i);
+    return QPointF(m_x.at(n) + m_xOffset, m_y.at(n));
+}
+
+QRectF PlotSeriesData::boundingRect() const
+{
+    if (d_boundingRect.width() < 0.0) {
+        d_boundingRect = qwtBoundingRect(*this);
+    }
+    return d_boundingRect;
+}
+
 PlotData::PlotData(UAVObject *object, UAVObjectField *field, int element,
                    int scaleOrderFactor, int meanSamples, QString mathFunction,
                    double plotDataSize, QPen pen, bool antialiased) :
     m_scalePower(scaleOrderFactor), m_meanSamples(meanSamples),
     m_meanSum(0.0f), m_mathFunction(mathFunction), m_correctionSum(0.0f),
     m_correctionCount(0), m_plotDataSize(plotDataSize),
+    m_plotSeries(new PlotSeriesData()),
     m_object(object), m_field(field), m_element(element),
     m_plotCurve(NULL), m_isVisible(true), m_pen(pen), m_isEnumPlot(false)
 {
@@ -62,7 +267,7 @@ PlotData::PlotData(UAVObject *object, UAVObjectField *field, int element,
     }
 
     m_plotCurve->setPen(m_pen);
-    m_plotCurve->setSamples(m_xDataEntries, m_yDataEntries);
+    m_plotCurve->setData(m_plotSeries);
     m_isEnumPlot = m_field->getType() == UAVObjectField::ENUM;
 }
 
@@ -90,7 +295,10 @@ void PlotData::setVisible(bool visible)
 
 void PlotData::updatePlotData()
 {
-    m_plotCurve->setSamples(m_xDataEntries, m_yDataEntries);
+    QwtPlot *plot = m_plotCurve->plot();
+
+    m_plotSeries->update(m_plotDataSize, plot ? plot->canvas()->width() : 0);
+    m_plotCurve->itemChanged();
 }
 
 void PlotData::clear()
@@ -98,8 +306,7 @@ void PlotData::clear()
     m_meanSum = 0.0f;
     m_correctionSum   = 0.0f;
     m_correctionCount = 0;
-    m_xDataEntries.clear();
-    m_yDataEntries.clear();
+    m_plotSeries->clear();
     while (!m_enumMarkerList.isEmpty()) {
         QwtPlotMarker *marker = m_enumMarkerList.takeFirst();
         marker->detach();
@@ -113,7 +320,7 @@ void PlotData::clear()
 bool PlotData::hasData() const
 {
     if (!m_isEnumPlot) {
-        return !m_xDataEntries.isEmpty();
+        return m_plotSeries->count() > 0;
     } else {
         return !m_enumMarkerList.isEmpty();
     }
@@ -122,7 +329,7 @@ bool PlotData::hasData() const
 QString PlotData::lastDataAsString()
 {
     if (!m_isEnumPlot) {
-        return QString().sprintf("%3.10g", m_yDataEntries.last());
+        return QString().sprintf("%3.10g", m_plotSeries->lastY());
     } else {
         return m_enumMarkerList.last()->title().text();
     }
@@ -142,7 +349,7 @@ void PlotData::visibilityChanged(QwtPlotItem *item)
     }
 }
 
-void PlotData::calcMathFunction(double currentValue)
+double PlotData::calcMathFunction(double currentValue)
 {
     // Put the new value at the back
     m_yDataHistory.append(currentValue);
@@ -169,10 +376,9 @@ void PlotData::calcMathFunction(double currentValue)
         for (int i = 0; i < m_yDataHistory.size(); i++) {
             stdSum += pow(m_yDataHistory.at(i) - boxcarAvg, 2) / (m_meanSamples - 1);
         }
-        m_yDataEntries.append(sqrt(stdSum));
-    } else {
-        m_yDataEntries.append(boxcarAvg);
+        return sqrt(stdSum);
     }
+    return boxcarAvg;
 }
 
 QwtPlotMarker *PlotData::createMarker(QString value)
@@ -211,18 +417,11 @@ bool SequentialPlotData::append(UAVObject *obj)
 
             // Perform scope math, if necessary
             if (m_mathFunction == "Boxcar average" || m_mathFunction == "Standard deviation") {
-                calcMathFunction(currentValue);
-            } else {
-                m_yDataEntries.append(currentValue);
+                currentValue = calcMathFunction(currentValue);
             }
 
-            if (m_yDataEntries.size() > m_plotDataSize) {
-                // If new data overflows the window, remove old data...
-                m_yDataEntries.pop_front();
-            } else {
-                // ...otherwise, add a new y point at position xData
-                m_xDataEntries.insert(m_xDataEntries.size(), m_xDataEntries.size());
-            }
+            // The buffer holds the window, new data overwrites the oldest
+            m_plotSeries->append(m_plotSeries->appended(), currentValue);
             return true;
         } else {
             // Enum markers
@@ -260,12 +459,10 @@ bool ChronoPlotData::append(UAVObject *obj)
 
             // Perform scope math, if necessary
             if (m_mathFunction == "Boxcar average" || m_mathFunction == "Standard deviation") {
-                calcMathFunction(currentValue);
-            } else {
-                m_yDataEntries.append(currentValue);
+                currentValue = calcMathFunction(currentValue);
             }
 
-            m_xDataEntries.append(xValue);
+            m_plotSeries->append(xValue, currentValue);
         } else {
             // Enum markers
             QString value = m_field->getValue(m_element).toString();
@@ -289,11 +486,7 @@ bool ChronoPlotData::append(UAVObject *obj)
 
 void ChronoPlotData::removeStaleData()
 {
-    while (!m_xDataEntries.isEmpty() &&
-           (m_xDataEntries.last() - m_xDataEntries.first()) > m_plotDataSize) {
-        m_yDataEntries.pop_front();
-        m_xDataEntries.pop_front();
-    }
+    m_plotSeries->removeOlderThan(m_plotDataSize);
     while (!m_enumMarkerList.isEmpty() &&
            (m_enumMarkerList.last()->xValue() - m_enumMarkerList.first()->xValue()) > m_plotDataSize) {
         QwtPlotMarker *marker = m_enumMarkerList.takeFirst();
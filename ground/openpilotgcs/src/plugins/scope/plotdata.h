@@ -35,6 +35,7 @@
 #include "qwt/src/qwt_plot_curve.h"
 #include "qwt/src/qwt_scale_draw.h"
 #include "qwt/src/qwt_scale_widget.h"
+#include "qwt/src/qwt_series_data.h"
 #include <qwt/src/qwt_plot_marker.h>
 
 #include <QTimer>
@@ -47,6 +48,77 @@
  */
 enum PlotType { SequentialPlot, ChronoPlot };
 
+/*!
+   \brief Ring buffer with the samples of one curve, read by Qwt in place.
+   Once it holds more than two samples per pixel of plot width, only the
+   minimum and maximum of each pixel column are drawn. The columns are kept
+   between updates so an update only folds in the new samples.
+ */
+class PlotSeriesData : public QwtSeriesData<QPointF> {
+public:
+    PlotSeriesData();
+
+    void setCapacity(int capacity, bool growable);
+    void setRelativeX(bool relative)
+    {
+        m_relativeX = relative;
+    }
+
+    void append(double x, double y);
+    void removeOlderThan(double window);
+    void clear();
+
+    int count() const
+    {
+        return m_count;
+    }
+    qint64 appended() const
+    {
+        return m_appended;
+    }
+    double lastY() const
+    {
+        return m_y.at(index(m_count - 1));
+    }
+
+    void update(double window, int pixels);
+
+    size_t size() const;
+    QPointF sample(size_t i) const;
+    QRectF boundingRect() const;
+
+private:
+    struct Column {
+        qint64 index;
+        double minX;
+        double minY;
+        double maxX;
+        double maxY;
+    };
+
+    QVector<double> m_x;
+    QVector<double> m_y;
+    int m_first;
+    int m_count;
+    qint64 m_appended;
+    bool m_growable;
+    bool m_relativeX;
+    double m_xOffset;
+
+    bool m_decimated;
+    double m_columnWidth;
+    qint64 m_folded;
+    QVector<Column> m_columns;
+    QVector<QPointF> m_points;
+
+    int index(int i) const
+    {
+        return (m_first + i) % m_x.size();
+    }
+    void fold(double x, double y);
+    void refoldFirstColumn();
+};
+
 /*!
    \brief Base class that keeps the data for each curve in the plot.
  */
@@ -113,8 +185,8 @@ protected:
     int m_correctionCount;
     double m_plotDataSize;
 
-    QVector<double> m_xDataEntries;
-    QVector<double> m_yDataEntries;
+    // Owned by m_plotCurve
+    PlotSeriesData *m_plotSeries;
     QVector<double> m_yDataHistory;
 
     UAVObject *m_object;
@@ -127,7 +199,7 @@ protected:
     bool m_isVisible;
     QPen m_pen;
     bool m_isEnumPlot;
-    virtual void calcMathFunction(double currentValue);
+    virtual double calcMathFunction(double currentValue);
     QwtPlotMarker *createMarker(QString value);
 };
 
@@ -142,7 +214,11 @@ public:
                        int scaleFactor, int meanSamples, QString mathFunction,
                        double plotDataSize, QPen pen, bool antialiased)
         : PlotData(object, field, element, scaleFactor, meanSamples,
-                   mathFunction, plotDataSize, pen, antialiased) {}
+                   mathFunction, plotDataSize, pen, antialiased)
+    {
+        m_plotSeries->setCapacity(qMax(1, (int)plotDataSize), false);
+        m_plotSeries->setRelativeX(true);
+    }
     ~SequentialPlotData() {}
 
     bool append(UAVObject *obj);
@@ -26,6 +26,8 @@
  */
 
 #include "systemalarms.h"
+#include "callbackinfo.h"
+#include "callbacktiming.h"
 #include "systemhealthgadgetwidget.h"
 
 #include "utils/stylehelper.h"
@@ -65,7 +67,8 @@ SystemHealthGadgetWidget::SystemHealthGadgetWidget(QWidget *parent) : QGraphicsV
     connect(telMngr, SIGNAL(connected()), this, SLOT(onAutopilotConnect()));
     connect(telMngr, SIGNAL(disconnected()), this, SLOT(onAutopilotDisconnect()));
 
-    setToolTip(tr("Displays flight system errors. Click on an alarm for more information."));
+    setToolTip(tr("Displays flight system errors. Click on an alarm for more information, "
+                  "click elsewhere for all alarms and the callback timing."));
 }
 
 /**
@@ -286,9 +289,68 @@ void SystemHealthGadgetWidget::showAllAlarmDescriptions(const QPoint & location)
             }
         }
 
+        alarmsText.append(callbackTimingReport());
+
         // Show alarms text if we have any
         if (alarmsText.length() > 0) {
             QWhatsThis::showText(location, alarmsText);
         }
     }
 }
+
+static bool worseExecTime(const QPair<QString, CallbackTiming::DataFields> & a, const QPair<QString, CallbackTiming::DataFields> & b)
+{
+    return a.second.ExecTimeMax > b.second.ExecTimeMax;
+}
+
+/**
+ * Table of the callback scheduler timing reported by the flight side, worst execution time first.
+ * Times above 1 ms (the upper histogram buckets) are what eats into the control loop margin.
+ */
+QString SystemHealthGadgetWidget::callbackTimingReport()
+{
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+    CallbackInfo *callbackInfo   = CallbackInfo::GetInstance(objManager);
+
+    if (!callbackInfo) {
+        return QString();
+    }
+    QStringList names = callbackInfo->getField("RunningTime")->getElementNames();
+    QList<QPair<QString, CallbackTiming::DataFields> > timings;
+    for (int instId = 0; instId < objManager->getNumInstances(CallbackTiming::OBJID); ++instId) {
+        CallbackTiming *timing = CallbackTiming::GetInstance(objManager, instId);
+        if (timing) {
+            QString name = instId < names.count() ? names.at(instId) : QString::number(instId);
+            timings.append(qMakePair(name, timing->getData()));
+        }
+    }
+    qSort(timings.begin(), timings.end(), worseExecTime);
+
+    // Buckets from 1024 us up
+    const quint32 slowBucket = 5;
+    QString rows;
+    for (int i = 0; i < timings.count(); ++i) {
+        const CallbackTiming::DataFields & data = timings.at(i).second;
+        quint32 runs = 0, slowRuns = 0, lateRuns = 0;
+        for (quint32 bucket = 0; bucket < CallbackTiming::EXECTIME_NUMELEM; ++bucket) {
+            runs += data.ExecTime[bucket];
+            if (bucket >= slowBucket) {
+                slowRuns += data.ExecTime[bucket];
+                lateRuns += data.Latency[bucket];
+            }
+        }
+        if (runs == 0) {
+            continue;
+        }
+        rows.append(QString("<tr><td>%1</td><td align=\"right\">%2</td><td align=\"right\">%3</td><td align=\"right\">%4</td>"
+                            "<td align=\"right\">%5</td><td align=\"right\">%6</td></tr>")
+                    .arg(timings.at(i).first).arg(runs).arg(data.ExecTimeMax).arg(slowRuns).arg(data.LatencyMax).arg(lateRuns));
+    }
+    if (rows.isEmpty()) {
+        return QString();
+    }
+    return tr("<h3>Callback timing</h3><table cellspacing=\"4\">"
+              "<tr><th>Callback</th><th>Runs</th><th>Worst run (us)</th><th>Runs &gt; 1 ms</th>"
+              "<th>Worst latency (us)</th><th>Latencies &gt; 1 ms</th></tr>") + rows + "</table>";
+}
@@ -70,5 +70,6 @@ private:
 
     void showAlarmDescriptionForItemId(const QString itemId, const QPoint & location);
     void showAllAlarmDescriptions(const QPoint &location);
+    QString callbackTimingReport();
 };
 #endif /* SYSTEMHEALTHGADGETWIDGET_H_ */
@@ -95,6 +95,7 @@ private slots:
     void updateHighlight(TreeItem *item);
     void updateIsKnown(TreeItem *item);
     void highlightUpdatedObject(UAVObject *obj);
+    void highlightUpdatedObjects(const QList<UAVObject *> &objects);
     void isKnownChanged(UAVObject *object, bool isKnown);
 
 private:
@@ -0,0 +1,341 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_uavobjectfield.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2015.
+ * @brief      Tests and benchmarks of the UAVObjectField accessors and packing
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "uavdataobject.h"
+#include "uavobjectfield.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QThreadPool>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QtEndian>
+#include <QtTest/QtTest>
+
+// As large as the biggest objects of the GCS
+#define NUM_FIELDS 100
+
+/**
+ * Object with NUM_FIELDS fields of all the numeric types, every fifth one an array.
+ */
+class TestObject : public UAVDataObject {
+public:
+    TestObject() : UAVDataObject(0x1000, true, false, QString("TestObject"))
+    {
+        static const UAVObjectField::FieldType types[] = {
+            UAVObjectField::INT8,   UAVObjectField::INT16,  UAVObjectField::INT32,   UAVObjectField::UINT8,
+            UAVObjectField::UINT16, UAVObjectField::UINT32, UAVObjectField::FLOAT32, UAVObjectField::ENUM
+        };
+        QList<UAVObjectField *> fields;
+        quint32 size = 0;
+
+        for (int n = 0; n < NUM_FIELDS; ++n) {
+            UAVObjectField::FieldType type = types[n % 8];
+            QStringList options;
+            if (type == UAVObjectField::ENUM) {
+                options << "Zero" << "One" << "Two" << "Three";
+            }
+            fields.append(new UAVObjectField(QString("Field%1").arg(n), QString(""), QString(""), type,
+                                             (n % 5 == 0) ? 4 : 1, options));
+            size += fields.last()->getNumBytes();
+        }
+        buffer.fill(0, size);
+        initializeFields(fields, (quint8 *)buffer.data(), size);
+    }
+
+    Metadata getDefaultMetadata()
+    {
+        Metadata metadata;
+
+        memset(&metadata, 0, sizeof(metadata));
+        return metadata;
+    }
+
+    UAVDataObject *clone(quint32 instID)
+    {
+        Q_UNUSED(instID);
+        return new TestObject();
+    }
+
+    UAVDataObject *dirtyClone()
+    {
+        return new TestObject();
+    }
+
+private:
+    QByteArray buffer;
+};
+
+/**
+ * Unpacks packets with all their bytes set to the same value until told to stop.
+ */
+class WriterTask : public QRunnable {
+public:
+    WriterTask(UAVObject *obj, QAtomicInt *stop) : m_obj(obj), m_stop(stop)
+    {}
+
+    void run()
+    {
+        QByteArray packet(m_obj->getNumBytes(), 0);
+
+        for (quint8 value = 0; m_stop->load() == 0; ++value) {
+            packet.fill(value);
+            m_obj->unpack((const quint8 *)packet.constData());
+        }
+    }
+
+private:
+    UAVObject *m_obj;
+    QAtomicInt *m_stop;
+};
+
+class tst_UAVObjectField : public QObject {
+    Q_OBJECT
+
+public:
+    tst_UAVObjectField() : obj(NULL) {}
+
+private slots:
+    void init();
+    void cleanup();
+
+    void typedMatchesVariant();
+    void copyTo();
+    void versions();
+    void consistentSnapshots();
+    void packUnpack();
+
+    void benchmarkVariant();
+    void benchmarkGetDouble();
+    void benchmarkTyped();
+    void benchmarkCopyTo();
+    void benchmarkUnpack();
+
+private:
+    TestObject *obj;
+};
+
+void tst_UAVObjectField::init()
+{
+    obj = new TestObject();
+    // Values that fit all the types, enums in the range of their options
+    int value = 0;
+    foreach(UAVObjectField * field, obj->getFields()) {
+        for (quint32 index = 0; index < field->getNumElements(); ++index, ++value) {
+            if (field->getType() == UAVObjectField::ENUM) {
+                field->setValue(field->getOptions().at(value % 4), index);
+            } else {
+                field->setDouble(value % 100 + (field->getType() == UAVObjectField::FLOAT32 ? 0.5 : 0), index);
+            }
+        }
+    }
+}
+
+void tst_UAVObjectField::cleanup()
+{
+    delete obj;
+    obj = NULL;
+}
+
+void tst_UAVObjectField::typedMatchesVariant()
+{
+    foreach(UAVObjectField * field, obj->getFields()) {
+        for (quint32 index = 0; index < field->getNumElements(); ++index) {
+            if (field->getType() == UAVObjectField::ENUM) {
+                QCOMPARE(field->value<int>(index), field->getOptions().indexOf(field->getValue(index).toString()));
+            } else {
+                QCOMPARE(field->value<double>(index), field->getValue(index).toDouble());
+                QCOMPARE(field->getDouble(index), field->getValue(index).toDouble());
+                QCOMPARE(field->value<int>(index), (int)field->getValue(index).toDouble());
+            }
+        }
+        QCOMPARE(field->value<double>(field->getNumElements()), 0.0);
+    }
+}
+
+void tst_UAVObjectField::copyTo()
+{
+    double values[8];
+
+    foreach(UAVObjectField * field, obj->getFields()) {
+        QCOMPARE(field->copyTo(values, 8), field->getNumElements());
+        for (quint32 index = 0; index < field->getNumElements(); ++index) {
+            QCOMPARE(values[index], field->value<double>(index));
+        }
+        QCOMPARE(field->copyTo(values, 1), (quint32)1);
+    }
+}
+
+void tst_UAVObjectField::versions()
+{
+    QByteArray packet(obj->getNumBytes(), 0);
+    quint32 version = obj->getVersion();
+    UAVObjectField *field = obj->getFields().at(1);
+
+    field->value<double>();
+    field->getValue();
+    QCOMPARE(obj->getVersion(), version);
+
+    obj->unpack((const quint8 *)packet.constData());
+    QCOMPARE(obj->getVersion(), version + 1);
+
+    field->setDouble(42);
+    QCOMPARE(obj->getVersion(), version + 2);
+    QCOMPARE(field->value<int>(), 42);
+}
+
+void tst_UAVObjectField::consistentSnapshots()
+{
+    QThreadPool pool;
+    QAtomicInt stop(0);
+    QByteArray snapshot(obj->getNumBytes(), 0);
+    QElapsedTimer timer;
+    int torn = 0;
+    int reads = 0;
+
+    pool.start(new WriterTask(obj, &stop));
+    timer.start();
+    while (timer.elapsed() < 1000) {
+        obj->readData((quint8 *)snapshot.data(), 0, snapshot.size());
+        for (int n = 1; n < snapshot.size(); ++n) {
+            if (snapshot.at(n) != snapshot.at(0)) {
+                torn++;
+                break;
+            }
+        }
+        reads++;
+    }
+    stop.store(1);
+    pool.waitForDone();
+
+    qDebug() << reads << "snapshots," << obj->getVersion() << "writes";
+    QCOMPARE(torn, 0);
+}
+
+void tst_UAVObjectField::packUnpack()
+{
+    QByteArray packet(obj->getNumBytes(), 0);
+    QByteArray fieldPacket(obj->getNumBytes(), 0);
+    UAVObjectField *int32Field = obj->getFields().at(2);
+    UAVObjectField *floatField = obj->getFields().at(6);
+
+    int32Field->setValue(-2, 0);
+    floatField->setValue(1.5f, 0);
+    QCOMPARE(obj->pack((quint8 *)packet.data()), (qint32)obj->getNumBytes());
+
+    // The object is packed as its fields one after the other, in little endian
+    quint32 offset = 0;
+    foreach(UAVObjectField * field, obj->getFields()) {
+        QCOMPARE(field->pack((quint8 *)fieldPacket.data() + offset), (qint32)field->getNumBytes());
+        offset += field->getNumBytes();
+    }
+    QCOMPARE(offset, obj->getNumBytes());
+    QVERIFY(packet == fieldPacket);
+    QCOMPARE(qFromLittleEndian<qint32>((const uchar *)packet.constData() + int32Field->getDataOffset()), -2);
+    QCOMPARE(qFromLittleEndian<quint32>((const uchar *)packet.constData() + floatField->getDataOffset()), (quint32)0x3FC00000);
+
+    TestObject copy;
+    QCOMPARE(copy.unpack((const quint8 *)packet.constData()), (qint32)obj->getNumBytes());
+    for (int n = 0; n < NUM_FIELDS; ++n) {
+        UAVObjectField *field = obj->getFields().at(n);
+        for (quint32 index = 0; index < field->getNumElements(); ++index) {
+            QCOMPARE(copy.getFields().at(n)->value<double>(index), field->value<double>(index));
+        }
+    }
+}
+
+void tst_UAVObjectField::benchmarkVariant()
+{
+    QList<UAVObjectField *> fields = obj->getFields();
+    double sum = 0;
+
+    QBENCHMARK {
+        foreach(UAVObjectField * field, fields) {
+            for (quint32 index = 0; index < field->getNumElements(); ++index) {
+                sum += field->getValue(index).toDouble();
+            }
+        }
+    }
+    QVERIFY(sum != 0);
+}
+
+void tst_UAVObjectField::benchmarkGetDouble()
+{
+    QList<UAVObjectField *> fields = obj->getFields();
+    double sum = 0;
+
+    QBENCHMARK {
+        foreach(UAVObjectField * field, fields) {
+            for (quint32 index = 0; index < field->getNumElements(); ++index) {
+                sum += field->getDouble(index);
+            }
+        }
+    }
+    QVERIFY(sum != 0);
+}
+
+void tst_UAVObjectField::benchmarkTyped()
+{
+    QList<UAVObjectField *> fields = obj->getFields();
+    double sum = 0;
+
+    QBENCHMARK {
+        foreach(UAVObjectField * field, fields) {
+            for (quint32 index = 0; index < field->getNumElements(); ++index) {
+                sum += field->value<double>(index);
+            }
+        }
+    }
+    QVERIFY(sum != 0);
+}
+
+void tst_UAVObjectField::benchmarkCopyTo()
+{
+    QList<UAVObjectField *> fields = obj->getFields();
+    double values[4];
+    double sum = 0;
+
+    QBENCHMARK {
+        foreach(UAVObjectField * field, fields) {
+            quint32 count = field->copyTo(values, 4);
+            for (quint32 index = 0; index < count; ++index) {
+                sum += values[index];
+            }
+        }
+    }
+    QVERIFY(sum != 0);
+}
+
+void tst_UAVObjectField::benchmarkUnpack()
+{
+    QByteArray packet(obj->getNumBytes(), 0);
+
+    obj->pack((quint8 *)packet.data());
+    QBENCHMARK {
+        obj->unpack((const quint8 *)packet.constData());
+    }
+}
+
+QTEST_MAIN(tst_UAVObjectField)
+
+#include "tst_uavobjectfield.moc"
@@ -0,0 +1,332 @@
+/**
+ ******************************************************************************
+ *
+ * @file       tst_uavobjectmanager.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2015.
+ * @brief      Lookup tests and benchmarks of the UAVObjectManager
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "uavobjectmanager.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QThreadPool>
+#include <QtCore/QAtomicInt>
+#include <QtTest/QtTest>
+
+// About as many object types as the GCS registers
+#define NUM_OBJECTS   150
+#define NUM_INSTANCES 8
+#define MULTI_OBJID   0x1000
+
+class TestObject : public UAVDataObject {
+public:
+    TestObject(quint32 objId, const QString &name, bool isSingleInst) :
+        UAVDataObject(objId, isSingleInst, false, name), m_isSingleInst(isSingleInst), value(0)
+    {
+        QList<UAVObjectField *> fields;
+        fields.append(new UAVObjectField(QString("Value"), QString(""), QString(""), UAVObjectField::FLOAT32, 1, QStringList()));
+        initializeFields(fields, (quint8 *)&value, sizeof(value));
+    }
+
+    Metadata getDefaultMetadata()
+    {
+        Metadata metadata;
+
+        memset(&metadata, 0, sizeof(metadata));
+        return metadata;
+    }
+
+    UAVDataObject *clone(quint32 instID)
+    {
+        TestObject *obj = new TestObject(getObjID(), getName(), m_isSingleInst);
+
+        obj->initialize(instID, getMetaObject());
+        return obj;
+    }
+
+    UAVDataObject *dirtyClone()
+    {
+        return new TestObject(getObjID(), getName(), m_isSingleInst);
+    }
+
+private:
+    bool m_isSingleInst;
+    float value;
+};
+
+/**
+ * Looks objects up from a worker thread until told to stop.
+ */
+class LookupTask : public QRunnable {
+public:
+    LookupTask(UAVObjectManager *objMngr, QAtomicInt *stop, QAtomicInt *lookups) :
+        m_objMngr(objMngr), m_stop(stop), m_lookups(lookups)
+    {}
+
+    void run()
+    {
+        int count = 0;
+
+        while (m_stop->load() == 0) {
+            for (quint32 n = 0; n < NUM_OBJECTS; ++n) {
+                if (m_objMngr->getObject(2 * n) != NULL) {
+                    count++;
+                }
+            }
+        }
+        m_lookups->fetchAndAddRelaxed(count);
+    }
+
+private:
+    UAVObjectManager *m_objMngr;
+    QAtomicInt *m_stop;
+    QAtomicInt *m_lookups;
+};
+
+class tst_UAVObjectManager : public QObject {
+    Q_OBJECT
+
+public:
+    tst_UAVObjectManager() : objMngr(NULL) {}
+
+private slots:
+    void init();
+    void cleanup();
+
+    void lookupById();
+    void lookupByName();
+    void lookupInstances();
+    void instanceGaps();
+    void lookupFromSignals();
+    void batchedUpdates();
+
+    void benchmarkLookupById();
+    void benchmarkLookupByName();
+    void benchmarkLookupInstance();
+    void benchmarkConcurrentLookups();
+
+public slots:
+    void objectAdded(UAVObject *obj);
+    void objectsUpdated(const QList<UAVObject *> &objects);
+
+private:
+    UAVObjectManager *objMngr;
+    QList<UAVObject *> found;
+    QList<QList<UAVObject *> > batches;
+};
+
+void tst_UAVObjectManager::init()
+{
+    objMngr = new UAVObjectManager();
+    // Even IDs, the odd ones are taken by the metaobjects
+    for (quint32 n = 0; n < NUM_OBJECTS; ++n) {
+        QVERIFY(objMngr->registerObject(new TestObject(2 * n, QString("Object%1").arg(n), true)));
+    }
+    for (quint32 n = 0; n < NUM_INSTANCES; ++n) {
+        QVERIFY(objMngr->registerObject(new TestObject(MULTI_OBJID, QString("MultiObject"), false)));
+    }
+    found.clear();
+    batches.clear();
+}
+
+void tst_UAVObjectManager::cleanup()
+{
+    // Objects belong to the application, as in the GCS they live until exit
+    delete objMngr;
+    objMngr = NULL;
+}
+
+void tst_UAVObjectManager::lookupById()
+{
+    for (quint32 n = 0; n < NUM_OBJECTS; ++n) {
+        UAVObject *obj = objMngr->getObject(2 * n);
+        QVERIFY(obj != NULL);
+        QCOMPARE(obj->getObjID(), 2 * n);
+        QCOMPARE(obj->getName(), QString("Object%1").arg(n));
+
+        UAVObject *meta = objMngr->getObject(2 * n + 1);
+        QVERIFY(meta != NULL);
+        QVERIFY(meta->isMetaDataObject());
+    }
+    QVERIFY(objMngr->getObject(2 * NUM_OBJECTS) == NULL);
+    QVERIFY(objMngr->getObject(0, 1) == NULL);
+}
+
+void tst_UAVObjectManager::lookupByName()
+{
+    for (quint32 n = 0; n < NUM_OBJECTS; ++n) {
+        UAVObject *obj = objMngr->getObject(QString("Object%1").arg(n));
+        QVERIFY(obj != NULL);
+        QCOMPARE(obj->getObjID(), 2 * n);
+        QVERIFY(objMngr->getObject(QString("Object%1Meta").arg(n)) == objMngr->getObject(2 * n + 1));
+    }
+    QVERIFY(objMngr->getObject(QString("object1")) == NULL);
+}
+
+void tst_UAVObjectManager::lookupInstances()
+{
+    QCOMPARE(objMngr->getNumInstances(MULTI_OBJID), NUM_INSTANCES);
+    QCOMPARE(objMngr->getNumInstances(QString("MultiObject")), NUM_INSTANCES);
+    QCOMPARE(objMngr->getNumInstances(2 * NUM_OBJECTS), -1);
+
+    QList<UAVObject *> instances = objMngr->getObjectInstances(MULTI_OBJID);
+    QCOMPARE(instances.length(), NUM_INSTANCES);
+    for (quint32 n = 0; n < NUM_INSTANCES; ++n) {
+        QCOMPARE(instances.at(n)->getInstID(), n);
+        QVERIFY(objMngr->getObject(MULTI_OBJID, n) == instances.at(n));
+    }
+    QVERIFY(objMngr->getObject(MULTI_OBJID, NUM_INSTANCES) == NULL);
+
+    // Single instance objects take no more instances
+    QVERIFY(!objMngr->registerObject(new TestObject(0, QString("Object0"), true)));
+}
+
+void tst_UAVObjectManager::instanceGaps()
+{
+    UAVDataObject *obj = dynamic_cast<UAVDataObject *>(objMngr->getObject(MULTI_OBJID));
+
+    QVERIFY(objMngr->registerObject(obj->clone(NUM_INSTANCES + 3)));
+    QCOMPARE(objMngr->getNumInstances(MULTI_OBJID), NUM_INSTANCES + 4);
+    for (quint32 n = 0; n < NUM_INSTANCES + 4; ++n) {
+        QVERIFY(objMngr->getObject(MULTI_OBJID, n) != NULL);
+        QCOMPARE(objMngr->getObject(MULTI_OBJID, n)->getInstID(), n);
+    }
+    // Instance conflict
+    QVERIFY(!objMngr->registerObject(obj->clone(2)));
+}
+
+void tst_UAVObjectManager::objectAdded(UAVObject *obj)
+{
+    // Receivers look objects up as soon as they are told about them
+    found.append(objMngr->getObject(obj->getObjID(), obj->getInstID()));
+}
+
+void tst_UAVObjectManager::lookupFromSignals()
+{
+    connect(objMngr, SIGNAL(newObject(UAVObject *)), this, SLOT(objectAdded(UAVObject *)), Qt::DirectConnection);
+    connect(objMngr, SIGNAL(newInstance(UAVObject *)), this, SLOT(objectAdded(UAVObject *)), Qt::DirectConnection);
+
+    UAVDataObject *obj = new TestObject(2 * NUM_OBJECTS, QString("NewObject"), false);
+    QVERIFY(objMngr->registerObject(obj));
+    QVERIFY(objMngr->registerObject(obj->clone(1)));
+
+    QCOMPARE(found.length(), 3);
+    QVERIFY(found.at(0) == obj);
+    QVERIFY(found.at(1) == obj->getMetaObject());
+    QVERIFY(found.at(2) == objMngr->getObject(2 * NUM_OBJECTS, 1));
+}
+
+void tst_UAVObjectManager::objectsUpdated(const QList<UAVObject *> &objects)
+{
+    batches.append(objects);
+}
+
+void tst_UAVObjectManager::batchedUpdates()
+{
+    UAVObject *obj = objMngr->getObject(0);
+    UAVObject *instance = objMngr->getObject(MULTI_OBJID, 1);
+
+    // Nothing is queued until someone listens
+    obj->updated();
+    QTest::qWait(100);
+
+    connect(objMngr, SIGNAL(objectsUpdated(QList<UAVObject *>)), this, SLOT(objectsUpdated(QList<UAVObject *>)));
+    objMngr->setBatchInterval(20);
+    for (int n = 0; n < 100; ++n) {
+        obj->updated();
+        instance->updated();
+    }
+    QTRY_COMPARE(batches.length(), 1);
+    QCOMPARE(batches.at(0).length(), 2);
+    QVERIFY(batches.at(0).at(0) == obj);
+    QVERIFY(batches.at(0).at(1) == instance);
+
+    instance->updated();
+    QTRY_COMPARE(batches.length(), 2);
+    QCOMPARE(batches.at(1).length(), 1);
+    QVERIFY(batches.at(1).at(0) == instance);
+}
+
+void tst_UAVObjectManager::benchmarkLookupById()
+{
+    UAVObject *obj = NULL;
+
+    QBENCHMARK {
+        for (quint32 n = 0; n < NUM_OBJECTS; ++n) {
+            obj = objMngr->getObject(2 * n);
+        }
+    }
+    QVERIFY(obj != NULL);
+}
+
+void tst_UAVObjectManager::benchmarkLookupByName()
+{
+    QStringList names;
+    UAVObject *obj = NULL;
+
+    for (quint32 n = 0; n < NUM_OBJECTS; ++n) {
+        names.append(QString("Object%1").arg(n));
+    }
+    QBENCHMARK {
+        foreach(const QString &name, names) {
+            obj = objMngr->getObject(name);
+        }
+    }
+    QVERIFY(obj != NULL);
+}
+
+void tst_UAVObjectManager::benchmarkLookupInstance()
+{
+    UAVObject *obj = NULL;
+
+    QBENCHMARK {
+        for (quint32 n = 0; n < NUM_INSTANCES; ++n) {
+            obj = objMngr->getObject(MULTI_OBJID, n);
+        }
+    }
+    QVERIFY(obj != NULL);
+}
+
+void tst_UAVObjectManager::benchmarkConcurrentLookups()
+{
+    int threads = qMax(2, QThread::idealThreadCount());
+    QThreadPool pool;
+    QAtomicInt stop(0);
+    QAtomicInt lookups(0);
+    QElapsedTimer timer;
+
+    pool.setMaxThreadCount(threads);
+    timer.start();
+    for (int n = 0; n < threads; ++n) {
+        pool.start(new LookupTask(objMngr, &stop, &lookups));
+    }
+    QTest::qSleep(1000);
+    stop.store(1);
+    pool.waitForDone();
+
+    qint64 rate = (qint64)lookups.load() * 1000 / qMax((qint64)1, timer.elapsed());
+    qDebug() << threads << "threads:" << rate << "lookups per second";
+    QVERIFY(lookups.load() > 0);
+}
+
+QTEST_MAIN(tst_UAVObjectManager)
+
+#include "tst_uavobjectmanager.moc"
@@ -0,0 +1,15 @@
+QT += testlib
+TEMPLATE = app
+TARGET = tst_uavobjectmanager
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../../../../../openpilotgcs.pri)
+include(../../uavobjects.pri)
+
+LIBS += -L$$GCS_PLUGIN_PATH/OpenPilot
+linux-* {
+    QMAKE_RPATHDIR += $$GCS_PLUGIN_PATH/OpenPilot $$GCS_LIBRARY_PATH
+}
+
+SOURCES += tst_uavobjectmanager.cpp
@@ -93,7 +93,9 @@ void UAVMetaObject::setData(const Metadata & mdata)
 {
     QMutexLocker locker(mutex);
 
+    beginWrite();
     parentMetadata = mdata;
+    endWrite();
     emit objectUpdatedAuto(this); // trigger object updated event
     emit objectUpdated(this);
 }
@@ -63,7 +63,9 @@ UAVObject::UAVObject(quint32 objID, bool isSingleInst, const QString & name)
     this->data         = 0;
     this->numBytes     = 0;
     this->mutex        = new QMutex(QMutex::Recursive);
-    m_isKnown = false;
+    m_isKnown      = false;
+    writeDepth     = 0;
+    m_isWireLayout = false;
 }
 
 /**
@@ -96,6 +98,12 @@ void UAVObject::initializeFields(QList<UAVObjectField *> & fields, quint8 *data,
         offset += fields[n]->getNumBytes();
         connect(fields[n], SIGNAL(fieldUpdated(UAVObjectField *)), this, SLOT(fieldUpdated(UAVObjectField *)));
     }
+    // Fields are little endian on the wire and packed one after the other
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    m_isWireLayout = (offset == numBytes);
+#else
+    m_isWireLayout = false;
+#endif
 }
 
 /**
@@ -253,6 +261,59 @@ QMutex *UAVObject::getMutex()
     return mutex;
 }
 
+/**
+ * Get the version of the object data, it changes every time the data is written
+ */
+quint32 UAVObject::getVersion() const
+{
+    return (quint32)dataVersion.loadAcquire() / 2;
+}
+
+/**
+ * Copy part of the object data without taking the mutex. The copy is retried
+ * if a writer got in meanwhile, so it never mixes two versions of the data.
+ * Falls back to the mutex if the object keeps being written.
+ * @param dataOut Destination, length bytes
+ * @param offset Offset of the first byte in the object data
+ */
+void UAVObject::readData(quint8 *dataOut, quint32 offset, quint32 length) const
+{
+    for (int retry = 0; retry < MAX_READ_RETRIES; ++retry) {
+        int version = dataVersion.loadAcquire();
+        if (version & 1) {
+            continue;
+        }
+        memcpy(dataOut, &data[offset], length);
+        // Ordered so that the copy completes before the version is checked again
+        if (dataVersion.fetchAndAddOrdered(0) == version) {
+            return;
+        }
+    }
+    QMutexLocker locker(mutex);
+    memcpy(dataOut, &data[offset], length);
+}
+
+/**
+ * Mark the start of a write to the object data, with the mutex held.
+ * Writes may nest, the version only changes for the outermost one.
+ */
+void UAVObject::beginWrite()
+{
+    if (writeDepth++ == 0) {
+        dataVersion.fetchAndAddOrdered(1);
+    }
+}
+
+/**
+ * Mark the end of a write started with beginWrite()
+ */
+void UAVObject::endWrite()
+{
+    if (--writeDepth == 0) {
+        dataVersion.fetchAndAddOrdered(1);
+    }
+}
+
 /**
  * Get the number of fields held by this object
  */
@@ -302,6 +363,10 @@ qint32 UAVObject::pack(quint8 *dataOut)
     QMutexLocker locker(mutex);
     qint32 offset = 0;
 
+    if (m_isWireLayout) {
+        memcpy(dataOut, data, numBytes);
+        return numBytes;
+    }
     for (int n = 0; n < fields.length(); ++n) {
         fields[n]->pack(&dataOut[offset]);
         offset += fields[n]->getNumBytes();
@@ -318,10 +383,16 @@ qint32 UAVObject::unpack(const quint8 *dataIn)
     QMutexLocker locker(mutex);
     qint32 offset = 0;
 
-    for (int n = 0; n < fields.length(); ++n) {
-        fields[n]->unpack(&dataIn[offset]);
-        offset += fields[n]->getNumBytes();
+    beginWrite();
+    if (m_isWireLayout) {
+        memcpy(data, dataIn, numBytes);
+    } else {
+        for (int n = 0; n < fields.length(); ++n) {
+            fields[n]->unpack(&dataIn[offset]);
+            offset += fields[n]->getNumBytes();
+        }
     }
+    endWrite();
     emit objectUnpacked(this); // trigger object updated event
     emit objectUpdated(this);
 
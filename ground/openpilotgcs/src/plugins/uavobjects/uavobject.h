@@ -33,6 +33,7 @@
 #include <QObject>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QAtomicInt>
 #include <QString>
 #include <QList>
 #include <QFile>
@@ -126,6 +127,10 @@ public:
     void lock(int timeoutMs);
     void unlock();
     QMutex *getMutex();
+    quint32 getVersion() const;
+    void readData(quint8 *dataOut, quint32 offset, quint32 length) const;
+    void beginWrite();
+    void endWrite();
     qint32 getNumFields();
     QList<UAVObjectField *> getFields();
     UAVObjectField *getField(const QString & name);
@@ -200,7 +205,14 @@ protected:
     void setCategory(const QString & category);
 
 private:
+    static const int MAX_READ_RETRIES = 16;
+
     bool m_isKnown;
+    // Odd while the data is being written, see readData()
+    mutable QAtomicInt dataVersion;
+    int writeDepth;
+    // The data is laid out as on the wire, it can be copied as a whole
+    bool m_isWireLayout;
 
 private slots:
     void fieldUpdated(UAVObjectField *field);
@@ -29,6 +29,17 @@
 #include <QtEndian>
 #include <QDebug>
 #include <QtWidgets>
+#include <QVarLengthArray>
+
+template<typename E>
+static void convertElements(const quint8 *dataIn, double *values, quint32 count)
+{
+    for (quint32 index = 0; index < count; ++index) {
+        E value;
+        memcpy(&value, &dataIn[sizeof(E) * index], sizeof(E));
+        values[index] = value;
+    }
+}
 
 UAVObjectField::UAVObjectField(const QString & name, const QString & description, const QString & units, FieldType type, quint32 numElements, const QStringList & options, const QString &limits)
 {
@@ -770,6 +781,10 @@ qint32 UAVObjectField::pack(quint8 *dataOut)
 {
     QMutexLocker locker(obj->getMutex());
 
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // Elements are stored as on the wire
+    memcpy(dataOut, &data[offset], getNumBytes());
+#else
     // Pack each element in output buffer
     switch (type) {
     case INT8:
@@ -829,6 +844,7 @@ qint32 UAVObjectField::pack(quint8 *dataOut)
         memcpy(dataOut, &data[offset], numElements);
         break;
     }
+#endif
     // Done
     return getNumBytes();
 }
@@ -837,6 +853,11 @@ qint32 UAVObjectField::unpack(const quint8 *dataIn)
 {
     QMutexLocker locker(obj->getMutex());
 
+    obj->beginWrite();
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // Elements are stored as on the wire
+    memcpy(&data[offset], dataIn, getNumBytes());
+#else
     // Unpack each element from input buffer
     switch (type) {
     case INT8:
@@ -896,6 +917,8 @@ qint32 UAVObjectField::unpack(const quint8 *dataIn)
         memcpy(&data[offset], dataIn, numElements);
         break;
     }
+#endif
+    obj->endWrite();
     // Done
     return getNumBytes();
 }
@@ -1102,6 +1125,7 @@ void UAVObjectField::setValue(const QVariant & value, quint32 index)
     UAVObject::Metadata mdata = obj->getMetadata();
     // Update value if the access mode permits
     if (UAVObject::GetGcsAccess(mdata) == UAVObject::ACCESS_READWRITE) {
+        obj->beginWrite();
         switch (type) {
         case INT8:
         {
@@ -1175,15 +1199,76 @@ void UAVObjectField::setValue(const QVariant & value, quint32 index)
             break;
         }
         }
+        obj->endWrite();
     }
 }
 
 double UAVObjectField::getDouble(quint32 index)
 {
-    return getValue(index).toDouble();
+    if (type == ENUM || type == STRING) {
+        return getValue(index).toDouble();
+    }
+    return value<double>(index);
 }
 
 void UAVObjectField::setDouble(double value, quint32 index)
 {
     setValue(QVariant(value), index);
 }
+
+/**
+ * Copy up to count elements converted to double, all from the same version
+ * of the object data and without taking the object mutex.
+ * Enums are copied as their option index.
+ * @returns The number of elements copied, 0 for strings
+ */
+quint32 UAVObjectField::copyTo(double *values, quint32 count)
+{
+    count = qMin(count, numElements);
+    if (type == STRING || count == 0) {
+        return 0;
+    }
+
+    QVarLengthArray<quint8, 256> elements(getNumBytes());
+    readElements(elements.data(), 0, getNumBytes());
+    switch (type) {
+    case INT8:
+        convertElements<qint8>(elements.constData(), values, count);
+        break;
+    case INT16:
+        convertElements<qint16>(elements.constData(), values, count);
+        break;
+    case INT32:
+        convertElements<qint32>(elements.constData(), values, count);
+        break;
+    case UINT8:
+    case ENUM:
+        convertElements<quint8>(elements.constData(), values, count);
+        break;
+    case UINT16:
+        convertElements<quint16>(elements.constData(), values, count);
+        break;
+    case UINT32:
+        convertElements<quint32>(elements.constData(), values, count);
+        break;
+    case FLOAT32:
+        convertElements<float>(elements.constData(), values, count);
+        break;
+    case BITFIELD:
+        for (quint32 index = 0; index < count; ++index) {
+            values[index] = (elements[index / 8] >> (index % 8)) & 1;
+        }
+        break;
+    case STRING:
+        break;
+    }
+    return count;
+}
+
+/**
+ * Consistent copy of length bytes from element index onwards, see UAVObject::readData()
+ */
+void UAVObjectField::readElements(quint8 *dataOut, quint32 index, quint32 length)
+{
+    obj->readData(dataOut, offset + numBytesPerElement * index, length);
+}
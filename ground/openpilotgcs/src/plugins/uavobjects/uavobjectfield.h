@@ -71,6 +71,9 @@ public:
     void setValue(const QVariant & data, quint32 index = 0);
     double getDouble(quint32 index = 0);
     void setDouble(double value, quint32 index = 0);
+    template<typename T>
+    T value(quint32 index = 0);
+    quint32 copyTo(double *values, quint32 count);
     quint32 getDataOffset();
     quint32 getNumBytes();
     bool isNumeric();
@@ -107,6 +110,61 @@ protected:
     void clear();
     void constructorInitialize(const QString & name, const QString & description, const QString & units, FieldType type, const QStringList & elementNames, const QStringList & options, const QString &limits);
     void limitsInitialize(const QString &limits);
+    void readElements(quint8 *dataOut, quint32 index, quint32 length);
+
+    template<typename E>
+    E element(quint32 index)
+    {
+        E value;
+
+        readElements((quint8 *)&value, index, sizeof(value));
+        return value;
+    }
 };
 
+/**
+ * Get an element converted to T, without taking the object mutex or going
+ * through a QVariant. Enums are returned as their option index, strings as T().
+ */
+template<typename T>
+T UAVObjectField::value(quint32 index)
+{
+    if (index >= numElements) {
+        return T();
+    }
+    switch (type) {
+    case INT8:
+        return static_cast<T>(element<qint8>(index));
+
+    case INT16:
+        return static_cast<T>(element<qint16>(index));
+
+    case INT32:
+        return static_cast<T>(element<qint32>(index));
+
+    case UINT8:
+    case ENUM:
+        return static_cast<T>(element<quint8>(index));
+
+    case UINT16:
+        return static_cast<T>(element<quint16>(index));
+
+    case UINT32:
+        return static_cast<T>(element<quint32>(index));
+
+    case FLOAT32:
+        return static_cast<T>(element<float>(index));
+
+    case BITFIELD:
+    {
+        quint8 bits;
+        readElements(&bits, index / 8, sizeof(bits));
+        return static_cast<T>((bits >> (index % 8)) & 1);
+    }
+    case STRING:
+        break;
+    }
+    return T();
+}
+
 #endif // UAVOBJECTFIELD_H
@@ -28,18 +28,23 @@
 #include "uavobjectmanager.h"
 
 #include <QtWidgetsDepends>
+#include <QMetaMethod>
 
 /**
  * Constructor
  */
-UAVObjectManager::UAVObjectManager()
+UAVObjectManager::UAVObjectManager() : batchScheduled(false)
 {
-    mutex = new QMutex(QMutex::Recursive);
+    lock = new QReadWriteLock();
+    batchTimer = new QTimer(this);
+    batchTimer->setSingleShot(true);
+    batchTimer->setInterval(DEFAULT_BATCH_INTERVAL);
+    connect(batchTimer, SIGNAL(timeout()), this, SLOT(flushBatch()));
 }
 
 UAVObjectManager::~UAVObjectManager()
 {
-    delete mutex;
+    delete lock;
 }
 
 /**
@@ -50,57 +55,124 @@ UAVObjectManager::~UAVObjectManager()
  */
 bool UAVObjectManager::registerObject(UAVDataObject *obj)
 {
-    QMutexLocker locker(mutex);
+    QList<UAVObject *> newObjects;
+    QList<UAVObject *> newInstances;
+    bool success = registerObject(obj, newObjects, newInstances);
+
+    // Signal once unlocked, so that the receivers can look objects up
+    foreach(UAVObject * object, newObjects) {
+        connect(object, SIGNAL(objectUpdated(UAVObject *)), this, SLOT(batchObjectUpdated(UAVObject *)), Qt::DirectConnection);
+        emit newObject(object);
+    }
+    foreach(UAVObject * instance, newInstances) {
+        connect(instance, SIGNAL(objectUpdated(UAVObject *)), this, SLOT(batchObjectUpdated(UAVObject *)), Qt::DirectConnection);
+        getObject(instance->getObjID())->emitNewInstance(instance);
+        emit newInstance(instance);
+    }
+    return success;
+}
+
+/**
+ * Set how often objectsUpdated() is emitted while objects are being updated.
+ */
+void UAVObjectManager::setBatchInterval(int interval)
+{
+    batchTimer->setInterval(interval);
+}
+
+/**
+ * Called in the thread that updated the object, typically the telemetry thread.
+ * The object is queued once until the next objectsUpdated(), which is emitted in the
+ * thread of the manager: receivers get one notification per interval however high
+ * the update rate and read the latest value from the object.
+ */
+void UAVObjectManager::batchObjectUpdated(UAVObject *obj)
+{
+    static const QMetaMethod objectsUpdatedSignal = QMetaMethod::fromSignal(&UAVObjectManager::objectsUpdated);
+
+    if (!isSignalConnected(objectsUpdatedSignal)) {
+        return;
+    }
+
+    QMutexLocker locker(&batchMutex);
+    if (!batched.contains(obj)) {
+        batched.insert(obj);
+        batch.append(obj);
+    }
+    if (!batchScheduled) {
+        batchScheduled = true;
+        QMetaObject::invokeMethod(batchTimer, "start", Qt::QueuedConnection);
+    }
+}
+
+void UAVObjectManager::flushBatch()
+{
+    QList<UAVObject *> updated;
+    {
+        QMutexLocker locker(&batchMutex);
+        updated.swap(batch);
+        batched.clear();
+        batchScheduled = false;
+    }
+    if (!updated.isEmpty()) {
+        emit objectsUpdated(updated);
+    }
+}
+
+/**
+ * Helper function for the public registerObject(), adds the object with the lock
+ * held and returns the objects and instances that have to be signalled.
+ */
+bool UAVObjectManager::registerObject(UAVDataObject *obj, QList<UAVObject *> &newObjects, QList<UAVObject *> &newInstances)
+{
+    QWriteLocker locker(lock);
 
     // Check if this object type is already in the list
-    for (int objidx = 0; objidx < objects.length(); ++objidx) {
-        // Check if the object ID is in the list
-        if (objects[objidx].length() > 0 && objects[objidx][0]->getObjID() == obj->getObjID()) {
-            // Check if this is a single instance object, if yes we can not add a new instance
-            if (obj->isSingleInstance()) {
-                return false;
-            }
-            // The object type has alredy been added, so now we need to initialize the new instance with the appropriate id
-            // There is a single metaobject for all object instances of this type, so no need to create a new one
-            // Get object type metaobject from existing instance
-            UAVDataObject *refObj = dynamic_cast<UAVDataObject *>(objects[objidx][0]);
-            if (refObj == NULL) {
-                return false;
-            }
-            UAVMetaObject *mobj = refObj->getMetaObject();
-            // If the instance ID is specified and not at the default value (0) then we need to make sure
-            // that there are no gaps in the instance list. If gaps are found then then additional instances
-            // will be created.
-            if ((obj->getInstID() > 0) && (obj->getInstID() < MAX_INSTANCES)) {
-                for (int instidx = 0; instidx < objects[objidx].length(); ++instidx) {
-                    if (objects[objidx][instidx]->getInstID() == obj->getInstID()) {
-                        // Instance conflict, do not add
-                        return false;
-                    }
-                }
-                // Check if there are any gaps between the requested instance ID and the ones in the list,
-                // if any then create the missing instances.
-                for (quint32 instidx = objects[objidx].length(); instidx < obj->getInstID(); ++instidx) {
-                    UAVDataObject *cobj = obj->clone(instidx);
-                    cobj->initialize(mobj);
-                    objects[objidx].append(cobj);
-                    getObject(cobj->getObjID())->emitNewInstance(cobj);
-                    emit newInstance(cobj);
+    int objidx = objectsById.value(obj->getObjID(), -1);
+
+    if (objidx >= 0) {
+        // Check if this is a single instance object, if yes we can not add a new instance
+        if (obj->isSingleInstance()) {
+            return false;
+        }
+        // The object type has alredy been added, so now we need to initialize the new instance with the appropriate id
+        // There is a single metaobject for all object instances of this type, so no need to create a new one
+        // Get object type metaobject from existing instance
+        UAVDataObject *refObj = dynamic_cast<UAVDataObject *>(objects[objidx][0]);
+        if (refObj == NULL) {
+            return false;
+        }
+        UAVMetaObject *mobj = refObj->getMetaObject();
+        // If the instance ID is specified and not at the default value (0) then we need to make sure
+        // that there are no gaps in the instance list. If gaps are found then then additional instances
+        // will be created.
+        if ((obj->getInstID() > 0) && (obj->getInstID() < MAX_INSTANCES)) {
+            for (int instidx = 0; instidx < objects[objidx].length(); ++instidx) {
+                if (objects[objidx][instidx]->getInstID() == obj->getInstID()) {
+                    // Instance conflict, do not add
+                    return false;
                 }
-                // Finally, initialize the actual object instance
-                obj->initialize(mobj);
-            } else if (obj->getInstID() == 0) {
-                // Assign the next available ID and initialize the object instance
-                obj->initialize(objects[objidx].length(), mobj);
-            } else {
-                return false;
             }
-            // Add the actual object instance in the list
-            objects[objidx].append(obj);
-            getObject(obj->getObjID())->emitNewInstance(obj);
-            emit newInstance(obj);
-            return true;
+            // Check if there are any gaps between the requested instance ID and the ones in the list,
+            // if any then create the missing instances.
+            for (quint32 instidx = objects[objidx].length(); instidx < obj->getInstID(); ++instidx) {
+                UAVDataObject *cobj = obj->clone(instidx);
+                cobj->initialize(mobj);
+                objects[objidx].append(cobj);
+                newInstances.append(cobj);
+            }
+            // Finally, initialize the actual object instance
+            obj->initialize(mobj);
+        } else if (obj->getInstID() == 0) {
+            // Assign the next available ID and initialize the object instance
+            obj->initialize(objects[objidx].length(), mobj);
+        } else {
+            return false;
         }
+        // Add the actual object instance in the list
+        objects[objidx].append(obj);
+        newInstances.append(obj);
+        return true;
     }
     // If this point is reached then this is the first time this object type (ID) is added in the list
     // create a new list of the instances, add in the object collection and create the object's metaobject
@@ -113,6 +185,8 @@ bool UAVObjectManager::registerObject(UAVDataObject *obj)
     // Add to list
     addObject(obj);
     addObject(mobj);
+    newObjects.append(obj);
+    newObjects.append(mobj);
     return true;
 }
 
@@ -121,8 +195,21 @@ void UAVObjectManager::addObject(UAVObject *obj)
     // Add to list
     QList<UAVObject *> list;
     list.append(obj);
+    objectsById.insert(obj->getObjID(), objects.length());
+    objectsByName.insert(obj->getName(), objects.length());
     objects.append(list);
-    emit newObject(obj);
+}
+
+/**
+ * Index in objects of the instances of an object type given its name (if not NULL) or its ID
+ * @returns The index or -1 if the object type is not registered
+ */
+int UAVObjectManager::indexOf(const QString *name, quint32 objId) const
+{
+    if (name != NULL) {
+        return objectsByName.value(*name, -1);
+    }
+    return objectsById.value(objId, -1);
 }
 
 /**
@@ -131,7 +218,7 @@ void UAVObjectManager::addObject(UAVObject *obj)
  */
 QList< QList<UAVObject *> > UAVObjectManager::getObjects()
 {
-    QMutexLocker locker(mutex);
+    QReadLocker locker(lock);
 
     return objects;
 }
@@ -141,7 +228,7 @@ QList< QList<UAVObject *> > UAVObjectManager::getObjects()
  */
 QList< QList<UAVDataObject *> > UAVObjectManager::getDataObjects()
 {
-    QMutexLocker locker(mutex);
+    QReadLocker locker(lock);
 
     QList< QList<UAVDataObject *> > dObjects;
 
@@ -174,7 +261,7 @@ QList< QList<UAVDataObject *> > UAVObjectManager::getDataObjects()
  */
 QList <QList<UAVMetaObject *> > UAVObjectManager::getMetaObjects()
 {
-    QMutexLocker locker(mutex);
+    QReadLocker locker(lock);
 
     QList< QList<UAVMetaObject *> > mObjects;
 
@@ -225,19 +312,20 @@ UAVObject *UAVObjectManager::getObject(quint32 objId, quint32 instId)
  */
 UAVObject *UAVObjectManager::getObject(const QString *name, quint32 objId, quint32 instId)
 {
-    QMutexLocker locker(mutex);
+    QReadLocker locker(lock);
 
-    // Check if this object type is already in the list
-    for (int objidx = 0; objidx < objects.length(); ++objidx) {
-        // Check if the object ID is in the list
-        if (objects[objidx].length() > 0) {
-            if ((name != NULL && objects[objidx][0]->getName().compare(name) == 0) || (name == NULL && objects[objidx][0]->getObjID() == objId)) {
-                // Look for the requested instance ID
-                for (int instidx = 0; instidx < objects[objidx].length(); ++instidx) {
-                    if (objects[objidx][instidx]->getInstID() == instId) {
-                        return objects[objidx][instidx];
-                    }
-                }
+    int objidx = indexOf(name, objId);
+
+    if (objidx >= 0) {
+        const QList<UAVObject *> &instances = objects.at(objidx);
+        // Instances are registered without gaps, so the instance ID is the index
+        if (instId < (quint32)instances.length() && instances.at(instId)->getInstID() == instId) {
+            return instances.at(instId);
+        }
+        // Look for the requested instance ID
+        for (int instidx = 0; instidx < instances.length(); ++instidx) {
+            if (instances.at(instidx)->getInstID() == instId) {
+                return instances.at(instidx);
             }
         }
     }
@@ -267,16 +355,12 @@ QList<UAVObject *> UAVObjectManager::getObjectInstances(quint32 objId)
  */
 QList<UAVObject *> UAVObjectManager::getObjectInstances(const QString *name, quint32 objId)
 {
-    QMutexLocker locker(mutex);
+    QReadLocker locker(lock);
 
-    // Check if this object type is already in the list
-    for (int objidx = 0; objidx < objects.length(); ++objidx) {
-        // Check if the object ID is in the list
-        if (objects[objidx].length() > 0) {
-            if ((name != NULL && objects[objidx][0]->getName().compare(name) == 0) || (name == NULL && objects[objidx][0]->getObjID() == objId)) {
-                return objects[objidx];
-            }
-        }
+    int objidx = indexOf(name, objId);
+
+    if (objidx >= 0) {
+        return objects.at(objidx);
     }
     // If this point is reached then the requested object could not be found
     return QList<UAVObject *>();
@@ -361,16 +445,12 @@ void UAVObjectManager::fromJson(const QJsonObject &jsonObject, QList<UAVObject *
  */
 qint32 UAVObjectManager::getNumInstances(const QString *name, quint32 objId)
 {
-    QMutexLocker locker(mutex);
+    QReadLocker locker(lock);
 
-    // Check if this object type is already in the list
-    for (int objidx = 0; objidx < objects.length(); ++objidx) {
-        // Check if the object ID is in the list
-        if (objects[objidx].length() > 0) {
-            if ((name != NULL && objects[objidx][0]->getName().compare(name) == 0) || (name == NULL && objects[objidx][0]->getObjID() == objId)) {
-                return objects[objidx].length();
-            }
-        }
+    int objidx = indexOf(name, objId);
+
+    if (objidx >= 0) {
+        return objects.at(objidx).length();
     }
     // If this point is reached then the requested object could not be found
     return -1;
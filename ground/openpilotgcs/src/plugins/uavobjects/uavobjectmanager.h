@@ -33,8 +33,11 @@
 #include "uavdataobject.h"
 #include "uavmetaobject.h"
 #include <QList>
+#include <QHash>
+#include <QSet>
 #include <QMutex>
-#include <QMutexLocker>
+#include <QReadWriteLock>
+#include <QTimer>
 #include <QJsonObject>
 
 class UAVOBJECTS_EXPORT UAVObjectManager : public QObject {
@@ -61,17 +64,38 @@ public:
     void toJson(QJsonObject &jsonObject, const QList<UAVObject *> &objectsToExport);
     void fromJson(const QJsonObject &jsonObject, QList<UAVObject *> *updatedObjects = NULL);
 
+    void setBatchInterval(int interval);
+
 signals:
     void newObject(UAVObject *obj);
     void newInstance(UAVObject *obj);
+    // Objects updated during the last batch interval, each one listed once
+    void objectsUpdated(const QList<UAVObject *> &objects);
+
+private slots:
+    void batchObjectUpdated(UAVObject *obj);
+    void flushBatch();
 
 private:
     static const quint32 MAX_INSTANCES = 1000;
+    static const int DEFAULT_BATCH_INTERVAL = 40; // ms
 
     QList< QList<UAVObject *> > objects;
-    QMutex *mutex;
+    // Index in objects of the instances of each object type
+    QHash<quint32, int> objectsById;
+    QHash<QString, int> objectsByName;
+    QReadWriteLock *lock;
+
+    // Updates waiting for the next objectsUpdated()
+    QMutex batchMutex;
+    QList<UAVObject *> batch;
+    QSet<UAVObject *> batched;
+    bool batchScheduled;
+    QTimer *batchTimer;
 
+    bool registerObject(UAVDataObject *obj, QList<UAVObject *> &newObjects, QList<UAVObject *> &newInstances);
     void addObject(UAVObject *obj);
+    int indexOf(const QString *name, quint32 objId) const;
     UAVObject *getObject(const QString *name, quint32 objId, quint32 instId);
     QList<UAVObject *> getObjectInstances(const QString *name, quint32 objId);
     qint32 getNumInstances(const QString *name, quint32 objId);
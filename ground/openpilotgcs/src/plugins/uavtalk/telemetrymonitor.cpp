@@ -210,6 +210,11 @@ void TelemetryMonitor::processStatsUpdates()
     gcsStats.RxSyncErrors += telStats.rxSyncErrors;
     gcsStats.RxCrcErrors  += telStats.rxCrcErrors;
 
+    // The flight side may collect small object updates into multi object packets
+    gcsStats.Batching      = GCSTelemetryStats::BATCHING_ENABLED;
+    // and may send objects as the blocks that changed since the last update
+    gcsStats.Delta         = GCSTelemetryStats::DELTA_ENABLED;
+
     // Check for a connection timeout
     bool connectionTimeout;
     if (telStats.rxObjects > 0) {
@@ -273,8 +273,8 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
             break;
         }
 
-        // Initialize and update CRC
-        rxCS = Crc::updateCRC(0, rxbyte);
+        // Keep the header, the CRC is computed once the packet is complete
+        rxHeader[0]    = rxbyte;
 
         rxPacketLength = 1;
 
@@ -286,8 +286,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
 
     case STATE_TYPE:
 
-        // Update CRC
-        rxCS = Crc::updateCRC(rxCS, rxbyte);
+        rxHeader[rxPacketLength - 1] = rxbyte;
 
         if ((rxbyte & TYPE_MASK) != TYPE_VER) {
             qWarning() << "UAVTalk - error : bad type";
@@ -305,8 +304,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
 
     case STATE_SIZE:
 
-        // Update CRC
-        rxCS = Crc::updateCRC(rxCS, rxbyte);
+        rxHeader[rxPacketLength - 1] = rxbyte;
 
         if (rxCount == 0) {
             packetSize += rxbyte;
@@ -316,6 +314,20 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
         packetSize += (quint32)rxbyte << 8;
         rxCount     = 0;
 
+        // A multi object packet has no object header, its entries are the payload
+        if (rxType == TYPE_MULTI) {
+            if (packetSize <= BATCH_HEADER_LENGTH || packetSize >= BATCH_HEADER_LENGTH + MAX_PAYLOAD_LENGTH) {
+                qWarning() << "UAVTalk - error : incorrect multi object packet size";
+                stats.rxErrors++;
+                rxState = STATE_ERROR;
+                break;
+            }
+            rxObjId  = 0;
+            rxInstId = 0;
+            rxLength = packetSize - BATCH_HEADER_LENGTH;
+            rxState  = STATE_DATA;
+            break;
+        }
 
         if (packetSize < HEADER_LENGTH || packetSize > HEADER_LENGTH + MAX_PAYLOAD_LENGTH) {
             // incorrect packet size
@@ -330,16 +342,14 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
 
     case STATE_OBJID:
 
-        // Update CRC
-        rxCS = Crc::updateCRC(rxCS, rxbyte);
+        rxHeader[rxPacketLength - 1] = rxbyte;
 
-        rxTmpBuffer[rxCount++] = rxbyte;
-        if (rxCount < 4) {
+        if (++rxCount < 4) {
             break;
         }
         rxCount  = 0;
 
-        rxObjId  = (qint32)qFromLittleEndian<quint32>(rxTmpBuffer);
+        rxObjId  = (qint32)qFromLittleEndian<quint32>(&rxHeader[4]);
 
         // Message always contain an instance ID
         rxInstId = 0;
@@ -348,16 +358,14 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
 
     case STATE_INSTID:
 
-        // Update CRC
-        rxCS = Crc::updateCRC(rxCS, rxbyte);
+        rxHeader[rxPacketLength - 1] = rxbyte;
 
-        rxTmpBuffer[rxCount++] = rxbyte;
-        if (rxCount < 2) {
+        if (++rxCount < 2) {
             break;
         }
         rxCount  = 0;
 
-        rxInstId = (qint16)qFromLittleEndian<quint16>(rxTmpBuffer);
+        rxInstId = (qint16)qFromLittleEndian<quint16>(&rxHeader[8]);
 
         // Search for object, if not found reset state machine
         {
@@ -373,7 +381,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
             if (rxType == TYPE_OBJ_REQ || rxType == TYPE_ACK || rxType == TYPE_NACK) {
                 rxLength = 0;
             } else {
-                if (rxObj) {
+                if (rxObj && rxType != TYPE_OBJ_DELTA) {
                     rxLength = rxObj->getNumBytes();
                 } else {
                     rxLength = packetSize - rxPacketLength;
@@ -409,9 +417,6 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
 
     case STATE_DATA:
 
-        // Update CRC
-        rxCS = Crc::updateCRC(rxCS, rxbyte);
-
         rxBuffer[rxCount++] = rxbyte;
         if (rxCount < rxLength) {
             break;
@@ -426,6 +431,9 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
         // The CRC byte
         rxCSPacket = rxbyte;
 
+        // Checksum the header and payload spans at once, their sizes were checked in STATE_SIZE or STATE_INSTID
+        rxCS = Crc::updateCRC(Crc::updateCRC(0, rxHeader, packetSize - rxLength), rxBuffer, rxLength);
+
         if (rxCS != rxCSPacket) {
             // packet error - faulty CRC
             qWarning() << "UAVTalk - error : failed CRC check" << rxObjId;
@@ -465,7 +473,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
  * Object handling errors are considered as application errors and are NACked.
  * In that case we want to nack as there is no point in the sender retrying to send invalid objects.
  *
- * \param[in] type Type of received message (TYPE_OBJ, TYPE_OBJ_REQ, TYPE_OBJ_ACK, TYPE_ACK, TYPE_NACK)
+ * \param[in] type Type of received message (TYPE_OBJ, TYPE_OBJ_REQ, TYPE_OBJ_ACK, TYPE_ACK, TYPE_NACK, TYPE_MULTI, TYPE_OBJ_DELTA)
  * \param[in] obj Handle of the received object
  * \param[in] instId The instance ID of UAVOBJ_ALL_INSTANCES for all instances.
  * \param[in] data Data buffer
@@ -474,8 +482,6 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
  */
 bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length)
 {
-    Q_UNUSED(length);
-
     UAVObject *obj    = NULL;
     bool error        = false;
     bool allInstances = (instId == ALL_INSTANCES);
@@ -491,6 +497,8 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
             VERBOSE_FILTER(objId) qDebug() << "UAVTalk - received object" << objId << instId << (obj != NULL ? obj->toStringBrief() : "<null object>");
 #endif
             if (obj != NULL) {
+                // Keep the image later delta packets apply to
+                storeDeltaImage(objId, instId, data, length);
                 // Check if this object acks a pending OBJ_REQ message
                 // any OBJ message can ack a pending OBJ_REQ message
                 // even one that was not sent in response to the OBJ_REQ message
@@ -512,6 +520,7 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
             VERBOSE_FILTER(objId) qDebug() << "UAVTalk - received object (acked)" << objId << instId << (obj != NULL ? obj->toStringBrief() : "<null object>");
 #endif
             if (obj != NULL) {
+                storeDeltaImage(objId, instId, data, length);
                 // Object updated or created, transmit ACK
                 error = !transmitObject(TYPE_ACK, objId, instId, obj);
             } else {
@@ -584,6 +593,16 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
         }
         break;
 
+    case TYPE_MULTI:
+        // Unacked updates of small objects collected by the sender
+        error = !receiveBatch(data, length);
+        break;
+
+    case TYPE_OBJ_DELTA:
+        // Unacked update carrying only what changed since the last one
+        error = !receiveDelta(objId, instId, data, length);
+        break;
+
     default:
         error = true;
     }
@@ -594,6 +613,124 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
     return !error;
 }
 
+/**
+ * Receive the entries of a multi object packet, each one is handled as an object update.
+ * Unknown objects and entries with a bad length are skipped.
+ * \param[in] data Packet payload
+ * \param[in] length Payload length
+ * \return Success (true), Failure (false) if any entry could not be received
+ */
+bool UAVTalk::receiveBatch(quint8 *data, qint32 length)
+{
+    bool success = true;
+    qint32 pos   = 0;
+
+    while (pos < length) {
+        quint8 flags = data[pos];
+        qint32 entryLength = BATCH_ENTRY_LENGTH + ((flags & BATCH_INSTANCE) ? 2 : 0);
+        qint32 dataLength  = flags & BATCH_LENGTH_MASK;
+
+        if (pos + entryLength + dataLength > length) {
+            qWarning() << "UAVTalk - error : truncated multi object entry";
+            stats.rxErrors++;
+            return false;
+        }
+        quint32 objId  = qFromLittleEndian<quint32>(&data[pos + 1]);
+        quint16 instId = (flags & BATCH_INSTANCE) ? qFromLittleEndian<quint16>(&data[pos + BATCH_ENTRY_LENGTH]) : 0;
+        UAVObject *obj = objMngr->getObject(objId);
+        pos += entryLength;
+
+        if (obj == NULL || (qint32)obj->getNumBytes() != dataLength) {
+            qWarning() << "UAVTalk - error : unknown object in multi object packet" << objId;
+            success = false;
+        } else if (!receiveObject(TYPE_OBJ, objId, instId, &data[pos], dataLength)) {
+            success = false;
+        }
+        pos += dataLength;
+    }
+    return success;
+}
+
+/**
+ * Receive a delta packet: apply the changed blocks to the image of the object last received
+ * and update the object from it. The full object is requested when the image is missing or
+ * is not the one the sender applied the changes to.
+ * \param[in] objId Object ID
+ * \param[in] instId Instance ID
+ * \param[in] data Packet payload
+ * \param[in] length Payload length
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::receiveDelta(quint32 objId, quint16 instId, quint8 *data, qint32 length)
+{
+    UAVObject *obj = objMngr->getObject(objId, instId);
+
+    if (obj == NULL || length < 1) {
+        return false;
+    }
+
+    qint32 objLength  = obj->getNumBytes();
+    qint32 maskLength = (objLength + 8 * DELTA_BLOCK - 1) / (8 * DELTA_BLOCK);
+    quint64 key = ((quint64)objId << 16) | instId;
+    QHash<quint64, QByteArray>::iterator image = deltaImages.find(key);
+
+    if (image == deltaImages.end() || image->size() != objLength ||
+        Crc::updateCRC(0, (const quint8 *)image->constData(), objLength) != data[0]) {
+        // Missed an update, ask for the full object unless that was done already
+        if (image == deltaImages.end() || !image->isEmpty()) {
+            deltaImages.insert(key, QByteArray());
+            transmitObject(TYPE_OBJ_REQ, objId, instId, obj);
+        }
+        return false;
+    }
+
+    // The changed blocks must add up to the payload
+    quint8 *mask    = &data[1];
+    qint32 expected = 1 + maskLength;
+    if (length < expected) {
+        stats.rxErrors++;
+        return false;
+    }
+    for (qint32 offset = 0; offset < objLength; offset += DELTA_BLOCK) {
+        qint32 block = offset / DELTA_BLOCK;
+        if (mask[block / 8] & (1 << (block % 8))) {
+            expected += qMin(DELTA_BLOCK, objLength - offset);
+        }
+    }
+    if (length != expected) {
+        qWarning() << "UAVTalk - error : mismatched delta length" << objId;
+        stats.rxErrors++;
+        return false;
+    }
+
+    quint8 *bytes = (quint8 *)image->data();
+    qint32 pos    = 1 + maskLength;
+    for (qint32 offset = 0; offset < objLength; offset += DELTA_BLOCK) {
+        qint32 block = offset / DELTA_BLOCK;
+        if (mask[block / 8] & (1 << (block % 8))) {
+            qint32 blockLength = qMin(DELTA_BLOCK, objLength - offset);
+            memcpy(&bytes[offset], &data[pos], blockLength);
+            pos += blockLength;
+        }
+    }
+
+    obj = updateObject(objId, instId, bytes);
+    if (obj == NULL) {
+        return false;
+    }
+    // Acks a pending OBJ_REQ message like a full object
+    updateAck(TYPE_OBJ, objId, instId, obj);
+    return true;
+}
+
+/**
+ * Keep the image of an object as received, delta packets for it apply to that image.
+ */
+void UAVTalk::storeDeltaImage(quint32 objId, quint16 instId, quint8 *data, qint32 length)
+{
+    deltaImages.insert(((quint64)objId << 16) | instId, QByteArray((const char *)data, length));
+}
+
 /**
  * Update the data of an object from a byte array (unpack).
  * If the object instance could not be found in the list, then a
@@ -896,6 +1033,16 @@ const char *UAVTalk::typeToString(quint8 type)
     case TYPE_NACK:
         return "nack";
 
+        break;
+
+    case TYPE_MULTI:
+        return "multi object";
+
+        break;
+
+    case TYPE_OBJ_DELTA:
+        return "object (delta)";
+
         break;
     }
     return "<error>";
@@ -93,10 +93,22 @@ private:
     static const int TYPE_OBJ_ACK  = (TYPE_VER | 0x02);
     static const int TYPE_ACK      = (TYPE_VER | 0x03);
     static const int TYPE_NACK     = (TYPE_VER | 0x04);
+    static const int TYPE_MULTI    = (TYPE_VER | 0x05);
+    static const int TYPE_OBJ_DELTA = (TYPE_VER | 0x06);
 
     // header : sync(1), type (1), size(2), object ID(4), instance ID(2)
     static const int HEADER_LENGTH = 10;
 
+    // multi object header : sync(1), type (1), size(2)
+    static const int BATCH_HEADER_LENGTH = 4;
+    // multi object entry : length and instance flag (1), object ID(4), instance ID(2) if flagged
+    static const int BATCH_ENTRY_LENGTH  = 5;
+    static const int BATCH_INSTANCE      = 0x80;
+    static const int BATCH_LENGTH_MASK   = 0x7F;
+
+    // delta payload : CRC of the image it applies to(1), changed block mask, changed blocks
+    static const int DELTA_BLOCK = 4;
+
     static const int MAX_PAYLOAD_LENGTH = 256;
 
     static const int CHECKSUM_LENGTH    = 1;
@@ -121,6 +133,9 @@ private:
 
     QMap<quint32, QMap<quint32, Transaction *> *> transMap;
 
+    // Images of the objects last received, keyed by object and instance ID, for delta packets
+    QHash<quint64, QByteArray> deltaImages;
+
     quint8 rxBuffer[MAX_PACKET_LENGTH];
 
     quint8 txBuffer[MAX_PACKET_LENGTH];
@@ -131,7 +146,7 @@ private:
     qint32 packetSize;
     RxStateType rxState;
     // data variables
-    quint8 rxTmpBuffer[4];
+    quint8 rxHeader[HEADER_LENGTH];
     quint8 rxType;
     quint32 rxObjId;
     quint16 rxInstId;
@@ -149,6 +164,9 @@ private:
     bool objectTransaction(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
     bool processInputByte(quint8 rxbyte);
     bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length);
+    bool receiveBatch(quint8 *data, qint32 length);
+    bool receiveDelta(quint32 objId, quint16 instId, quint8 *data, qint32 length);
+    void storeDeltaImage(quint32 objId, quint16 instId, quint8 *data, qint32 length);
     UAVObject *updateObject(quint32 objId, quint16 instId, quint8 *data);
     void updateAck(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
     void updateNack(quint32 objId, quint16 instId, UAVObject *obj);
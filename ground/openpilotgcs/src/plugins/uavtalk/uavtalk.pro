@@ -13,6 +13,9 @@ include(uavtalk_dependencies.pri)
 
 HEADERS += \
     uavtalk.h \
+    uavtalklogdecoder.h \
+    uavtalklogexporter.h \
+    uavtalkcolumnfile.h \
     uavtalkplugin.h \
     telemetrymonitor.h \
     telemetrymanager.h \
@@ -21,6 +24,9 @@ HEADERS += \
 
 SOURCES += \
     uavtalk.cpp \
+    uavtalklogdecoder.cpp \
+    uavtalklogexporter.cpp \
+    uavtalkcolumnfile.cpp \
     uavtalkplugin.cpp \
     telemetrymonitor.cpp \
     telemetrymanager.cpp \
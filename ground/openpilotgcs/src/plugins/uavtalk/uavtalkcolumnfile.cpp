@@ -0,0 +1,167 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavtalkcolumnfile.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2015.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief The UAVTalk protocol plugin
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include "uavtalkcolumnfile.h"
+#include "uavtalklogdecoder.h"
+
+#include <QtEndian>
+#include <QDebug>
+
+#include <string.h>
+
+static double readDouble(const uchar *data)
+{
+    quint64 bits = qFromLittleEndian<quint64>(data);
+    double value;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void writeDouble(uchar *data, double value)
+{
+    quint64 bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    qToLittleEndian<quint64>(bits, data);
+}
+
+UAVTalkColumnFile::UAVTalkColumnFile() :
+    m_map(NULL), m_type(UAVObjectField::UINT8), m_size(0), m_rows(0), m_chunkRows(CHUNK_ROWS), m_chunks(0)
+{}
+
+UAVTalkColumnFile::~UAVTalkColumnFile()
+{
+    close();
+}
+
+/**
+ * Write a column and the summary of each of its chunks.
+ * \param[in] data Packed values, rows * size bytes
+ * \return false if the file could not be written
+ */
+bool UAVTalkColumnFile::write(const QString &fileName, UAVObjectField::FieldType type, quint32 size,
+                              const char *data, quint32 rows)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "UAVTalkColumnFile - unable to open" << fileName;
+        return false;
+    }
+
+    quint32 chunks = (rows + CHUNK_ROWS - 1) / CHUNK_ROWS;
+    QByteArray header(HEADER_LENGTH + chunks * SUMMARY_LENGTH, 0);
+    uchar *bytes = (uchar *)header.data();
+
+    qToLittleEndian<quint32>(MAGIC, &bytes[0]);
+    qToLittleEndian<quint16>(VERSION, &bytes[4]);
+    bytes[6] = (quint8)type;
+    bytes[7] = (quint8)size;
+    qToLittleEndian<quint32>(rows, &bytes[8]);
+    qToLittleEndian<quint32>(CHUNK_ROWS, &bytes[12]);
+    qToLittleEndian<quint32>(chunks, &bytes[16]);
+
+    for (quint32 chunk = 0; chunk < chunks; ++chunk) {
+        quint32 first = chunk * CHUNK_ROWS;
+        quint32 last  = qMin(first + CHUNK_ROWS, rows);
+        double min    = UAVTalkLogDecoder::toDouble(type, &data[(qint64)first * size]);
+        double max    = min;
+        double sum    = 0;
+        for (quint32 row = first; row < last; ++row) {
+            double value = UAVTalkLogDecoder::toDouble(type, &data[(qint64)row * size]);
+            min  = qMin(min, value);
+            max  = qMax(max, value);
+            sum += value;
+        }
+        uchar *summary = &bytes[HEADER_LENGTH + chunk * SUMMARY_LENGTH];
+        writeDouble(&summary[0], min);
+        writeDouble(&summary[8], max);
+        writeDouble(&summary[16], sum / (last - first));
+    }
+
+    qint64 length = (qint64)rows * size;
+    return file.write(header) == header.size() && file.write(data, length) == length;
+}
+
+/**
+ * Map a column written by write().
+ * \return false if the file is missing, truncated or not a column
+ */
+bool UAVTalkColumnFile::open(const QString &fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < HEADER_LENGTH) {
+        close();
+        return false;
+    }
+    m_map = m_file.map(0, m_file.size());
+    if (m_map == NULL || qFromLittleEndian<quint32>(&m_map[0]) != MAGIC ||
+        qFromLittleEndian<quint16>(&m_map[4]) != VERSION) {
+        close();
+        return false;
+    }
+    m_type      = (UAVObjectField::FieldType)m_map[6];
+    m_size      = m_map[7];
+    m_rows      = qFromLittleEndian<quint32>(&m_map[8]);
+    m_chunkRows = qFromLittleEndian<quint32>(&m_map[12]);
+    m_chunks    = qFromLittleEndian<quint32>(&m_map[16]);
+    if (m_file.size() != HEADER_LENGTH + (qint64)m_chunks * SUMMARY_LENGTH + (qint64)m_rows * m_size) {
+        qWarning() << "UAVTalkColumnFile - truncated column" << fileName;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void UAVTalkColumnFile::close()
+{
+    if (m_map) {
+        m_file.unmap((uchar *)m_map);
+        m_map = NULL;
+    }
+    m_file.close();
+    m_rows   = 0;
+    m_chunks = 0;
+}
+
+UAVTalkColumnFile::Summary UAVTalkColumnFile::summary(quint32 chunk) const
+{
+    const uchar *data = &m_map[HEADER_LENGTH + chunk * SUMMARY_LENGTH];
+    Summary summary;
+
+    summary.min  = readDouble(&data[0]);
+    summary.max  = readDouble(&data[8]);
+    summary.mean = readDouble(&data[16]);
+    return summary;
+}
+
+double UAVTalkColumnFile::value(quint32 row) const
+{
+    return UAVTalkLogDecoder::toDouble(m_type,
+                                       (const char *)&m_map[HEADER_LENGTH + m_chunks * SUMMARY_LENGTH + (qint64)row * m_size]);
+}
@@ -0,0 +1,95 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavtalkcolumnfile.h
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2015.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief The UAVTalk protocol plugin
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef UAVTALKCOLUMNFILE_H
+#define UAVTALKCOLUMNFILE_H
+
+#include "uavobjectfield.h"
+#include "uavtalk_global.h"
+
+#include <QFile>
+#include <QString>
+
+/**
+ * One field element of an exported log, stored as
+ * [header][min, max, mean of each chunk][packed values].
+ * Values are little endian in the width of the field type, the chunk
+ * summaries let a plot of the whole flight be drawn without reading them.
+ */
+class UAVTALK_EXPORT UAVTalkColumnFile {
+public:
+    struct Summary {
+        double min;
+        double max;
+        double mean;
+    };
+
+    static const quint32 CHUNK_ROWS = 4096;
+
+    UAVTalkColumnFile();
+    ~UAVTalkColumnFile();
+
+    static bool write(const QString &fileName, UAVObjectField::FieldType type, quint32 size,
+                      const char *data, quint32 rows);
+
+    bool open(const QString &fileName);
+    void close();
+
+    UAVObjectField::FieldType type() const
+    {
+        return m_type;
+    }
+    quint32 rows() const
+    {
+        return m_rows;
+    }
+    quint32 chunks() const
+    {
+        return m_chunks;
+    }
+    quint32 chunkRows() const
+    {
+        return m_chunkRows;
+    }
+    Summary summary(quint32 chunk) const;
+    double value(quint32 row) const;
+
+private:
+    static const quint32 MAGIC   = 0x434c504f; // "OPLC"
+    static const quint16 VERSION = 1;
+    static const int HEADER_LENGTH  = 24;
+    static const int SUMMARY_LENGTH = 3 * sizeof(double);
+
+    QFile m_file;
+    const uchar *m_map;
+    UAVObjectField::FieldType m_type;
+    quint32 m_size;
+    quint32 m_rows;
+    quint32 m_chunkRows;
+    quint32 m_chunks;
+};
+
+#endif // UAVTALKCOLUMNFILE_H
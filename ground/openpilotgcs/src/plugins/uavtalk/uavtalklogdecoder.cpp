@@ -0,0 +1,342 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavtalklogdecoder.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2015.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief The UAVTalk protocol plugin
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include "uavtalklogdecoder.h"
+#include <utils/crc.h>
+
+#include <QFile>
+#include <QtEndian>
+#include <QDebug>
+
+#include <string.h>
+
+using namespace Utils;
+
+UAVTalkLogDecoder::Columns::Columns(UAVObject *object, quint16 instId) :
+    m_object(object), m_objId(object->getObjID()), m_instId(instId), m_numBytes(object->getNumBytes())
+{
+    foreach(UAVObjectField * field, object->getFields()) {
+        quint32 elements = field->getNumElements();
+        quint32 size     = elements ? field->getNumBytes() / elements : 0;
+
+        for (quint32 n = 0; n < elements; ++n) {
+            Column column;
+            column.field   = field;
+            column.element = n;
+            column.offset  = field->getDataOffset() + n * size;
+            column.size    = size;
+            m_columns.append(column);
+        }
+    }
+}
+
+/**
+ * Append one update, each element is copied to the end of its column.
+ */
+void UAVTalkLogDecoder::Columns::append(quint32 timeStamp, const quint8 *data)
+{
+    m_timeStamps.append(timeStamp);
+    for (int n = 0; n < m_columns.size(); ++n) {
+        Column &column = m_columns[n];
+        column.data.append((const char *)&data[column.offset], column.size);
+    }
+}
+
+QString UAVTalkLogDecoder::Columns::columnName(int column) const
+{
+    const Column &c = m_columns.at(column);
+
+    if (c.field->getNumElements() == 1) {
+        return c.field->getName();
+    }
+    return QString("%1.%2").arg(c.field->getName()).arg(c.field->getElementNames().value(c.element));
+}
+
+/**
+ * Value of one element of an update, converted to double for plotting and statistics.
+ */
+double UAVTalkLogDecoder::Columns::value(int column, int row) const
+{
+    const Column &c = m_columns.at(column);
+
+    return toDouble(c.field->getType(), c.data.constData() + row * c.size);
+}
+
+/**
+ * Convert one packed field element to double.
+ */
+double UAVTalkLogDecoder::toDouble(UAVObjectField::FieldType type, const char *data)
+{
+    switch (type) {
+    case UAVObjectField::INT8:
+        return *(const qint8 *)data;
+
+    case UAVObjectField::INT16:
+        return qFromLittleEndian<qint16>((const uchar *)data);
+
+    case UAVObjectField::INT32:
+        return qFromLittleEndian<qint32>((const uchar *)data);
+
+    case UAVObjectField::UINT16:
+        return qFromLittleEndian<quint16>((const uchar *)data);
+
+    case UAVObjectField::UINT32:
+        return qFromLittleEndian<quint32>((const uchar *)data);
+
+    case UAVObjectField::FLOAT32:
+    {
+        quint32 bits = qFromLittleEndian<quint32>((const uchar *)data);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    default:
+        // UINT8, ENUM, BITFIELD and STRING are single bytes
+        return *(const quint8 *)data;
+    }
+}
+
+UAVTalkLogDecoder::UAVTalkLogDecoder(UAVObjectManager *objMngr) : m_objMngr(objMngr)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+UAVTalkLogDecoder::~UAVTalkLogDecoder()
+{
+    clear();
+}
+
+void UAVTalkLogDecoder::clear()
+{
+    qDeleteAll(m_objects);
+    m_objects.clear();
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/**
+ * Decode a whole log file. The file is mapped rather than read so the
+ * records are parsed straight from the page cache.
+ * \return false if the file could not be opened or mapped
+ */
+bool UAVTalkLogDecoder::decode(const QString &fileName)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "UAVTalkLogDecoder - unable to open" << fileName;
+        return false;
+    }
+    if (file.size() == 0) {
+        return true;
+    }
+    uchar *log = file.map(0, file.size());
+    if (log == NULL) {
+        qWarning() << "UAVTalkLogDecoder - unable to map" << fileName;
+        return false;
+    }
+    decode(log, file.size());
+    file.unmap(log);
+    return true;
+}
+
+/**
+ * Decode log records, each one is [timestamp (4)][size (8)][UAVTalk packets].
+ * Decoding stops at the first truncated record.
+ */
+void UAVTalkLogDecoder::decode(const uchar *log, qint64 size)
+{
+    qint64 pos = 0;
+
+    while (size - pos >= (qint64)(sizeof(quint32) + sizeof(qint64))) {
+        quint32 timeStamp;
+        qint64 dataSize;
+
+        memcpy(&timeStamp, &log[pos], sizeof(timeStamp));
+        memcpy(&dataSize, &log[pos + sizeof(timeStamp)], sizeof(dataSize));
+        pos += sizeof(timeStamp) + sizeof(dataSize);
+        if (dataSize < 0 || dataSize > size - pos) {
+            m_stats.errors++;
+            break;
+        }
+        decodeRecord(timeStamp, &log[pos], dataSize);
+        pos += dataSize;
+        m_stats.records++;
+    }
+    m_stats.bytes += pos;
+}
+
+void UAVTalkLogDecoder::decodeRecord(quint32 timeStamp, const quint8 *data, qint64 size)
+{
+    qint64 pos = 0;
+
+    while (size - pos >= BATCH_HEADER_LENGTH + CHECKSUM_LENGTH) {
+        const quint8 *packet = &data[pos];
+
+        if (packet[0] != SYNC_VAL || (packet[1] & TYPE_MASK) != TYPE_VER) {
+            // Resynchronise on the next byte
+            m_stats.errors++;
+            pos++;
+            continue;
+        }
+        quint8 type = packet[1];
+        qint32 headerLength = (type == TYPE_MULTI) ? BATCH_HEADER_LENGTH : HEADER_LENGTH;
+        qint32 packetSize   = qFromLittleEndian<quint16>(&packet[2]);
+        if (packetSize < headerLength || packetSize + CHECKSUM_LENGTH > size - pos) {
+            m_stats.errors++;
+            pos++;
+            continue;
+        }
+        if (!m_filter.isEmpty() && type != TYPE_MULTI &&
+            !m_filter.contains(qFromLittleEndian<quint32>(&packet[4]))) {
+            // Not ours, skip it without checking the CRC
+            pos += packetSize + CHECKSUM_LENGTH;
+            m_stats.filtered++;
+            continue;
+        }
+        if (Crc::updateCRC(0, packet, packetSize) != packet[packetSize]) {
+            m_stats.errors++;
+            pos++;
+            continue;
+        }
+        pos += packetSize + CHECKSUM_LENGTH;
+        m_stats.packets++;
+
+        const quint8 *payload = &packet[headerLength];
+        qint32 length = packetSize - headerLength;
+
+        switch (type) {
+        case TYPE_OBJ:
+        case TYPE_OBJ_ACK:
+            decodeObject(timeStamp, qFromLittleEndian<quint32>(&packet[4]), qFromLittleEndian<quint16>(&packet[8]), payload, length);
+            break;
+
+        case TYPE_OBJ_DELTA:
+            decodeDelta(timeStamp, qFromLittleEndian<quint32>(&packet[4]), qFromLittleEndian<quint16>(&packet[8]), payload, length);
+            break;
+
+        case TYPE_MULTI:
+        {
+            // The multi object header has no object or instance id, each entry has its own
+            qint32 entry = 0;
+            while (entry < length) {
+                quint8 flags = payload[entry];
+                qint32 entryLength = BATCH_ENTRY_LENGTH + ((flags & BATCH_INSTANCE) ? 2 : 0);
+                qint32 dataLength  = flags & BATCH_LENGTH_MASK;
+                if (entry + entryLength + dataLength > length) {
+                    m_stats.errors++;
+                    break;
+                }
+                quint32 objId  = qFromLittleEndian<quint32>(&payload[entry + 1]);
+                quint16 instId = (flags & BATCH_INSTANCE) ? qFromLittleEndian<quint16>(&payload[entry + BATCH_ENTRY_LENGTH]) : 0;
+                if (m_filter.isEmpty() || m_filter.contains(objId)) {
+                    decodeObject(timeStamp, objId, instId, &payload[entry + entryLength], dataLength);
+                }
+                entry += entryLength + dataLength;
+            }
+            break;
+        }
+
+        default:
+            // Requests, acks and nacks carry no data
+            break;
+        }
+    }
+}
+
+void UAVTalkLogDecoder::decodeObject(quint32 timeStamp, quint32 objId, quint16 instId, const quint8 *data, qint32 length)
+{
+    Columns *object = columns(objId, instId);
+
+    if (object == NULL) {
+        return;
+    }
+    if ((quint32)length != object->m_numBytes) {
+        m_stats.errors++;
+        return;
+    }
+    object->append(timeStamp, data);
+    object->m_image = QByteArray((const char *)data, length);
+}
+
+/**
+ * Apply a delta packet to the last image of the instance, see UAVTalk::receiveDelta().
+ * Deltas following a missed update are dropped until the next full object.
+ */
+void UAVTalkLogDecoder::decodeDelta(quint32 timeStamp, quint32 objId, quint16 instId, const quint8 *data, qint32 length)
+{
+    Columns *object = columns(objId, instId);
+
+    if (object == NULL) {
+        return;
+    }
+    qint32 objLength  = object->m_numBytes;
+    qint32 maskLength = (objLength + 8 * DELTA_BLOCK - 1) / (8 * DELTA_BLOCK);
+    if (length < 1 + maskLength || object->m_image.size() != objLength ||
+        Crc::updateCRC(0, (const quint8 *)object->m_image.constData(), objLength) != data[0]) {
+        m_stats.errors++;
+        return;
+    }
+
+    const quint8 *mask = &data[1];
+    quint8 *bytes = (quint8 *)object->m_image.data();
+    qint32 pos    = 1 + maskLength;
+    for (qint32 offset = 0; offset < objLength; offset += DELTA_BLOCK) {
+        qint32 block = offset / DELTA_BLOCK;
+        if (mask[block / 8] & (1 << (block % 8))) {
+            qint32 blockLength = qMin(DELTA_BLOCK, objLength - offset);
+            if (pos + blockLength > length) {
+                m_stats.errors++;
+                return;
+            }
+            memcpy(&bytes[offset], &data[pos], blockLength);
+            pos += blockLength;
+        }
+    }
+    object->append(timeStamp, bytes);
+}
+
+/**
+ * Columns of an instance, created on its first update. Only the object type has to be
+ * known, instances are not registered with the object manager.
+ */
+UAVTalkLogDecoder::Columns *UAVTalkLogDecoder::columns(quint32 objId, quint16 instId)
+{
+    quint64 key = ((quint64)objId << 16) | instId;
+    QHash<quint64, Columns *>::const_iterator it = m_objects.constFind(key);
+
+    if (it != m_objects.constEnd()) {
+        return it.value();
+    }
+    UAVObject *typeObj = m_objMngr->getObject(objId);
+    if (typeObj == NULL) {
+        m_stats.unknownObjects++;
+        return NULL;
+    }
+    Columns *object = new Columns(typeObj, instId);
+    m_objects.insert(key, object);
+    return object;
+}
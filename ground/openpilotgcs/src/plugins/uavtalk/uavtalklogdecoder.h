@@ -0,0 +1,171 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavtalklogdecoder.h
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2015.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief The UAVTalk protocol plugin
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef UAVTALKLOGDECODER_H
+#define UAVTALKLOGDECODER_H
+
+#include "uavobjectmanager.h"
+#include "uavobjectfield.h"
+#include "uavtalk_global.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QVector>
+
+/**
+ * Decodes a .opl log as fast as it can be read, without a replay timer,
+ * telemetry or object signals. The log is mapped and parsed in place, the
+ * updates of every object instance are stored one column per field
+ * element, each one in the element's own type.
+ */
+class UAVTALK_EXPORT UAVTalkLogDecoder {
+public:
+    class UAVTALK_EXPORT Columns {
+public:
+        struct Column {
+            UAVObjectField *field;
+            quint32 element;
+            quint32 offset;
+            quint32 size;
+            QByteArray data;
+        };
+
+        UAVObject *object() const
+        {
+            return m_object;
+        }
+        quint32 objId() const
+        {
+            return m_objId;
+        }
+        quint16 instId() const
+        {
+            return m_instId;
+        }
+        int rows() const
+        {
+            return m_timeStamps.size();
+        }
+        int columnCount() const
+        {
+            return m_columns.size();
+        }
+        const QVector<quint32> &timeStamps() const
+        {
+            return m_timeStamps;
+        }
+        const Column &column(int column) const
+        {
+            return m_columns.at(column);
+        }
+
+        QString columnName(int column) const;
+        double value(int column, int row) const;
+
+private:
+        friend class UAVTalkLogDecoder;
+
+        Columns(UAVObject *object, quint16 instId);
+        void append(quint32 timeStamp, const quint8 *data);
+
+        UAVObject *m_object;
+        quint32 m_objId;
+        quint16 m_instId;
+        quint32 m_numBytes;
+        QVector<quint32> m_timeStamps;
+        QVector<Column> m_columns;
+        // Image of the last update, delta packets apply to it
+        QByteArray m_image;
+    };
+
+    struct Stats {
+        qint64  bytes;
+        quint32 records;
+        quint32 packets;
+        quint32 filtered;
+        quint32 unknownObjects;
+        quint32 errors;
+    };
+
+    explicit UAVTalkLogDecoder(UAVObjectManager *objMngr);
+    ~UAVTalkLogDecoder();
+
+    bool decode(const QString &fileName);
+    void decode(const uchar *log, qint64 size);
+    void clear();
+
+    // Decode only the given objects, all of them when empty
+    void setObjectFilter(const QSet<quint32> &objIds)
+    {
+        m_filter = objIds;
+    }
+
+    static double toDouble(UAVObjectField::FieldType type, const char *data);
+
+    QList<Columns *> objects() const
+    {
+        return m_objects.values();
+    }
+    Columns *object(quint32 objId, quint16 instId) const
+    {
+        return m_objects.value(((quint64)objId << 16) | instId);
+    }
+    Stats stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    // Same framing as UAVTalk, see uavtalk.h
+    static const quint8 SYNC_VAL       = 0x3C;
+    static const quint8 TYPE_MASK      = 0xF8;
+    static const quint8 TYPE_VER       = 0x20;
+    static const quint8 TYPE_OBJ       = (TYPE_VER | 0x00);
+    static const quint8 TYPE_OBJ_ACK   = (TYPE_VER | 0x02);
+    static const quint8 TYPE_MULTI     = (TYPE_VER | 0x05);
+    static const quint8 TYPE_OBJ_DELTA = (TYPE_VER | 0x06);
+    static const int HEADER_LENGTH       = 10;
+    static const int BATCH_HEADER_LENGTH = 4;
+    static const int BATCH_ENTRY_LENGTH  = 5;
+    static const int BATCH_INSTANCE      = 0x80;
+    static const int BATCH_LENGTH_MASK   = 0x7F;
+    static const int DELTA_BLOCK         = 4;
+    static const int CHECKSUM_LENGTH     = 1;
+
+    UAVObjectManager *m_objMngr;
+    QHash<quint64, Columns *> m_objects;
+    QSet<quint32> m_filter;
+    Stats m_stats;
+
+    void decodeRecord(quint32 timeStamp, const quint8 *data, qint64 size);
+    void decodeObject(quint32 timeStamp, quint32 objId, quint16 instId, const quint8 *data, qint32 length);
+    void decodeDelta(quint32 timeStamp, quint32 objId, quint16 instId, const quint8 *data, qint32 length);
+    Columns *columns(quint32 objId, quint16 instId);
+};
+
+#endif // UAVTALKLOGDECODER_H
@@ -0,0 +1,210 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavtalklogexporter.cpp
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2015.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief The UAVTalk protocol plugin
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include "uavtalklogexporter.h"
+#include "uavtalklogdecoder.h"
+#include "uavtalkcolumnfile.h"
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMultiMap>
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
+#include <QVector>
+#include <QtEndian>
+#include <QDebug>
+
+#include <string.h>
+
+namespace {
+/**
+ * Decodes and writes the objects of one worker.
+ */
+class ExportTask : public QRunnable {
+public:
+    ExportTask(UAVObjectManager *objMngr, const uchar *log, qint64 size, const QSet<quint32> &objIds,
+               const QString &directory, QAtomicInt *failed) :
+        m_objMngr(objMngr), m_log(log), m_size(size), m_objIds(objIds), m_directory(directory), m_failed(failed)
+    {}
+
+    void run()
+    {
+        UAVTalkLogDecoder decoder(m_objMngr);
+
+        decoder.setObjectFilter(m_objIds);
+        decoder.decode(m_log, m_size);
+
+        foreach(UAVTalkLogDecoder::Columns * object, decoder.objects()) {
+            QString objName = object->object()->getName();
+
+            if (!QDir().mkpath(QFileInfo(UAVTalkLogExporter::columnFileName(m_directory, objName, object->instId(), "timestamp")).path())) {
+                m_failed->ref();
+                return;
+            }
+            bool success = UAVTalkColumnFile::write(UAVTalkLogExporter::columnFileName(m_directory, objName, object->instId(), "timestamp"),
+                                                    UAVObjectField::UINT32, sizeof(quint32),
+                                                    (const char *)object->timeStamps().constData(), object->rows());
+            for (int n = 0; success && n < object->columnCount(); ++n) {
+                const UAVTalkLogDecoder::Columns::Column &column = object->column(n);
+                success = UAVTalkColumnFile::write(UAVTalkLogExporter::columnFileName(m_directory, objName, object->instId(), object->columnName(n)),
+                                                   column.field->getType(), column.size, column.data.constData(), object->rows());
+            }
+            if (!success) {
+                m_failed->ref();
+                return;
+            }
+        }
+    }
+
+private:
+    UAVObjectManager *m_objMngr;
+    const uchar *m_log;
+    qint64 m_size;
+    QSet<quint32> m_objIds;
+    QString m_directory;
+    QAtomicInt *m_failed;
+};
+}
+
+UAVTalkLogExporter::UAVTalkLogExporter(UAVObjectManager *objMngr) : m_objMngr(objMngr)
+{}
+
+QString UAVTalkLogExporter::columnFileName(const QString &directory, const QString &objName, quint16 instId,
+                                           const QString &columnName)
+{
+    return QString("%1/%2/%3/%4.col").arg(directory).arg(objName).arg(instId).arg(columnName);
+}
+
+/**
+ * Export a log, objects are balanced between the threads by the number of bytes
+ * they take in the log.
+ * \return false if the log could not be mapped or a column could not be written,
+ * see errorString()
+ */
+bool UAVTalkLogExporter::exportLog(const QString &logFileName, const QString &directory, int threads)
+{
+    QFile file(logFileName);
+
+    m_error.clear();
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_error = QString("Unable to open %1").arg(logFileName);
+        return false;
+    }
+    if (file.size() == 0) {
+        return true;
+    }
+    uchar *log = file.map(0, file.size());
+    if (log == NULL) {
+        m_error = QString("Unable to map %1").arg(logFileName);
+        return false;
+    }
+
+    // Heaviest objects first, each one to the least loaded thread
+    QHash<quint32, qint64> objBytes = scanObjects(log, file.size());
+    QMultiMap<qint64, quint32> byBytes;
+    for (QHash<quint32, qint64>::const_iterator it = objBytes.constBegin(); it != objBytes.constEnd(); ++it) {
+        byBytes.insert(it.value(), it.key());
+    }
+    if (objBytes.isEmpty()) {
+        // An empty filter would decode everything
+        file.unmap(log);
+        return true;
+    }
+    threads = qMax(1, qMin(threads, objBytes.size()));
+    QVector<QSet<quint32> > objIds(threads);
+    QVector<qint64> load(threads, 0);
+    for (QMultiMap<qint64, quint32>::const_iterator it = byBytes.constEnd(); it != byBytes.constBegin();) {
+        --it;
+        int least = 0;
+        for (int n = 1; n < threads; ++n) {
+            if (load[n] < load[least]) {
+                least = n;
+            }
+        }
+        objIds[least].insert(it.value());
+        load[least] += it.key();
+    }
+
+    QThreadPool pool;
+    QAtomicInt failed(0);
+    pool.setMaxThreadCount(threads);
+    for (int n = 0; n < threads; ++n) {
+        pool.start(new ExportTask(m_objMngr, log, file.size(), objIds[n], directory, &failed));
+    }
+    pool.waitForDone();
+    file.unmap(log);
+
+    if (failed.load() != 0) {
+        m_error = QString("Unable to write the columns to %1").arg(directory);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Bytes taken by each object in the log, from the packet headers only.
+ * Multi object packets are walked so that objects only sent in them get a worker too.
+ */
+QHash<quint32, qint64> UAVTalkLogExporter::scanObjects(const uchar *log, qint64 size)
+{
+    QHash<quint32, qint64> objBytes;
+    qint64 pos = 0;
+
+    while (size - pos >= (qint64)(sizeof(quint32) + sizeof(qint64))) {
+        qint64 dataSize;
+        memcpy(&dataSize, &log[pos + sizeof(quint32)], sizeof(dataSize));
+        pos += sizeof(quint32) + sizeof(qint64);
+        if (dataSize < 0 || dataSize > size - pos) {
+            break;
+        }
+        const uchar *data = &log[pos];
+        qint64 packet     = 0;
+        while (dataSize - packet >= 4 && data[packet] == 0x3C) {
+            qint32 packetSize = qFromLittleEndian<quint16>(&data[packet + 2]);
+            if (packetSize < 4 || packet + packetSize > dataSize) {
+                break;
+            }
+            if (data[packet + 1] == 0x25) {
+                // Multi object: [flags][objId (4)][instId (2) if flags & 0x80][data]
+                qint32 entry = 4;
+                while (entry + 5 <= packetSize) {
+                    quint8 flags  = data[packet + entry];
+                    qint32 length = 5 + ((flags & 0x80) ? 2 : 0) + (flags & 0x7F);
+                    objBytes[qFromLittleEndian<quint32>(&data[packet + entry + 1])] += length;
+                    entry += length;
+                }
+            } else if (packetSize >= 10) {
+                objBytes[qFromLittleEndian<quint32>(&data[packet + 4])] += packetSize;
+            }
+            packet += packetSize + 1;
+        }
+        pos += dataSize;
+    }
+    return objBytes;
+}
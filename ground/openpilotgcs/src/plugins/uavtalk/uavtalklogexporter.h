@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavtalklogexporter.h
+ * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2015.
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief The UAVTalk protocol plugin
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef UAVTALKLOGEXPORTER_H
+#define UAVTALKLOGEXPORTER_H
+
+#include "uavobjectmanager.h"
+#include "uavtalk_global.h"
+
+#include <QHash>
+#include <QString>
+#include <QThread>
+
+/**
+ * Converts a .opl log to a column store, one UAVTalkColumnFile per field element:
+ * <directory>/<object>/<instance>/<field>[.<element>].col, next to the update
+ * times in timestamp.col. Objects are shared out between worker threads, each
+ * one decoding the mapped log for its own objects only.
+ */
+class UAVTALK_EXPORT UAVTalkLogExporter {
+public:
+    explicit UAVTalkLogExporter(UAVObjectManager *objMngr);
+
+    bool exportLog(const QString &logFileName, const QString &directory,
+                   int threads = QThread::idealThreadCount());
+
+    QString errorString() const
+    {
+        return m_error;
+    }
+
+    static QString columnFileName(const QString &directory, const QString &objName, quint16 instId,
+                                  const QString &columnName);
+
+private:
+    UAVObjectManager *m_objMngr;
+    QString m_error;
+
+    static QHash<quint32, qint64> scanObjects(const uchar *log, qint64 size);
+};
+
+#endif // UAVTALKLOGEXPORTER_H
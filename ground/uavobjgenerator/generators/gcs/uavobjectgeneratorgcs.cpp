@@ -136,8 +136,9 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo *info)
             propertiesImpl  +=
                 QString("%1 %2::get%3(quint32 index) const\n"
                         "{\n"
-                        "   QMutexLocker locker(mutex);\n"
-                        "   return data.%3[index];\n"
+                        "   %1 value;\n"
+                        "   readData((quint8 *)&value, offsetof(DataFields, %3) + index * sizeof(value), sizeof(value));\n"
+                        "   return value;\n"
                         "}\n")
                 .arg(type).arg(info->name).arg(field->name);
             propertySetters +=
@@ -148,7 +149,9 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo *info)
                         "{\n"
                         "   mutex->lock();\n"
                         "   bool changed = data.%2[index] != value;\n"
+                        "   beginWrite();\n"
                         "   data.%2[index] = value;\n"
+                        "   endWrite();\n"
                         "   mutex->unlock();\n"
                         "   if (changed) emit %2Changed(index,value);\n"
                         "}\n\n")
@@ -167,8 +170,9 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo *info)
                 propertiesImpl  +=
                     QString("%1 %2::get%3_%4() const\n"
                             "{\n"
-                            "   QMutexLocker locker(mutex);\n"
-                            "   return data.%3[%5];\n"
+                            "   %1 value;\n"
+                            "   readData((quint8 *)&value, offsetof(DataFields, %3) + %5 * sizeof(value), sizeof(value));\n"
+                            "   return value;\n"
                             "}\n")
                     .arg(type).arg(info->name).arg(field->name).arg(elementName).arg(elementIndex);
                 propertySetters +=
@@ -179,7 +183,9 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo *info)
                             "{\n"
                             "   mutex->lock();\n"
                             "   bool changed = data.%2[%5] != value;\n"
+                            "   beginWrite();\n"
                             "   data.%2[%5] = value;\n"
+                            "   endWrite();\n"
                             "   mutex->unlock();\n"
                             "   if (changed) emit %2_%3Changed(value);\n"
                             "}\n\n")
@@ -201,8 +207,9 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo *info)
             propertiesImpl  +=
                 QString("%1 %2::get%3() const\n"
                         "{\n"
-                        "   QMutexLocker locker(mutex);\n"
-                        "   return data.%3;\n"
+                        "   %1 value;\n"
+                        "   readData((quint8 *)&value, offsetof(DataFields, %3), sizeof(value));\n"
+                        "   return value;\n"
                         "}\n")
                 .arg(type).arg(info->name).arg(field->name);
             propertySetters +=
@@ -213,7 +220,9 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo *info)
                         "{\n"
                         "   mutex->lock();\n"
                         "   bool changed = data.%2 != value;\n"
+                        "   beginWrite();\n"
                         "   data.%2 = value;\n"
+                        "   endWrite();\n"
                         "   mutex->unlock();\n"
                         "   if (changed) emit %2Changed(value);\n"
                         "}\n\n")